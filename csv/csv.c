@@ -1,7 +1,13 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
 #include "csv.h"
 #include "util.h"
+#include "error.h"
+#include "samples.h"
 
 void print_format(
     const char *filename,
@@ -30,3 +36,400 @@ void print_format(
   printf(",%d", frame_error);
   putchar('\n');
 }
+
+/*!
+ * @brief print_format() with a formatted value
+ */
+static void print_row(
+    const char *filename,
+    int year,
+    uint64_t msec_of_year,
+    int apollo_station,
+    const char *data_type,
+    int frame_count,
+    const char *value,
+    uint32_t process_flag,
+    uint32_t record_error,
+    uint32_t frame_error)
+{
+  uint32_t doy, hh, mm, ss, ms;
+  msec_of_year_to_date(msec_of_year, &doy, &hh, &mm, &ss, &ms);
+  printf("%s", filename);
+  printf(",%d", apollo_station);
+  printf(",%s", data_type);
+  printf(",%d", frame_count);
+  printf(",%d", year);
+  printf(",%d", doy);
+  printf(",%02d:%02d:%02d.%03d", hh, mm, ss, ms);
+  printf(",%s", value);
+  printf(",%d", process_flag);
+  printf(",%d", record_error);
+  printf(",%d", frame_error);
+  putchar('\n');
+}
+
+/*!
+ * @brief print_format() of a filtered value
+ */
+void print_format_real(
+    const char *filename,
+    int year,
+    uint64_t msec_of_year,
+    int apollo_station,
+    const char *data_type,
+    int frame_count,
+    double value,
+    uint32_t process_flag,
+    uint32_t record_error,
+    uint32_t frame_error)
+{
+  char str[64];
+
+  snprintf(str, sizeof(str), "%.3f", value);
+  print_row(filename, year, msec_of_year, apollo_station, data_type, frame_count,
+            str, process_flag, record_error, frame_error);
+}
+
+/*!
+ * @brief print_format() of a value in physical units (all digits of a float)
+ */
+void print_format_float(
+    const char *filename,
+    int year,
+    uint64_t msec_of_year,
+    int apollo_station,
+    const char *data_type,
+    int frame_count,
+    float value,
+    uint32_t process_flag,
+    uint32_t record_error,
+    uint32_t frame_error)
+{
+  char str[64];
+
+  snprintf(str, sizeof(str), "%.9g", value);
+  print_row(filename, year, msec_of_year, apollo_station, data_type, frame_count,
+            str, process_flag, record_error, frame_error);
+}
+
+int csv_parse_band(const char *arg, double *lo, double *hi)
+{
+  char *end;
+
+  *lo = 0.0;
+  *hi = 0.0;
+  if (*arg != ',')
+  {
+    *lo = strtod(arg, &end);
+    if (end == arg || *end != ',')
+    {
+      return -1;
+    }
+    arg = end;
+  }
+  arg++;
+  if (*arg != '\0')
+  {
+    *hi = strtod(arg, &end);
+    if (end == arg || *end != '\0')
+    {
+      return -1;
+    }
+  }
+  return (*lo > 0.0 || *hi > 0.0) ? 0 : -1;
+}
+
+/*!
+ * @brief set up the filters of a channel
+ *
+ * @param[in] rate sample rate [Hz]
+ * @param[in] factor decimation factor (1 for none)
+ * @param[in] lo, hi bandpass corners [Hz] (none if both <= 0); a lowpass
+ *            corner at or above the Nyquist frequency of the channel is
+ *            left out, so one band serves channels of all rates
+ * @param[in] max_input samples of a frame
+ * @return 0 on success, -1 for bad parameters or no memory
+ */
+int csv_filter_init(csv_filter *cf, double rate, int factor, double lo, double hi, int max_input)
+{
+  int max = max_input + FIR_HALF_TAPS + 2;
+
+  memset(cf, 0, sizeof(csv_filter));
+  if (hi >= rate / 2.0)
+  {
+    hi = 0.0;
+  }
+  cf->factor = factor;
+  cf->dt = 1000.0 / rate;
+  cf->rate = rate;
+  cf->running = 0;
+  cf->max_input = max_input;
+  cf->n = 0;
+  cf->x = (float *)malloc(max_input * sizeof(float));
+  cf->out_year = (int *)malloc(max * sizeof(int));
+  cf->out_msec = (uint64_t *)malloc(max * sizeof(uint64_t));
+  cf->out_value = (float *)malloc(max * sizeof(float));
+  cf->max_output = max;
+  if (filter_chain_init(&cf->chain, rate, factor, lo, hi) != 0 || cf->x == NULL ||
+      cf->out_year == NULL || cf->out_msec == NULL || cf->out_value == NULL)
+  {
+    csv_filter_free(cf);
+    return -1;
+  }
+  return 0;
+}
+
+/*!
+ * @brief remove the response of the channel before the filters
+ *
+ * The samples of a frame are deconvolved with the definition of the
+ * station and channel at the time of the frame; frames without one are
+ * left out (with a warning), and a change of definition ends the run.
+ *
+ * @param[in] cache transfer functions shared by the channels
+ * @param[in] channel SAMPLES_* channel
+ */
+void csv_filter_response(csv_filter *cf, resp_cache *cache, int apollo_station, int channel)
+{
+  cf->cache = cache;
+  cf->apollo_station = apollo_station;
+  cf->channel = channel;
+}
+
+/*!
+ * @brief times of the m outputs from out_value[cf->n]
+ *
+ * Output k of a run is centred on input k * factor, timed from the
+ * latest frame.
+ */
+static void emit(csv_filter *cf, int m)
+{
+  double t;
+  int j;
+
+  for (j = cf->n; j < cf->n + m; j++, cf->nout++)
+  {
+    t = cf->msec + (cf->nout * cf->factor - cf->start) * cf->dt;
+    cf->out_year[j] = cf->year;
+    cf->out_msec[j] = (t > 0.0) ? (uint64_t)llround(t) : 0;
+  }
+  cf->n += m;
+}
+
+static void end_run(csv_filter *cf)
+{
+  int m;
+
+  if (cf->transfer != NULL)
+  {
+    m = resp_calib_flush(&cf->calib, cf->y);
+    emit(cf, filter_chain_process(&cf->chain, cf->y, m, &cf->out_value[cf->n]));
+  }
+  emit(cf, filter_chain_flush(&cf->chain, &cf->out_value[cf->n]));
+  cf->running = 0;
+}
+
+/*!
+ * @brief deconvolve with the transfer function of a definition from the next run
+ *
+ * @return 0 on success, -1 for an invalid prefilter or no memory
+ */
+static int use_transfer(csv_filter *cf, const resp_def *d)
+{
+  const resp_transfer *t = resp_cache_get(cf->cache, d, cf->rate);
+  int max, *year;
+  uint64_t *msec;
+  float *value, *y;
+
+  if (t == NULL)
+  {
+    return -1;
+  }
+  if (cf->transfer == NULL || cf->transfer->nfft != t->nfft)
+  {
+    resp_calib_free(&cf->calib);
+    if (resp_calib_init(&cf->calib, t) != 0)
+    {
+      cf->transfer = NULL;
+      return -1;
+    }
+
+    // the flush of a run and the blocks completed by the next frame
+    max = 2 * (resp_calib_max_output(&cf->calib, cf->max_input) + FIR_HALF_TAPS + 2);
+    year = (int *)realloc(cf->out_year, max * sizeof(int));
+    cf->out_year = (year != NULL) ? year : cf->out_year;
+    msec = (uint64_t *)realloc(cf->out_msec, max * sizeof(uint64_t));
+    cf->out_msec = (msec != NULL) ? msec : cf->out_msec;
+    value = (float *)realloc(cf->out_value, max * sizeof(float));
+    cf->out_value = (value != NULL) ? value : cf->out_value;
+    y = (float *)realloc(cf->y, max * sizeof(float));
+    cf->y = (y != NULL) ? y : cf->y;
+    if (year == NULL || msec == NULL || value == NULL || y == NULL)
+    {
+      resp_calib_free(&cf->calib);
+      cf->transfer = NULL;
+      return -1;
+    }
+    cf->max_output = max;
+  }
+  cf->calib.t = t;
+  cf->transfer = t;
+  return 0;
+}
+
+/*!
+ * @brief check the response of a frame, ending the run at a change
+ *
+ * @return 0 to filter the frame, -1 to leave it out
+ */
+static int check_response(csv_filter *cf, int year, uint64_t msec_of_year)
+{
+  const resp_def *d = resp_find(cf->cache->table, cf->apollo_station, cf->channel,
+                                msec_of_year_to_epoch(year, msec_of_year));
+
+  if (d != NULL && cf->transfer != NULL && d == cf->transfer->def)
+  {
+    return 0;
+  }
+  if (cf->running)
+  {
+    end_run(cf);
+  }
+  if (d == NULL || use_transfer(cf, d) != 0)
+  {
+    if (!cf->warned)
+    {
+      log_printf(LOG_WARNING, __FILE__, __LINE__,
+                 "no response of %s of station %d at %d %" PRIu64 ", frames left out",
+                 samples_channel_name(cf->channel), cf->apollo_station, year, msec_of_year);
+      cf->warned = 1;
+    }
+    cf->transfer = NULL;
+    return -1;
+  }
+  return 0;
+}
+
+/*!
+ * @brief filter the samples of a frame
+ *
+ * A frame with an error or not following the previous one within a
+ * frame ends the run (with its remaining outputs) and the next good
+ * frame starts a new one.
+ *
+ * @param[in] msec_of_year time of x[0]
+ * @param[in] x n samples (at most max_input)
+ * @return number of outputs in out_year, out_msec and out_value
+ */
+int csv_filter_add(csv_filter *cf, int year, uint64_t msec_of_year,
+                   const int32_t *x, int n, uint32_t error_flag)
+{
+  double expected;
+  int k, m;
+
+  cf->n = 0;
+  if (error_flag & SAMPLES_ERROR_MASK)
+  {
+    if (cf->running)
+    {
+      end_run(cf);
+    }
+    return cf->n;
+  }
+  if (cf->cache != NULL && check_response(cf, year, msec_of_year) != 0)
+  {
+    return cf->n;
+  }
+  expected = cf->msec + (cf->nin - cf->start) * cf->dt;
+  if (cf->running && (year != cf->year || fabs(msec_of_year - expected) > n * cf->dt))
+  {
+    end_run(cf);
+  }
+  if (!cf->running)
+  {
+    cf->running = 1;
+    cf->year = year;
+    cf->nin = 0;
+    cf->nout = 0;
+  }
+  cf->msec = msec_of_year;
+  cf->start = cf->nin;
+  for (k = 0; k < n && k < cf->max_input; k++)
+  {
+    cf->x[k] = x[k];
+  }
+  if (cf->transfer != NULL)
+  {
+    m = resp_calib_process(&cf->calib, cf->x, k, cf->y);
+    emit(cf, filter_chain_process(&cf->chain, cf->y, m, &cf->out_value[cf->n]));
+  }
+  else
+  {
+    emit(cf, filter_chain_process(&cf->chain, cf->x, k, &cf->out_value[cf->n]));
+  }
+  cf->nin += k;
+  return cf->n;
+}
+
+/*!
+ * @brief end the run at the end of the input
+ *
+ * @return number of outputs in out_year, out_msec and out_value
+ */
+int csv_filter_flush(csv_filter *cf)
+{
+  cf->n = 0;
+  if (cf->running)
+  {
+    end_run(cf);
+  }
+  return cf->n;
+}
+
+void csv_filter_free(csv_filter *cf)
+{
+  filter_chain_free(&cf->chain);
+  resp_calib_free(&cf->calib);
+  free(cf->x);
+  free(cf->out_year);
+  free(cf->out_msec);
+  free(cf->out_value);
+  free(cf->y);
+  cf->x = NULL;
+  cf->out_year = NULL;
+  cf->out_msec = NULL;
+  cf->out_value = NULL;
+  cf->y = NULL;
+  cf->transfer = NULL;
+}
+
+/*!
+ * @brief read a response file and set up the cache of its transfer functions
+ *
+ * @param[in] unit output quantity (NULL for displacement)
+ * @param[in] prefilter "f1,f2,f3,f4" [Hz] (NULL for the defaults of each rate)
+ * @return 0 on success, -1 for a bad file or option
+ */
+int csv_response_init(resp_table *t, resp_cache *c, const char *filename,
+                      const char *unit, const char *prefilter)
+{
+  double f[4];
+  int output = RESP_DISPLACEMENT;
+
+  if (unit != NULL && (output = resp_quantity(unit)) < 0)
+  {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "invalid unit: %s", unit);
+    return -1;
+  }
+  if (prefilter != NULL && resp_parse_prefilter(prefilter, f) != 0)
+  {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "invalid prefilter: %s", prefilter);
+    return -1;
+  }
+  if (resp_read(filename, t) != 0)
+  {
+    return -1;
+  }
+  resp_cache_init(c, t, output, (prefilter != NULL) ? f : NULL, RESP_WATER_LEVEL);
+  return 0;
+}
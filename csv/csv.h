@@ -1,6 +1,44 @@
 #ifndef __CSV_H__
 #define __CSV_H__
 #include <stdint.h>
+#include "filter.h"
+#include "response.h"
+
+//! filters of one channel of a station, fed a frame at a time
+typedef struct tag_csv_filter {
+  filter_chain chain;
+  int factor;
+
+  //! sample interval [msec]
+  double dt;
+
+  //! year, first frame time and inputs of the run
+  int running;
+  int year;
+  double msec;
+  int64_t start;
+  int64_t nin;
+  int64_t nout;
+
+  //! inputs of a frame and the outputs completed by it
+  float *x;
+  int max_input;
+  int n;
+  int *out_year;
+  uint64_t *out_msec;
+  float *out_value;
+  int max_output;
+
+  //! response removal before the filters (cache NULL for counts)
+  resp_cache *cache;
+  int apollo_station;
+  int channel;
+  double rate;
+  const resp_transfer *transfer;
+  resp_calib calib;
+  float *y;
+  int warned;
+} csv_filter;
 
 void print_format(
     const char *filename,
@@ -13,4 +51,38 @@ void print_format(
     uint32_t process_flag,
     uint32_t record_error,
     uint32_t frame_error);
+
+void print_format_real(
+    const char *filename,
+    int year,
+    uint64_t msec_of_year,
+    int apollo_station,
+    const char *data_type,
+    int frame_count,
+    double value,
+    uint32_t process_flag,
+    uint32_t record_error,
+    uint32_t frame_error);
+
+void print_format_float(
+    const char *filename,
+    int year,
+    uint64_t msec_of_year,
+    int apollo_station,
+    const char *data_type,
+    int frame_count,
+    float value,
+    uint32_t process_flag,
+    uint32_t record_error,
+    uint32_t frame_error);
+
+int csv_parse_band(const char *arg, double *lo, double *hi);
+int csv_filter_init(csv_filter *cf, double rate, int factor, double lo, double hi, int max_input);
+int csv_response_init(resp_table *t, resp_cache *c, const char *filename,
+                      const char *unit, const char *prefilter);
+void csv_filter_response(csv_filter *cf, resp_cache *cache, int apollo_station, int channel);
+int csv_filter_add(csv_filter *cf, int year, uint64_t msec_of_year,
+                   const int32_t *x, int n, uint32_t error_flag);
+int csv_filter_flush(csv_filter *cf);
+void csv_filter_free(csv_filter *cf);
 #endif
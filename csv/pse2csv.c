@@ -12,37 +12,99 @@
 #include <unistd.h>
 #include <inttypes.h>
 #include <libgen.h>
+#include <getopt.h>
 
 #include "define.h"
 #include "pse.h"
 #include "error.h"
 #include "util.h"
+#include "timebase.h"
+#include "samples.h"
 #include "csv.h"
+#include "despike.h"
+
+#define NUM_FILTER 4
+
+//! filters of spz, lpx, lpy and lpz (NULL without --decimate, --bandpass or --response)
+static csv_filter *filters = NULL;
+static const char *filter_types[NUM_FILTER] = {"spz", "lpx", "lpy", "lpz"};
+static const int filter_channels[NUM_FILTER] = {SAMPLES_SP_Z, SAMPLES_LP_X, SAMPLES_LP_Y, SAMPLES_LP_Z};
+
+//! responses of --response and their transfer functions
+static resp_table responses;
+static resp_cache cache;
+
+//! offsets of the samples of spz and lp* in a frame
+static timebase tb_sp, tb_lp;
 
 void usage(const char *cmd)
 {
-  fprintf(stderr, "usage: %s psefile\n", cmd);
+  fprintf(stderr, "usage: %s [-s] [-r file [-u unit] [-p f1,f2,f3,f4]] [-d factor] [-b lo,hi] psefile\n", cmd);
+  fprintf(stderr, "  -s, --despike          replace spikes of spz, lpx, lpy and lpz by the running median\n");
+  fprintf(stderr, "  -d, --decimate=factor  lowpass and keep every factor-th sample of spz, lpx, lpy and lpz\n");
+  fprintf(stderr, "  -b, --bandpass=lo,hi   Butterworth bandpass of them [Hz] (either corner may be empty)\n");
+  fprintf(stderr, "  -r, --response=file    remove the instrument responses of the file (see response.c)\n");
+  fprintf(stderr, "  -u, --unit=unit        disp, vel or acc of the ground [m, m/s, m/s^2] (default disp)\n");
+  fprintf(stderr, "  -p, --prefilter=f1,f2,f3,f4  cosine taper of the deconvolution [Hz]\n");
+}
+
+/*!
+ * @brief print the outputs of a filter
+ */
+void pse_csv_print(const char *filename, pse_record pr, pse_frame pf, int c, int n)
+{
+  csv_filter *cf = &filters[c];
+  int j;
+
+  for (j = 0; j < n; j++)
+  {
+    if (cf->cache != NULL)
+    {
+      print_format_float(filename, cf->out_year[j], cf->out_msec[j], pr.apollo_station, filter_types[c],
+                         pf.frame_count, cf->out_value[j], pf.process_flag, pr.error_flag, pf.error_flag);
+    }
+    else
+    {
+      print_format_real(filename, cf->out_year[j], cf->out_msec[j], pr.apollo_station, filter_types[c],
+                        pf.frame_count, cf->out_value[j], pf.process_flag, pr.error_flag, pf.error_flag);
+    }
+  }
+}
+
+void pse_csv_filter(const char *filename, pse_record pr, pse_frame pf, int c, const int32_t *x, int n)
+{
+  pse_csv_print(filename, pr, pf, c,
+                csv_filter_add(&filters[c], pr.year, pf.msec_of_year, x, n, pf.error_flag));
 }
 
 void pse_csv_output(const char *filename, pse_record pr, pse_frame pf)
 {
   int i;
   uint64_t msec_of_year;
-  double dmsec = 64 * 10 / 1060.0 * 1000;
 
-  if (pr.format == FORMAT_OLD)
+  if (filters != NULL)
+  {
+    if (pr.format == FORMAT_OLD)
+    {
+      pse_csv_filter(filename, pr, pf, 0, pf.spz, COUNTS_PER_FRAME_FOR_PSE_SP);
+    }
+    pse_csv_filter(filename, pr, pf, 1, pf.lpx, COUNTS_PER_FRAME_FOR_PSE_LP);
+    pse_csv_filter(filename, pr, pf, 2, pf.lpy, COUNTS_PER_FRAME_FOR_PSE_LP);
+    pse_csv_filter(filename, pr, pf, 3, pf.lpz, COUNTS_PER_FRAME_FOR_PSE_LP);
+  }
+  else if (pr.format == FORMAT_OLD)
   {
     for (i = 0; i < COUNTS_PER_FRAME_FOR_PSE_SP; ++i)
     {
-      msec_of_year = pf.msec_of_year + dmsec * i / COUNTS_PER_FRAME_FOR_PSE_SP;
+      msec_of_year = pf.msec_of_year + tb_sp.msec[i];
       print_format(filename, pr.year, msec_of_year, pr.apollo_station, "spz",
                    pf.frame_count, pf.spz[i], pf.process_flag, pr.error_flag, pf.error_flag);
     }
   }
 
-  for (i = 0; i < COUNTS_PER_FRAME_FOR_PSE_LP; ++i)
+  for (i = 0; i < COUNTS_PER_FRAME_FOR_PSE_LP && filters == NULL; ++i)
   {
-    msec_of_year = pf.msec_of_year + dmsec * i / COUNTS_PER_FRAME_FOR_PSE_LP;
+    msec_of_year = pf.msec_of_year + tb_lp.msec[i];
     print_format(filename, pr.year, msec_of_year, pr.apollo_station, "lpx",
                  pf.frame_count, pf.lpx[i], pf.process_flag, pr.error_flag, pf.error_flag);
     print_format(filename, pr.year, msec_of_year, pr.apollo_station, "lpy",
@@ -82,6 +144,7 @@ int main(int argc, char **argv)
   long frame_offset;
   uint32_t doy, hh, mm, ss, ms;
   char *basec, *bname;
+  int c, nrecord = 0, ret = EXIT_SUCCESS;
 
   //initial value of Frame time error at last frame in one record
   uint64_t msec_of_year_fmax = 0;
@@ -92,16 +155,97 @@ int main(int argc, char **argv)
   unsigned char record[SIZE_RECORD];
   pse_record pr;
   pse_frame pf[MAX_PSE_FRAME + 1];
+  pse_frame last_frame;
+  despike_set ds;
+  int nframe;
 
   // ----------------------------------------
   // Command line option
   // ----------------------------------------
-  if (argc != 2)
+  int ch;
+  extern char *optarg;
+  extern int optind, opterr;
+  int factor = 1;
+  double lo = 0.0, hi = 0.0;
+  int despiking = 0;
+  const char *response = NULL, *unit = NULL, *prefilter = NULL;
+  static const struct option options[] = {
+    {"despike", no_argument, NULL, 's'},
+    {"decimate", required_argument, NULL, 'd'},
+    {"bandpass", required_argument, NULL, 'b'},
+    {"response", required_argument, NULL, 'r'},
+    {"unit", required_argument, NULL, 'u'},
+    {"prefilter", required_argument, NULL, 'p'},
+    {NULL, 0, NULL, 0}
+  };
+
+  while ((ch = getopt_long(argc, argv, "sd:b:r:u:p:", options, NULL)) != -1)
+  {
+    switch (ch)
+    {
+    case 's':
+      despiking = 1;
+      break;
+    case 'd':
+      factor = atoi(optarg);
+      break;
+    case 'r':
+      response = optarg;
+      break;
+    case 'u':
+      unit = optarg;
+      break;
+    case 'p':
+      prefilter = optarg;
+      break;
+    case 'b':
+      if (csv_parse_band(optarg, &lo, &hi) != 0)
+      {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (argc - optind != 1)
+  {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  SET_ARG(filename, optind, PATH_MAX);
+  timebase_init(&tb_sp, TIMEBASE_FRAME_BITS, TIMEBASE_BIT_RATE, COUNTS_PER_FRAME_FOR_PSE_SP);
+  timebase_init(&tb_lp, TIMEBASE_FRAME_BITS, TIMEBASE_BIT_RATE, COUNTS_PER_FRAME_FOR_PSE_LP);
+  despike_set_init(&ds);
+
+  if (response != NULL && csv_response_init(&responses, &cache, response, unit, prefilter) != 0)
   {
     usage(argv[0]);
     return EXIT_FAILURE;
   }
-  SET_ARG(filename, 1, PATH_MAX);
+  if (factor != 1 || lo > 0.0 || hi > 0.0 || response != NULL)
+  {
+    filters = (csv_filter *)calloc(NUM_FILTER, sizeof(csv_filter));
+    if (filters == NULL)
+    {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+      return EXIT_FAILURE;
+    }
+    for (c = 0; c < NUM_FILTER; c++)
+    {
+      int n = (c == 0) ? COUNTS_PER_FRAME_FOR_PSE_SP : COUNTS_PER_FRAME_FOR_PSE_LP;
+
+      if (csv_filter_init(&filters[c], n * 1060.0 / 640.0, factor, lo, hi, n) != 0)
+      {
+        log_printf(LOG_ERROR, __FILE__, __LINE__,
+                   "invalid decimation factor or band for %s: %d, %g,%g", filter_types[c], factor, lo, hi);
+        ret = EXIT_FAILURE;
+        goto main_finish;
+      }
+    }
+  }
 
   // ----------------------------------------
   // PROGRAM MAIN
@@ -111,7 +255,8 @@ int main(int argc, char **argv)
   {
     log_printf(LOG_ERROR, __FILE__, __LINE__,
                "no such file: %s", filename);
-    return -1;
+    ret = -1;
+    goto main_finish;
   }
 
   basec = strdup(filename);
@@ -147,6 +292,12 @@ int main(int argc, char **argv)
       size_part = SIZE_DATA_PART_NEW;
     }
 
+    // the station of the file for the responses
+    for (c = 0; c < NUM_FILTER && response != NULL && nrecord == 0; c++)
+    {
+      csv_filter_response(&filters[c], &cache, pr.apollo_station, filter_channels[c]);
+    }
+
     // register first frame into database
     frame_offset = SIZE_PSE_HEADER;
     pf[0] = binary2pse_frame(pr, &record[frame_offset]);
@@ -156,10 +307,9 @@ int main(int argc, char **argv)
     pf[0].process_flag = process_flag | FLAG_TOP_OF_RECORD | FLAG_FIRST_DATA_COPIED;
     pf[0].error_flag = check_pse_frame(pf[0], pr.apollo_station, pr.year);
 
-    pse_csv_output(bname, pr, pf[0]);
-
     // register remnant frames into database
-    for (i = 1; i < (SIZE_LOGICAL_RECORD * pr.phys_records); i++)
+    nframe = SIZE_LOGICAL_RECORD * pr.phys_records;
+    for (i = 1; i < nframe; i++)
     {
       frame_offset = SIZE_PSE_HEADER + size_part * i;
       unsigned char *frame = &record[frame_offset];
@@ -176,13 +326,42 @@ int main(int argc, char **argv)
           pf[i - 1].spz[31],
           pf[i].spz[1],
           pf[i].spz[2]);
+    }
+
+    // the frames of a record are despiked together, before any output
+    if (despiking && despike_pse_frames(&ds, pf, nframe, pr.format) < 0)
+    {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+      ret = EXIT_FAILURE;
+      break;
+    }
 
+    for (i = 0; i < nframe; i++)
+    {
       pse_csv_output(bname, pr, pf[i]);
     }
-    msec_of_year_fmax = pf[i - 1].msec_of_year;
+    last_frame = pf[nframe - 1];
+    msec_of_year_fmax = last_frame.msec_of_year;
     process_flag = 0;
+    nrecord++;
+  }
+
+  // the remaining outputs of the filters, with the last frame
+  for (c = 0; c < NUM_FILTER && filters != NULL && nrecord > 0; c++)
+  {
+    pse_csv_print(bname, pr, last_frame, c, csv_filter_flush(&filters[c]));
   }
   fclose(f);
   free(basec);
-  return EXIT_SUCCESS;
+
+main_finish:
+  despike_set_free(&ds);
+  for (c = 0; c < NUM_FILTER && filters != NULL; c++)
+  {
+    csv_filter_free(&filters[c]);
+  }
+  free(filters);
+  resp_cache_free(&cache);
+  resp_table_free(&responses);
+  return ret;
 }
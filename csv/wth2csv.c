@@ -11,55 +11,113 @@
 #include <unistd.h>
 #include <inttypes.h>
 #include <libgen.h>
+#include <getopt.h>
 
 #include "define.h"
 #include "wth.h"
 #include "error.h"
 #include "util.h"
+#include "timebase.h"
+#include "samples.h"
+#include "csv.h"
+#include "despike.h"
+
+#define NUM_FILTER 4
+
+//! filters of dp1, dp6, dp11 and dp16 (NULL without --decimate, --bandpass or --response)
+static csv_filter *filters = NULL;
+static const char *filter_types[NUM_FILTER] = {"dp1", "dp6", "dp11", "dp16"};
+static const int filter_channels[NUM_FILTER] = {
+  SAMPLES_GP_1, SAMPLES_GP_2, SAMPLES_GP_3, SAMPLES_GP_4
+};
+
+//! responses of --response and their transfer functions
+static resp_table responses;
+static resp_cache cache;
+
+//! offsets of the samples of the geophones in a frame
+static timebase tb_gp;
 
 void usage(const char *cmd)
 {
-  fprintf(stderr, "usage: %s wthfile\n", cmd);
+  fprintf(stderr, "usage: %s [-s] [-r file [-u unit] [-p f1,f2,f3,f4]] [-d factor] [-b lo,hi] wthfile\n", cmd);
+  fprintf(stderr, "  -s, --despike          replace spikes of dp1, dp6, dp11 and dp16 by the running median\n");
+  fprintf(stderr, "  -d, --decimate=factor  lowpass and keep every factor-th sample of dp1, dp6, dp11 and dp16\n");
+  fprintf(stderr, "  -b, --bandpass=lo,hi   Butterworth bandpass of them [Hz] (either corner may be empty)\n");
+  fprintf(stderr, "  -r, --response=file    remove the instrument responses of the file (see response.c)\n");
+  fprintf(stderr, "  -u, --unit=unit        disp, vel or acc of the ground [m, m/s, m/s^2] (default disp)\n");
+  fprintf(stderr, "  -p, --prefilter=f1,f2,f3,f4  cosine taper of the deconvolution [Hz]\n");
 }
 
-void wth_csv_output(const char *filename, wth_record whr, wth_frame whf)
+/*!
+ * @brief print the outputs of a filter
+ */
+void wth_csv_print(const char *filename, int c, int n)
+{
+  csv_filter *cf = &filters[c];
+  uint32_t doy, hh, mm, ss, ms;
+  int j;
+
+  for (j = 0; j < n; j++)
+  {
+    msec_of_year_to_date(cf->out_msec[j], &doy, &hh, &mm, &ss, &ms);
+    printf("%s", filename);
+    printf(",%s", filter_types[c]);
+    printf(",%d", cf->out_year[j]);
+    printf(",%d,%02d:%02d:%02d.%06d", doy, hh, mm, ss, ms * 1000);
+    // calibrated values are float32 ground motion
+    printf((cf->cache != NULL) ? ",%.9g" : ",%.3f", cf->out_value[j]);
+    putchar('\n');
+  }
+}
+
+void wth_csv_output(const char *filename, wth_record whr, wth_frame whf, uint32_t error_flag)
 {
   int i;
   uint32_t doy, hh, mm, ss, ms;
   uint64_t msec_of_year;
-  double dmsec = 20 * 30 / 3533.0 * 1000;
+  const int32_t *x[NUM_FILTER] = {whf.dp1, whf.dp6, whf.dp11, whf.dp16};
+
+  for (i = 0; i < NUM_FILTER && filters != NULL; i++)
+  {
+    wth_csv_print(filename, i, csv_filter_add(&filters[i], whr.year, whf.msec_of_year,
+                                              x[i], COUNTS_PER_FRAME_FOR_WTH_GP, error_flag));
+  }
 
   for (i = 0; i < COUNTS_PER_FRAME_FOR_WTH_GP; ++i)
   {
-    msec_of_year = whf.msec_of_year + dmsec * i / COUNTS_PER_FRAME_FOR_WTH_GP;
+    msec_of_year = whf.msec_of_year + tb_gp.msec[i];
     msec_of_year_to_date(msec_of_year, &doy, &hh, &mm, &ss, &ms);
-    printf("%s", filename);
-    printf(",dp1");
-    printf(",%d", whr.year);
-    printf(",%d,%02d:%02d:%02d.%06d", doy, hh, mm, ss, ms * 1000);
-    printf(",%d", whf.dp1[i]);
-    putchar('\n');
+    if (filters == NULL)
+    {
+      printf("%s", filename);
+      printf(",dp1");
+      printf(",%d", whr.year);
+      printf(",%d,%02d:%02d:%02d.%06d", doy, hh, mm, ss, ms * 1000);
+      printf(",%d", whf.dp1[i]);
+      putchar('\n');
 
-    printf("%s", filename);
-    printf(",dp6");
-    printf(",%d", whr.year);
-    printf(",%d,%02d:%02d:%02d.%06d", doy, hh, mm, ss, ms * 1000);
-    printf(",%d", whf.dp6[i]);
-    putchar('\n');
+      printf("%s", filename);
+      printf(",dp6");
+      printf(",%d", whr.year);
+      printf(",%d,%02d:%02d:%02d.%06d", doy, hh, mm, ss, ms * 1000);
+      printf(",%d", whf.dp6[i]);
+      putchar('\n');
 
-    printf("%s", filename);
-    printf(",dp11");
-    printf(",%d", whr.year);
-    printf(",%d,%02d:%02d:%02d.%06d", doy, hh, mm, ss, ms * 1000);
-    printf(",%d", whf.dp11[i]);
-    putchar('\n');
+      printf("%s", filename);
+      printf(",dp11");
+      printf(",%d", whr.year);
+      printf(",%d,%02d:%02d:%02d.%06d", doy, hh, mm, ss, ms * 1000);
+      printf(",%d", whf.dp11[i]);
+      putchar('\n');
 
-    printf("%s", filename);
-    printf(",dp16");
-    printf(",%d", whr.year);
-    printf(",%d,%02d:%02d:%02d.%06d", doy, hh, mm, ss, ms * 1000);
-    printf(",%d", whf.dp16[i]);
-    putchar('\n');
+      printf("%s", filename);
+      printf(",dp16");
+      printf(",%d", whr.year);
+      printf(",%d,%02d:%02d:%02d.%06d", doy, hh, mm, ss, ms * 1000);
+      printf(",%d", whf.dp16[i]);
+      putchar('\n');
+    }
 
     printf("%s", filename);
     printf(",dp_status");
@@ -80,7 +138,8 @@ int main(int argc, char **argv)
   int error_flag;
   int i;
   uint32_t doy, hh, mm, ss, ms;
-  char *basec, *bname;
+  char *basec = NULL, *bname;
+  int c, ret = EXIT_SUCCESS;
 
   // ----------------------------------------
   // Apollo related variables
@@ -90,6 +149,7 @@ int main(int argc, char **argv)
   unsigned char frame[SIZE_FRAME];
   wth_record whr;
   wth_frame *whf = NULL;
+  despike_set ds;
   int fsize;
   int max_wth_frame;
   int fmax = -1;
@@ -98,12 +158,94 @@ int main(int argc, char **argv)
   // ----------------------------------------
   // Command line option
   // ----------------------------------------
-  if (argc != 2)
+  int ch;
+  extern char *optarg;
+  extern int optind, opterr;
+  int factor = 1;
+  double lo = 0.0, hi = 0.0;
+  int despiking = 0;
+  const char *response = NULL, *unit = NULL, *prefilter = NULL;
+  static const struct option options[] = {
+    {"despike", no_argument, NULL, 's'},
+    {"decimate", required_argument, NULL, 'd'},
+    {"bandpass", required_argument, NULL, 'b'},
+    {"response", required_argument, NULL, 'r'},
+    {"unit", required_argument, NULL, 'u'},
+    {"prefilter", required_argument, NULL, 'p'},
+    {NULL, 0, NULL, 0}
+  };
+
+  while ((ch = getopt_long(argc, argv, "sd:b:r:u:p:", options, NULL)) != -1)
+  {
+    switch (ch)
+    {
+    case 's':
+      despiking = 1;
+      break;
+    case 'd':
+      factor = atoi(optarg);
+      break;
+    case 'r':
+      response = optarg;
+      break;
+    case 'u':
+      unit = optarg;
+      break;
+    case 'p':
+      prefilter = optarg;
+      break;
+    case 'b':
+      if (csv_parse_band(optarg, &lo, &hi) != 0)
+      {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (argc - optind != 1)
   {
     usage(argv[0]);
     return EXIT_FAILURE;
   }
-  SET_ARG(filename, 1, PATH_MAX);
+  SET_ARG(filename, optind, PATH_MAX);
+  timebase_init(&tb_gp, TIMEBASE_FRAME_BITS_WTH, TIMEBASE_BIT_RATE_WTH, COUNTS_PER_FRAME_FOR_WTH_GP);
+  despike_set_init(&ds);
+
+  if (response != NULL && csv_response_init(&responses, &cache, response, unit, prefilter) != 0)
+  {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (factor != 1 || lo > 0.0 || hi > 0.0 || response != NULL)
+  {
+    filters = (csv_filter *)calloc(NUM_FILTER, sizeof(csv_filter));
+    if (filters == NULL)
+    {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+      return EXIT_FAILURE;
+    }
+    for (c = 0; c < NUM_FILTER; c++)
+    {
+      if (csv_filter_init(&filters[c], COUNTS_PER_FRAME_FOR_WTH_GP * 3533.0 / 600.0,
+                          factor, lo, hi, COUNTS_PER_FRAME_FOR_WTH_GP) != 0)
+      {
+        log_printf(LOG_ERROR, __FILE__, __LINE__,
+                   "invalid decimation factor or band for %s: %d, %g,%g", filter_types[c], factor, lo, hi);
+        ret = EXIT_FAILURE;
+        goto main_finish;
+      }
+      if (response != NULL)
+      {
+        // the geophones of the LSPE are on Apollo 17 only
+        csv_filter_response(&filters[c], &cache, package_id2station_id(ALSEP_PACKAGE_ID_APOLLO_17),
+                            filter_channels[c]);
+      }
+    }
+  }
 
   // ----------------------------------------
   // PROGRAM MAIN
@@ -113,7 +255,8 @@ int main(int argc, char **argv)
   {
     log_printf(LOG_ERROR, __FILE__, __LINE__,
                "no such file: %s", filename);
-    return EXIT_FAILURE;
+    ret = EXIT_FAILURE;
+    goto main_finish;
   }
 
   // get filesize
@@ -193,13 +336,39 @@ int main(int argc, char **argv)
         goto main_finish;
       }
       whf[fmax] = binary2wth_frame(whr, frame);
-      error_flag = check_wth_frame(whf[fmax], whr.year);
-      wth_csv_output(bname, whr, whf[fmax]);
+      whf[fmax].error_flag = check_wth_frame(whf[fmax], whr.year);
+      fmax++;
+    }
+
+    // the frames of a record are despiked together, before any output
+    if (despiking && despike_wth_frames(&ds, whf, fmax) < 0)
+    {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+      ret = EXIT_FAILURE;
+      goto main_finish;
+    }
+
+    for (i = 0; i < fmax; i++)
+    {
+      wth_csv_output(bname, whr, whf[i], whf[i].error_flag);
     }
-    fmax++;
   }
 
 main_finish:
+  // the remaining outputs of the filters
+  for (c = 0; c < NUM_FILTER && filters != NULL; c++)
+  {
+    if (basec != NULL)
+    {
+      wth_csv_print(bname, c, csv_filter_flush(&filters[c]));
+    }
+    csv_filter_free(&filters[c]);
+  }
+  free(filters);
+  despike_set_free(&ds);
+  resp_cache_free(&cache);
+  resp_table_free(&responses);
+
   if (f)
   {
     fclose(f);
@@ -218,5 +387,5 @@ main_finish:
     basec = NULL;
   }
 
-  return EXIT_SUCCESS;
+  return ret;
 }
@@ -12,16 +12,140 @@
 #include <unistd.h>
 #include <inttypes.h>
 #include <libgen.h>
+#include <getopt.h>
 
 #include "define.h"
 #include "wtn.h"
 #include "error.h"
 #include "util.h"
+#include "timebase.h"
+#include "wtn_demux.h"
+#include "samples.h"
 #include "csv.h"
+#include "despike.h"
+
+#define NUM_PACKAGE 6
+#define NUM_FILTER 5
+
+//! filters of spz, lpx, lpy, lpz and lsg of every package (NULL without --decimate, --bandpass or --response)
+static csv_filter (*filters)[NUM_FILTER] = NULL;
+static const char *filter_types[NUM_FILTER] = {"spz", "lpx", "lpy", "lpz", "lsg"};
+static const int filter_channels[NUM_FILTER] = {
+  SAMPLES_SP_Z, SAMPLES_LP_X, SAMPLES_LP_Y, SAMPLES_LP_Z, SAMPLES_LSG
+};
+static const int filter_counts[NUM_FILTER] = {
+  COUNTS_PER_FRAME_FOR_WTN_SP, COUNTS_PER_FRAME_FOR_WTN_LP, COUNTS_PER_FRAME_FOR_WTN_LP,
+  COUNTS_PER_FRAME_FOR_WTN_LP, COUNTS_PER_FRAME_FOR_WTN_LSG
+};
+static const int apollo_station[NUM_PACKAGE] = {-1, 12, 15, 16, 14, 17};
+
+//! the last frame of every package, for the outputs at the end
+static wtn_record last_record;
+static wtn_frame last_frame[NUM_PACKAGE];
+static int have_frame[NUM_PACKAGE];
+
+//! responses of --response and their transfer functions
+static resp_table responses;
+static resp_cache cache;
+
+//! offsets of the samples of spz, lp* and lsg in a frame
+static timebase tb_sp, tb_lp, tb_lsg;
 
 void usage(const char *cmd)
 {
-  fprintf(stderr, "usage: %s wtnfile\n", cmd);
+  fprintf(stderr, "usage: %s [-s] [-r file [-u unit] [-p f1,f2,f3,f4]] [-d factor] [-b lo,hi] wtnfile\n", cmd);
+  fprintf(stderr, "  -s, --despike          replace spikes of spz, lpx, lpy, lpz and lsg by the running median\n");
+  fprintf(stderr, "  -d, --decimate=factor  lowpass and keep every factor-th sample of spz, lpx, lpy, lpz and lsg\n");
+  fprintf(stderr, "  -b, --bandpass=lo,hi   Butterworth bandpass of them [Hz] (either corner may be empty)\n");
+  fprintf(stderr, "  -r, --response=file    remove the instrument responses of the file (see response.c)\n");
+  fprintf(stderr, "  -u, --unit=unit        disp, vel or acc of the ground [m, m/s, m/s^2] (default disp)\n");
+  fprintf(stderr, "  -p, --prefilter=f1,f2,f3,f4  cosine taper of the deconvolution [Hz]\n");
+}
+
+/*!
+ * @brief print the outputs of a filter
+ */
+void wtn_csv_print(const char *filename, wtn_record wnr, wtn_frame wnf, int c, int n)
+{
+  csv_filter *cf = &filters[wnf.alsep_package_id][c];
+  int j;
+
+  for (j = 0; j < n; j++)
+  {
+    if (cf->cache != NULL)
+    {
+      print_format_float(filename, cf->out_year[j], cf->out_msec[j],
+                         apollo_station[wnf.alsep_package_id], filter_types[c],
+                         wnf.frame_count, cf->out_value[j], wnf.process_flag, wnr.error_flag, wnf.error_flag);
+    }
+    else
+    {
+      print_format_real(filename, cf->out_year[j], cf->out_msec[j],
+                        apollo_station[wnf.alsep_package_id], filter_types[c],
+                        wnf.frame_count, cf->out_value[j], wnf.process_flag, wnr.error_flag, wnf.error_flag);
+    }
+  }
+}
+
+void wtn_csv_filter(const char *filename, wtn_record wnr, wtn_frame wnf, int c, const int32_t *x)
+{
+  csv_filter *cf = &filters[wnf.alsep_package_id][c];
+
+  wtn_csv_print(filename, wnr, wnf, c,
+                csv_filter_add(cf, wnr.year, wnf.msec_of_year, x, filter_counts[c], wnf.error_flag));
+}
+
+/*!
+ * @brief set up the filters of all packages
+ *
+ * @param[in] response with the responses of the cache
+ * @return 0 on success, -1 for a bad factor or band
+ */
+static int init_filters(int factor, double lo, double hi, int response)
+{
+  int p, c;
+
+  filters = (csv_filter (*)[NUM_FILTER])calloc(NUM_PACKAGE, sizeof(*filters));
+  if (filters == NULL)
+  {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+    return -1;
+  }
+  for (p = 0; p < NUM_PACKAGE; p++)
+  {
+    for (c = 0; c < NUM_FILTER; c++)
+    {
+      if (csv_filter_init(&filters[p][c], filter_counts[c] * 1060.0 / 640.0,
+                          factor, lo, hi, filter_counts[c]) != 0)
+      {
+        log_printf(LOG_ERROR, __FILE__, __LINE__,
+                   "invalid decimation factor or band for %s: %d, %g,%g", filter_types[c], factor, lo, hi);
+        return -1;
+      }
+      if (response)
+      {
+        csv_filter_response(&filters[p][c], &cache, apollo_station[p], filter_channels[c]);
+      }
+    }
+  }
+  return 0;
+}
+
+static void free_filters(void)
+{
+  int p, c;
+
+  for (p = 0; p < NUM_PACKAGE && filters != NULL; p++)
+  {
+    for (c = 0; c < NUM_FILTER; c++)
+    {
+      csv_filter_free(&filters[p][c]);
+    }
+  }
+  free(filters);
+  filters = NULL;
+  resp_cache_free(&cache);
+  resp_table_free(&responses);
 }
 
 void wtn_csv_output(const char *filename, wtn_record wnr, wtn_frame wnf)
@@ -29,22 +153,38 @@ void wtn_csv_output(const char *filename, wtn_record wnr, wtn_frame wnf)
   int i;
   uint32_t doy, hh, mm, ss, ms;
   uint64_t msec_of_year;
-  double dmsec = 64 * 10 / 1060.0 * 1000;
-  int apollo_station[] = {-1, 12, 15, 16, 14, 17};
+
+  if (filters != NULL && wnf.alsep_package_id < NUM_PACKAGE)
+  {
+    last_record = wnr;
+    last_frame[wnf.alsep_package_id] = wnf;
+    have_frame[wnf.alsep_package_id] = 1;
+    if (wnf.alsep_package_id != ALSEP_PACKAGE_ID_APOLLO_17)
+    {
+      wtn_csv_filter(filename, wnr, wnf, 0, wnf.spz);
+      wtn_csv_filter(filename, wnr, wnf, 1, wnf.lpx);
+      wtn_csv_filter(filename, wnr, wnf, 2, wnf.lpy);
+      wtn_csv_filter(filename, wnr, wnf, 3, wnf.lpz);
+    }
+    else
+    {
+      wtn_csv_filter(filename, wnr, wnf, 4, wnf.lsg);
+    }
+  }
 
   if (wnf.alsep_package_id != ALSEP_PACKAGE_ID_APOLLO_17)
   {
-    for (i = 0; i < COUNTS_PER_FRAME_FOR_WTN_SP; ++i)
+    for (i = 0; i < COUNTS_PER_FRAME_FOR_WTN_SP && filters == NULL; ++i)
     {
-      msec_of_year = wnf.msec_of_year + dmsec * i / COUNTS_PER_FRAME_FOR_WTN_SP;
+      msec_of_year = wnf.msec_of_year + tb_sp.msec[i];
       print_format(filename, wnr.year, msec_of_year,
                    apollo_station[wnf.alsep_package_id], "spz",
                    wnf.frame_count, wnf.spz[i], wnf.process_flag, wnr.error_flag, wnf.error_flag);
     }
 
-    for (i = 0; i < COUNTS_PER_FRAME_FOR_WTN_LP; ++i)
+    for (i = 0; i < COUNTS_PER_FRAME_FOR_WTN_LP && filters == NULL; ++i)
     {
-      msec_of_year = wnf.msec_of_year + dmsec * i / COUNTS_PER_FRAME_FOR_WTN_LP;
+      msec_of_year = wnf.msec_of_year + tb_lp.msec[i];
       print_format(filename, wnr.year, msec_of_year,
                    apollo_station[wnf.alsep_package_id], "lpx",
                    wnf.frame_count, wnf.lpx[i], wnf.process_flag, wnr.error_flag, wnf.error_flag);
@@ -77,9 +217,9 @@ void wtn_csv_output(const char *filename, wtn_record wnr, wtn_frame wnf)
   }
   else
   {
-    for (i = 0; i < COUNTS_PER_FRAME_FOR_WTN_LSG; ++i)
+    for (i = 0; i < COUNTS_PER_FRAME_FOR_WTN_LSG && filters == NULL; ++i)
     {
-      msec_of_year = wnf.msec_of_year + dmsec * i / COUNTS_PER_FRAME_FOR_WTN_LSG;
+      msec_of_year = wnf.msec_of_year + tb_lsg.msec[i];
       print_format(filename, wnr.year, msec_of_year,
                    apollo_station[wnf.alsep_package_id], "lsg",
                    wnf.frame_count, wnf.lsg[i], wnf.process_flag, wnr.error_flag, wnf.error_flag);
@@ -104,10 +244,11 @@ int main(int argc, char **argv)
   FILE *f;
   size_t r;
   char filename[PATH_MAX + 1];
-  uint32_t process_flag;
+  uint32_t process_flag = 0;
   uint32_t error_flag;
   int i;
-  char *basec, *bname;
+  char *basec = NULL, *bname = NULL;
+  int p, c;
 
   // ----------------------------------------
   // Apollo related variables
@@ -117,6 +258,8 @@ int main(int argc, char **argv)
   unsigned char frame[SIZE_FRAME];
   wtn_record wnr;
   wtn_frame *wnf = NULL;
+  wtn_demux demux;
+  despike_set ds[WTN_DEMUX_STREAMS];
   int fsize;
   int max_wtn_frame;
   int fmax = -1;
@@ -125,12 +268,79 @@ int main(int argc, char **argv)
   // ----------------------------------------
   // Command line option
   // ----------------------------------------
-  if (argc != 2)
+  int ch;
+  extern char *optarg;
+  extern int optind, opterr;
+  int factor = 1;
+  double lo = 0.0, hi = 0.0;
+  int despiking = 0;
+  const char *response = NULL, *unit = NULL, *prefilter = NULL;
+  static const struct option options[] = {
+    {"despike", no_argument, NULL, 's'},
+    {"decimate", required_argument, NULL, 'd'},
+    {"bandpass", required_argument, NULL, 'b'},
+    {"response", required_argument, NULL, 'r'},
+    {"unit", required_argument, NULL, 'u'},
+    {"prefilter", required_argument, NULL, 'p'},
+    {NULL, 0, NULL, 0}
+  };
+
+  while ((ch = getopt_long(argc, argv, "sd:b:r:u:p:", options, NULL)) != -1)
+  {
+    switch (ch)
+    {
+    case 's':
+      despiking = 1;
+      break;
+    case 'd':
+      factor = atoi(optarg);
+      break;
+    case 'r':
+      response = optarg;
+      break;
+    case 'u':
+      unit = optarg;
+      break;
+    case 'p':
+      prefilter = optarg;
+      break;
+    case 'b':
+      if (csv_parse_band(optarg, &lo, &hi) != 0)
+      {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (argc - optind != 1)
+  {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  SET_ARG(filename, optind, PATH_MAX);
+  timebase_init(&tb_sp, TIMEBASE_FRAME_BITS, TIMEBASE_BIT_RATE, COUNTS_PER_FRAME_FOR_WTN_SP);
+  timebase_init(&tb_lp, TIMEBASE_FRAME_BITS, TIMEBASE_BIT_RATE, COUNTS_PER_FRAME_FOR_WTN_LP);
+  timebase_init(&tb_lsg, TIMEBASE_FRAME_BITS, TIMEBASE_BIT_RATE, COUNTS_PER_FRAME_FOR_WTN_LSG);
+  for (p = 0; p < WTN_DEMUX_STREAMS; p++)
+  {
+    despike_set_init(&ds[p]);
+  }
+
+  if (response != NULL && csv_response_init(&responses, &cache, response, unit, prefilter) != 0)
   {
     usage(argv[0]);
     return EXIT_FAILURE;
   }
-  SET_ARG(filename, 1, PATH_MAX);
+  if ((factor != 1 || lo > 0.0 || hi > 0.0 || response != NULL) &&
+      init_filters(factor, lo, hi, response != NULL) != 0)
+  {
+    free_filters();
+    return EXIT_FAILURE;
+  }
 
   // ----------------------------------------
   // PROGRAM MAIN
@@ -140,6 +350,7 @@ int main(int argc, char **argv)
   {
     log_printf(LOG_ERROR, __FILE__, __LINE__,
                "no such file: %s", filename);
+    free_filters();
     return -1;
   }
 
@@ -157,6 +368,7 @@ int main(int argc, char **argv)
   // ----------------------------------------
   // Frame registration
   // ----------------------------------------
+  wtn_demux_init(&demux);
   while ((r = fread(record, sizeof(unsigned char), SIZE_HEADER, f)) > 0)
   {
     if (r != SIZE_HEADER)
@@ -225,17 +437,15 @@ int main(int argc, char **argv)
       fmax++;
     }
 
-    // first frame
-    for (i = 0; i < wnr.num_asta; i++)
+    // link every frame to the last frame of its station
+    wtn_demux_frames(&demux, wnf, fmax);
+    for (i = 0; i < wnr.num_asta && i < fmax; i++)
     {
-      if (wnf[i].alsep_package_id != ALSEP_PACKAGE_ID_APOLLO_17)
-      {
-        wnf[i].spz[0] = wnf[i].spz[1];
-      }
-      wnf[i].time_diff = wnf[i].msec_of_year;
-      wnf[i].process_flag = process_flag | FLAG_TOP_OF_RECORD | FLAG_FIRST_DATA_COPIED;
-      wnf[i].prev_frame = -1;
+      wnf[i].process_flag |= process_flag | FLAG_TOP_OF_RECORD;
+    }
 
+    for (i = 0; i < fmax; i++)
+    {
       wnf[i].error_flag = check_wtn_frame(wnf[i], wnr.year);
       if (wnf[i].error_flag)
       {
@@ -245,55 +455,35 @@ int main(int argc, char **argv)
                    SIZE_HEADER * num_header + SIZE_FRAME * i,
                    wnf[i].msec_of_year);
       }
-
-      wtn_csv_output(bname, wnr, wnf[i]);
     }
 
-    for (i = wnr.num_asta; i < fmax; i++)
+    // the frames of a record are despiked together, before any output
+    if (despiking && despike_wtn_frames(ds, wnf, fmax) < 0)
     {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+      goto main_finish;
+    }
 
-      if (wnf[i].alsep_package_id == wnf[i - wnr.num_asta].alsep_package_id)
-      {
-        wnf[i].time_diff = wnf[i].msec_of_year - wnf[i - wnr.num_asta].msec_of_year;
-        wnf[i].prev_frame = wnf[i - wnr.num_asta].frame_count;
-      }
-      else
-      {
-        wnf[i].time_diff = wnf[i].msec_of_year;
-        wnf[i].process_flag = FLAG_FIRST_DATA_COPIED;
-        wnf[i].prev_frame = -1;
-      }
-
-      wnf[i].error_flag = check_wtn_frame(wnf[i], wnr.year);
-      if (wnf[i].error_flag)
-      {
-        log_printf(LOG_WARNING, __FILE__, __LINE__,
-                   "frame error: error code=0x%04x  file offset=%d msec_of_year=%" PRId64,
-                   wnf[i].error_flag,
-                   SIZE_HEADER * num_header + SIZE_FRAME * i,
-                   wnf[i].msec_of_year);
-      }
-
-      if (wnf[i].alsep_package_id != ALSEP_PACKAGE_ID_APOLLO_17)
-      {
-        if (wnf[i].process_flag & FLAG_FIRST_DATA_COPIED)
-        {
-          wnf[i].spz[0] = wnf[i].spz[1];
-        }
-        else
-        {
-          //! ALSEP WORD 2
-          wnf[i].spz[0] = interp(wnf[i - wnr.num_asta].spz[30],
-                                 wnf[i - wnr.num_asta].spz[31],
-                                 wnf[i].spz[1],
-                                 wnf[i].spz[2]);
-        }
-      }
+    for (i = 0; i < fmax; i++)
+    {
       wtn_csv_output(bname, wnr, wnf[i]);
     }
   }
 
 main_finish:
+  // the remaining outputs of the filters, with the last frame of their package
+  for (p = 0; p < NUM_PACKAGE && filters != NULL; p++)
+  {
+    for (c = 0; c < NUM_FILTER && have_frame[p]; c++)
+    {
+      wtn_csv_print(bname, last_record, last_frame[p], c, csv_filter_flush(&filters[p][c]));
+    }
+  }
+  free_filters();
+  for (p = 0; p < WTN_DEMUX_STREAMS; p++)
+  {
+    despike_set_free(&ds[p]);
+  }
   if (f)
   {
     fclose(f);
@@ -14,17 +14,24 @@
 #include <libgen.h>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <getopt.h>
 
 #include "define.h"
 #include "pse.h"
 #include "error.h"
 #include "util.h"
+#include "timebase.h"
+#include "despike.h"
 #include "pse2csv_for_d5a_print.h"
 
 
+//! offsets of the samples of spz and lp* in a frame
+static timebase tb_sp, tb_lp;
+
 void usage(const char *cmd)
 {
-  fprintf(stderr, "usage: %s output_dirname psefile\n", cmd);
+  fprintf(stderr, "usage: %s [-s] output_dirname psefile\n", cmd);
+  fprintf(stderr, "  -s  replace spikes of spz, lpx, lpy and lpz by the running median\n");
 }
 
 void pse_csv_output(FILE *fps_write[SIZE_PSE_FILEPOINTERS],
@@ -33,8 +40,6 @@ void pse_csv_output(FILE *fps_write[SIZE_PSE_FILEPOINTERS],
                     pse_record pr, pse_frame pf)
 {
   int i;
-  double us_offset;
-  double dmsec = 64 * 10 / 1060.0 * 1000;
   print_pse_meta(
       fps_write[PSE_FILEPOINTER_META],
       filename,
@@ -47,12 +52,11 @@ void pse_csv_output(FILE *fps_write[SIZE_PSE_FILEPOINTERS],
   {
     for (i = 0; i < COUNTS_PER_FRAME_FOR_PSE_SP; ++i)
     {
-      us_offset = dmsec * i / COUNTS_PER_FRAME_FOR_PSE_SP * 1000;
       print_pse_spz(
           fps_write[PSE_FILEPOINTER_SPZ],
           filename,
           file_offset,
-          us_offset,
+          tb_sp.usec[i],
           &pr, &pf,
           i);
     }
@@ -60,12 +64,11 @@ void pse_csv_output(FILE *fps_write[SIZE_PSE_FILEPOINTERS],
 
   for (i = 0; i < COUNTS_PER_FRAME_FOR_PSE_LP; ++i)
   {
-    us_offset = dmsec * i / COUNTS_PER_FRAME_FOR_PSE_LP * 1000;
     print_pse_lpxyz(
         fps_write[PSE_FILEPOINTER_LPXYZ],
         filename,
         file_offset,
-        us_offset,
+        tb_lp.usec[i],
         &pr, &pf,
         i);
   }
@@ -102,7 +105,7 @@ int main(int argc, char **argv)
   char pathname[PATH_MAX + 1];
   uint32_t process_flag;
   int size_part;
-  int i;
+  int i, nframe;
   char *basec, *bname;
   int record_no;
   int frame_no;
@@ -118,17 +121,36 @@ int main(int argc, char **argv)
   unsigned char record[SIZE_RECORD];
   pse_record pr;
   pse_frame pf[MAX_PSE_FRAME + 1];
+  despike_set ds;
 
   // ----------------------------------------
   // Command line option
   // ----------------------------------------
-  if (argc != 3)
+  int ch;
+  extern int optind, opterr;
+  int despiking = 0;
+
+  while ((ch = getopt(argc, argv, "s")) != -1)
+  {
+    switch (ch)
+    {
+    case 's':
+      despiking = 1;
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (argc - optind != 2)
   {
     usage(argv[0]);
     return EXIT_FAILURE;
   }
-  SET_ARG(dirname, 1, PATH_MAX);
-  SET_ARG(filename, 2, PATH_MAX);
+  SET_ARG(dirname, optind, PATH_MAX);
+  SET_ARG(filename, optind + 1, PATH_MAX);
+  timebase_init(&tb_sp, TIMEBASE_FRAME_BITS, TIMEBASE_BIT_RATE, COUNTS_PER_FRAME_FOR_PSE_SP);
+  timebase_init(&tb_lp, TIMEBASE_FRAME_BITS, TIMEBASE_BIT_RATE, COUNTS_PER_FRAME_FOR_PSE_LP);
 
   // ----------------------------------------
   // PROGRAM MAIN
@@ -168,6 +190,7 @@ int main(int argc, char **argv)
   // Frame
   // ----------------------------------------
   process_flag = FLAG_FIRST_DATA_OF_FILE;
+  despike_set_init(&ds);
   rec_offset = ftell(fp_read);
   record_no = 0;
   prev_frame = -1;
@@ -206,12 +229,9 @@ int main(int argc, char **argv)
     pf[0].process_flag = process_flag | FLAG_TOP_OF_RECORD | FLAG_FIRST_DATA_COPIED;
     pf[0].error_flag = check_pse_frame(pf[0], pr.apollo_station, pr.year);
 
-    frame_no = 0;
-    pse_csv_output(fps_write, bname, rec_offset + frame_offset, record_no, frame_no, pr, pf[0]);
-    frame_no++;
-
     // register remnant frames into database
-    for (i = 1; i < (SIZE_LOGICAL_RECORD * pr.phys_records); i++)
+    nframe = SIZE_LOGICAL_RECORD * pr.phys_records;
+    for (i = 1; i < nframe; i++)
     {
       frame_offset = SIZE_PSE_HEADER + size_part * i;
       unsigned char *frame = &record[frame_offset];
@@ -228,9 +248,20 @@ int main(int argc, char **argv)
           pf[i - 1].spz[31],
           pf[i].spz[1],
           pf[i].spz[2]);
+    }
+
+    // the frames of a record are despiked together, before any output
+    if (despiking && despike_pse_frames(&ds, pf, nframe, pr.format) < 0)
+    {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+      break;
+    }
 
+    for (i = 0; i < nframe; i++)
+    {
+      frame_no = i;
+      frame_offset = SIZE_PSE_HEADER + size_part * i;
       pse_csv_output(fps_write, bname, rec_offset + frame_offset, record_no, frame_no, pr, pf[i]);
-      frame_no++;
     }
     msec_of_year_fmax = pf[i - 1].msec_of_year;
     process_flag = 0;
@@ -238,6 +269,7 @@ int main(int argc, char **argv)
     prev_frame = pf[i - 1].frame_count;
     record_no++;
   }
+  despike_set_free(&ds);
   fclose(fp_read);
   free(basec);
   return EXIT_SUCCESS;
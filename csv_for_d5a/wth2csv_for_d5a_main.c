@@ -13,16 +13,23 @@
 #include <libgen.h>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <getopt.h>
 
 #include "wth.h"
 #include "define.h"
 #include "error.h"
 #include "util.h"
+#include "timebase.h"
+#include "despike.h"
 #include "wth2csv_for_d5a_print.h"
 
+//! offsets of the samples of the geophones in a frame
+static timebase tb_gp;
+
 void usage(const char *cmd)
 {
-  fprintf(stderr, "usage: %s dirname wthfile\n", cmd);
+  fprintf(stderr, "usage: %s [-s] dirname wthfile\n", cmd);
+  fprintf(stderr, "  -s  replace spikes of dp1, dp6, dp11 and dp16 by the running median\n");
 }
 
 void wth_csv_output(FILE *fps_write[SIZE_WTH_FILEPOINTERS],
@@ -31,8 +38,6 @@ void wth_csv_output(FILE *fps_write[SIZE_WTH_FILEPOINTERS],
                     wth_record whr, wth_frame whf)
 {
   int i;
-  double us_offset;
-  double dmsec = 20 * 30 / 3533.0 * 1000;
 
   print_wth_meta(
       fps_write[WTH_FILEPOINTER_META],
@@ -44,11 +49,10 @@ void wth_csv_output(FILE *fps_write[SIZE_WTH_FILEPOINTERS],
 
   for (i = 0; i < COUNTS_PER_FRAME_FOR_WTH_GP; ++i)
   {
-    us_offset = dmsec * i / COUNTS_PER_FRAME_FOR_WTH_GP * 1000;
     print_wth_gp(fps_write[WTH_FILEPOINTER_GP],
              filename,
              file_offset,
-             us_offset,
+             tb_gp.usec[i],
              &whr, &whf,
              i);
   }
@@ -65,7 +69,7 @@ int main(int argc, char **argv)
   char dirname[PATH_MAX + 1];
   char pathname[PATH_MAX + 1];
   int error_flag;
-  int i;
+  int i, k;
   char *basec = NULL;
   char *bname = NULL;
   long file_offset;
@@ -78,6 +82,7 @@ int main(int argc, char **argv)
   unsigned char frame[SIZE_FRAME];
   wth_record whr;
   wth_frame *whf = NULL;
+  despike_set ds;
   int fsize;
   int max_wth_frame;
   int fmax = -1;
@@ -86,13 +91,31 @@ int main(int argc, char **argv)
   // ----------------------------------------
   // Command line option
   // ----------------------------------------
-  if (argc != 3)
+  int ch;
+  extern int optind, opterr;
+  int despiking = 0;
+
+  while ((ch = getopt(argc, argv, "s")) != -1)
+  {
+    switch (ch)
+    {
+    case 's':
+      despiking = 1;
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (argc - optind != 2)
   {
     usage(argv[0]);
     return EXIT_FAILURE;
   }
-  SET_ARG(dirname, 1, PATH_MAX);
-  SET_ARG(filename, 2, PATH_MAX);
+  SET_ARG(dirname, optind, PATH_MAX);
+  SET_ARG(filename, optind + 1, PATH_MAX);
+  timebase_init(&tb_gp, TIMEBASE_FRAME_BITS_WTH, TIMEBASE_BIT_RATE_WTH, COUNTS_PER_FRAME_FOR_WTH_GP);
+  despike_set_init(&ds);
 
   mkdir(dirname, S_IRWXU);
 
@@ -195,16 +218,29 @@ int main(int argc, char **argv)
       }
       whf[fmax] = binary2wth_frame(whr, frame);
       error_flag = check_wth_frame(whf[fmax], whr.year);
+      whf[fmax].error_flag = error_flag;
+      fmax++;
+    }
+
+    // the frames of a record are despiked together, before any output
+    if (despiking && despike_wth_frames(&ds, whf, fmax) < 0)
+    {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+      goto main_finish;
+    }
+
+    for (k = 0; k < fmax; k++)
+    {
       wth_csv_output(fps_write,
                      bname, file_offset,
-                     fmax, i,
-                     whr, whf[fmax]);
+                     0, i,
+                     whr, whf[k]);
     }
-    fmax++;
     file_offset = ftell(fp_read);
   }
 
 main_finish:
+  despike_set_free(&ds);
   if (fp_read)
   {
     fclose(fp_read);
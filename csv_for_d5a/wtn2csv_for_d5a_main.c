@@ -14,16 +14,24 @@
 #include <libgen.h>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <getopt.h>
 
 #include "define.h"
 #include "wtn.h"
 #include "error.h"
 #include "util.h"
+#include "timebase.h"
+#include "wtn_demux.h"
+#include "despike.h"
 #include "wtn2csv_for_d5a_print.h"
 
+//! offsets of the samples of spz, lp* and lsg in a frame
+static timebase tb_sp, tb_lp, tb_lsg;
+
 void usage(const char *cmd)
 {
-  fprintf(stderr, "usage: %s dirname wtnfile\n", cmd);
+  fprintf(stderr, "usage: %s [-s] dirname wtnfile\n", cmd);
+  fprintf(stderr, "  -s  replace spikes of spz, lpx, lpy, lpz and lsg by the running median\n");
 }
 
 void wtn_csv_output(FILE *fps_write[SIZE_WTN_FILEPOINTERS],
@@ -32,10 +40,6 @@ void wtn_csv_output(FILE *fps_write[SIZE_WTN_FILEPOINTERS],
                     wtn_record wnr, wtn_frame wnf)
 {
   int i;
-  uint64_t msec_of_year;
-  double dmsec = 64 * 10 / 1060.0 * 1000;
-  int apollo_station[] = {-1, 12, 15, 16, 14, 17};
-  double us_offset;
 
   print_wtn_meta(
       fps_write[WTN_FILEPOINTER_META],
@@ -49,21 +53,19 @@ void wtn_csv_output(FILE *fps_write[SIZE_WTN_FILEPOINTERS],
   {
     for (i = 0; i < COUNTS_PER_FRAME_FOR_WTN_SP; ++i)
     {
-      us_offset = dmsec * i / COUNTS_PER_FRAME_FOR_WTN_SP * 1000;
       print_wtn_spz(fps_write[WTN_FILEPOINTER_SPZ],
                 filename,
                 file_offset,
-                us_offset,
+                tb_sp.usec[i],
                 &wnr, &wnf, i);
     }
 
     for (i = 0; i < COUNTS_PER_FRAME_FOR_WTN_LP; ++i)
     {
-      us_offset = dmsec * i / COUNTS_PER_FRAME_FOR_WTN_LP * 1000;
       print_wtn_lpxyz(fps_write[WTN_FILEPOINTER_LPXYZ],
                   filename,
                   file_offset,
-                  us_offset,
+                  tb_lp.usec[i],
                   &wnr, &wnf, i);
     }
 
@@ -88,11 +90,10 @@ void wtn_csv_output(FILE *fps_write[SIZE_WTN_FILEPOINTERS],
   {
     for (i = 0; i < COUNTS_PER_FRAME_FOR_WTN_LSG; ++i)
     {
-      us_offset = dmsec * i / COUNTS_PER_FRAME_FOR_WTN_LSG * 1000;
       print_wtn_lsg(fps_write[WTN_FILEPOINTER_LSG],
                 filename,
                 file_offset,
-                us_offset,
+                tb_lsg.usec[i],
                 &wnr, &wnf, i);
     }
   }
@@ -124,6 +125,8 @@ int main(int argc, char **argv)
   unsigned char frame[SIZE_FRAME];
   wtn_record wnr;
   wtn_frame *wnf = NULL;
+  wtn_demux demux;
+  despike_set ds[WTN_DEMUX_STREAMS];
   int fsize;
   int max_wtn_frame;
   int fmax = -1;
@@ -132,13 +135,36 @@ int main(int argc, char **argv)
   // ----------------------------------------
   // Command line option
   // ----------------------------------------
-  if (argc != 3)
+  int ch;
+  extern int optind, opterr;
+  int despiking = 0;
+
+  while ((ch = getopt(argc, argv, "s")) != -1)
+  {
+    switch (ch)
+    {
+    case 's':
+      despiking = 1;
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (argc - optind != 2)
   {
     usage(argv[0]);
     return EXIT_FAILURE;
   }
-  SET_ARG(dirname, 1, PATH_MAX);
-  SET_ARG(filename, 2, PATH_MAX);
+  SET_ARG(dirname, optind, PATH_MAX);
+  SET_ARG(filename, optind + 1, PATH_MAX);
+  timebase_init(&tb_sp, TIMEBASE_FRAME_BITS, TIMEBASE_BIT_RATE, COUNTS_PER_FRAME_FOR_WTN_SP);
+  timebase_init(&tb_lp, TIMEBASE_FRAME_BITS, TIMEBASE_BIT_RATE, COUNTS_PER_FRAME_FOR_WTN_LP);
+  timebase_init(&tb_lsg, TIMEBASE_FRAME_BITS, TIMEBASE_BIT_RATE, COUNTS_PER_FRAME_FOR_WTN_LSG);
+  for (i = 0; i < WTN_DEMUX_STREAMS; i++)
+  {
+    despike_set_init(&ds[i]);
+  }
 
   // ----------------------------------------
   // PROGRAM MAIN
@@ -188,6 +214,7 @@ int main(int argc, char **argv)
   // ----------------------------------------
   // Frame registration
   // ----------------------------------------
+  wtn_demux_init(&demux);
   file_offset = ftell(fp_read);
   while ((r = fread(record, sizeof(unsigned char), SIZE_HEADER, fp_read)) > 0)
   {
@@ -258,17 +285,15 @@ int main(int argc, char **argv)
       fmax++;
     }
 
-    // first frame
-    for (i = 0; i < wnr.num_asta; i++)
+    // link every frame to the last frame of its station
+    wtn_demux_frames(&demux, wnf, fmax);
+    for (i = 0; i < wnr.num_asta && i < fmax; i++)
     {
-      if (wnf[i].alsep_package_id != ALSEP_PACKAGE_ID_APOLLO_17)
-      {
-        wnf[i].spz[0] = wnf[i].spz[1];
-      }
-      wnf[i].time_diff = wnf[i].msec_of_year;
-      wnf[i].process_flag = process_flag | FLAG_TOP_OF_RECORD | FLAG_FIRST_DATA_COPIED;
-      wnf[i].prev_frame = -1;
+      wnf[i].process_flag |= process_flag | FLAG_TOP_OF_RECORD;
+    }
 
+    for (i = 0; i < fmax; i++)
+    {
       wnf[i].error_flag = check_wtn_frame(wnf[i], wnr.year);
       if (wnf[i].error_flag)
       {
@@ -278,53 +303,17 @@ int main(int argc, char **argv)
                    SIZE_HEADER * num_header + SIZE_FRAME * i,
                    wnf[i].msec_of_year);
       }
-
-      wtn_csv_output(fps_write,
-                     bname, file_offset,
-                     frame_no, i,
-                     wnr, wnf[i]);
     }
 
-    for (i = wnr.num_asta; i < fmax; i++)
+    // the frames of a record are despiked together, before any output
+    if (despiking && despike_wtn_frames(ds, wnf, fmax) < 0)
     {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+      goto main_finish;
+    }
 
-      if (wnf[i].alsep_package_id == wnf[i - wnr.num_asta].alsep_package_id)
-      {
-        wnf[i].time_diff = wnf[i].msec_of_year - wnf[i - wnr.num_asta].msec_of_year;
-        wnf[i].prev_frame = wnf[i - wnr.num_asta].frame_count;
-      }
-      else
-      {
-        wnf[i].time_diff = wnf[i].msec_of_year;
-        wnf[i].process_flag = FLAG_FIRST_DATA_COPIED;
-        wnf[i].prev_frame = -1;
-      }
-
-      wnf[i].error_flag = check_wtn_frame(wnf[i], wnr.year);
-      if (wnf[i].error_flag)
-      {
-        log_printf(LOG_WARNING, __FILE__, __LINE__,
-                   "frame error: error code=0x%04x  file offset=%d msec_of_year=%" PRId64,
-                   wnf[i].error_flag,
-                   SIZE_HEADER * num_header + SIZE_FRAME * i,
-                   wnf[i].msec_of_year);
-      }
-
-      if (wnf[i].alsep_package_id != ALSEP_PACKAGE_ID_APOLLO_17)
-      {
-        if (wnf[i].process_flag & FLAG_FIRST_DATA_COPIED)
-        {
-          wnf[i].spz[0] = wnf[i].spz[1];
-        }
-        else
-        {
-          //! ALSEP WORD 2
-          wnf[i].spz[0] = interp(wnf[i - wnr.num_asta].spz[30],
-                                 wnf[i - wnr.num_asta].spz[31],
-                                 wnf[i].spz[1],
-                                 wnf[i].spz[2]);
-        }
-      }
+    for (i = 0; i < fmax; i++)
+    {
       wtn_csv_output(fps_write,
                      bname, file_offset,
                      frame_no, i,
@@ -335,6 +324,10 @@ int main(int argc, char **argv)
   }
 
 main_finish:
+  for (i = 0; i < WTN_DEMUX_STREAMS; i++)
+  {
+    despike_set_free(&ds[i]);
+  }
   if (fp_read)
   {
     fclose(fp_read);
@@ -0,0 +1,205 @@
+/*! @file alsephash.c
+ *  @brief manifest of the tape files of register_*.sh command lists
+ *  @date 2026/10/18
+ *
+ *  Reads "xxx2pgcopy [opts] id filename" lines and prints, for every
+ *  line, the loader, the file_id, the decoder version of the loader, the
+ *  size and the CRC32C of the file and the command line, separated by
+ *  tabs. reload_archive.sh compares this with the manifest of the last
+ *  load to find the files to reload.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <getopt.h>
+
+#include "define.h"
+#include "error.h"
+#include "crc32c.h"
+#include "parallel.h"
+
+//! longest command line
+#define SIZE_LINE 4096
+
+typedef struct tag_entry {
+  char line[SIZE_LINE];
+
+  //! line split by strtok(), loader, file_id and filename are offsets into
+  //! it (the entries are moved by realloc())
+  char tokens[SIZE_LINE];
+  int loader;
+  int file_id;
+  int filename;
+  int version;
+  uint32_t crc;
+  int64_t size;
+  int error;
+} entry;
+
+typedef struct tag_loader_version {
+  const char *loader;
+  int version;
+} loader_version;
+
+static const loader_version versions[] = {
+  {"pse2pgcopy", DECODER_VERSION_PSE2PGCOPY},
+  {"wtn2pgcopy", DECODER_VERSION_WTN2PGCOPY},
+  {"wtn2pgcopy_lsg", DECODER_VERSION_WTN2PGCOPY_LSG},
+  {"wth2pgcopy", DECODER_VERSION_WTH2PGCOPY},
+};
+
+void usage(const char* cmd) {
+  fprintf(stderr, "%s [-j jobs] [command_list ...]\n", cmd);
+  fprintf(stderr, "  command_list: register_*.sh (stdin if none)\n");
+}
+
+/*!
+ * @brief decoder version of a loader (0 if unknown)
+ */
+static int decoder_version(const char *loader) {
+  size_t i;
+
+  for (i = 0; i < sizeof(versions) / sizeof(versions[0]); i++) {
+    if (strcmp(versions[i].loader, loader) == 0) {
+      return versions[i].version;
+    }
+  }
+  return 0;
+}
+
+/*!
+ * @brief split a command line into the loader, file_id and filename
+ *
+ * @return 0 on success, -1 for a comment, an empty or a broken line
+ */
+static int parse_line(entry *e, const char *line) {
+  char *tok[SIZE_LINE / 2];
+  char *p;
+  int n = 0;
+
+  strncpy(e->line, line, SIZE_LINE - 1);
+  e->line[SIZE_LINE - 1] = '\0';
+  e->line[strcspn(e->line, "\r\n")] = '\0';
+  if (e->line[strspn(e->line, " \t")] == '#') {
+    return -1;
+  }
+
+  strcpy(e->tokens, e->line);
+  for (p = strtok(e->tokens, " \t"); p != NULL; p = strtok(NULL, " \t")) {
+    tok[n++] = p;
+  }
+  if (n < 3) {
+    return -1;
+  }
+
+  p = strrchr(tok[0], '/');
+  e->loader = (int)(((p != NULL) ? p + 1 : tok[0]) - e->tokens);
+  e->file_id = (int)(tok[n - 2] - e->tokens);
+  e->filename = (int)(tok[n - 1] - e->tokens);
+  e->version = decoder_version(&e->tokens[e->loader]);
+  if (e->version == 0) {
+    log_printf(LOG_WARNING, __FILE__, __LINE__, "unknown loader: %s", &e->tokens[e->loader]);
+  }
+  return 0;
+}
+
+static void hash_job(int i, void *arg) {
+  entry *e = &((entry *)arg)[i];
+
+  e->error = crc32c_file(&e->tokens[e->filename], &e->crc, &e->size);
+}
+
+/*!
+ * @brief append the command lines of a file to the entries
+ */
+static int read_lines(FILE *f, entry **e, int *n, int *max) {
+  char line[SIZE_LINE];
+  entry *t;
+
+  while (fgets(line, sizeof(line), f) != NULL) {
+    if (*n >= *max) {
+      *max = (*max > 0) ? *max * 2 : 1024;
+      t = (entry *)realloc(*e, *max * sizeof(entry));
+      if (t == NULL) {
+        log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+        return -1;
+      }
+      *e = t;
+    }
+    if (parse_line(&(*e)[*n], line) == 0) {
+      (*n)++;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+
+  entry *e = NULL;
+  int n = 0, max = 0;
+  int i;
+  FILE *f;
+
+  // ----------------------------------------
+  // getopt
+  // ----------------------------------------
+  int ch;
+  extern char *optarg;
+  extern int optind, opterr;
+  int jobs = 0;
+
+  while ((ch = getopt(argc, argv, "j:")) != -1) {
+    switch(ch) {
+    case 'j':
+      jobs = atoi(optarg);
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  argc -= optind;
+  argv += optind;
+
+  // ----------------------------------------
+  // PROGRAM MAIN
+  // ----------------------------------------
+  if (argc == 0) {
+    if (read_lines(stdin, &e, &n, &max) < 0) {
+      free(e);
+      return EXIT_FAILURE;
+    }
+  }
+  for (i = 0; i < argc; i++) {
+    f = fopen(argv[i], "r");
+    if (f == NULL) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "no such file: %s", argv[i]);
+      free(e);
+      return EXIT_FAILURE;
+    }
+    if (read_lines(f, &e, &n, &max) < 0) {
+      fclose(f);
+      free(e);
+      return EXIT_FAILURE;
+    }
+    fclose(f);
+  }
+
+  parallel_for(n, jobs, hash_job, e);
+
+  // a file which cannot be read has size -1 and no CRC
+  for (i = 0; i < n; i++) {
+    printf("%s\t%s\t%d\t",
+           &e[i].tokens[e[i].loader], &e[i].tokens[e[i].file_id], e[i].version);
+    if (e[i].error) {
+      printf("-1\t-\t%s\n", e[i].line);
+    } else {
+      printf("%"PRId64"\t%08x\t%s\n", e[i].size, e[i].crc, e[i].line);
+    }
+  }
+
+  free(e);
+  return EXIT_SUCCESS;
+}
@@ -16,9 +16,13 @@
 #include "pse.h"
 #include "error.h"
 #include "util.h"
+#include "summary.h"
 
 void usage(const char* cmd) {
   fprintf(stderr, "%s [-rfd] filename\n", cmd);
+  fprintf(stderr, "%s -s [-j jobs] [-J|-Q] filename...\n", cmd);
+  fprintf(stderr, "  -s: summary of the headers of many files, -J: in JSON instead of CSV\n");
+  fprintf(stderr, "  -Q: the quality of every station as COPY data of file_quality (quality.sql)\n");
 }
 
 void display_frame(pse_frame pf) {
@@ -96,6 +100,9 @@ int main(int argc, char** argv) {
   int verbose_frame = 0;
   int verbose_record = 0;
   int verbose_data = 0;
+  int summary = 0;
+  int jobs = 0;
+  int summary_format = SUMMARY_FORMAT_CSV;
 
   long rec_offset, frame_offset;
 
@@ -117,7 +124,7 @@ int main(int argc, char** argv) {
   pse_record pr;
   pse_frame pf[MAX_PSE_FRAME+1];
   
-  while ((ch = getopt(argc, argv, "rfd")) != -1) {
+  while ((ch = getopt(argc, argv, "rfdsj:JQ")) != -1) {
     switch(ch) {
     case 'r':
       verbose_record = 1;
@@ -128,12 +135,32 @@ int main(int argc, char** argv) {
     case 'd':
       verbose_data = 1;
       break;
+    case 's':
+      summary = 1;
+      break;
+    case 'j':
+      jobs = atoi(optarg);
+      break;
+    case 'J':
+      summary_format = SUMMARY_FORMAT_JSON;
+      break;
+    case 'Q':
+      summary = 1;
+      summary_format = SUMMARY_FORMAT_PGCOPY;
+      break;
     default:
       usage(argv[0]);
       break;
     }
   }
   argc -= optind;
+  if (summary) {
+    if (argc < 1) {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    return summary_run(SUMMARY_TYPE_PSE, argv + optind, argc, jobs, summary_format);
+  }
   if (argc != 1){
     usage(argv[0]);
     return EXIT_FAILURE;
@@ -15,9 +15,13 @@
 #include "wth.h"
 #include "error.h"
 #include "util.h"
+#include "summary.h"
 
 static void usage(const char* cmd) {
   fprintf(stderr, "%s [-rfdi] filename\n", cmd);
+  fprintf(stderr, "%s -s [-j jobs] [-J|-Q] filename...\n", cmd);
+  fprintf(stderr, "  -s: summary of the headers of many files, -J: in JSON instead of CSV\n");
+  fprintf(stderr, "  -Q: the quality of every station as COPY data of file_quality (quality.sql)\n");
 }
 
 void display_frame(wth_frame whf) {
@@ -90,6 +94,9 @@ int main(int argc, char** argv) {
   int verbose_record = 0;
   int verbose_frame = 0;
   int verbose_data = 0;
+  int summary = 0;
+  int jobs = 0;
+  int summary_format = SUMMARY_FORMAT_CSV;
   int ignore_duplicated = 0;
   int select_package = -1;
 
@@ -107,7 +114,7 @@ int main(int argc, char** argv) {
   int num_header = 2;
 
   // 引数の確認
-  while ((ch=getopt(argc, argv, "rfdi"))!=-1) {
+  while ((ch=getopt(argc, argv, "rfdisj:JQ"))!=-1) {
     switch(ch) {
     case 'r':
       verbose_record = 1;
@@ -121,12 +128,32 @@ int main(int argc, char** argv) {
     case 'i':
       ignore_duplicated = 1;
       break;
+    case 's':
+      summary = 1;
+      break;
+    case 'j':
+      jobs = atoi(optarg);
+      break;
+    case 'J':
+      summary_format = SUMMARY_FORMAT_JSON;
+      break;
+    case 'Q':
+      summary = 1;
+      summary_format = SUMMARY_FORMAT_PGCOPY;
+      break;
     default:
       usage(argv[0]);
       break;
     }
   }
   argc -= optind;
+  if (summary) {
+    if (argc < 1) {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    return summary_run(SUMMARY_TYPE_WTH, argv + optind, argc, jobs, summary_format);
+  }
   if (argc != 1) {
     usage(argv[0]);
     return EXIT_FAILURE;
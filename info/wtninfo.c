@@ -16,9 +16,13 @@
 #include "wtn.h"
 #include "error.h"
 #include "util.h"
+#include "summary.h"
 
 void usage(const char* cmd) {
   fprintf(stderr, "%s [-rfdi] [-p package_id] filename\n", cmd);
+  fprintf(stderr, "%s -s [-j jobs] [-J|-Q] filename...\n", cmd);
+  fprintf(stderr, "  -s: summary of the headers of many files, -J: in JSON instead of CSV\n");
+  fprintf(stderr, "  -Q: the quality of every station as COPY data of file_quality (quality.sql)\n");
 }
 
 void display_frame(wtn_frame wnf) {
@@ -121,6 +125,9 @@ int main(int argc, char** argv) {
   int verbose_record = 0;
   int verbose_frame = 0;
   int verbose_data = 0;
+  int summary = 0;
+  int jobs = 0;
+  int summary_format = SUMMARY_FORMAT_CSV;
   int ignore_duplicated = 0;
   int select_package = -1;
   
@@ -141,7 +148,7 @@ int main(int argc, char** argv) {
   int fmax = -1;
   int num_header = 2;
 
-  while ((ch = getopt(argc, argv, "rfdip:")) != -1) {
+  while ((ch = getopt(argc, argv, "rfdip:sj:JQ")) != -1) {
     switch(ch) {
     case 'r':
       verbose_record = 1;
@@ -158,12 +165,32 @@ int main(int argc, char** argv) {
     case 'p':
       select_package = atoi(optarg);
       break;
+    case 's':
+      summary = 1;
+      break;
+    case 'j':
+      jobs = atoi(optarg);
+      break;
+    case 'J':
+      summary_format = SUMMARY_FORMAT_JSON;
+      break;
+    case 'Q':
+      summary = 1;
+      summary_format = SUMMARY_FORMAT_PGCOPY;
+      break;
     default:
       usage(argv[0]);
       break;
     }
   }
   argc -= optind;
+  if (summary) {
+    if (argc < 1) {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+    return summary_run(SUMMARY_TYPE_WTN, argv + optind, argc, jobs, summary_format);
+  }
   if (argc != 1){
     usage(argv[0]);
     return EXIT_FAILURE;
@@ -0,0 +1,233 @@
+/*! @file clock.c
+ *  @brief streaming correction of the frame time tags by a local linear clock model
+ *  @date 2026/10/18
+ *
+ *  The ground station time tags jitter around the frame clock of the
+ *  ALSEP. Frames are numbered by frame_count continuity (or by their time
+ *  tag when they are not counted) and a line time = a + b * index is
+ *  fitted to the last CLOCK_WINDOW good frames. A frame near the line
+ *  gets the fitted time, a frame off the line gets the prediction, and
+ *  CLOCK_JUMP_FRAMES consistent outliers restart the line.
+ */
+#include <stdint.h>
+#include <math.h>
+
+#include "define.h"
+#include "error.h"
+#include "clock.h"
+
+/*!
+ * @brief time of a frame index on the current line
+ */
+static double clock_value(const clock_model *c, int64_t k) {
+  return (double)c->t_base + c->a + c->b * (double)(k - c->k_base);
+}
+
+/*!
+ * @brief fit the line to the frames of the window
+ */
+static void clock_fit(clock_model *c) {
+  double mx = 0, my = 0, sxx = 0, sxy = 0, b;
+  int i;
+
+  for (i = 0; i < c->n; i++) {
+    mx += c->x[i];
+    my += c->y[i];
+  }
+  mx /= c->n;
+  my /= c->n;
+
+  b = (double)c->period;
+  if (c->n >= CLOCK_MIN_FIT) {
+    for (i = 0; i < c->n; i++) {
+      sxx += (c->x[i] - mx) * (c->x[i] - mx);
+      sxy += (c->x[i] - mx) * (c->y[i] - my);
+    }
+    // a rate more than 5% off the nominal one is not a clock
+    if (sxx > 0 && fabs(sxy / sxx - b) < b * 0.05) {
+      b = sxy / sxx;
+    }
+  }
+  c->b = b;
+  c->a = my - b * mx;
+}
+
+static void clock_add(clock_model *c, int64_t k, int64_t msec) {
+  c->x[c->head] = (double)(k - c->k_base);
+  c->y[c->head] = (double)(msec - c->t_base);
+  c->head = (c->head + 1) % CLOCK_WINDOW;
+  if (c->n < CLOCK_WINDOW) {
+    c->n++;
+  }
+}
+
+/*!
+ * @brief start a new line at a frame
+ */
+static void clock_restart(clock_model *c, int64_t k, int64_t msec) {
+  c->n = 0;
+  c->head = 0;
+  c->k_base = k;
+  c->t_base = msec;
+  c->njump = 0;
+  clock_add(c, k, msec);
+  clock_fit(c);
+}
+
+/*!
+ * @brief number of frames since the last frame
+ *
+ * frame_count gives the step modulo the cycle, the time tag gives the
+ * number of whole cycles. Without a count the step is taken from the time.
+ */
+static int64_t clock_step(const clock_model *c, int64_t msec, int32_t count, int usable) {
+  int64_t n = 1, dk, m;
+
+  if (usable) {
+    n = llround(((double)msec - clock_value(c, c->k)) / c->b);
+  }
+  if (c->modulo <= 0 || count < 0 || c->count < 0) {
+    return (n >= 1) ? n : 1;
+  }
+
+  dk = ((int64_t)count - c->count) % c->modulo;
+  if (dk < 0) {
+    dk += c->modulo;
+  }
+  if (!usable) {
+    return dk;
+  }
+  m = llround((double)(n - dk) / c->modulo);
+  return dk + ((m > 0) ? m : 0) * c->modulo;
+}
+
+/*!
+ * @brief keep an outlier as a candidate of a new clock
+ *
+ * @return 1 when CLOCK_JUMP_FRAMES outliers are on one line of the
+ * current rate and the model is restarted on them
+ */
+static int clock_jump(clock_model *c, int64_t k, int64_t msec) {
+  int i, last = c->njump - 1;
+
+  if (c->njump > 0 &&
+      fabs((double)(msec - c->jump_t[last]) - c->b * (double)(k - c->jump_k[last])) > CLOCK_TOLERANCE) {
+    c->njump = 0;
+  }
+  c->jump_k[c->njump] = k;
+  c->jump_t[c->njump] = msec;
+  c->njump++;
+  if (c->njump < CLOCK_JUMP_FRAMES) {
+    return 0;
+  }
+
+  clock_restart(c, c->jump_k[0], c->jump_t[0]);
+  for (i = 1; i < CLOCK_JUMP_FRAMES; i++) {
+    clock_add(c, c->jump_k[i], c->jump_t[i]);
+  }
+  clock_fit(c);
+  return 1;
+}
+
+/*!
+ * @brief initialize a clock model of a frame stream
+ *
+ * @param[in] period nominal msec per frame
+ * @param[in] modulo frame_count cycle, 0 when frames are not counted
+ */
+void clock_init(clock_model *c, int64_t period, int modulo) {
+  c->period = period;
+  c->modulo = modulo;
+  c->n = 0;
+  c->head = 0;
+  c->k_base = 0;
+  c->t_base = 0;
+  c->a = 0;
+  c->b = (double)period;
+  c->k = 0;
+  c->count = -1;
+  c->njump = 0;
+}
+
+/*!
+ * @brief corrected time of the next frame of the stream
+ *
+ * @param[in] msec time tag of the frame (msec_of_year)
+ * @param[in] count frame_count of the frame, -1 for a stream without it
+ * @param[in] error_flag error_flag of the frame by check_*_frame()
+ * @param[out] time_flag TIME_FLAG_* describing the correction
+ * @return corrected msec_of_year (the time tag while there is no model)
+ */
+int64_t clock_correct(clock_model *c, int64_t msec, int32_t count, uint32_t error_flag, uint32_t *time_flag) {
+  int64_t k, step, n;
+  uint32_t flag = 0;
+  double pred;
+  int usable = !(error_flag & ERROR_INVALID_DATETIME);
+
+  if (error_flag & (ERROR_INVALID_SYNC_CODE | ERROR_INVALID_FRAME_COUNTER)) {
+    count = -1;
+  }
+
+  if (c->n == 0) {
+    if (usable) {
+      clock_restart(c, c->k, msec);
+      c->count = count;
+    }
+    *time_flag = 0;
+    return msec;
+  }
+
+  if (!usable && count < 0) {
+    // nothing tells where the frame is, the clock is left as it is
+    *time_flag = TIME_FLAG_OUTLIER;
+    return llround(clock_value(c, c->k + 1));
+  }
+
+  step = clock_step(c, msec, count, usable);
+  if (count < 0 && c->modulo > 0 && c->count >= 0) {
+    count = (int32_t)((c->count + step) % c->modulo);
+  }
+  if (usable && step > CLOCK_MAX_GAP) {
+    clock_restart(c, c->k + step, msec);
+    c->k += step;
+    c->count = count;
+    *time_flag = TIME_FLAG_GAP;
+    return msec;
+  }
+
+  k = c->k + step;
+  pred = clock_value(c, k);
+  if (usable && step != 1 && fabs((double)msec - pred) > CLOCK_TOLERANCE &&
+      c->modulo > 0 && count >= 0) {
+    // a broken frame_count on a good time tag
+    n = llround(((double)msec - clock_value(c, c->k)) / c->b);
+    if (n >= 0 && n <= CLOCK_MAX_GAP &&
+        fabs((double)msec - clock_value(c, c->k + n)) <= CLOCK_TOLERANCE) {
+      step = n;
+      k = c->k + n;
+      pred = clock_value(c, k);
+      flag |= TIME_FLAG_COUNT_ERROR;
+    }
+  }
+  if (step > 1) {
+    flag |= TIME_FLAG_GAP;
+  }
+  c->k = k;
+  c->count = count;
+
+  if (usable && fabs((double)msec - pred) <= CLOCK_TOLERANCE) {
+    c->njump = 0;
+    clock_add(c, k, msec);
+    clock_fit(c);
+    *time_flag = flag | TIME_FLAG_FITTED;
+    return llround(clock_value(c, k));
+  }
+
+  if (usable && clock_jump(c, k, msec)) {
+    *time_flag = flag | TIME_FLAG_JUMP;
+    return llround(clock_value(c, k));
+  }
+
+  *time_flag = flag | TIME_FLAG_OUTLIER;
+  return llround(pred);
+}
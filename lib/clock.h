@@ -0,0 +1,57 @@
+/*! @file clock.h
+ *  @brief streaming correction of the frame time tags by a local linear clock model
+ *  @date 2026/10/18
+ */
+#ifndef __CLOCK_H__
+#define __CLOCK_H__
+
+#include <stdint.h>
+
+//! number of frames of the local linear fit
+#define CLOCK_WINDOW 32
+
+//! minimum number of frames to fit the rate (the nominal rate is used below)
+#define CLOCK_MIN_FIT 8
+
+//! consecutive consistent outliers taken as a clock jump
+#define CLOCK_JUMP_FRAMES 3
+
+//! frames missing longer than this restart the model instead of extrapolating
+#define CLOCK_MAX_GAP 900
+
+//! residual [msec] beyond which a time tag is an outlier
+#define CLOCK_TOLERANCE 100
+
+typedef struct tag_clock_model {
+  //! nominal msec per frame (VALID_FRAME_RATE or VALID_FRAME_RATE_WTH)
+  int64_t period;
+
+  //! frame_count cycle (90 for PSE/WTN), 0 when frames are not counted
+  int modulo;
+
+  //! frames of the fit: index relative to k_base, msec relative to t_base
+  double x[CLOCK_WINDOW];
+  double y[CLOCK_WINDOW];
+  int n;
+  int head;
+  int64_t k_base;
+  int64_t t_base;
+
+  //! time = t_base + a + b * (k - k_base)
+  double a;
+  double b;
+
+  //! index and frame_count of the last frame (-1 if unknown)
+  int64_t k;
+  int32_t count;
+
+  //! outliers which may start a new clock
+  int njump;
+  int64_t jump_k[CLOCK_JUMP_FRAMES];
+  int64_t jump_t[CLOCK_JUMP_FRAMES];
+} clock_model;
+
+void clock_init(clock_model *c, int64_t period, int modulo);
+int64_t clock_correct(clock_model *c, int64_t msec, int32_t count, uint32_t error_flag, uint32_t *time_flag);
+
+#endif
@@ -0,0 +1,127 @@
+/*! @file coincidence.c
+ *  @brief streaming association of triggers of several stations (coincidence trigger)
+ *  @date 2026/10/18
+ *
+ *  Triggers of all stations come in order of their switch on time (a
+ *  time-ordered merge of the per-station streams). The buffer holds only
+ *  the triggers within the window of the oldest one: when a trigger comes
+ *  later than that window, all triggers of the window are known. If they
+ *  are of at least min_stations stations, they are emitted as one event
+ *  and removed; otherwise only the oldest one is dropped and the window
+ *  moves to the next. The memory is bounded by the triggers of one
+ *  window, however long the stream is.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "coincidence.h"
+
+/*!
+ * @brief initialize
+ *
+ * @return 0 on success, -1 for invalid parameters
+ */
+int coinc_init(coinc *c, const coinc_param *p, coinc_emit_func emit, void *arg) {
+  memset(c, 0, sizeof(coinc));
+  if (p->window < 0 || p->min_stations < 1) {
+    return -1;
+  }
+  c->p = *p;
+  c->emit = emit;
+  c->arg = arg;
+  c->last = INT64_MIN;
+  return 0;
+}
+
+static int count_stations(uint32_t stations) {
+  int n = 0;
+
+  for (; stations != 0; stations &= stations - 1) {
+    n++;
+  }
+  return n;
+}
+
+/*!
+ * @brief decide the window of the oldest trigger
+ */
+static void decide(coinc *c) {
+  const coinc_trigger *t = &c->t[c->head];
+  coinc_event e;
+  int k;
+
+  memset(&e, 0, sizeof(e));
+  e.on = t[0].on;
+  e.off = t[0].off;
+  for (k = 0; k < c->n && t[k].on <= t[0].on + c->p.window; k++) {
+    e.stations |= 1U << t[k].apollo_station;
+    if (t[k].off > e.off) {
+      e.off = t[k].off;
+    }
+    if (t[k].ratio > e.ratio) {
+      e.ratio = t[k].ratio;
+    }
+  }
+  e.nstation = count_stations(e.stations);
+  if (e.nstation < c->p.min_stations) {
+    k = 1;
+  } else if (c->emit != NULL) {
+    c->emit(&e, t, k, c->arg);
+  }
+  c->head += k;
+  c->n -= k;
+}
+
+/*!
+ * @brief add a trigger
+ *
+ * A trigger switched on before the last one added, or of a station out
+ * of 0 ... COINC_MAX_STATION, is dropped.
+ *
+ * @return 0 on success, -1 for no memory
+ */
+int coinc_add(coinc *c, const coinc_trigger *t) {
+  coinc_trigger *x;
+
+  if (t->on < c->last || t->apollo_station < 0 || t->apollo_station > COINC_MAX_STATION) {
+    c->nlate++;
+    return 0;
+  }
+  c->last = t->on;
+  while (c->n > 0 && c->t[c->head].on + c->p.window < t->on) {
+    decide(c);
+  }
+
+  if (c->head + c->n >= c->max) {
+    if (c->head > 0) {
+      memmove(c->t, &c->t[c->head], c->n * sizeof(coinc_trigger));
+      c->head = 0;
+    }
+    if (c->n >= c->max) {
+      c->max = (c->max > 0) ? c->max * 2 : 64;
+      x = (coinc_trigger *)realloc(c->t, c->max * sizeof(coinc_trigger));
+      if (x == NULL) {
+        return -1;
+      }
+      c->t = x;
+    }
+  }
+  c->t[c->head + c->n] = *t;
+  c->n++;
+  return 0;
+}
+
+/*!
+ * @brief decide the triggers left at the end of the stream
+ */
+void coinc_flush(coinc *c) {
+  while (c->n > 0) {
+    decide(c);
+  }
+  c->head = 0;
+}
+
+void coinc_free(coinc *c) {
+  free(c->t);
+  c->t = NULL;
+  c->head = c->n = c->max = 0;
+}
@@ -0,0 +1,72 @@
+/*! @file coincidence.h
+ *  @brief streaming association of triggers of several stations (coincidence trigger)
+ *  @date 2026/10/18
+ */
+#ifndef __COINCIDENCE_H__
+#define __COINCIDENCE_H__
+
+#include <stdint.h>
+
+//! stations are bits of a mask
+#define COINC_MAX_STATION 31
+
+typedef struct tag_coinc_param {
+  //! largest time between the first and the last trigger of an event [msec]
+  int64_t window;
+
+  //! stations needed for an event
+  int min_stations;
+} coinc_param;
+
+//! trigger of a station, times are msec since the epoch
+typedef struct tag_coinc_trigger {
+  int64_t on;
+  int64_t off;
+  int apollo_station;
+  int channel;
+  double ratio;
+  double peak;
+} coinc_trigger;
+
+//! associated event
+typedef struct tag_coinc_event {
+  //! first switch on and last switch off of the triggers
+  int64_t on;
+  int64_t off;
+
+  //! bit k for apollo_station k
+  uint32_t stations;
+  int nstation;
+
+  //! largest ratio of the triggers
+  double ratio;
+} coinc_event;
+
+//! called for every event with its triggers in time order
+typedef void (*coinc_emit_func)(const coinc_event *e, const coinc_trigger *t, int n, void *arg);
+
+typedef struct tag_coinc {
+  coinc_param p;
+
+  //! triggers within the window of the first one, t[head] ... t[head+n-1]
+  coinc_trigger *t;
+  int head;
+  int n;
+  int max;
+
+  //! switch on of the last trigger
+  int64_t last;
+
+  //! triggers out of time order or of a station out of range (dropped)
+  uint64_t nlate;
+
+  coinc_emit_func emit;
+  void *arg;
+} coinc;
+
+int coinc_init(coinc *c, const coinc_param *p, coinc_emit_func emit, void *arg);
+int coinc_add(coinc *c, const coinc_trigger *t);
+void coinc_flush(coinc *c);
+void coinc_free(coinc *c);
+
+#endif
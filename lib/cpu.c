@@ -0,0 +1,89 @@
+/*! @file cpu.c
+ *  @brief choice of the SIMD versions of the kernels of a module from the CPU at run time
+ *  @date 2026/10/18
+ *
+ *  The CPU is probed once. A module takes the best of its versions the
+ *  CPU supports on the first call of a kernel; the choice is an atomic
+ *  int, so kernels may be called from many threads from the start.
+ */
+#include <pthread.h>
+#include "cpu.h"
+
+#ifdef __GNUC__
+#define LOAD_ISA(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE_ISA(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+#define LOAD_ISA(p) (*(p))
+#define STORE_ISA(p, v) (*(p) = (v))
+#endif
+
+static pthread_once_t cpu_once = PTHREAD_ONCE_INIT;
+static int cpu_best = CPU_ISA_SCALAR;
+
+static void detect_isa(void) {
+#ifdef CPU_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    cpu_best = CPU_ISA_AVX2;
+  } else if (__builtin_cpu_supports("sse4.2")) {
+    cpu_best = CPU_ISA_SSE42;
+  } else if (__builtin_cpu_supports("ssse3")) {
+    cpu_best = CPU_ISA_SSSE3;
+  }
+#endif
+}
+
+/*!
+ * @brief best instruction set of the CPU
+ */
+int cpu_isa(void) {
+  pthread_once(&cpu_once, detect_isa);
+  return cpu_best;
+}
+
+/*!
+ * @brief best version of a module the CPU supports
+ */
+static int best_version(const cpu_dispatch *d) {
+  int isa;
+
+  for (isa = cpu_isa(); isa > CPU_ISA_SCALAR; isa--) {
+    if (d->versions & CPU_ISA_BIT(isa)) {
+      return isa;
+    }
+  }
+  return CPU_ISA_SCALAR;
+}
+
+/*!
+ * @brief version of the kernels of a module in use, the best one from the first call
+ */
+int cpu_dispatch_isa(cpu_dispatch *d) {
+  int isa = LOAD_ISA(&d->isa);
+
+  if (isa == CPU_ISA_AUTO) {
+    isa = best_version(d);
+    STORE_ISA(&d->isa, isa);
+  }
+  return isa;
+}
+
+/*!
+ * @brief select the version of the kernels of a module (for tests and benchmarks)
+ *
+ * Not to be called while the kernels run on other threads.
+ *
+ * @param[in] isa CPU_ISA_* (CPU_ISA_AUTO for the best one)
+ * @return 0 on success, -1 if the module or the CPU does not have it
+ */
+int cpu_dispatch_set(cpu_dispatch *d, int isa) {
+  if (isa == CPU_ISA_AUTO) {
+    isa = best_version(d);
+  }
+  if (isa < CPU_ISA_SCALAR || isa >= CPU_NUM_ISA || isa > cpu_isa() ||
+      (isa != CPU_ISA_SCALAR && !(d->versions & CPU_ISA_BIT(isa)))) {
+    return -1;
+  }
+  STORE_ISA(&d->isa, isa);
+  return 0;
+}
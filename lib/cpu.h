@@ -0,0 +1,40 @@
+/*! @file cpu.h
+ *  @brief choice of the SIMD versions of the kernels of a module from the CPU at run time
+ *  @date 2026/10/18
+ */
+#ifndef __CPU_H__
+#define __CPU_H__
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CPU_X86
+#endif
+
+//! instruction sets in order: a CPU with one of them has those before it
+#define CPU_ISA_AUTO   -1
+#define CPU_ISA_SCALAR  0
+#define CPU_ISA_SSSE3   1
+#define CPU_ISA_SSE42   2
+#define CPU_ISA_AVX2    3
+#define CPU_NUM_ISA     4
+
+#define CPU_ISA_BIT(isa) (1U << (isa))
+
+/*!
+ * version of the kernels of a module: a module has a table of its
+ * kernels indexed by CPU_ISA_* and calls the one of cpu_dispatch_isa()
+ */
+typedef struct tag_cpu_dispatch {
+  //! CPU_ISA_BIT() of every version besides the scalar one
+  unsigned int versions;
+
+  //! version in use, CPU_ISA_AUTO until the first call
+  int isa;
+} cpu_dispatch;
+
+#define CPU_DISPATCH_INIT(versions) {(versions), CPU_ISA_AUTO}
+
+int cpu_isa(void);
+int cpu_dispatch_isa(cpu_dispatch *d);
+int cpu_dispatch_set(cpu_dispatch *d, int isa);
+
+#endif
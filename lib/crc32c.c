@@ -0,0 +1,172 @@
+/*! @file crc32c.c
+ *  @brief CRC32C (Castagnoli) of tape files (SSE4.2 with runtime dispatch)
+ *  @date 2026/10/18
+ *
+ *  The manifest of the archive identifies the content of a tape file by
+ *  its CRC32C. The SSE4.2 version uses the crc32 instruction on 8 bytes
+ *  at a time; the scalar version is table driven, 8 bytes at a time
+ *  (slicing-by-8). Both give the same value, the one of iSCSI (RFC 3720).
+ *  The version is chosen from the CPU (cpu.h); the crc32 instruction on
+ *  8 bytes needs x86-64.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "error.h"
+#include "cpu.h"
+#include "crc32c.h"
+
+#if defined(CPU_X86) && defined(__x86_64__)
+#define CRC32C_X86
+#include <immintrin.h>
+#endif
+
+//! reflected polynomial 0x1EDC6F41
+#define CRC32C_POLY 0x82f63b78U
+
+//! read size of crc32c_file()
+#define CRC32C_BUFFER (1 << 20)
+
+typedef uint32_t (*crc_func)(uint32_t crc, const unsigned char *p, size_t len);
+
+static uint32_t table[8][256];
+
+static void make_table(void) {
+  uint32_t c;
+  int i, j;
+
+  for (i = 0; i < 256; i++) {
+    c = (uint32_t)i;
+    for (j = 0; j < 8; j++) {
+      c = (c & 1) ? (c >> 1) ^ CRC32C_POLY : c >> 1;
+    }
+    table[0][i] = c;
+  }
+  for (i = 0; i < 256; i++) {
+    c = table[0][i];
+    for (j = 1; j < 8; j++) {
+      c = table[0][c & 0xff] ^ (c >> 8);
+      table[j][i] = c;
+    }
+  }
+}
+
+static uint32_t crc_scalar(uint32_t crc, const unsigned char *p, size_t len) {
+  uint32_t lo, hi;
+
+  while (len >= 8) {
+    lo = crc ^ ((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+    hi = (uint32_t)p[4] | ((uint32_t)p[5] << 8) | ((uint32_t)p[6] << 16) | ((uint32_t)p[7] << 24);
+    crc = table[7][lo & 0xff] ^ table[6][(lo >> 8) & 0xff] ^
+          table[5][(lo >> 16) & 0xff] ^ table[4][lo >> 24] ^
+          table[3][hi & 0xff] ^ table[2][(hi >> 8) & 0xff] ^
+          table[1][(hi >> 16) & 0xff] ^ table[0][hi >> 24];
+    p += 8;
+    len -= 8;
+  }
+  while (len--) {
+    crc = table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+#ifdef CRC32C_X86
+
+__attribute__((target("sse4.2")))
+static uint32_t crc_sse42(uint32_t crc, const unsigned char *p, size_t len) {
+  uint64_t c = crc, w;
+
+  while (len >= 8) {
+    memcpy(&w, p, 8);
+    c = _mm_crc32_u64(c, w);
+    p += 8;
+    len -= 8;
+  }
+  while (len--) {
+    c = _mm_crc32_u8((uint32_t)c, *p++);
+  }
+  return (uint32_t)c;
+}
+
+#endif
+
+static pthread_once_t table_once = PTHREAD_ONCE_INIT;
+static const crc_func versions[CPU_NUM_ISA] = {
+  [CPU_ISA_SCALAR] = crc_scalar,
+#ifdef CRC32C_X86
+  [CPU_ISA_SSE42] = crc_sse42,
+#endif
+};
+#ifdef CRC32C_X86
+static cpu_dispatch dispatch = CPU_DISPATCH_INIT(CPU_ISA_BIT(CPU_ISA_SSE42));
+#else
+static cpu_dispatch dispatch = CPU_DISPATCH_INIT(0);
+#endif
+
+/*!
+ * @brief select the version of the CRC (for tests and benchmarks)
+ *
+ * @param[in] isa CPU_ISA_SCALAR, CPU_ISA_SSE42 or CPU_ISA_AUTO
+ * @return 0 on success, -1 if the CPU does not support it
+ */
+int crc32c_set_isa(int isa) {
+  return cpu_dispatch_set(&dispatch, isa);
+}
+
+/*!
+ * @brief version of the CRC in use
+ */
+int crc32c_isa(void) {
+  return cpu_dispatch_isa(&dispatch);
+}
+
+/*!
+ * @brief continue a CRC32C over more data
+ *
+ * @param[in] crc CRC of the data so far (0 for none)
+ * @return CRC of the data so far and buf
+ */
+uint32_t crc32c_update(uint32_t crc, const void *buf, size_t len) {
+  pthread_once(&table_once, make_table);
+  return ~versions[cpu_dispatch_isa(&dispatch)](~crc, (const unsigned char *)buf, len);
+}
+
+/*!
+ * @brief CRC32C and size of a file
+ *
+ * @return 0 on success, -1 if the file cannot be read
+ */
+int crc32c_file(const char *filename, uint32_t *crc, int64_t *size) {
+  unsigned char *buf;
+  FILE *f;
+  size_t r;
+  int ret = 0;
+
+  f = fopen(filename, "rb");
+  if (f == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "no such file: %s", filename);
+    return -1;
+  }
+  buf = (unsigned char *)malloc(CRC32C_BUFFER);
+  if (buf == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+    fclose(f);
+    return -1;
+  }
+  *crc = 0;
+  *size = 0;
+  while ((r = fread(buf, 1, CRC32C_BUFFER, f)) > 0) {
+    *crc = crc32c_update(*crc, buf, r);
+    *size += (int64_t)r;
+  }
+  if (ferror(f)) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot read: %s", filename);
+    ret = -1;
+  }
+  free(buf);
+  fclose(f);
+  return ret;
+}
@@ -0,0 +1,17 @@
+/*! @file crc32c.h
+ *  @brief CRC32C (Castagnoli) of tape files (SSE4.2 with runtime dispatch)
+ *  @date 2026/10/18
+ */
+#ifndef __CRC32C_H__
+#define __CRC32C_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cpu.h"
+
+uint32_t crc32c_update(uint32_t crc, const void *buf, size_t len);
+int crc32c_file(const char *filename, uint32_t *crc, int64_t *size);
+int crc32c_isa(void);
+int crc32c_set_isa(int isa);
+
+#endif
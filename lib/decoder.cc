@@ -0,0 +1,404 @@
+/*! @file decoder.cc
+ *  @brief PSE/WTN frame decoders specialized on station, format and package at compile time
+ *  @date 2026/10/18
+ *
+ *  binary2pse_frame() and binary2wtn_frame() test the format, the station
+ *  and the package for every frame. Here the word layout of each case is
+ *  a constexpr table of (channel, index, group, field), and a decoder is
+ *  generated per case that stores every word with a fixed shift and mask,
+ *  so no branch is left but the even/odd frame of the tidal words.
+ *
+ *  binary2pse_frames() selects the decoder once per record; in WTN the
+ *  frames of the packages are interleaved, so binary2wtn_frames() selects
+ *  it per frame from a table indexed by the 3-bit package id.
+ *
+ *  The results are the same as binary2pse_frame()/binary2wtn_frame()
+ *  except spz of FORMAT_NEW (36-octet frames without SP data), which is
+ *  left 0 instead of being read from the next frame.
+ *
+ *  Built without exceptions and RTTI, the C tools link it without the C++
+ *  runtime.
+ */
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+extern "C" {
+#include <sys/types.h>
+#include "define.h"
+#include "util.h"
+#include "pse.h"
+#include "wtn.h"
+}
+
+namespace {
+
+// ------------------------------
+// 30-bit groups of three 10-bit words (a, b, c), 4 octets each,
+// from octet 12 of a frame
+// ------------------------------
+constexpr int OFFSET_GROUP = 12;
+
+enum field { FA, FB, FC };
+
+template <int Field>
+inline int32_t word(const unsigned char *frame, int group) {
+  const unsigned char *g = frame + OFFSET_GROUP + group * 4;
+  if constexpr (Field == FA) {
+    return ((int32_t)g[0] << 2) | (g[1] >> 6);
+  } else if constexpr (Field == FB) {
+    return ((int32_t)(g[1] & 0x1fU) << 5) | ((g[2] >> 3) & 0x1fU);
+  } else {
+    return ((int32_t)(g[2] & 0x03U) << 8) | (int32_t)g[3];
+  }
+}
+
+enum channel { SPZ, LPX, LPY, LPZ, LSM, LSG };
+
+//! a word of a frame stored to channel[index]
+struct slot {
+  int channel;
+  int index;
+  int group;
+  int field;
+};
+
+template <int Channel>
+inline int32_t *channel_of(pse_frame &pf) {
+  if constexpr (Channel == SPZ) return pf.spz;
+  else if constexpr (Channel == LPX) return pf.lpx;
+  else if constexpr (Channel == LPY) return pf.lpy;
+  else return pf.lpz;
+}
+
+template <int Channel>
+inline int32_t *channel_of(wtn_frame &wnf) {
+  if constexpr (Channel == SPZ) return wnf.spz;
+  else if constexpr (Channel == LPX) return wnf.lpx;
+  else if constexpr (Channel == LPY) return wnf.lpy;
+  else if constexpr (Channel == LPZ) return wnf.lpz;
+  else if constexpr (Channel == LSM) return wnf.lsm;
+  else return wnf.lsg;
+}
+
+/*!
+ * @brief store the words of a layout table (unrolled at compile time)
+ *
+ * Bias and Sign give value = Bias + Sign * word (511 - word for the LSG).
+ */
+template <const slot *Table, int Bias, int Sign, typename Frame, std::size_t... I>
+inline void scatter(Frame &f, const unsigned char *frame, std::index_sequence<I...>) {
+  ((channel_of<Table[I].channel>(f)[Table[I].index] =
+    Bias + Sign * word<Table[I].field>(frame, Table[I].group)), ...);
+}
+
+template <const slot *Table, std::size_t N, typename Frame>
+inline void scatter(Frame &f, const unsigned char *frame) {
+  scatter<Table, 0, 1>(f, frame, std::make_index_sequence<N>());
+}
+
+// ------------------------------
+// PSE
+// ------------------------------
+
+//! SP words of FORMAT_OLD but spz[11], spz[22] and spz[27]
+constexpr slot pse_spz_old[] = {
+  {SPZ,  1,  0, FA}, {SPZ,  2,  0, FB}, {SPZ,  3,  0, FC}, {SPZ,  4,  1, FB},
+  {SPZ,  5,  2, FA}, {SPZ,  6,  2, FC}, {SPZ,  7,  3, FA}, {SPZ,  8,  3, FB},
+  {SPZ,  9,  3, FC}, {SPZ, 10,  4, FA},
+  {SPZ, 12,  5, FA}, {SPZ, 13,  5, FC}, {SPZ, 14,  6, FB}, {SPZ, 15,  6, FC},
+  {SPZ, 16,  7, FB}, {SPZ, 17,  8, FA}, {SPZ, 18,  8, FC}, {SPZ, 19,  9, FA},
+  {SPZ, 20,  9, FC}, {SPZ, 21, 10, FB},
+  {SPZ, 23, 11, FB}, {SPZ, 24, 11, FC}, {SPZ, 25, 12, FA}, {SPZ, 26, 12, FB},
+  {SPZ, 28, 13, FA}, {SPZ, 29, 13, FC}, {SPZ, 30, 14, FB}, {SPZ, 31, 14, FC},
+};
+
+constexpr slot pse_lp_old[] = {
+  {LPX, 0,  1, FA}, {LPY, 0,  1, FC}, {LPZ, 0,  2, FB},
+  {LPX, 1,  4, FC}, {LPY, 1,  5, FB}, {LPZ, 1,  6, FA},
+  {LPX, 2,  9, FB}, {LPY, 2, 10, FA}, {LPZ, 2, 10, FC},
+  {LPX, 3, 12, FC}, {LPY, 3, 13, FB}, {LPZ, 3, 14, FA},
+};
+
+constexpr slot pse_lp_new[] = {
+  {LPX, 0, 0, FA}, {LPY, 0, 0, FB}, {LPZ, 0, 0, FC},
+  {LPX, 1, 1, FA}, {LPY, 1, 1, FB}, {LPZ, 1, 1, FC},
+  {LPX, 2, 3, FA}, {LPY, 2, 3, FB}, {LPZ, 2, 3, FC},
+  {LPX, 3, 4, FB}, {LPY, 3, 4, FC}, {LPZ, 3, 5, FA},
+};
+
+template <unsigned Format>
+struct pse_format_traits;
+
+template <>
+struct pse_format_traits<FORMAT_OLD> {
+  static constexpr bool has_sp = true;
+  static constexpr const slot *lp = pse_lp_old;
+  static constexpr std::size_t nlp = sizeof(pse_lp_old) / sizeof(slot);
+
+  //! tidal words (tidal x/z, tidal y/temperature), the other pair is DATA_NONE
+  static constexpr slot tidal1 = {0, 0, 7, FC};
+  static constexpr slot tidal2 = {0, 0, 8, FB};
+  static constexpr int32_t tidal_none = DATA_NONE;
+
+  static constexpr slot hk = {0, 0, 7, FA};
+  static constexpr slot cv = {0, 0, 11, FA};
+};
+
+template <>
+struct pse_format_traits<FORMAT_NEW> {
+  static constexpr bool has_sp = false;
+  static constexpr const slot *lp = pse_lp_new;
+  static constexpr std::size_t nlp = sizeof(pse_lp_new) / sizeof(slot);
+
+  //! the other pair is left 0 as binary2pse_frame() does
+  static constexpr slot tidal1 = {0, 0, 2, FB};
+  static constexpr slot tidal2 = {0, 0, 2, FC};
+  static constexpr int32_t tidal_none = 0;
+
+  static constexpr slot hk = {0, 0, 2, FA};
+  static constexpr slot cv = {0, 0, 4, FA};
+};
+
+template <unsigned Station>
+struct pse_station_traits {
+  //! spz[11] is interpolated at station 15, it is the word b of group 4 elsewhere
+  static constexpr bool interp_spz11 = (Station == ALSEP_PSE_APOLLO_STATION_15);
+
+  //! spz[22] is the word a of group 11 at station 14, interpolated elsewhere
+  static constexpr bool interp_spz22 = (Station != ALSEP_PSE_APOLLO_STATION_14);
+
+  //! command verification is in ALSEP word 5 at station 14 (FORMAT_OLD)
+  static constexpr bool cv_word5 = (Station == ALSEP_PSE_APOLLO_STATION_14);
+};
+
+template <unsigned Format, unsigned Station>
+void decode_pse(const pse_record &pr, const unsigned char *record, int size_part,
+                pse_frame *pf, int nframe) {
+  using F = pse_format_traits<Format>;
+  using S = pse_station_traits<Station>;
+
+  for (int i = 0; i < nframe; i++) {
+    const unsigned char *frame = record + SIZE_PSE_HEADER + size_part * i;
+    pse_frame &p = pf[i];
+    int32_t t1, t2;
+    bool even;
+
+    p = binary2pse_frame_header(pr, frame);
+
+    if constexpr (F::has_sp) {
+      scatter<pse_spz_old, sizeof(pse_spz_old) / sizeof(slot)>(p, frame);
+      if constexpr (S::interp_spz11) {
+        p.spz[11] = interp(p.spz[9], p.spz[10], p.spz[12], p.spz[13]);
+      } else {
+        p.spz[11] = word<FB>(frame, 4);
+      }
+      if constexpr (S::interp_spz22) {
+        p.spz[22] = interp(p.spz[20], p.spz[21], p.spz[23], p.spz[24]);
+      } else {
+        p.spz[22] = word<FA>(frame, 11);
+      }
+      p.spz[27] = interp(p.spz[25], p.spz[26], p.spz[28], p.spz[29]);
+    }
+
+    scatter<F::lp, F::nlp>(p, frame);
+
+    t1 = word<F::tidal1.field>(frame, F::tidal1.group);
+    t2 = word<F::tidal2.field>(frame, F::tidal2.group);
+    even = (p.frame_count % 2U == 0U);
+    p.TidX  = even ? t1 : F::tidal_none;
+    p.TidY  = even ? t2 : F::tidal_none;
+    p.TidZ  = even ? F::tidal_none : t1;
+    p.InstT = even ? F::tidal_none : t2;
+
+    p.hk = word<F::hk.field>(frame, F::hk.group);
+    if constexpr (Format == FORMAT_OLD && S::cv_word5) {
+      p.cv = p.alsep_word5 >> 1;
+    } else {
+      p.cv = word<F::cv.field>(frame, F::cv.group) >> 1;
+    }
+  }
+}
+
+typedef void (*pse_decoder)(const pse_record &, const unsigned char *, int, pse_frame *, int);
+
+//! a decoder of a station; stations other than 14 and 15 share the layout of station 12
+template <unsigned Format>
+pse_decoder pse_decoder_of(unsigned station) {
+  switch (station) {
+  case ALSEP_PSE_APOLLO_STATION_11: return decode_pse<Format, ALSEP_PSE_APOLLO_STATION_11>;
+  case ALSEP_PSE_APOLLO_STATION_14: return decode_pse<Format, ALSEP_PSE_APOLLO_STATION_14>;
+  case ALSEP_PSE_APOLLO_STATION_15: return decode_pse<Format, ALSEP_PSE_APOLLO_STATION_15>;
+  case ALSEP_PSE_APOLLO_STATION_16: return decode_pse<Format, ALSEP_PSE_APOLLO_STATION_16>;
+  default: return decode_pse<Format, ALSEP_PSE_APOLLO_STATION_12>;
+  }
+}
+
+// ------------------------------
+// WTN
+// ------------------------------
+
+//! SP words (groups 0-20) but spz[11], spz[22] and spz[27]
+constexpr slot wtn_spz[] = {
+  {SPZ,  1,  0, FA}, {SPZ,  2,  0, FC}, {SPZ,  3,  1, FB},
+  {SPZ,  4,  2, FA}, {SPZ,  5,  2, FC}, {SPZ,  6,  3, FB},
+  {SPZ,  7,  4, FA}, {SPZ,  8,  4, FC}, {SPZ,  9,  5, FB},
+  {SPZ, 10,  6, FA},                    {SPZ, 12,  7, FB},
+  {SPZ, 13,  8, FA}, {SPZ, 14,  8, FC}, {SPZ, 15,  9, FB},
+  {SPZ, 16, 10, FA}, {SPZ, 17, 10, FC}, {SPZ, 18, 11, FB},
+  {SPZ, 19, 12, FA}, {SPZ, 20, 12, FC}, {SPZ, 21, 13, FB},
+                     {SPZ, 23, 14, FC}, {SPZ, 24, 15, FB},
+  {SPZ, 25, 16, FA}, {SPZ, 26, 16, FC},
+  {SPZ, 28, 18, FA}, {SPZ, 29, 18, FC}, {SPZ, 30, 19, FB},
+  {SPZ, 31, 20, FA},
+};
+
+constexpr slot wtn_lp[] = {
+  {LPX, 0,  1, FC}, {LPY, 0,  2, FB}, {LPZ, 0,  3, FA},
+  {LPX, 1,  7, FA}, {LPY, 1,  7, FC}, {LPZ, 1,  8, FB},
+  {LPX, 2, 12, FB}, {LPY, 2, 13, FA}, {LPZ, 2, 13, FC},
+  {LPX, 3, 17, FC}, {LPY, 3, 18, FB}, {LPZ, 3, 19, FA},
+};
+
+constexpr slot wtn_lsm[] = {
+  {LSM, 0,  4, FB}, {LSM, 1,  5, FA}, {LSM, 2,  5, FC},
+  {LSM, 3, 15, FA}, {LSM, 4, 15, FC}, {LSM, 5, 16, FB},
+};
+
+//! LSG words of Apollo 17, stored as 511 - word
+constexpr slot wtn_lsg[] = {
+  {LSG,  0,  0, FA}, {LSG,  1,  0, FC}, {LSG,  2,  1, FB},
+  {LSG,  3,  2, FA}, {LSG,  4,  2, FC}, {LSG,  5,  3, FB},
+  {LSG,  6,  4, FA}, {LSG,  7,  4, FC}, {LSG,  8,  5, FB},
+  {LSG,  9,  6, FA}, {LSG, 10,  6, FC}, {LSG, 11,  7, FB},
+  {LSG, 12,  8, FA}, {LSG, 13,  8, FC}, {LSG, 14,  9, FB},
+  {LSG, 15, 10, FA}, {LSG, 16, 10, FC}, {LSG, 17, 11, FB},
+  {LSG, 18, 12, FA}, {LSG, 19, 12, FC}, {LSG, 20, 13, FB},
+  {LSG, 21, 14, FA}, {LSG, 22, 14, FC}, {LSG, 23, 15, FB},
+  {LSG, 24, 16, FA}, {LSG, 25, 16, FC}, {LSG, 26, 17, FB},
+  {LSG, 27, 18, FA}, {LSG, 28, 18, FC}, {LSG, 29, 19, FB},
+  {LSG, 30, 20, FA},
+};
+
+template <unsigned Package>
+struct wtn_package_traits {
+  static constexpr bool lsg = (Package == ALSEP_PACKAGE_ID_APOLLO_17);
+  static constexpr bool lsm = (Package == ALSEP_PACKAGE_ID_APOLLO_12 ||
+                               Package == ALSEP_PACKAGE_ID_APOLLO_15 ||
+                               Package == ALSEP_PACKAGE_ID_APOLLO_16);
+  static constexpr bool interp_spz11 = (Package == ALSEP_PACKAGE_ID_APOLLO_15);
+  static constexpr bool interp_spz22 = (Package != ALSEP_PACKAGE_ID_APOLLO_14);
+  static constexpr bool cv_lsm_stat = (Package == ALSEP_PACKAGE_ID_APOLLO_14);
+};
+
+template <unsigned Package>
+void decode_wtn(const wtn_record &wnr, const unsigned char *frame, wtn_frame &w) {
+  using P = wtn_package_traits<Package>;
+  bool even;
+  int32_t t1, t2;
+
+  w = binary2wtn_frame_header(wnr, frame);
+
+  if constexpr (P::lsg) {
+    scatter<wtn_lsg, 511, -1>(w, frame, std::make_index_sequence<sizeof(wtn_lsg) / sizeof(slot)>());
+    w.lsg_tide = 511 - word<FA>(frame, 7);
+    w.lsg_free = 511 - word<FC>(frame, 7);
+    w.lsg_temp = 511 - word<FB>(frame, 8);
+  } else {
+    scatter<wtn_spz, sizeof(wtn_spz) / sizeof(slot)>(w, frame);
+    if constexpr (P::interp_spz11) {
+      w.spz[11] = interp(w.spz[9], w.spz[10], w.spz[12], w.spz[13]);
+    } else {
+      w.spz[11] = word<FC>(frame, 6);
+    }
+    if constexpr (P::interp_spz22) {
+      w.spz[22] = interp(w.spz[20], w.spz[21], w.spz[23], w.spz[24]);
+    } else {
+      w.spz[22] = word<FA>(frame, 14);
+    }
+    w.spz[27] = interp(w.spz[25], w.spz[26], w.spz[28], w.spz[29]);
+
+    scatter<wtn_lp, sizeof(wtn_lp) / sizeof(slot)>(w, frame);
+
+    // tidal x/z and tidal y/temperature alternate, the other pair is left 0
+    t1 = word<FB>(frame, 10);
+    t2 = word<FA>(frame, 11);
+    even = (w.frame_count % 2U == 0U);
+    w.TidX  = even ? t1 : 0;
+    w.TidY  = even ? t2 : 0;
+    w.TidZ  = even ? 0 : t1;
+    w.InstT = even ? 0 : t2;
+
+    if constexpr (P::lsm) {
+      w.lsm_stat = word<FB>(frame, 0);
+      scatter<wtn_lsm, sizeof(wtn_lsm) / sizeof(slot)>(w, frame);
+    } else {
+      for (int i = 0; i < COUNTS_PER_FRAME_FOR_WTN_LSM; i++) {
+        w.lsm[i] = DATA_NONE;
+      }
+    }
+
+    w.hk = word<FC>(frame, 9);
+    if constexpr (P::cv_lsm_stat) {
+      w.cv = word<FB>(frame, 0) >> 1;
+    } else {
+      w.cv = word<FA>(frame, 14) >> 1;
+    }
+  }
+}
+
+typedef void (*wtn_decoder)(const wtn_record &, const unsigned char *, wtn_frame &);
+
+//! decoders indexed by the 3-bit package id (0, 6 and 7 are invalid ids)
+constexpr wtn_decoder wtn_decoders[8] = {
+  decode_wtn<0>, decode_wtn<1>, decode_wtn<2>, decode_wtn<3>,
+  decode_wtn<4>, decode_wtn<5>, decode_wtn<6>, decode_wtn<7>,
+};
+
+} // namespace
+
+/*!
+ * @brief decode the frames of a PSE record with the decoder of its format and station
+ *
+ * The links between frames (spz[0], time_diff, prev_frame, flags) are
+ * left to the caller as with binary2pse_frame().
+ *
+ * @param[in] pr PSE record
+ * @param[in] record binary data of the record (SIZE_RECORD octets)
+ * @param[out] pf frames
+ * @param[in] nframe number of frames, limited to 1 ... the frames in a record
+ * @return number of frames decoded
+ */
+extern "C" int binary2pse_frames(pse_record pr, const unsigned char *record, pse_frame *pf, int nframe) {
+  int size_part = (pr.format == FORMAT_OLD) ? SIZE_DATA_PART_OLD : SIZE_DATA_PART_NEW;
+  int max_frame = (SIZE_RECORD - SIZE_PSE_HEADER) / size_part;
+
+  if (nframe > max_frame) {
+    nframe = max_frame;
+  }
+  if (nframe < 1) {
+    nframe = 1;
+  }
+
+  if (pr.format == FORMAT_OLD) {
+    pse_decoder_of<FORMAT_OLD>(pr.apollo_station)(pr, record, size_part, pf, nframe);
+  } else {
+    pse_decoder_of<FORMAT_NEW>(pr.apollo_station)(pr, record, size_part, pf, nframe);
+  }
+  return nframe;
+}
+
+/*!
+ * @brief decode consecutive WTN frames with the decoder of their package
+ *
+ * @param[in] wnr WTN record
+ * @param[in] frames binary data of the frames (SIZE_FRAME octets each)
+ * @param[out] wnf frames
+ * @param[in] nframe number of frames
+ */
+extern "C" void binary2wtn_frames(wtn_record wnr, const unsigned char *frames, wtn_frame *wnf, int nframe) {
+  for (int i = 0; i < nframe; i++) {
+    const unsigned char *frame = frames + SIZE_FRAME * i;
+    wtn_decoders[frame[5] >> 5](wnr, frame, wnf[i]);
+  }
+}
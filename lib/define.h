@@ -12,9 +12,29 @@
 #define FLAG_FIRST_DATA_OF_FILE 0x0001
 #define FLAG_TOP_OF_RECORD      0x0002
 #define FLAG_FIRST_DATA_COPIED  0x0004
+//! process_flag: samples of the frame replaced by the despiker (despike.h)
+#define FLAG_DESPIKED           0x0008
+
+//! time_flag: "time" is fitted to the clock of the neighbouring frames
+#define TIME_FLAG_FITTED        0x0001
+//! time_flag: time tag off the clock, "time" is the prediction
+#define TIME_FLAG_OUTLIER       0x0002
+//! time_flag: the clock jumped and restarts at this frame
+#define TIME_FLAG_JUMP          0x0004
+//! time_flag: frames are missing before this frame
+#define TIME_FLAG_GAP           0x0008
+//! time_flag: frame_count off the sequence, the step is taken from the time tag
+#define TIME_FLAG_COUNT_ERROR   0x0010
 
 #define FRAME_COUNT_INIT -1
 
+//! version of the rows written by each loader, raised when its decoding
+//! changes so that reload_archive.sh reloads the files of the loader
+#define DECODER_VERSION_PSE2PGCOPY     1
+#define DECODER_VERSION_WTN2PGCOPY     1
+#define DECODER_VERSION_WTN2PGCOPY_LSG 1
+#define DECODER_VERSION_WTH2PGCOPY     1
+
 //! 64 word/frame, 1word=10bit, 1060bits/sec, (64*10/1060=603.77[msec])
 #define VALID_FRAME_RATE 604
 
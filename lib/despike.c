@@ -0,0 +1,455 @@
+/*! @file despike.c
+ *  @brief streaming running median / MAD removal of spikes and glitches of raw samples
+ *  @date 2026/10/18
+ *
+ *  Every sample is compared with the median of the DESPIKE_WINDOW samples
+ *  centred on it (a Hampel filter): it is replaced by the median when it
+ *  is off by more than DESPIKE_K times the median absolute deviation of
+ *  the window, and by more than DESPIKE_MIN_DEV counts, which keeps the
+ *  quiet 10-bit samples (MAD of 0 or 1 count) from being touched. The
+ *  medians are a 19 compare-exchange network (Paeth) on the raw samples,
+ *  so an isolated spike or a glitch of a few samples does not reach them
+ *  (a glitch of DESPIKE_HALF samples on a steep signal may raise the MAD
+ *  above it).
+ *
+ *  A stream is given a block at a time. The last DESPIKE_HALF raw samples
+ *  of a block are the history of the next one; the stream starts on
+ *  copies of its first sample and the samples at the end of a block are
+ *  judged with the samples before its last one mirrored after it (a
+ *  spike in the last sample is then once in its window, like any other),
+ *  so the output of a block is final when it returns.
+ *
+ *  The frame functions gather a channel of all good frames of a station
+ *  into one block, so a stream sees the samples of consecutive frames in
+ *  order. A frame with an error in DESPIKE_ERROR_MASK is left as it is and
+ *  restarts the streams of its station. Frames with replaced samples get
+ *  FLAG_DESPIKED in process_flag.
+ *
+ *  The kernel has an AVX2 version (cpu.h) that judges 8 windows at once.
+ *  The medians and deviations are integer compares, so the replaced
+ *  samples do not depend on the version.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "define.h"
+#include "despike.h"
+
+#ifdef CPU_X86
+#include <immintrin.h>
+#endif
+
+//! median of p[0] ... p[8] in p[4] by compare-exchanges SORT(a, b) (a <= b after)
+#define MEDIAN9(SORT, p) do {                                 \
+    SORT(p[1], p[2]); SORT(p[4], p[5]); SORT(p[7], p[8]);     \
+    SORT(p[0], p[1]); SORT(p[3], p[4]); SORT(p[6], p[7]);     \
+    SORT(p[1], p[2]); SORT(p[4], p[5]); SORT(p[7], p[8]);     \
+    SORT(p[0], p[3]); SORT(p[5], p[8]); SORT(p[4], p[7]);     \
+    SORT(p[3], p[6]); SORT(p[1], p[4]); SORT(p[2], p[5]);     \
+    SORT(p[4], p[7]); SORT(p[4], p[2]); SORT(p[6], p[4]);     \
+    SORT(p[4], p[2]);                                         \
+  } while (0)
+
+#define SORT_SCALAR(a, b) do {                  \
+    int32_t lo_ = ((a) < (b)) ? (a) : (b);      \
+    (b) = ((a) < (b)) ? (b) : (a);              \
+    (a) = lo_;                                  \
+  } while (0)
+
+typedef int (*kernel_func)(const int32_t *e, int n, int32_t *y, uint8_t *replaced);
+
+/*!
+ * @brief despike e[DESPIKE_HALF] ... e[DESPIKE_HALF + n - 1] into y[0] ... y[n - 1]
+ *
+ * @return number of samples replaced
+ */
+static int kernel_scalar(const int32_t *e, int n, int32_t *y, uint8_t *replaced) {
+  int32_t p[DESPIKE_WINDOW], x, med, thr;
+  int i, k, spike, m = 0;
+
+  for (i = 0; i < n; i++) {
+    for (k = 0; k < DESPIKE_WINDOW; k++) {
+      p[k] = e[i+k];
+    }
+    MEDIAN9(SORT_SCALAR, p);
+    med = p[4];
+    for (k = 0; k < DESPIKE_WINDOW; k++) {
+      p[k] = abs(e[i+k] - med);
+    }
+    MEDIAN9(SORT_SCALAR, p);
+    thr = DESPIKE_K * p[4];
+    if (thr < DESPIKE_MIN_DEV) {
+      thr = DESPIKE_MIN_DEV;
+    }
+    x = e[i+DESPIKE_HALF];
+    spike = (abs(x - med) > thr);
+    y[i] = spike ? med : x;
+    m += spike;
+    if (replaced != NULL) {
+      replaced[i] = spike;
+    }
+  }
+  return m;
+}
+
+#ifdef CPU_X86
+
+#define SORT_AVX2(a, b) do {                    \
+    __m256i lo_ = _mm256_min_epi32((a), (b));   \
+    (b) = _mm256_max_epi32((a), (b));           \
+    (a) = lo_;                                  \
+  } while (0)
+
+__attribute__((target("avx2")))
+static int kernel_avx2(const int32_t *e, int n, int32_t *y, uint8_t *replaced) {
+  const __m256i k = _mm256_set1_epi32(DESPIKE_K);
+  const __m256i min_dev = _mm256_set1_epi32(DESPIKE_MIN_DEV);
+  __m256i p[DESPIKE_WINDOW], x, med, thr, mask;
+  int i, j, bits, m = 0;
+
+  for (i = 0; i + 8 <= n; i += 8) {
+    for (j = 0; j < DESPIKE_WINDOW; j++) {
+      p[j] = _mm256_loadu_si256((const __m256i *)&e[i+j]);
+    }
+    x = p[DESPIKE_HALF];
+    MEDIAN9(SORT_AVX2, p);
+    med = p[4];
+    for (j = 0; j < DESPIKE_WINDOW; j++) {
+      p[j] = _mm256_abs_epi32(_mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)&e[i+j]), med));
+    }
+    MEDIAN9(SORT_AVX2, p);
+    thr = _mm256_max_epi32(_mm256_mullo_epi32(p[4], k), min_dev);
+    mask = _mm256_cmpgt_epi32(_mm256_abs_epi32(_mm256_sub_epi32(x, med)), thr);
+    _mm256_storeu_si256((__m256i *)&y[i], _mm256_blendv_epi8(x, med, mask));
+    bits = _mm256_movemask_ps(_mm256_castsi256_ps(mask));
+    m += __builtin_popcount(bits);
+    if (replaced != NULL) {
+      for (j = 0; j < 8; j++) {
+        replaced[i+j] = (bits >> j) & 1;
+      }
+    }
+  }
+  return m + kernel_scalar(&e[i], n - i, &y[i], (replaced != NULL) ? &replaced[i] : NULL);
+}
+
+#endif
+
+static const kernel_func versions[CPU_NUM_ISA] = {
+  [CPU_ISA_SCALAR] = kernel_scalar,
+#ifdef CPU_X86
+  [CPU_ISA_AVX2] = kernel_avx2,
+#endif
+};
+static cpu_dispatch dispatch = CPU_DISPATCH_INIT(CPU_ISA_BIT(CPU_ISA_AVX2));
+
+/*!
+ * @brief select the version of the kernel (for tests and benchmarks)
+ *
+ * @param[in] isa CPU_ISA_SCALAR, CPU_ISA_AVX2 or CPU_ISA_AUTO
+ * @return 0 on success, -1 if the CPU does not support it
+ */
+int despike_set_isa(int isa) {
+  return cpu_dispatch_set(&dispatch, isa);
+}
+
+/*!
+ * @brief version of the kernel in use
+ */
+int despike_isa(void) {
+  return cpu_dispatch_isa(&dispatch);
+}
+
+void despike_init(despiker *d) {
+  memset(d, 0, sizeof(despiker));
+}
+
+/*!
+ * @brief start a new stream (at a gap or a bad frame)
+ */
+void despike_reset(despiker *d) {
+  d->nhist = 0;
+}
+
+void despike_free(despiker *d) {
+  free(d->buf);
+  d->buf = NULL;
+  d->max = 0;
+}
+
+/*!
+ * @brief despike the next block of a stream in place
+ *
+ * @param[in,out] x n samples following the previous block
+ * @param[out] replaced 1 for the samples replaced, 0 for the others (may be NULL)
+ * @return number of samples replaced, -1 if no memory
+ */
+int despike(despiker *d, int32_t *x, int n, uint8_t *replaced) {
+  const int h = DESPIKE_HALF;
+  int32_t *b;
+  int k, m;
+
+  if (n <= 0) {
+    return 0;
+  }
+  if (n + 2 * h > d->max) {
+    b = (int32_t *)realloc(d->buf, (n + 2 * h) * sizeof(int32_t));
+    if (b == NULL) {
+      return -1;
+    }
+    d->buf = b;
+    d->max = n + 2 * h;
+  }
+  b = d->buf;
+  for (k = 0; k < h; k++) {
+    b[k] = (d->nhist > 0) ? d->hist[k] : x[0];
+  }
+  memcpy(&b[h], x, n * sizeof(int32_t));
+
+  // mirrored about the last sample, into the history for short blocks
+  for (k = 0; k < h; k++) {
+    b[h+n+k] = b[h+n-2-k];
+  }
+
+  m = versions[cpu_dispatch_isa(&dispatch)](b, n, x, replaced);
+
+  // the last raw samples
+  memcpy(d->hist, &b[n], h * sizeof(int32_t));
+  d->nhist = h;
+  return m;
+}
+
+void despike_set_init(despike_set *s) {
+  int c;
+
+  for (c = 0; c < DESPIKE_MAX_CHANNEL; c++) {
+    despike_init(&s->ch[c]);
+  }
+}
+
+static void despike_set_reset(despike_set *s) {
+  int c;
+
+  for (c = 0; c < DESPIKE_MAX_CHANNEL; c++) {
+    despike_reset(&s->ch[c]);
+  }
+}
+
+void despike_set_free(despike_set *s) {
+  int c;
+
+  for (c = 0; c < DESPIKE_MAX_CHANNEL; c++) {
+    despike_free(&s->ch[c]);
+  }
+}
+
+//! good frames of a station gathered for the streams of its channels
+typedef struct tag_frame_run {
+  int nch;
+  int count[DESPIKE_MAX_CHANNEL];
+
+  //! samples of channel c of frame i at x[c][i]
+  int32_t **x[DESPIKE_MAX_CHANNEL];
+  uint32_t **flag;
+  int n;
+} frame_run;
+
+static int run_init(frame_run *r, int nch, const int *count, int max) {
+  int c;
+
+  memset(r, 0, sizeof(frame_run));
+  r->nch = nch;
+  r->flag = (uint32_t **)malloc((max > 0 ? max : 1) * sizeof(uint32_t *));
+  for (c = 0; c < nch; c++) {
+    r->count[c] = count[c];
+    r->x[c] = (int32_t **)malloc((max > 0 ? max : 1) * sizeof(int32_t *));
+    if (r->x[c] == NULL) {
+      return -1;
+    }
+  }
+  return (r->flag == NULL) ? -1 : 0;
+}
+
+static void run_free(frame_run *r) {
+  int c;
+
+  for (c = 0; c < r->nch; c++) {
+    free(r->x[c]);
+  }
+  free(r->flag);
+}
+
+/*!
+ * @brief despike the channels of the gathered frames as the next blocks of their streams
+ *
+ * @return number of samples replaced, -1 if no memory
+ */
+static int run_flush(frame_run *r, despike_set *s) {
+  int32_t *block = NULL;
+  uint8_t *replaced = NULL;
+  int c, i, k, m, total = 0;
+
+  for (c = 0; c < r->nch && r->n > 0; c++) {
+    int count = r->count[c];
+
+    block = (int32_t *)malloc(r->n * count * sizeof(int32_t));
+    replaced = (uint8_t *)malloc(r->n * count);
+    if (block == NULL || replaced == NULL) {
+      total = -1;
+      break;
+    }
+    for (i = 0; i < r->n; i++) {
+      memcpy(&block[i*count], r->x[c][i], count * sizeof(int32_t));
+    }
+    m = despike(&s->ch[c], block, r->n * count, replaced);
+    if (m < 0) {
+      total = -1;
+      break;
+    }
+    for (i = 0; i < r->n && m > 0; i++) {
+      memcpy(r->x[c][i], &block[i*count], count * sizeof(int32_t));
+      for (k = 0; k < count; k++) {
+        if (replaced[i*count+k]) {
+          *r->flag[i] |= FLAG_DESPIKED;
+          break;
+        }
+      }
+    }
+    total += m;
+    free(block);
+    free(replaced);
+    block = NULL;
+    replaced = NULL;
+  }
+  free(block);
+  free(replaced);
+  r->n = 0;
+  return total;
+}
+
+/*!
+ * @brief despike the seismic channels of the frames of a PSE record
+ *
+ * Called on the records of a file in order, after check_pse_frame() and
+ * the interpolation of spz[0].
+ *
+ * @param[in] format FORMAT_OLD (spz and lp) or FORMAT_NEW (lp only)
+ * @return number of samples replaced, -1 if no memory
+ */
+int despike_pse_frames(despike_set *s, pse_frame *pf, int n, int format) {
+  const int count[4] = {COUNTS_PER_FRAME_FOR_PSE_LP, COUNTS_PER_FRAME_FOR_PSE_LP,
+                        COUNTS_PER_FRAME_FOR_PSE_LP, COUNTS_PER_FRAME_FOR_PSE_SP};
+  frame_run r;
+  int i, m, total = 0;
+
+  // spz only in the old format
+  if (run_init(&r, (format == FORMAT_OLD) ? 4 : 3, count, n) != 0) {
+    run_free(&r);
+    return -1;
+  }
+  for (i = 0; i <= n && total >= 0; i++) {
+    if (i == n || (pf[i].error_flag & DESPIKE_ERROR_MASK)) {
+      m = run_flush(&r, s);
+      total = (m < 0) ? -1 : total + m;
+      if (i < n) {
+        despike_set_reset(s);
+      }
+      continue;
+    }
+    r.x[0][r.n] = pf[i].lpx;
+    r.x[1][r.n] = pf[i].lpy;
+    r.x[2][r.n] = pf[i].lpz;
+    if (format == FORMAT_OLD) {
+      r.x[3][r.n] = pf[i].spz;
+    }
+    r.flag[r.n++] = &pf[i].process_flag;
+  }
+  run_free(&r);
+  return total;
+}
+
+/*!
+ * @brief despike the seismic channels of the frames of a WTN record
+ *
+ * Called on the records of a file in order, after wtn_demux_frames() and
+ * check_wtn_frame().
+ *
+ * @param[in,out] s WTN_DEMUX_STREAMS sets, one for each ALSEP package
+ * @return number of samples replaced, -1 if no memory
+ */
+int despike_wtn_frames(despike_set *s, wtn_frame *wnf, int n) {
+  const int count[4] = {COUNTS_PER_FRAME_FOR_WTN_LP, COUNTS_PER_FRAME_FOR_WTN_LP,
+                        COUNTS_PER_FRAME_FOR_WTN_LP, COUNTS_PER_FRAME_FOR_WTN_SP};
+  const int count_lsg[1] = {COUNTS_PER_FRAME_FOR_WTN_LSG};
+  frame_run r;
+  int p, i, m, total = 0;
+
+  for (p = 0; p < WTN_DEMUX_STREAMS && total >= 0; p++) {
+    int lsg = (p == ALSEP_PACKAGE_ID_APOLLO_17);
+
+    if (run_init(&r, lsg ? 1 : 4, lsg ? count_lsg : count, n) != 0) {
+      run_free(&r);
+      return -1;
+    }
+    for (i = 0; i <= n && total >= 0; i++) {
+      if (i < n && wtn_demux_stream(wnf[i].alsep_package_id) != p) {
+        continue;
+      }
+      if (i == n || (wnf[i].error_flag & DESPIKE_ERROR_MASK)) {
+        m = run_flush(&r, &s[p]);
+        total = (m < 0) ? -1 : total + m;
+        if (i < n) {
+          despike_set_reset(&s[p]);
+        }
+        continue;
+      }
+      if (lsg) {
+        r.x[0][r.n] = wnf[i].lsg;
+      } else {
+        r.x[0][r.n] = wnf[i].lpx;
+        r.x[1][r.n] = wnf[i].lpy;
+        r.x[2][r.n] = wnf[i].lpz;
+        r.x[3][r.n] = wnf[i].spz;
+      }
+      r.flag[r.n++] = &wnf[i].process_flag;
+    }
+    run_free(&r);
+  }
+  return total;
+}
+
+/*!
+ * @brief despike the geophone channels of the frames of a WTH record
+ *
+ * Called on the records of a file in order, after check_wth_frame().
+ *
+ * @return number of samples replaced, -1 if no memory
+ */
+int despike_wth_frames(despike_set *s, wth_frame *whf, int n) {
+  const int count[4] = {COUNTS_PER_FRAME_FOR_WTH_GP, COUNTS_PER_FRAME_FOR_WTH_GP,
+                        COUNTS_PER_FRAME_FOR_WTH_GP, COUNTS_PER_FRAME_FOR_WTH_GP};
+  frame_run r;
+  int i, m, total = 0;
+
+  if (run_init(&r, 4, count, n) != 0) {
+    run_free(&r);
+    return -1;
+  }
+  for (i = 0; i <= n && total >= 0; i++) {
+    if (i == n || (whf[i].error_flag & DESPIKE_ERROR_MASK)) {
+      m = run_flush(&r, s);
+      total = (m < 0) ? -1 : total + m;
+      if (i < n) {
+        despike_set_reset(s);
+      }
+      continue;
+    }
+    r.x[0][r.n] = whf[i].dp1;
+    r.x[1][r.n] = whf[i].dp6;
+    r.x[2][r.n] = whf[i].dp11;
+    r.x[3][r.n] = whf[i].dp16;
+    r.flag[r.n++] = &whf[i].process_flag;
+  }
+  run_free(&r);
+  return total;
+}
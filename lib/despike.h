@@ -0,0 +1,58 @@
+/*! @file despike.h
+ *  @brief streaming running median / MAD removal of spikes and glitches of raw samples
+ *  @date 2026/10/18
+ */
+#ifndef __DESPIKE_H__
+#define __DESPIKE_H__
+
+#include <stdint.h>
+#include "pse.h"
+#include "wtn.h"
+#include "wth.h"
+#include "wtn_demux.h"
+#include "cpu.h"
+
+//! window of the running median: DESPIKE_HALF samples on both sides
+#define DESPIKE_HALF 4
+#define DESPIKE_WINDOW (2 * DESPIKE_HALF + 1)
+
+//! a sample is replaced by the median if |x - median| > max(DESPIKE_K MAD, DESPIKE_MIN_DEV) [counts]
+#define DESPIKE_K 8
+#define DESPIKE_MIN_DEV 8
+
+//! frames with these errors are not despiked and restart the streams
+#define DESPIKE_ERROR_MASK 0xff00
+
+//! channels of a station
+#define DESPIKE_MAX_CHANNEL 5
+
+//! one channel: the last raw samples before the next block
+typedef struct tag_despiker {
+  int32_t hist[DESPIKE_HALF];
+  int nhist;
+
+  //! history, block and padding
+  int32_t *buf;
+  int max;
+} despiker;
+
+//! streams of a station (PSE/WTN: lpx, lpy, lpz, spz or lsg; WTH: dp1, dp6, dp11, dp16)
+typedef struct tag_despike_set {
+  despiker ch[DESPIKE_MAX_CHANNEL];
+} despike_set;
+
+void despike_init(despiker *d);
+void despike_reset(despiker *d);
+int despike(despiker *d, int32_t *x, int n, uint8_t *replaced);
+void despike_free(despiker *d);
+
+void despike_set_init(despike_set *s);
+void despike_set_free(despike_set *s);
+int despike_pse_frames(despike_set *s, pse_frame *pf, int n, int format);
+int despike_wtn_frames(despike_set *s, wtn_frame *wnf, int n);
+int despike_wth_frames(despike_set *s, wth_frame *whf, int n);
+
+int despike_isa(void);
+int despike_set_isa(int isa);
+
+#endif
@@ -23,9 +23,12 @@ void log_printf(int type, const char* filename, int line, char *format, ...) {
   char timestr[SIZE_TIME_STRING];
   va_list ap;
   time_t t = time(NULL);
-  struct tm* date = localtime(&t);
+  struct tm date;
 
-  strftime(timestr, (size_t)(SIZE_TIME_STRING-1), "%b %d %H:%M:%S", date);
+  //! may be called from the threads of parallel_for()
+  localtime_r(&t, &date);
+  strftime(timestr, (size_t)(SIZE_TIME_STRING-1), "%b %d %H:%M:%S", &date);
+  flockfile(stderr);
   fprintf(stderr, "%s ", timestr);
   
 
@@ -48,4 +51,6 @@ void log_printf(int type, const char* filename, int line, char *format, ...) {
   fprintf(stderr,"%s[%d] ", filename, line);
   vfprintf(stderr, format, ap);
   fprintf(stderr,"\n");
+  funlockfile(stderr);
+  va_end(ap);
 }
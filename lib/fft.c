@@ -0,0 +1,287 @@
+/*! @file fft.c
+ *  @brief radix-2 FFT of real sequences with precomputed tables
+ *  @date 2026/10/18
+ *
+ *  The analysis tools transform blocks of real samples, so only the real
+ *  FFT is provided: n real samples are packed into n/2 complex points,
+ *  transformed by an iterative radix-2 FFT and split into the n/2+1
+ *  coefficients of the real sequence. The bit reversal and the twiddle
+ *  factors are tabulated once per size by fft_init(); the transforms do
+ *  not allocate and can run on many threads with one plan. Spectra are
+ *  interleaved re/im arrays of n+2 doubles, and the inverse is scaled by
+ *  1/n, so fft_inverse(fft_forward(x)) is x.
+ *
+ *  fft_forward_batch() transforms many sequences of one size at once
+ *  (e.g. the segments of a Welch PSD). The sequences are interleaved in
+ *  a work buffer, point by point, so every butterfly loads its twiddle
+ *  factor once for the batch and the innermost loop runs over the batch
+ *  with unit stride, which the compiler vectorizes. It does the same
+ *  arithmetic as fft_forward(), so the results are equal bit for bit.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "fft.h"
+
+/*!
+ * @brief smallest power of two which is at least n (and FFT_MIN_SIZE)
+ */
+int fft_size(int n) {
+  int m = FFT_MIN_SIZE;
+
+  while (m < n) {
+    m *= 2;
+  }
+  return m;
+}
+
+/*!
+ * @brief tabulate the FFT of n real samples
+ *
+ * @param[in] n power of two, at least FFT_MIN_SIZE
+ * @return 0 on success, -1 for an invalid size or no memory
+ */
+int fft_init(fft_plan *p, int n) {
+  int m = n / 2;
+  int i, j, bits;
+
+  memset(p, 0, sizeof(fft_plan));
+  if (n < FFT_MIN_SIZE || (n & (n - 1)) != 0) {
+    return -1;
+  }
+  p->n = n;
+  p->rev = (int *)malloc(m * sizeof(int));
+  p->twiddle = (double *)malloc(2 * (m / 2) * sizeof(double));
+  p->split = (double *)malloc(2 * (m + 1) * sizeof(double));
+  if (p->rev == NULL || p->twiddle == NULL || p->split == NULL) {
+    fft_free(p);
+    return -1;
+  }
+
+  for (bits = 0; (1 << bits) < m; bits++);
+  for (i = 0; i < m; i++) {
+    for (j = 0, p->rev[i] = 0; j < bits; j++) {
+      p->rev[i] |= ((i >> j) & 1) << (bits - 1 - j);
+    }
+  }
+  for (i = 0; i < m / 2; i++) {
+    p->twiddle[2*i] = cos(2.0 * M_PI * i / m);
+    p->twiddle[2*i+1] = -sin(2.0 * M_PI * i / m);
+  }
+  for (i = 0; i <= m; i++) {
+    p->split[2*i] = cos(2.0 * M_PI * i / n);
+    p->split[2*i+1] = -sin(2.0 * M_PI * i / n);
+  }
+  return 0;
+}
+
+void fft_free(fft_plan *p) {
+  free(p->rev);
+  free(p->twiddle);
+  free(p->split);
+  memset(p, 0, sizeof(fft_plan));
+}
+
+/*!
+ * @brief in place complex FFT of n/2 interleaved points (conjugate twiddles if inverse)
+ */
+static void complex_fft(const fft_plan *p, double *z, int inverse) {
+  int m = p->n / 2;
+  double sign = inverse ? -1.0 : 1.0;
+  double wr, wi, tr, ti;
+  int i, j, k, len, half, step;
+
+  for (i = 0; i < m; i++) {
+    j = p->rev[i];
+    if (i < j) {
+      tr = z[2*i]; z[2*i] = z[2*j]; z[2*j] = tr;
+      ti = z[2*i+1]; z[2*i+1] = z[2*j+1]; z[2*j+1] = ti;
+    }
+  }
+
+  for (len = 2; len <= m; len *= 2) {
+    half = len / 2;
+    step = m / len;
+    for (i = 0; i < m; i += len) {
+      for (k = 0; k < half; k++) {
+        double *a = &z[2*(i+k)];
+        double *b = &z[2*(i+k+half)];
+
+        wr = p->twiddle[2*k*step];
+        wi = sign * p->twiddle[2*k*step+1];
+        tr = b[0] * wr - b[1] * wi;
+        ti = b[0] * wi + b[1] * wr;
+        b[0] = a[0] - tr;
+        b[1] = a[1] - ti;
+        a[0] += tr;
+        a[1] += ti;
+      }
+    }
+  }
+}
+
+/*!
+ * @brief the n/2+1 coefficients of n real samples from the complex FFT of their pairs
+ */
+static void split_forward(const fft_plan *p, double *z) {
+  int m = p->n / 2;
+  double er, ei, or_, oi, wr, wi, tr, ti;
+  int k;
+
+  // X[k] = E[k] + W^k O[k] for k and m-k at once
+  for (k = 1; k <= m / 2; k++) {
+    int l = m - k;
+    double zr = z[2*k], zi = z[2*k+1];
+    double yr = z[2*l], yi = z[2*l+1];
+
+    er = (zr + yr) / 2;
+    ei = (zi - yi) / 2;
+    or_ = (zi + yi) / 2;
+    oi = (yr - zr) / 2;
+    wr = p->split[2*k];
+    wi = p->split[2*k+1];
+    tr = or_ * wr - oi * wi;
+    ti = or_ * wi + oi * wr;
+    z[2*k] = er + tr;
+    z[2*k+1] = ei + ti;
+
+    if (l != k) {
+      // E[l] = conj(E[k]), O[l] = conj(O[k]), W^l = -conj(W^k)
+      tr = or_ * wr - oi * wi;
+      ti = or_ * wi + oi * wr;
+      z[2*l] = er - tr;
+      z[2*l+1] = -ei + ti;
+    }
+  }
+  er = z[0];
+  ei = z[1];
+  z[0] = er + ei;
+  z[1] = 0.0;
+  z[2*m] = er - ei;
+  z[2*m+1] = 0.0;
+}
+
+/*!
+ * @brief FFT of n real samples
+ *
+ * @param[in] x n samples
+ * @param[out] z n/2+1 coefficients (n+2 doubles, re/im), may not be x
+ */
+void fft_forward(const fft_plan *p, const double *x, double *z) {
+  // even samples as the real part, odd samples as the imaginary part
+  memcpy(z, x, p->n * sizeof(double));
+  complex_fft(p, z, 0);
+  split_forward(p, z);
+}
+
+/*!
+ * @brief inverse FFT of the n/2+1 coefficients of n real samples
+ *
+ * @param[in] z n/2+1 coefficients (n+2 doubles, re/im)
+ * @param[out] x n samples, may not be z
+ */
+void fft_inverse(const fft_plan *p, const double *z, double *x) {
+  int m = p->n / 2;
+  double er, ei, or_, oi, wr, wi, tr, ti;
+  double scale = 1.0 / m;
+  int k;
+
+  // Z[k] = E[k] + i O[k], E[k] = (X[k] + conj(X[m-k])) / 2,
+  // O[k] = (X[k] - conj(X[m-k])) / (2 W^k)
+  for (k = 0; k < m; k++) {
+    int l = m - k;
+
+    er = (z[2*k] + z[2*l]) / 2;
+    ei = (z[2*k+1] - z[2*l+1]) / 2;
+    tr = (z[2*k] - z[2*l]) / 2;
+    ti = (z[2*k+1] + z[2*l+1]) / 2;
+    wr = p->split[2*k];
+    wi = -p->split[2*k+1];
+    or_ = tr * wr - ti * wi;
+    oi = tr * wi + ti * wr;
+    x[2*k] = er - oi;
+    x[2*k+1] = ei + or_;
+  }
+  complex_fft(p, x, 1);
+  for (k = 0; k < p->n; k++) {
+    x[k] *= scale;
+  }
+}
+
+/*!
+ * @brief complex FFTs of n/2 points of count interleaved sequences
+ *
+ * Point i of sequence b is re z[2*i*count+b], im z[(2*i+1)*count+b].
+ */
+static void complex_fft_batch(const fft_plan *p, double *z, int count) {
+  int m = p->n / 2;
+  double wr, wi, tr, ti;
+  int i, j, k, b, len, half, step;
+
+  for (i = 0; i < m; i++) {
+    j = p->rev[i];
+    if (i < j) {
+      for (b = 0; b < 2 * count; b++) {
+        tr = z[2*i*count+b]; z[2*i*count+b] = z[2*j*count+b]; z[2*j*count+b] = tr;
+      }
+    }
+  }
+
+  for (len = 2; len <= m; len *= 2) {
+    half = len / 2;
+    step = m / len;
+    for (i = 0; i < m; i += len) {
+      for (k = 0; k < half; k++) {
+        double *ar = &z[2*(i+k)*count];
+        double *ai = ar + count;
+        double *br = &z[2*(i+k+half)*count];
+        double *bi = br + count;
+
+        wr = p->twiddle[2*k*step];
+        wi = p->twiddle[2*k*step+1];
+        for (b = 0; b < count; b++) {
+          tr = br[b] * wr - bi[b] * wi;
+          ti = br[b] * wi + bi[b] * wr;
+          br[b] = ar[b] - tr;
+          bi[b] = ai[b] - ti;
+          ar[b] += tr;
+          ai[b] += ti;
+        }
+      }
+    }
+  }
+}
+
+/*!
+ * @brief FFTs of count sequences of n real samples
+ *
+ * @param[in] x count sequences of n samples, one after another
+ * @param[in] count number of sequences
+ * @param[out] z count spectra of n+2 doubles, as fft_forward()
+ * @param[out] work n * count doubles
+ */
+void fft_forward_batch(const fft_plan *p, const double *x, int count, double *z, double *work) {
+  int m = p->n / 2;
+  int k, b;
+
+  // point i of sequence b: even sample re, odd sample im
+  for (b = 0; b < count; b++) {
+    const double *xb = &x[(size_t)b * p->n];
+
+    for (k = 0; k < m; k++) {
+      work[2*k*count+b] = xb[2*k];
+      work[(2*k+1)*count+b] = xb[2*k+1];
+    }
+  }
+  complex_fft_batch(p, work, count);
+
+  for (b = 0; b < count; b++) {
+    double *zb = &z[(size_t)b * (p->n + 2)];
+
+    for (k = 0; k < m; k++) {
+      zb[2*k] = work[2*k*count+b];
+      zb[2*k+1] = work[(2*k+1)*count+b];
+    }
+    split_forward(p, zb);
+  }
+}
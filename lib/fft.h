@@ -0,0 +1,35 @@
+/*! @file fft.h
+ *  @brief radix-2 FFT of real sequences with precomputed tables
+ *  @date 2026/10/18
+ */
+#ifndef __FFT_H__
+#define __FFT_H__
+
+//! smallest size of a plan
+#define FFT_MIN_SIZE 4
+
+/*!
+ * plan of the FFT of n real samples; a plan is read only after
+ * fft_init(), so one plan is shared by the threads
+ */
+typedef struct tag_fft_plan {
+  int n;
+
+  //! bit reversed index of the complex FFT of n/2 points
+  int *rev;
+
+  //! exp(-2 pi i k / (n/2)), k < n/4, interleaved re/im
+  double *twiddle;
+
+  //! exp(-2 pi i k / n), k <= n/2, interleaved re/im
+  double *split;
+} fft_plan;
+
+int fft_size(int n);
+int fft_init(fft_plan *p, int n);
+void fft_free(fft_plan *p);
+void fft_forward(const fft_plan *p, const double *x, double *z);
+void fft_inverse(const fft_plan *p, const double *z, double *x);
+void fft_forward_batch(const fft_plan *p, const double *x, int count, double *z, double *work);
+
+#endif
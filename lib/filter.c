@@ -0,0 +1,417 @@
+/*! @file filter.c
+ *  @brief polyphase FIR decimators and IIR bandpass sections of sample streams
+ *  @date 2026/10/18
+ *
+ *  A decimator by M is a Blackman windowed sinc lowpass of
+ *  2 FIR_HALF_TAPS M + 1 taps with the -6 dB point at FIR_PASS of the
+ *  output Nyquist frequency and unit gain at DC. Only every M-th output
+ *  of the filter is computed (the polyphase form: each output takes the
+ *  taps of all M phases once), so a block costs ntap multiplications per
+ *  output sample. Output j is centred on input j M since the reset; it is
+ *  made when input j M + delay arrives. The filter starts on copies of
+ *  the first sample and fir_decimator_flush() ends it on copies of the
+ *  last one, so the outputs at the ends of a run have no step.
+ *
+ *  The bandpass is a Butterworth highpass and lowpass, each a cascade of
+ *  biquads (bilinear transform with prewarping) computed in double. The
+ *  sections start at their steady state for the first sample, which
+ *  keeps the offset of the raw counts from ringing.
+ *
+ *  The FIR dot product has an AVX2 version (cpu.h). The scalar code keeps
+ *  FIR_LANES partial sums and reduces them pairwise like the vector
+ *  lanes, so a filtered stream is the same on every CPU.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "cpu.h"
+#include "filter.h"
+
+#ifdef CPU_X86
+#include <immintrin.h>
+#endif
+
+typedef float (*dot_func)(const float *h, const float *x, int n);
+
+/*!
+ * @brief sum of h[i] x[i] in FIR_LANES partial sums (n a multiple of FIR_LANES)
+ */
+static float dot_scalar(const float *h, const float *x, int n) {
+  float s[FIR_LANES] = {0.0f};
+  int i, k;
+
+  for (i = 0; i < n; i += FIR_LANES) {
+    for (k = 0; k < FIR_LANES; k++) {
+      s[k] += h[i+k] * x[i+k];
+    }
+  }
+  return ((s[0] + s[4]) + (s[2] + s[6])) + ((s[1] + s[5]) + (s[3] + s[7]));
+}
+
+#ifdef CPU_X86
+
+__attribute__((target("avx2")))
+static float dot_avx2(const float *h, const float *x, int n) {
+  __m256 s = _mm256_setzero_ps();
+  __m128 v;
+  int i;
+
+  for (i = 0; i < n; i += FIR_LANES) {
+    s = _mm256_add_ps(s, _mm256_mul_ps(_mm256_loadu_ps(&h[i]), _mm256_loadu_ps(&x[i])));
+  }
+  v = _mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(s, 1));
+  v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+  v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 1));
+  return _mm_cvtss_f32(v);
+}
+
+#endif
+
+static const dot_func versions[CPU_NUM_ISA] = {
+  [CPU_ISA_SCALAR] = dot_scalar,
+#ifdef CPU_X86
+  [CPU_ISA_AVX2] = dot_avx2,
+#endif
+};
+static cpu_dispatch dispatch = CPU_DISPATCH_INIT(CPU_ISA_BIT(CPU_ISA_AVX2));
+
+/*!
+ * @brief select the version of the kernels (for tests and benchmarks)
+ *
+ * @param[in] isa CPU_ISA_SCALAR, CPU_ISA_AVX2 or CPU_ISA_AUTO
+ * @return 0 on success, -1 if the CPU does not support it
+ */
+int filter_set_isa(int isa) {
+  return cpu_dispatch_set(&dispatch, isa);
+}
+
+/*!
+ * @brief version of the kernels in use
+ */
+int filter_isa(void) {
+  return cpu_dispatch_isa(&dispatch);
+}
+
+/*!
+ * @brief sum of h[i] x[i] (n a multiple of FIR_LANES)
+ */
+float filter_dot(const float *h, const float *x, int n) {
+  return versions[cpu_dispatch_isa(&dispatch)](h, x, n);
+}
+
+/*!
+ * @brief design the lowpass of a decimator
+ *
+ * @param[in] factor decimation factor, 2 ... FIR_MAX_FACTOR
+ * @return 0 on success, -1 for a bad factor or no memory
+ */
+int fir_decimator_init(fir_decimator *d, int factor) {
+  int taps, pad, k;
+  double fc, t, w, sum = 0.0;
+  double *h;
+
+  memset(d, 0, sizeof(fir_decimator));
+  if (factor < 2 || factor > FIR_MAX_FACTOR) {
+    return -1;
+  }
+  taps = 2 * FIR_HALF_TAPS * factor + 1;
+  d->factor = factor;
+  d->delay = FIR_HALF_TAPS * factor;
+  d->ntap = (taps + FIR_LANES - 1) / FIR_LANES * FIR_LANES;
+  pad = d->ntap - taps;
+
+  h = (double *)malloc(taps * sizeof(double));
+  d->h = (float *)calloc(d->ntap, sizeof(float));
+  d->buf = (float *)malloc((d->ntap - 1 + FIR_BLOCK) * sizeof(float));
+  if (h == NULL || d->h == NULL || d->buf == NULL) {
+    free(h);
+    fir_decimator_free(d);
+    return -1;
+  }
+
+  // windowed sinc of cutoff fc [cycles/sample]
+  fc = FIR_PASS * 0.5 / factor;
+  for (k = 0; k < taps; k++) {
+    t = k - d->delay;
+    w = 0.42 - 0.5 * cos(2.0 * M_PI * k / (taps - 1)) + 0.08 * cos(4.0 * M_PI * k / (taps - 1));
+    h[k] = (t == 0.0) ? 2.0 * fc : sin(2.0 * M_PI * fc * t) / (M_PI * t);
+    h[k] *= w;
+    sum += h[k];
+  }
+  for (k = 0; k < taps; k++) {
+    d->h[pad + k] = (float)(h[k] / sum);
+  }
+  free(h);
+  fir_decimator_reset(d);
+  return 0;
+}
+
+/*!
+ * @brief start a new run (at a gap of the input)
+ */
+void fir_decimator_reset(fir_decimator *d) {
+  d->nin = 0;
+  d->next = d->delay;
+}
+
+/*!
+ * @brief filter the input samples of one block
+ *
+ * The block is at buf[ntap - 1], after the last ntap - 1 samples.
+ */
+static int process_block(fir_decimator *d, int n, float *y) {
+  const int hist = d->ntap - 1;
+  int64_t p;
+  int m = 0;
+
+  // input nin + p completes an output over buf[p] ... buf[p + ntap - 1]
+  for (p = d->next - d->nin; p < n; p += d->factor) {
+    y[m++] = filter_dot(d->h, &d->buf[p], d->ntap);
+  }
+  d->next += (int64_t)m * d->factor;
+  d->nin += n;
+  memmove(d->buf, &d->buf[n], hist * sizeof(float));
+  return m;
+}
+
+/*!
+ * @brief filter and decimate samples of a run
+ *
+ * @param[in] x n samples following the previous ones of the run
+ * @param[out] y outputs completed by them (at most n / factor + 1)
+ * @return number of outputs
+ */
+int fir_decimator_process(fir_decimator *d, const float *x, int n, float *y) {
+  const int hist = d->ntap - 1;
+  int i, k, m, nout = 0;
+
+  if (n > 0 && d->nin == 0) {
+    for (k = 0; k < hist; k++) {
+      d->buf[k] = x[0];
+    }
+  }
+  for (i = 0; i < n; i += m) {
+    m = (n - i < FIR_BLOCK) ? n - i : FIR_BLOCK;
+    memcpy(&d->buf[hist], &x[i], m * sizeof(float));
+    nout += process_block(d, m, &y[nout]);
+  }
+  return nout;
+}
+
+/*!
+ * @brief end a run: the outputs up to its last sample, then reset
+ *
+ * @param[out] y outputs (at most delay / factor + 1 = FIR_HALF_TAPS + 1)
+ * @return number of outputs
+ */
+int fir_decimator_flush(fir_decimator *d, float *y) {
+  const int hist = d->ntap - 1;
+  float last;
+  int j, k, m, nout = 0;
+
+  if (d->nin > 0) {
+    last = d->buf[hist - 1];
+    for (k = d->delay; k > 0; k -= m) {
+      m = (k < FIR_BLOCK) ? k : FIR_BLOCK;
+      for (j = 0; j < m; j++) {
+        d->buf[hist + j] = last;
+      }
+      nout += process_block(d, m, &y[nout]);
+    }
+  }
+  fir_decimator_reset(d);
+  return nout;
+}
+
+void fir_decimator_free(fir_decimator *d) {
+  free(d->h);
+  free(d->buf);
+  d->h = NULL;
+  d->buf = NULL;
+}
+
+/*!
+ * @brief biquad of a Butterworth section
+ *
+ * @param[in] f0 corner frequency [cycles/sample]
+ * @param[in] q quality factor of the section
+ * @param[in] highpass 1 for a highpass, 0 for a lowpass
+ */
+static void design_section(iir_section *s, double f0, double q, int highpass) {
+  double w0 = 2.0 * M_PI * f0;
+  double c = cos(w0), alpha = sin(w0) / (2.0 * q);
+  double a0 = 1.0 + alpha;
+
+  if (highpass) {
+    s->b0 = (1.0 + c) / 2.0 / a0;
+    s->b1 = -(1.0 + c) / a0;
+  } else {
+    s->b0 = (1.0 - c) / 2.0 / a0;
+    s->b1 = (1.0 - c) / a0;
+  }
+  s->b2 = s->b0;
+  s->a1 = -2.0 * c / a0;
+  s->a2 = (1.0 - alpha) / a0;
+}
+
+/*!
+ * @brief design a Butterworth bandpass
+ *
+ * @param[in] order even order of the highpass and of the lowpass, 2 ... IIR_MAX_ORDER
+ * @param[in] lo highpass corner [Hz] (none if <= 0)
+ * @param[in] hi lowpass corner [Hz] (none if <= 0)
+ * @param[in] rate sample rate [Hz]
+ * @return 0 on success, -1 for bad corners or order
+ */
+int iir_bandpass_init(iir_bandpass *f, int order, double lo, double hi, double rate) {
+  int k;
+
+  memset(f, 0, sizeof(iir_bandpass));
+  if (order < 2 || order > IIR_MAX_ORDER || order % 2 != 0 || rate <= 0.0 ||
+      lo >= rate / 2.0 || hi >= rate / 2.0 || (lo > 0.0 && hi > 0.0 && lo >= hi)) {
+    return -1;
+  }
+  for (k = 0; k < order / 2; k++) {
+    double q = 1.0 / (2.0 * cos(M_PI * (2 * k + 1) / (2.0 * order)));
+
+    if (lo > 0.0) {
+      design_section(&f->s[f->n++], lo / rate, q, 1);
+    }
+    if (hi > 0.0) {
+      design_section(&f->s[f->n++], hi / rate, q, 0);
+    }
+  }
+  return 0;
+}
+
+/*!
+ * @brief start a new run (at a gap of the input)
+ */
+void iir_bandpass_reset(iir_bandpass *f) {
+  f->started = 0;
+}
+
+/*!
+ * @brief filter samples of a run (x and y may be the same)
+ */
+void iir_bandpass_process(iir_bandpass *f, const float *x, int n, float *y) {
+  iir_section *s;
+  double v, out;
+  int i, k;
+
+  if (n > 0 && !f->started) {
+    // steady state of every section for a constant x[0]
+    v = x[0];
+    for (k = 0; k < f->n; k++) {
+      s = &f->s[k];
+      out = v * (s->b0 + s->b1 + s->b2) / (1.0 + s->a1 + s->a2);
+      s->z1 = out - s->b0 * v;
+      s->z2 = s->b2 * v - s->a2 * out;
+      v = out;
+    }
+    f->started = 1;
+  }
+  for (i = 0; i < n; i++) {
+    v = x[i];
+    for (k = 0; k < f->n; k++) {
+      s = &f->s[k];
+      out = s->b0 * v + s->z1;
+      s->z1 = s->b1 * v - s->a1 * out + s->z2;
+      s->z2 = s->b2 * v - s->a2 * out;
+      v = out;
+    }
+    y[i] = (float)v;
+  }
+}
+
+/*!
+ * @brief set up the filters of a channel
+ *
+ * @param[in] rate sample rate [Hz]
+ * @param[in] factor decimation factor (1 for none)
+ * @param[in] lo, hi bandpass corners [Hz] (no bandpass if both <= 0)
+ * @return 0 on success, -1 for bad parameters or no memory
+ */
+int filter_chain_init(filter_chain *c, double rate, int factor, double lo, double hi) {
+  memset(c, 0, sizeof(filter_chain));
+  c->rate = rate;
+  if (lo > 0.0 || hi > 0.0) {
+    if (iir_bandpass_init(&c->bp, IIR_DEFAULT_ORDER, lo, hi, rate) != 0) {
+      return -1;
+    }
+    c->bandpass = 1;
+  }
+  if (factor != 1) {
+    if (fir_decimator_init(&c->dec, factor) != 0) {
+      return -1;
+    }
+    c->tmp = (float *)malloc(FIR_BLOCK * sizeof(float));
+    if (c->tmp == NULL) {
+      filter_chain_free(c);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/*!
+ * @brief filter samples of a run
+ *
+ * @param[out] y outputs (n without decimation, at most n / factor + 1 with it)
+ * @return number of outputs
+ */
+int filter_chain_process(filter_chain *c, const float *x, int n, float *y) {
+  int i, m, nout = 0;
+
+  if (c->dec.factor == 0) {
+    if (c->bandpass) {
+      iir_bandpass_process(&c->bp, x, n, y);
+    } else if (y != x) {
+      memmove(y, x, n * sizeof(float));
+    }
+    return n;
+  }
+  if (!c->bandpass) {
+    return fir_decimator_process(&c->dec, x, n, y);
+  }
+  for (i = 0; i < n; i += m) {
+    m = (n - i < FIR_BLOCK) ? n - i : FIR_BLOCK;
+    iir_bandpass_process(&c->bp, &x[i], m, c->tmp);
+    nout += fir_decimator_process(&c->dec, c->tmp, m, &y[nout]);
+  }
+  return nout;
+}
+
+/*!
+ * @brief end a run: the remaining outputs (at most FIR_HALF_TAPS + 1), then reset
+ *
+ * @return number of outputs
+ */
+int filter_chain_flush(filter_chain *c, float *y) {
+  int n = 0;
+
+  if (c->dec.factor != 0) {
+    n = fir_decimator_flush(&c->dec, y);
+  }
+  filter_chain_reset(c);
+  return n;
+}
+
+/*!
+ * @brief start a new run without the remaining outputs
+ */
+void filter_chain_reset(filter_chain *c) {
+  if (c->bandpass) {
+    iir_bandpass_reset(&c->bp);
+  }
+  if (c->dec.factor != 0) {
+    fir_decimator_reset(&c->dec);
+  }
+}
+
+void filter_chain_free(filter_chain *c) {
+  fir_decimator_free(&c->dec);
+  free(c->tmp);
+  c->tmp = NULL;
+}
@@ -0,0 +1,87 @@
+/*! @file filter.h
+ *  @brief polyphase FIR decimators and IIR bandpass sections of sample streams
+ *  @date 2026/10/18
+ */
+#ifndef __FILTER_H__
+#define __FILTER_H__
+
+#include <stdint.h>
+#include "cpu.h"
+
+//! taps of a decimator by M: 2 * FIR_HALF_TAPS * M + 1 (padded to a multiple of FIR_LANES)
+#define FIR_HALF_TAPS 10
+#define FIR_LANES 8
+
+//! cutoff of a decimator by M: FIR_PASS * rate / 2 / M
+#define FIR_PASS 0.8
+
+//! input samples filtered at once
+#define FIR_BLOCK 1024
+
+#define FIR_MAX_FACTOR 256
+
+//! biquads of a Butterworth highpass and lowpass of up to IIR_MAX_ORDER each
+#define IIR_MAX_ORDER 8
+#define IIR_MAX_SECTIONS IIR_MAX_ORDER
+#define IIR_DEFAULT_ORDER 4
+
+//! lowpass FIR decimator; output j is centred on input j * factor since the reset
+typedef struct tag_fir_decimator {
+  int factor;
+
+  //! taps (a multiple of FIR_LANES, zeros first) and the delay of the filter
+  int ntap;
+  int delay;
+  float *h;
+
+  //! ntap - 1 samples before the block, then the block
+  float *buf;
+
+  //! samples since the reset and the one which completes the next output
+  int64_t nin;
+  int64_t next;
+} fir_decimator;
+
+//! biquad in transposed direct form II
+typedef struct tag_iir_section {
+  double b0, b1, b2, a1, a2;
+  double z1, z2;
+} iir_section;
+
+//! cascade of biquads, started at the steady state of its first sample
+typedef struct tag_iir_bandpass {
+  int n;
+  iir_section s[IIR_MAX_SECTIONS];
+  int started;
+} iir_bandpass;
+
+//! optional bandpass and decimator of one channel
+typedef struct tag_filter_chain {
+  double rate;
+  int bandpass;
+  iir_bandpass bp;
+  fir_decimator dec;
+  float *tmp;
+} filter_chain;
+
+int fir_decimator_init(fir_decimator *d, int factor);
+void fir_decimator_reset(fir_decimator *d);
+int fir_decimator_process(fir_decimator *d, const float *x, int n, float *y);
+int fir_decimator_flush(fir_decimator *d, float *y);
+void fir_decimator_free(fir_decimator *d);
+
+int iir_bandpass_init(iir_bandpass *f, int order, double lo, double hi, double rate);
+void iir_bandpass_reset(iir_bandpass *f);
+void iir_bandpass_process(iir_bandpass *f, const float *x, int n, float *y);
+
+int filter_chain_init(filter_chain *c, double rate, int factor, double lo, double hi);
+int filter_chain_process(filter_chain *c, const float *x, int n, float *y);
+int filter_chain_flush(filter_chain *c, float *y);
+void filter_chain_reset(filter_chain *c);
+void filter_chain_free(filter_chain *c);
+
+float filter_dot(const float *h, const float *x, int n);
+int filter_isa(void);
+int filter_set_isa(int isa);
+
+#endif
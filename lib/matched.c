@@ -0,0 +1,438 @@
+/*! @file matched.c
+ *  @brief FFT normalized cross-correlation of many templates (matched filter)
+ *  @date 2026/10/18
+ *
+ *  A series is cut into blocks of nfft samples overlapping by the longest
+ *  template (overlap-save). The spectrum of a block is computed once and
+ *  multiplied by the stored conjugate spectra of a group of templates,
+ *  one inverse FFT per template gives the correlations of step = nfft -
+ *  len + 1 window positions. The windows are normalized by the running
+ *  sums of the block, so the correlation coefficient costs O(1) per
+ *  position; windows with a missing sample (NAN) are not correlated.
+ *
+ *  Templates are zero mean and unit norm; a stack is the normalized sum
+ *  of the normalized event windows. Template files are written in host
+ *  byte order with the magic MF_MAGIC.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "error.h"
+#include "util.h"
+#include "matched.h"
+
+#define MF_MAGIC "ALSEPMF1"
+
+//! longest line of an event list
+#define MF_EVENT_LINE 256
+
+//! window variance taken as flat (no correlation)
+#define MF_MIN_VARIANCE 1.0e-9
+
+/*!
+ * @brief tabulate the spectra of templates (all of one rate)
+ *
+ * @return 0 on success, -1 for no memory
+ */
+int mf_init(mf_plan *p, const mf_template *t, int nt) {
+  double *buf;
+  int i, j;
+
+  memset(p, 0, sizeof(mf_plan));
+  p->t = t;
+  p->nt = nt;
+  for (i = 0; i < nt; i++) {
+    if (t[i].n > p->len) {
+      p->len = t[i].n;
+    }
+  }
+  p->nfft = fft_size(4 * p->len);
+  p->step = p->nfft - p->len + 1;
+  if (fft_init(&p->fft, p->nfft) != 0) {
+    return -1;
+  }
+
+  p->spectrum = (double *)malloc((size_t)nt * (p->nfft + 2) * sizeof(double));
+  buf = (double *)calloc(p->nfft, sizeof(double));
+  if (p->spectrum == NULL || buf == NULL) {
+    free(buf);
+    mf_free(p);
+    return -1;
+  }
+  for (i = 0; i < nt; i++) {
+    double *z = &p->spectrum[(size_t)i * (p->nfft + 2)];
+
+    for (j = 0; j < p->nfft; j++) {
+      buf[j] = (j < t[i].n) ? t[i].x[j] : 0.0;
+    }
+    fft_forward(&p->fft, buf, z);
+    for (j = 0; j <= p->nfft / 2; j++) {
+      z[2*j+1] = -z[2*j+1];
+    }
+  }
+  free(buf);
+  return 0;
+}
+
+void mf_free(mf_plan *p) {
+  fft_free(&p->fft);
+  free(p->spectrum);
+  memset(p, 0, sizeof(mf_plan));
+}
+
+/*!
+ * @brief number of blocks of a series of n samples
+ */
+int64_t mf_blocks(const mf_plan *p, int64_t n) {
+  return (n + p->step - 1) / p->step;
+}
+
+static int add_detection(mf_detections *d, int t, int64_t index, double cc) {
+  mf_detection *x;
+
+  if (d->n >= d->max) {
+    d->max = (d->max > 0) ? d->max * 2 : 256;
+    x = (mf_detection *)realloc(d->d, d->max * sizeof(mf_detection));
+    if (x == NULL) {
+      return -1;
+    }
+    d->d = x;
+  }
+  d->d[d->n].t = t;
+  d->d[d->n].index = index;
+  d->d[d->n].cc = (float)cc;
+  d->n++;
+  return 0;
+}
+
+/*!
+ * @brief correlate a block of a series with templates t0 ... t1-1
+ *
+ * Appends the local maxima of the correlation coefficient of at least
+ * threshold to d.
+ *
+ * @param[in] x series (NAN where missing)
+ * @param[in] n number of samples of x
+ * @param[in] block block of the series (0 ... mf_blocks()-1)
+ * @return 0 on success, -1 for no memory
+ */
+int mf_correlate(const mf_plan *p, const float *x, int64_t n, int64_t block, int t0, int t1,
+                 double threshold, mf_detections *d) {
+  int nfft = p->nfft;
+  int64_t start = block * p->step;
+  double *y, *z, *c, *s1, *s2, *cc;
+  int *gap;
+  double mean = 0.0, var;
+  int64_t count = 0;
+  int i, j, k, len, last;
+  int ret = 0;
+
+  y = (double *)malloc(nfft * sizeof(double));
+  z = (double *)malloc((nfft + 2) * sizeof(double));
+  c = (double *)malloc((nfft + 2) * sizeof(double));
+  s1 = (double *)malloc((nfft + 1) * sizeof(double));
+  s2 = (double *)malloc((nfft + 1) * sizeof(double));
+  cc = (double *)malloc(p->step * sizeof(double));
+  gap = (int *)malloc((nfft + 1) * sizeof(int));
+  if (y == NULL || z == NULL || c == NULL || s1 == NULL || s2 == NULL || cc == NULL || gap == NULL) {
+    ret = -1;
+    goto correlate_finish;
+  }
+
+  // block without its mean, missing samples as 0, running sums
+  for (i = 0; i < nfft; i++) {
+    if (start + i < n && !isnan(x[start + i])) {
+      mean += x[start + i];
+      count++;
+    }
+  }
+  mean = (count > 0) ? mean / count : 0.0;
+  s1[0] = s2[0] = 0.0;
+  gap[0] = 0;
+  for (i = 0; i < nfft; i++) {
+    int missing = (start + i >= n || isnan(x[start + i]));
+
+    y[i] = missing ? 0.0 : x[start + i] - mean;
+    s1[i+1] = s1[i] + y[i];
+    s2[i+1] = s2[i] + y[i] * y[i];
+    gap[i+1] = gap[i] + missing;
+  }
+  fft_forward(&p->fft, y, z);
+
+  for (j = t0; j < t1; j++) {
+    const double *h = &p->spectrum[(size_t)j * (nfft + 2)];
+
+    len = p->t[j].n;
+    for (i = 0; i <= nfft / 2; i++) {
+      double zr = z[2*i], zi = z[2*i+1];
+
+      c[2*i] = zr * h[2*i] - zi * h[2*i+1];
+      c[2*i+1] = zr * h[2*i+1] + zi * h[2*i];
+    }
+    fft_inverse(&p->fft, c, y);
+
+    // windows starting in the block and ending in the series
+    last = p->step;
+    if (n - len + 1 - start < last) {
+      last = (int)(n - len + 1 - start);
+    }
+    for (k = 0; k < last; k++) {
+      cc[k] = 0.0;
+      if (gap[k + len] - gap[k] > 0) {
+        continue;
+      }
+      var = s2[k + len] - s2[k] - (s1[k + len] - s1[k]) * (s1[k + len] - s1[k]) / len;
+      if (var > MF_MIN_VARIANCE * len) {
+        cc[k] = y[k] / sqrt(var);
+      }
+    }
+    for (k = 0; k < last; k++) {
+      if (cc[k] >= threshold && (k == 0 || cc[k] >= cc[k-1]) && (k == last - 1 || cc[k] > cc[k+1])) {
+        if (add_detection(d, j, start + k, cc[k]) != 0) {
+          ret = -1;
+          goto correlate_finish;
+        }
+      }
+    }
+  }
+
+ correlate_finish:
+  free(y);
+  free(z);
+  free(c);
+  free(s1);
+  free(s2);
+  free(cc);
+  free(gap);
+  return ret;
+}
+
+static int compare_detection(const void *a, const void *b) {
+  const mf_detection *x = (const mf_detection *)a;
+  const mf_detection *y = (const mf_detection *)b;
+
+  if (x->t != y->t) {
+    return x->t - y->t;
+  }
+  if (x->index != y->index) {
+    return (x->index < y->index) ? -1 : 1;
+  }
+  return 0;
+}
+
+/*!
+ * @brief keep the best detection of a template within its length
+ */
+void mf_decluster(mf_detections *d, const mf_plan *p) {
+  int i, m = 0;
+
+  qsort(d->d, d->n, sizeof(mf_detection), compare_detection);
+  for (i = 0; i < d->n; i++) {
+    mf_detection *last = (m > 0) ? &d->d[m-1] : NULL;
+
+    if (last != NULL && last->t == d->d[i].t && d->d[i].index - last->index < p->t[last->t].n) {
+      if (d->d[i].cc > last->cc) {
+        *last = d->d[i];
+      }
+      continue;
+    }
+    d->d[m++] = d->d[i];
+  }
+  d->n = m;
+}
+
+/*!
+ * @brief add an event window, without its mean and normalized, to a stack
+ *
+ * @return 0 on success, -1 for a window with a missing sample or flat
+ */
+int mf_stack_add(double *sum, const float *x, int n) {
+  double mean = 0.0, norm = 0.0;
+  int i;
+
+  for (i = 0; i < n; i++) {
+    if (isnan(x[i])) {
+      return -1;
+    }
+    mean += x[i];
+  }
+  mean /= n;
+  for (i = 0; i < n; i++) {
+    norm += (x[i] - mean) * (x[i] - mean);
+  }
+  if (norm <= MF_MIN_VARIANCE * n) {
+    return -1;
+  }
+  norm = sqrt(norm);
+  for (i = 0; i < n; i++) {
+    sum[i] += (x[i] - mean) / norm;
+  }
+  return 0;
+}
+
+/*!
+ * @brief template of a stack (zero mean, unit norm)
+ *
+ * @return 0 on success, -1 for no memory or a flat stack
+ */
+int mf_stack_finish(mf_template *t, const double *sum, int n, int count) {
+  double mean = 0.0, norm = 0.0;
+  int i;
+
+  for (i = 0; i < n; i++) {
+    mean += sum[i];
+  }
+  mean /= n;
+  for (i = 0; i < n; i++) {
+    norm += (sum[i] - mean) * (sum[i] - mean);
+  }
+  if (norm <= 0.0) {
+    return -1;
+  }
+  t->x = (float *)malloc(n * sizeof(float));
+  if (t->x == NULL) {
+    return -1;
+  }
+  norm = sqrt(norm);
+  for (i = 0; i < n; i++) {
+    t->x[i] = (float)((sum[i] - mean) / norm);
+  }
+  t->n = n;
+  t->nstack = count;
+  return 0;
+}
+
+/*!
+ * @brief write templates
+ *
+ * @return 0 on success, -1 on a write error
+ */
+int mf_template_write(FILE *f, const mf_template *t, int nt) {
+  int32_t n = nt, v[4];
+  int i;
+
+  if (fwrite(MF_MAGIC, 1, 8, f) != 8 || fwrite(&n, sizeof(int32_t), 1, f) != 1) {
+    return -1;
+  }
+  for (i = 0; i < nt; i++) {
+    v[0] = t[i].apollo_station;
+    v[1] = t[i].channel;
+    v[2] = t[i].nstack;
+    v[3] = t[i].n;
+    if (fwrite(t[i].nest, 1, MF_NEST_SIZE, f) != MF_NEST_SIZE ||
+        fwrite(v, sizeof(int32_t), 4, f) != 4 ||
+        fwrite(&t[i].rate, sizeof(double), 1, f) != 1 ||
+        fwrite(&t[i].offset, sizeof(int64_t), 1, f) != 1 ||
+        fwrite(t[i].x, sizeof(float), t[i].n, f) != (size_t)t[i].n) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/*!
+ * @brief read templates written by mf_template_write()
+ *
+ * @param[out] t templates (to be freed by mf_template_free())
+ * @return 0 on success, -1 for a broken file or no memory
+ */
+int mf_template_read(FILE *f, mf_template **t, int *nt) {
+  char magic[8];
+  int32_t n, v[4];
+  mf_template *x;
+  int i;
+
+  if (fread(magic, 1, 8, f) != 8 || memcmp(magic, MF_MAGIC, 8) != 0 ||
+      fread(&n, sizeof(int32_t), 1, f) != 1 || n < 0) {
+    return -1;
+  }
+  x = (mf_template *)calloc((n > 0) ? n : 1, sizeof(mf_template));
+  if (x == NULL) {
+    return -1;
+  }
+  for (i = 0; i < n; i++) {
+    if (fread(x[i].nest, 1, MF_NEST_SIZE, f) != MF_NEST_SIZE ||
+        fread(v, sizeof(int32_t), 4, f) != 4 || v[3] <= 0 ||
+        fread(&x[i].rate, sizeof(double), 1, f) != 1 ||
+        fread(&x[i].offset, sizeof(int64_t), 1, f) != 1) {
+      mf_template_free(x, i);
+      return -1;
+    }
+    x[i].nest[MF_NEST_SIZE - 1] = '\0';
+    x[i].apollo_station = v[0];
+    x[i].channel = v[1];
+    x[i].nstack = v[2];
+    x[i].n = v[3];
+    x[i].x = (float *)malloc(x[i].n * sizeof(float));
+    if (x[i].x == NULL || fread(x[i].x, sizeof(float), x[i].n, f) != (size_t)x[i].n) {
+      mf_template_free(x, i + 1);
+      return -1;
+    }
+  }
+  *t = x;
+  *nt = n;
+  return 0;
+}
+
+void mf_template_free(mf_template *t, int nt) {
+  int i;
+
+  for (i = 0; i < nt; i++) {
+    free(t[i].x);
+  }
+  free(t);
+}
+
+/*!
+ * @brief read "datetime<TAB>deep_nest" lines (psql -At -F $'\t')
+ *
+ * Lines without a nest are skipped, invalid datetimes are warned.
+ *
+ * @return 0 on success, -1 on error
+ */
+int mf_event_read(const char *filename, mf_event **ev, int *n) {
+  char line[MF_EVENT_LINE];
+  char *tab;
+  mf_event *e = NULL, *t;
+  int max = 0;
+  FILE *f;
+
+  *n = 0;
+  f = fopen(filename, "r");
+  if (f == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "no such file: %s", filename);
+    return -1;
+  }
+  while (fgets(line, sizeof(line), f) != NULL) {
+    line[strcspn(line, "\r\n")] = '\0';
+    tab = strchr(line, '\t');
+    if (tab == NULL || tab[1] == '\0') {
+      continue;
+    }
+    *tab = '\0';
+    if (*n >= max) {
+      max = (max > 0) ? max * 2 : 1024;
+      t = (mf_event *)realloc(e, max * sizeof(mf_event));
+      if (t == NULL) {
+        log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+        free(e);
+        fclose(f);
+        return -1;
+      }
+      e = t;
+    }
+    if (date_string_to_epoch(line, &e[*n].epoch) != 0) {
+      log_printf(LOG_WARNING, __FILE__, __LINE__, "invalid datetime: %s", line);
+      continue;
+    }
+    strncpy(e[*n].nest, tab + 1, MF_NEST_SIZE - 1);
+    e[*n].nest[MF_NEST_SIZE - 1] = '\0';
+    (*n)++;
+  }
+  fclose(f);
+  *ev = e;
+  return 0;
+}
@@ -0,0 +1,92 @@
+/*! @file matched.h
+ *  @brief FFT normalized cross-correlation of many templates (matched filter)
+ *  @date 2026/10/18
+ */
+#ifndef __MATCHED_H__
+#define __MATCHED_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include "fft.h"
+
+//! longest deep_nest label
+#define MF_NEST_SIZE 32
+
+//! templates correlated with one block spectrum by a job of the tools
+#define MF_TEMPLATE_GROUP 16
+
+//! waveform template of a nest at a station and channel
+typedef struct tag_mf_template {
+  char nest[MF_NEST_SIZE];
+  int apollo_station;
+  int channel;
+
+  //! samples per second
+  double rate;
+
+  //! time of the first sample from the event time [msec]
+  int64_t offset;
+
+  //! number of event windows stacked
+  int nstack;
+
+  //! samples, zero mean and unit norm
+  float *x;
+  int n;
+} mf_template;
+
+//! catalogued event of a nest ("datetime<TAB>deep_nest" line of the event table)
+typedef struct tag_mf_event {
+  //! msec since the epoch
+  int64_t epoch;
+  char nest[MF_NEST_SIZE];
+} mf_event;
+
+//! local maximum of the correlation above the threshold
+typedef struct tag_mf_detection {
+  //! index of the template in the plan
+  int t;
+
+  //! sample of the series at the first sample of the template
+  int64_t index;
+  float cc;
+} mf_detection;
+
+//! list of detections (grown by mf_correlate())
+typedef struct tag_mf_detections {
+  mf_detection *d;
+  int n;
+  int max;
+} mf_detections;
+
+//! spectra of the templates of one station and channel
+typedef struct tag_mf_plan {
+  fft_plan fft;
+  int nfft;
+
+  //! longest template, correlations of one block
+  int len;
+  int step;
+
+  const mf_template *t;
+  int nt;
+
+  //! conjugate spectra of the templates (nfft+2 doubles each)
+  double *spectrum;
+} mf_plan;
+
+int mf_init(mf_plan *p, const mf_template *t, int nt);
+void mf_free(mf_plan *p);
+int64_t mf_blocks(const mf_plan *p, int64_t n);
+int mf_correlate(const mf_plan *p, const float *x, int64_t n, int64_t block, int t0, int t1,
+                 double threshold, mf_detections *d);
+void mf_decluster(mf_detections *d, const mf_plan *p);
+
+int mf_stack_add(double *sum, const float *x, int n);
+int mf_stack_finish(mf_template *t, const double *sum, int n, int count);
+int mf_template_write(FILE *f, const mf_template *t, int nt);
+int mf_template_read(FILE *f, mf_template **t, int *nt);
+void mf_template_free(mf_template *t, int nt);
+int mf_event_read(const char *filename, mf_event **ev, int *n);
+
+#endif
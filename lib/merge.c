@@ -0,0 +1,189 @@
+/*! @file merge.c
+ *  @brief time-ordered k-way merge of frame streams with removal of overlapping copies
+ *  @date 2026/10/18
+ *
+ *  The same station is recorded both on PSE tapes and on the normal bit
+ *  rate work tapes of 1976-1977. The sources are merged by a binary heap
+ *  holding the next frame of each source, so the memory does not depend
+ *  on the length of the sources. A frame of a station is held until the
+ *  next frame of the station comes: frames of other sources within the
+ *  tolerance are copies of it and only the one with the fewest errors is
+ *  returned.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "define.h"
+#include "error.h"
+#include "pse.h"
+#include "merge.h"
+
+//! longer than any year, so that keys of consecutive years do not overlap
+#define MERGE_MSEC_PER_YEAR (367LL * 86400000LL)
+
+/*!
+ * @brief sort key of a frame
+ */
+int64_t merge_key(int year, int64_t msec_of_year) {
+  return (int64_t)year * MERGE_MSEC_PER_YEAR + msec_of_year;
+}
+
+/*!
+ * @brief badness of an error_flag: errors of 0x0100 and above weigh more
+ *  than all the lower ones together
+ */
+static int merge_rank(uint32_t error_flag) {
+  int rank = 0;
+
+  for (; error_flag; error_flag &= error_flag - 1) {
+    rank += (error_flag & ~(error_flag - 1)) >= 0x0100 ? 16 : 1;
+  }
+  return rank;
+}
+
+static int heap_less(const merge_frame *a, const merge_frame *b) {
+  return (a->key < b->key) || (a->key == b->key && a->source < b->source);
+}
+
+static void heap_down(merger *m, int i) {
+  merge_frame t;
+  int c;
+
+  for (;;) {
+    c = 2 * i + 1;
+    if (c >= m->nheap) {
+      return;
+    }
+    if (c + 1 < m->nheap && heap_less(&m->heap[c + 1], &m->heap[c])) {
+      c++;
+    }
+    if (!heap_less(&m->heap[c], &m->heap[i])) {
+      return;
+    }
+    t = m->heap[i];
+    m->heap[i] = m->heap[c];
+    m->heap[c] = t;
+    i = c;
+  }
+}
+
+/*!
+ * @brief read the next frame of a source into a heap slot
+ *
+ * @return 1 for a frame, 0 at the end of the source
+ */
+static int read_source(merger *m, int s, merge_frame *mf) {
+  if (m->source[s].next(m->source[s].arg, mf) != 1) {
+    return 0;
+  }
+  mf->source = s;
+  mf->key = merge_key(mf->year, mf->pf.msec_of_year_corrected);
+  return 1;
+}
+
+/*!
+ * @brief start a merge reading the first frame of every source
+ *
+ * @param[in] source sources, kept by the merger until merge_free()
+ * @param[in] tolerance msec within which frames of different sources
+ *  are copies (MERGE_TOLERANCE for about half a PSE frame)
+ * @return 0 on success, -1 if memory cannot be allocated
+ */
+int merge_init(merger *m, const merge_source *source, int nsource, int64_t tolerance) {
+  int s, i;
+
+  memset(m, 0, sizeof(merger));
+  m->source = source;
+  m->nsource = nsource;
+  m->tolerance = tolerance;
+  m->heap = (merge_frame *)malloc((nsource > 0 ? nsource : 1) * sizeof(merge_frame));
+  if (m->heap == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+    return -1;
+  }
+
+  for (s = 0; s < nsource; s++) {
+    if (read_source(m, s, &m->heap[m->nheap])) {
+      m->nheap++;
+    }
+  }
+  for (i = m->nheap / 2 - 1; i >= 0; i--) {
+    heap_down(m, i);
+  }
+  return 0;
+}
+
+/*!
+ * @brief next frame of the merged stream
+ *
+ * Frames of each station come in time order with their copies removed.
+ * Frames of different stations may be returned up to one frame of the
+ * station out of order.
+ *
+ * @param[out] mf frame
+ * @return 1 for a frame, 0 at the end of all sources
+ */
+int merge_next(merger *m, merge_frame *mf) {
+  merge_frame cur;
+  merge_frame *h;
+  int64_t d;
+  int st, i;
+
+  for (;;) {
+    if (m->nheap == 0) {
+      // flush the held frames in time order
+      st = -1;
+      for (i = 0; i < MERGE_STATIONS; i++) {
+        if (m->valid[i] && (st < 0 || heap_less(&m->held[i], &m->held[st]))) {
+          st = i;
+        }
+      }
+      if (st < 0) {
+        return 0;
+      }
+      *mf = m->held[st];
+      m->valid[st] = 0;
+      return 1;
+    }
+
+    cur = m->heap[0];
+    if (!read_source(m, cur.source, &m->heap[0])) {
+      m->heap[0] = m->heap[--m->nheap];
+    }
+    heap_down(m, 0);
+
+    st = cur.apollo_station & (MERGE_STATIONS - 1);
+    h = &m->held[st];
+    if (!m->valid[st]) {
+      *h = cur;
+      m->valid[st] = 1;
+      continue;
+    }
+
+    d = cur.key - h->key;
+    if (d < 0) {
+      d = -d;
+    }
+    if (cur.source != h->source && d <= m->tolerance) {
+      m->nduplicate++;
+      if (merge_rank(cur.pf.error_flag) < merge_rank(h->pf.error_flag)) {
+        *h = cur;
+      }
+      continue;
+    }
+
+    *mf = *h;
+    *h = cur;
+    return 1;
+  }
+}
+
+/*!
+ * @brief release the merger (the sources are not closed)
+ */
+void merge_free(merger *m) {
+  free(m->heap);
+  m->heap = NULL;
+  m->nheap = 0;
+}
@@ -0,0 +1,82 @@
+/*! @file merge.h
+ *  @brief time-ordered k-way merge of frame streams with removal of overlapping copies
+ *  @date 2026/10/18
+ */
+#ifndef __MERGE_H__
+#define __MERGE_H__
+
+#include <stdint.h>
+#include "pse.h"
+
+//! apollo_station & 7 is unique for the stations 11 ... 17
+#define MERGE_STATIONS 8
+
+//! default distance [msec] within which two frames of a station are copies
+#define MERGE_TOLERANCE 300
+
+//! a decoded frame of a source in the columns of tbl_pse
+typedef struct tag_merge_frame {
+
+  //! sort key: year and msec_of_year_corrected in one number
+  int64_t key;
+
+  //! index of the source given to merge_init()
+  int source;
+
+  int apollo_station;
+  int year;
+
+  //! FORMAT_OLD or FORMAT_NEW (no SP data)
+  uint32_t format;
+
+  //! file_id, pos and length of the row
+  int file_id;
+  long pos;
+  int len;
+
+  pse_frame pf;
+
+} merge_frame;
+
+/*!
+ * @brief read the next frame of a source
+ *
+ * Frames of a station must come in time order. The function fills all
+ * fields of mf but key and source.
+ *
+ * @return 1 for a frame, 0 at the end of the source
+ */
+typedef int (*merge_next_func)(void *arg, merge_frame *mf);
+
+typedef struct tag_merge_source {
+  merge_next_func next;
+  void *arg;
+} merge_source;
+
+typedef struct tag_merger {
+
+  const merge_source *source;
+  int nsource;
+
+  //! msec within which frames of different sources are copies
+  int64_t tolerance;
+
+  //! min-heap of the next frame of each source
+  merge_frame *heap;
+  int nheap;
+
+  //! best copy so far of the next frame of each station
+  merge_frame held[MERGE_STATIONS];
+  int valid[MERGE_STATIONS];
+
+  //! number of copies dropped
+  uint64_t nduplicate;
+
+} merger;
+
+int merge_init(merger *m, const merge_source *source, int nsource, int64_t tolerance);
+int merge_next(merger *m, merge_frame *mf);
+void merge_free(merger *m);
+int64_t merge_key(int year, int64_t msec_of_year);
+
+#endif
@@ -0,0 +1,203 @@
+/*! @file parallel.c
+ *  @brief run independent jobs (e.g. one per file) on a pool of threads
+ *  @date 2026/10/18
+ *
+ *  The jobs are handed out one at a time from a shared counter, so a
+ *  thread that got small files picks up more of them and the pool stays
+ *  busy until the last job. The results are written by func into a slot
+ *  of its own (e.g. an array indexed by the job), no other locking is done.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "error.h"
+#include "parallel.h"
+
+#define PARALLEL_MAX_JOBS 256
+
+//! items formatted by one job of parallel_print()
+#define PARALLEL_PRINT_CHUNK 1024
+
+//! chunks per thread held in memory at a time by parallel_print()
+#define PARALLEL_PRINT_WINDOW 4
+
+typedef struct tag_print_chunk {
+  char *buf;
+  size_t size;
+} print_chunk;
+
+typedef struct tag_print_ctx {
+  int n;
+  int first;
+  print_chunk *chunk;
+  parallel_print_func func;
+  void *arg;
+} print_ctx;
+
+typedef struct tag_parallel_ctx {
+  int n;
+  int next;
+  pthread_mutex_t mutex;
+  parallel_func func;
+  void *arg;
+} parallel_ctx;
+
+/*!
+ * @brief number of online processors (at least 1)
+ */
+int parallel_default_jobs(void) {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  if (n < 1) {
+    return 1;
+  }
+  if (n > PARALLEL_MAX_JOBS) {
+    return PARALLEL_MAX_JOBS;
+  }
+  return (int)n;
+}
+
+static void *worker(void *p) {
+  parallel_ctx *ctx = (parallel_ctx *)p;
+  int i;
+
+  for (;;) {
+    pthread_mutex_lock(&ctx->mutex);
+    i = ctx->next++;
+    pthread_mutex_unlock(&ctx->mutex);
+    if (i >= ctx->n) {
+      break;
+    }
+    ctx->func(i, ctx->arg);
+  }
+  return NULL;
+}
+
+/*!
+ * @brief call func(i, arg) for i = 0 ... n-1 on up to jobs threads
+ *
+ * The calling thread takes part in the work. When a thread cannot be
+ * created the jobs are run by the threads already started.
+ *
+ * @param[in] n number of jobs
+ * @param[in] jobs number of threads (<= 0 for parallel_default_jobs())
+ * @param[in] func job function
+ * @param[in] arg argument passed to func
+ * @return number of threads used
+ */
+int parallel_for(int n, int jobs, parallel_func func, void *arg) {
+  pthread_t th[PARALLEL_MAX_JOBS];
+  parallel_ctx ctx;
+  int i, nth = 0;
+
+  if (jobs <= 0) {
+    jobs = parallel_default_jobs();
+  }
+  if (jobs > PARALLEL_MAX_JOBS) {
+    jobs = PARALLEL_MAX_JOBS;
+  }
+  if (jobs > n) {
+    jobs = n;
+  }
+
+  ctx.n = n;
+  ctx.next = 0;
+  ctx.func = func;
+  ctx.arg = arg;
+  pthread_mutex_init(&ctx.mutex, NULL);
+
+  for (i = 1; i < jobs; i++) {
+    if (pthread_create(&th[nth], NULL, worker, &ctx) != 0) {
+      log_printf(LOG_WARNING, __FILE__, __LINE__,
+                 "cannot create thread, running on %d threads", nth + 1);
+      break;
+    }
+    nth++;
+  }
+  worker(&ctx);
+  for (i = 0; i < nth; i++) {
+    pthread_join(th[i], NULL);
+  }
+  pthread_mutex_destroy(&ctx.mutex);
+
+  return nth + 1;
+}
+
+static void print_job(int c, void *p) {
+  print_ctx *ctx = (print_ctx *)p;
+  print_chunk *pc = &ctx->chunk[c];
+  FILE *out;
+  int i, first = ctx->first + c * PARALLEL_PRINT_CHUNK;
+
+  pc->buf = NULL;
+  pc->size = 0;
+  out = open_memstream(&pc->buf, &pc->size);
+  if (out == NULL) {
+    return;
+  }
+  for (i = first; i < first + PARALLEL_PRINT_CHUNK && i < ctx->n; i++) {
+    ctx->func(out, i, ctx->arg);
+  }
+  fclose(out);
+}
+
+/*!
+ * @brief print items 0 ... n-1 in order, formatting them on up to jobs threads
+ *
+ * Chunks of PARALLEL_PRINT_CHUNK items are formatted into memory
+ * concurrently and written to out in the order of the items, so the
+ * output is the same as calling func(out, i, arg) for i = 0 ... n-1.
+ * A chunk that cannot be buffered is printed directly.
+ *
+ * @param[in] out output stream
+ * @param[in] n number of items
+ * @param[in] jobs number of threads (<= 0 for parallel_default_jobs())
+ * @param[in] func print function of an item
+ * @param[in] arg argument passed to func
+ * @return 0 on success, -1 if out failed
+ */
+int parallel_print(FILE *out, int n, int jobs, parallel_print_func func, void *arg) {
+  print_ctx ctx;
+  int c, i, nchunk, window;
+
+  if (jobs <= 0) {
+    jobs = parallel_default_jobs();
+  }
+  window = jobs * PARALLEL_PRINT_WINDOW;
+  ctx.chunk = (print_chunk *)calloc(window, sizeof(print_chunk));
+  if (ctx.chunk == NULL) {
+    window = 0;
+  }
+  ctx.n = n;
+  ctx.func = func;
+  ctx.arg = arg;
+
+  for (ctx.first = 0; ctx.first < n; ctx.first += window * PARALLEL_PRINT_CHUNK) {
+    if (jobs == 1 || window == 0) {
+      for (i = ctx.first; i < n; i++) {
+        func(out, i, arg);
+      }
+      break;
+    }
+    nchunk = (n - ctx.first + PARALLEL_PRINT_CHUNK - 1) / PARALLEL_PRINT_CHUNK;
+    if (nchunk > window) {
+      nchunk = window;
+    }
+    parallel_for(nchunk, jobs, print_job, &ctx);
+
+    for (c = 0; c < nchunk; c++) {
+      if (ctx.chunk[c].buf == NULL) {
+        for (i = ctx.first + c * PARALLEL_PRINT_CHUNK;
+             i < ctx.first + (c + 1) * PARALLEL_PRINT_CHUNK && i < n; i++) {
+          func(out, i, arg);
+        }
+        continue;
+      }
+      fwrite(ctx.chunk[c].buf, 1, ctx.chunk[c].size, out);
+      free(ctx.chunk[c].buf);
+    }
+  }
+  free(ctx.chunk);
+
+  return ferror(out) ? -1 : 0;
+}
@@ -0,0 +1,20 @@
+/*! @file parallel.h
+ *  @brief run independent jobs (e.g. one per file) on a pool of threads
+ *  @date 2026/10/18
+ */
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+#include <stdio.h>
+
+//! called once for every index 0 ... n-1, from any of the threads
+typedef void (*parallel_func)(int index, void *arg);
+
+//! prints the item index to out, called for the items of a chunk in order
+typedef void (*parallel_print_func)(FILE *out, int index, void *arg);
+
+int parallel_default_jobs(void);
+int parallel_for(int n, int jobs, parallel_func func, void *arg);
+int parallel_print(FILE *out, int n, int jobs, parallel_print_func func, void *arg);
+
+#endif
@@ -0,0 +1,388 @@
+/*! @file psd.c
+ *  @brief Welch power spectral densities and PPSD histograms per station-day
+ *  @date 2026/10/18
+ *
+ *  A PSD is the mean of the periodograms of Hann windowed segments of
+ *  nseg samples overlapping by half (Welch), one-sided and in counts^2/Hz.
+ *  Segments with a missing sample (NAN) are left out; the segments of a
+ *  series are transformed PSD_BATCH at a time by fft_forward_batch().
+ *
+ *  For the probabilistic PSD (McNamara and Buland, 2004) the PSD of every
+ *  hour is averaged over one octave around band centres 1/8 octave apart,
+ *  starting one half octave below the Nyquist frequency. An hour with at
+ *  least half of its segments is counted in the histogram of its day, in
+ *  1 dB bins; the histograms of days add up to the PPSD of any period.
+ *
+ *  PSD files start with the magic PSD_MAGIC followed by psd_day records,
+ *  all in host byte order.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "psd.h"
+
+#define PSD_MAGIC "ALSEPPD1"
+
+//! fewest samples of a segment
+#define PSD_MIN_SEGMENT 16
+
+/*!
+ * @brief tabulate the segments and bands of a sample rate
+ *
+ * @param[in] rate samples per second
+ * @param[in] segment longest segment [sec]
+ * @return 0 on success, -1 for a too short segment or no memory
+ */
+int psd_init(psd_plan *p, double rate, double segment) {
+  double sum = 0.0, fhi, fc;
+  int i, k, n;
+
+  memset(p, 0, sizeof(psd_plan));
+  for (n = PSD_MIN_SEGMENT; 2.0 * n <= segment * rate; n *= 2);
+  if (n > segment * rate || fft_init(&p->fft, n) != 0) {
+    return -1;
+  }
+  p->rate = rate;
+  p->nseg = n;
+  p->nfreq = n / 2 + 1;
+
+  // bands from the highest down to the last one whose octave starts at
+  // bin 1 or above (an octave is then at least one bin wide)
+  fhi = rate / 2.0 / M_SQRT2;
+  for (k = 0; fhi * pow(2.0, -k / (double)PSD_BANDS_PER_OCTAVE) / M_SQRT2 * n / rate >= 1.0; k++);
+  p->nband = k;
+
+  p->taper = (double *)malloc(n * sizeof(double));
+  p->fc = (double *)malloc((p->nband > 0 ? p->nband : 1) * sizeof(double));
+  p->lo = (int *)malloc((p->nband > 0 ? p->nband : 1) * sizeof(int));
+  p->hi = (int *)malloc((p->nband > 0 ? p->nband : 1) * sizeof(int));
+  if (p->taper == NULL || p->fc == NULL || p->lo == NULL || p->hi == NULL) {
+    psd_free(p);
+    return -1;
+  }
+  for (i = 0; i < n; i++) {
+    p->taper[i] = 0.5 - 0.5 * cos(2.0 * M_PI * i / n);
+    sum += p->taper[i] * p->taper[i];
+  }
+  p->scale = 2.0 / (rate * sum);
+
+  // in order of frequency
+  for (k = 0; k < p->nband; k++) {
+    fc = fhi * pow(2.0, -k / (double)PSD_BANDS_PER_OCTAVE);
+    i = p->nband - 1 - k;
+    p->fc[i] = fc;
+    p->lo[i] = (int)ceil(fc / M_SQRT2 * n / rate);
+    p->hi[i] = (int)floor(fc * M_SQRT2 * n / rate);
+  }
+  return 0;
+}
+
+void psd_free(psd_plan *p) {
+  fft_free(&p->fft);
+  free(p->taper);
+  free(p->fc);
+  free(p->lo);
+  free(p->hi);
+  memset(p, 0, sizeof(psd_plan));
+}
+
+/*!
+ * @brief add the periodograms of the segments of a series
+ *
+ * @param[in] x samples, NAN where missing
+ * @param[in] n number of samples
+ * @param[in,out] sum nfreq one-sided periodograms [counts^2/Hz] added
+ * @return number of segments added, -1 for no memory
+ */
+int psd_welch(const psd_plan *p, const float *x, int64_t n, double *sum) {
+  int nseg = p->nseg, step = p->nseg / 2;
+  double *buf, *z, *work, mean, re, im, w;
+  int64_t start;
+  int i, k, b, nb = 0, count = 0;
+
+  if (n < nseg) {
+    return 0;
+  }
+  buf = (double *)malloc((size_t)PSD_BATCH * nseg * sizeof(double));
+  z = (double *)malloc((size_t)PSD_BATCH * (nseg + 2) * sizeof(double));
+  work = (double *)malloc((size_t)PSD_BATCH * nseg * sizeof(double));
+  if (buf == NULL || z == NULL || work == NULL) {
+    free(buf);
+    free(z);
+    free(work);
+    return -1;
+  }
+
+  for (start = 0; start + nseg <= n || nb > 0; start += step) {
+    if (start + nseg <= n) {
+      const float *s = &x[start];
+      double *d = &buf[(size_t)nb * nseg];
+
+      mean = 0.0;
+      for (i = 0; i < nseg && !isnan(s[i]); i++) {
+        mean += s[i];
+      }
+      if (i == nseg) {
+        mean /= nseg;
+        for (i = 0; i < nseg; i++) {
+          d[i] = (s[i] - mean) * p->taper[i];
+        }
+        nb++;
+      }
+      if (nb < PSD_BATCH && start + step + nseg <= n) {
+        continue;
+      }
+    }
+    if (nb == 0) {
+      continue;
+    }
+
+    fft_forward_batch(&p->fft, buf, nb, z, work);
+    for (b = 0; b < nb; b++) {
+      const double *zb = &z[(size_t)b * (nseg + 2)];
+
+      for (k = 0; k < p->nfreq; k++) {
+        re = zb[2*k];
+        im = zb[2*k+1];
+        w = (k == 0 || k == p->nfreq - 1) ? p->scale / 2.0 : p->scale;
+        sum[k] += (re * re + im * im) * w;
+      }
+    }
+    count += nb;
+    nb = 0;
+  }
+  free(buf);
+  free(z);
+  free(work);
+  return count;
+}
+
+/*!
+ * @brief octave averages of a PSD in dB (NAN for no power)
+ *
+ * @param[in] psd nfreq values [counts^2/Hz]
+ * @param[out] db nband values [dB]
+ */
+void psd_bands(const psd_plan *p, const double *psd, float *db) {
+  double mean;
+  int b, k;
+
+  for (b = 0; b < p->nband; b++) {
+    mean = 0.0;
+    for (k = p->lo[b]; k <= p->hi[b]; k++) {
+      mean += psd[k];
+    }
+    mean /= p->hi[b] - p->lo[b] + 1;
+    db[b] = (mean > 0.0) ? (float)(10.0 * log10(mean)) : NAN;
+  }
+}
+
+/*!
+ * @brief PSDs of a station and channel for a day
+ *
+ * @param[in] s series (of any station and channel) holding the day
+ * @param[in] ns number of series
+ * @param[in] day 00:00 of the day [msec since the epoch]
+ * @param[out] d PSDs of the day (psd_day_free())
+ * @return 0 on success, 1 if no segment is in the day, -1 for no memory
+ */
+int psd_day_compute(const psd_plan *p, const samples_series *s, int ns,
+                    int apollo_station, int channel, int64_t day, psd_day *d) {
+  double *sum, *total;
+  int64_t t0, t1, i0, i1, ntotal = 0;
+  int64_t expected = ((int64_t)(PSD_HOUR_MSEC / 1000 * p->rate) - p->nseg) / (p->nseg / 2) + 1;
+  int h, j, k, c, bin, ret = -1;
+
+  memset(d, 0, sizeof(psd_day));
+  d->apollo_station = apollo_station;
+  d->channel = channel;
+  d->day = day;
+  d->rate = p->rate;
+  d->nseg = p->nseg;
+  d->nfreq = p->nfreq;
+  d->nband = p->nband;
+  d->psd = (float *)malloc(p->nfreq * sizeof(float));
+  d->fc = (float *)malloc((p->nband > 0 ? p->nband : 1) * sizeof(float));
+  d->hour = (float *)malloc((PSD_HOURS * p->nband > 0 ? PSD_HOURS * p->nband : 1) * sizeof(float));
+  d->hist = (uint8_t *)calloc(p->nband * PSD_DB_BINS > 0 ? p->nband * PSD_DB_BINS : 1, 1);
+  sum = (double *)malloc(p->nfreq * sizeof(double));
+  total = (double *)calloc(p->nfreq, sizeof(double));
+  if (d->psd == NULL || d->fc == NULL || d->hour == NULL || d->hist == NULL ||
+      sum == NULL || total == NULL) {
+    goto compute_finish;
+  }
+  for (k = 0; k < p->nband; k++) {
+    d->fc[k] = (float)p->fc[k];
+  }
+
+  for (h = 0; h < PSD_HOURS; h++) {
+    float *db = &d->hour[h * p->nband];
+
+    t0 = day + h * PSD_HOUR_MSEC;
+    t1 = t0 + PSD_HOUR_MSEC;
+    memset(sum, 0, p->nfreq * sizeof(double));
+    d->count[h] = 0;
+    for (j = 0; j < ns; j++) {
+      if (s[j].apollo_station != apollo_station || s[j].channel != channel) {
+        continue;
+      }
+      // the samples at t0 <= time < t1
+      i0 = (int64_t)ceil((t0 - s[j].t0) * s[j].rate / 1000.0);
+      i1 = (int64_t)ceil((t1 - s[j].t0) * s[j].rate / 1000.0);
+      i0 = (i0 < 0) ? 0 : i0;
+      i1 = (i1 > s[j].n) ? s[j].n : i1;
+      if (i1 - i0 < p->nseg) {
+        continue;
+      }
+      c = psd_welch(p, &s[j].x[i0], i1 - i0, sum);
+      if (c < 0) {
+        goto compute_finish;
+      }
+      d->count[h] += c;
+    }
+
+    if (d->count[h] == 0) {
+      for (k = 0; k < p->nband; k++) {
+        db[k] = NAN;
+      }
+      continue;
+    }
+    for (k = 0; k < p->nfreq; k++) {
+      total[k] += sum[k];
+      sum[k] /= d->count[h];
+    }
+    ntotal += d->count[h];
+    psd_bands(p, sum, db);
+    if (2 * d->count[h] < expected) {
+      continue;
+    }
+    for (k = 0; k < p->nband; k++) {
+      if (isnan(db[k])) {
+        continue;
+      }
+      bin = (int)floor(db[k] - PSD_DB_MIN);
+      bin = (bin < 0) ? 0 : (bin >= PSD_DB_BINS) ? PSD_DB_BINS - 1 : bin;
+      d->hist[k * PSD_DB_BINS + bin]++;
+    }
+  }
+
+  for (k = 0; k < p->nfreq; k++) {
+    d->psd[k] = (ntotal > 0 && total[k] > 0.0) ? (float)(10.0 * log10(total[k] / ntotal)) : NAN;
+  }
+  ret = (ntotal > 0) ? 0 : 1;
+
+ compute_finish:
+  free(sum);
+  free(total);
+  if (ret != 0) {
+    psd_day_free(d);
+  }
+  return ret;
+}
+
+void psd_day_free(psd_day *d) {
+  free(d->psd);
+  free(d->fc);
+  free(d->hour);
+  free(d->hist);
+  d->psd = NULL;
+  d->fc = NULL;
+  d->hour = NULL;
+  d->hist = NULL;
+}
+
+/*!
+ * @brief write the magic of a PSD file
+ *
+ * @return 0 on success, -1 on a write error
+ */
+int psd_write_header(FILE *f) {
+  return (fwrite(PSD_MAGIC, 1, 8, f) == 8) ? 0 : -1;
+}
+
+/*!
+ * @brief check the magic of a PSD file
+ *
+ * @return 0 for a PSD file, -1 otherwise
+ */
+int psd_read_header(FILE *f) {
+  char magic[8];
+
+  if (fread(magic, 1, 8, f) != 8 || memcmp(magic, PSD_MAGIC, 8) != 0) {
+    return -1;
+  }
+  return 0;
+}
+
+/*!
+ * @brief write a day
+ *
+ * @return 0 on success, -1 on a write error
+ */
+int psd_day_write(FILE *f, const psd_day *d) {
+  int32_t v[5];
+  size_t nh = (size_t)PSD_HOURS * d->nband;
+  size_t nb = (size_t)d->nband * PSD_DB_BINS;
+
+  v[0] = d->apollo_station;
+  v[1] = d->channel;
+  v[2] = d->nseg;
+  v[3] = d->nfreq;
+  v[4] = d->nband;
+  if (fwrite(v, sizeof(int32_t), 5, f) != 5 ||
+      fwrite(&d->day, sizeof(int64_t), 1, f) != 1 ||
+      fwrite(&d->rate, sizeof(double), 1, f) != 1 ||
+      fwrite(d->psd, sizeof(float), d->nfreq, f) != (size_t)d->nfreq ||
+      fwrite(d->fc, sizeof(float), d->nband, f) != (size_t)d->nband ||
+      fwrite(d->count, sizeof(int32_t), PSD_HOURS, f) != PSD_HOURS ||
+      fwrite(d->hour, sizeof(float), nh, f) != nh ||
+      fwrite(d->hist, 1, nb, f) != nb) {
+    return -1;
+  }
+  return 0;
+}
+
+/*!
+ * @brief read the next day
+ *
+ * @param[out] d the day (psd_day_free())
+ * @return 1 for a day, 0 at the end of the file, -1 on error
+ */
+int psd_day_read(FILE *f, psd_day *d) {
+  int32_t v[5];
+  size_t nh, nb;
+
+  memset(d, 0, sizeof(psd_day));
+  if (fread(v, sizeof(int32_t), 5, f) != 5) {
+    return feof(f) ? 0 : -1;
+  }
+  if (v[2] < PSD_MIN_SEGMENT || v[3] != v[2] / 2 + 1 || v[4] < 0 || v[4] > v[3]) {
+    return -1;
+  }
+  d->apollo_station = v[0];
+  d->channel = v[1];
+  d->nseg = v[2];
+  d->nfreq = v[3];
+  d->nband = v[4];
+  nh = (size_t)PSD_HOURS * d->nband;
+  nb = (size_t)d->nband * PSD_DB_BINS;
+  d->psd = (float *)malloc(d->nfreq * sizeof(float));
+  d->fc = (float *)malloc((d->nband > 0 ? d->nband : 1) * sizeof(float));
+  d->hour = (float *)malloc((nh > 0 ? nh : 1) * sizeof(float));
+  d->hist = (uint8_t *)malloc(nb > 0 ? nb : 1);
+  if (d->psd == NULL || d->fc == NULL || d->hour == NULL || d->hist == NULL ||
+      fread(&d->day, sizeof(int64_t), 1, f) != 1 ||
+      fread(&d->rate, sizeof(double), 1, f) != 1 ||
+      fread(d->psd, sizeof(float), d->nfreq, f) != (size_t)d->nfreq ||
+      fread(d->fc, sizeof(float), d->nband, f) != (size_t)d->nband ||
+      fread(d->count, sizeof(int32_t), PSD_HOURS, f) != PSD_HOURS ||
+      fread(d->hour, sizeof(float), nh, f) != nh ||
+      fread(d->hist, 1, nb, f) != nb) {
+    psd_day_free(d);
+    return -1;
+  }
+  return 1;
+}
@@ -0,0 +1,89 @@
+/*! @file psd.h
+ *  @brief Welch power spectral densities and PPSD histograms per station-day
+ *  @date 2026/10/18
+ */
+#ifndef __PSD_H__
+#define __PSD_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include "fft.h"
+#include "samples.h"
+
+#define PSD_HOURS 24
+#define PSD_HOUR_MSEC 3600000LL
+#define PSD_DAY_MSEC (PSD_HOURS * PSD_HOUR_MSEC)
+
+//! default length of a Welch segment [sec] (the largest power of two samples within)
+#define PSD_DEFAULT_SEGMENT 300.0
+
+//! segments transformed at once
+#define PSD_BATCH 16
+
+//! band centres per octave, each band averages one octave
+#define PSD_BANDS_PER_OCTAVE 8
+
+//! bins of the histograms: 1 dB from PSD_DB_MIN [dB re 1 count^2/Hz]
+#define PSD_DB_MIN -50
+#define PSD_DB_BINS 150
+
+//! Welch segments and octave bands of a sample rate
+typedef struct tag_psd_plan {
+  fft_plan fft;
+  double rate;
+
+  //! samples of a segment (overlapping by half), nseg/2+1 frequencies
+  int nseg;
+  int nfreq;
+
+  //! Hann window and the scale of a periodogram to a one-sided PSD
+  double *taper;
+  double scale;
+
+  //! band centres [Hz] and their FFT bins lo ... hi
+  int nband;
+  double *fc;
+  int *lo;
+  int *hi;
+} psd_plan;
+
+//! PSDs of a channel of a station for a day (a record of a PSD file)
+typedef struct tag_psd_day {
+  int apollo_station;
+  int channel;
+
+  //! 00:00 of the day [msec since the epoch]
+  int64_t day;
+  double rate;
+  int nseg;
+
+  //! mean Welch PSD of the day [dB], nfreq = nseg/2+1 frequencies k * rate / nseg
+  int nfreq;
+  float *psd;
+
+  //! band centres [Hz]
+  int nband;
+  float *fc;
+
+  //! segments of every hour, band PSD of every hour [dB] (NAN if none)
+  int32_t count[PSD_HOURS];
+  float *hour;
+
+  //! hours of every band in every 1 dB bin (nband x PSD_DB_BINS)
+  uint8_t *hist;
+} psd_day;
+
+int psd_init(psd_plan *p, double rate, double segment);
+void psd_free(psd_plan *p);
+int psd_welch(const psd_plan *p, const float *x, int64_t n, double *sum);
+void psd_bands(const psd_plan *p, const double *psd, float *db);
+int psd_day_compute(const psd_plan *p, const samples_series *s, int ns,
+                    int apollo_station, int channel, int64_t day, psd_day *d);
+void psd_day_free(psd_day *d);
+
+int psd_write_header(FILE *f);
+int psd_read_header(FILE *f);
+int psd_day_write(FILE *f, const psd_day *d);
+int psd_day_read(FILE *f, psd_day *d);
+
+#endif
@@ -62,51 +62,69 @@ int check_pse_record(pse_record pr) {
 }
 
 /*!
- * @brief PSEフレームをチェックしエラーを返す。
+ * @brief PSEフレームのエラー番号マスク値 (条件分岐なし)
  *
  * @param[in] pf PSEフレーム構造体
- * @return 成功したときは0を返す。
- * 失敗したときはエラー番号マスク値を返す。
+ * @param[in] w date_windows()で求めた観測期間
  */
-int check_pse_frame(pse_frame pf, int apollo_station, int year) {
-  int error_flag = 0;
+static inline uint32_t pse_frame_error(const pse_frame *pf, const date_window *w) {
+  uint32_t error_flag;
   int64_t delta;
 
-  if (!validate_date(apollo_station, year, pf.msec_of_year)) {
-    error_flag |= ERROR_INVALID_DATETIME;
-  }
-  
+  error_flag = (uint32_t)!in_date_windows(w, pf->msec_of_year) * ERROR_INVALID_DATETIME;
+
   //! HK must be equal to and less than 255 due to 8 effective bits.
   //! see 'APOLLO LUNAR SURFACE EXPERIMENT PACKAGE
   //! ARCHIVE TAPE DESCRIPTION DOCUMENT (JSC-09652)'
   //! 1.4.1.2.3 ALSEP Word 33 - Housekeeping
-  if ( pf.hk > 255 ) {
-    error_flag |= ERROR_INVALID_HK;
-  }
-  
+  error_flag |= (uint32_t)(pf->hk > 255) * ERROR_INVALID_HK;
+
   //! these judgment using 10, 100 below is not so meaningful.
-  delta = pf.time_diff - VALID_FRAME_RATE;
+  delta = pf->time_diff - VALID_FRAME_RATE;
   delta = (delta < 0) ? -delta : delta;
-  if (delta >10 && delta <= 100) {
-    error_flag |= ERROR_FRAME_SMALL_TIME_ERROR;
-  }
-  if (delta >100) {
-    error_flag |= ERROR_FRAME_LARGE_TIME_ERROR;
-  }
-  
-  if (pf.sync_code != VALID_SYNC_CODE) {
-    error_flag |= ERROR_INVALID_SYNC_CODE;
-  }
+  error_flag |= (uint32_t)((delta > 10) & (delta <= 100)) * ERROR_FRAME_SMALL_TIME_ERROR;
+  error_flag |= (uint32_t)(delta > 100) * ERROR_FRAME_LARGE_TIME_ERROR;
+
+  error_flag |= (uint32_t)(pf->sync_code != VALID_SYNC_CODE) * ERROR_INVALID_SYNC_CODE;
+
+  error_flag |= (uint32_t)((pf->frame_count - pf->prev_frame != 1U) &
+                           !((pf->frame_count == 0U) & (pf->prev_frame == 89U)))
+    * ERROR_FRAME_COUNT_SEQUENCE;
 
-  if (pf.frame_count - pf.prev_frame != 1U) {
-    if (!(pf.frame_count == 0U && pf.prev_frame == 89U)) {
-      error_flag |= ERROR_FRAME_COUNT_SEQUENCE;
-    }
-  }
-  
   return error_flag;
 }
 
+/*!
+ * @brief PSEフレームをチェックしエラーを返す。
+ *
+ * @param[in] pf PSEフレーム構造体
+ * @return 成功したときは0を返す。
+ * 失敗したときはエラー番号マスク値を返す。
+ */
+int check_pse_frame(pse_frame pf, int apollo_station, int year) {
+  return pse_frame_error(&pf, date_windows(apollo_station, year));
+}
+
+/*!
+ * @brief 1レコード分のPSEフレームをチェックしerror_flagに設定する。
+ *
+ * 観測期間はレコードで1回だけ求め、各フレームは条件分岐なしで判定する。
+ * time_diff, prev_frameは設定済みであること。
+ *
+ * @param[in,out] pf PSEフレーム構造体の配列
+ * @param[in] nframe フレーム数
+ * @param[in] apollo_station アポロ観測所番号
+ * @param[in] year 年
+ */
+void check_pse_frames(pse_frame *pf, int nframe, int apollo_station, int year) {
+  const date_window *w = date_windows(apollo_station, year);
+  int i;
+
+  for (i = 0; i < nframe; i++) {
+    pf[i].error_flag = pse_frame_error(&pf[i], w);
+  }
+}
+
 /*!
  * @brief バイナリデータをPSEレコード構造体に展開する
  *
@@ -155,17 +173,18 @@ pse_record binary2pse_record(const unsigned char *record) {
 }
 
 /*!
- * @brief バイナリデータをPSEフレーム構造体に展開する
+ * @brief バイナリデータからPSEフレームのヘッダ部のみを展開する
+ *
+ * 時刻、パッケージID、同期コード、フレームカウンタ等、フレームの検査に
+ * 必要な項目だけを取り出す。データ部は展開しない。
  *
  * @param[in] pr PSEレコード構造体
  * @param[in] frame バイナリデータ
- * @return PSEフレーム構造体を返す。
+ * @return PSEフレーム構造体を返す（データ部は0）。
  */
-pse_frame binary2pse_frame(pse_record pr, const unsigned char *frame) {
-  int i;
+pse_frame binary2pse_frame_header(pse_record pr, const unsigned char *frame) {
   pse_frame pf;
-  int32_t la[15], lb[15], lc[15];
-  
+
   memset(&pf, 0, sizeof(pf));
   pf.software_time_flag= frame[0] >> 7;
   
@@ -191,7 +210,31 @@ pse_frame binary2pse_frame(pse_record pr, const unsigned char *frame) {
   pf.frame_count = frame[11] >> 1;
   
   pf.mode_bit = frame[11] & 0x01U;
+
+  //! ALSEP word 33 (housekeeping) for check_pse_frame()
+  if (pr.format == FORMAT_OLD) {
+    pf.hk = ((int32_t)frame[40] << 2) | (frame[41] >> 6);
+  } else {
+    pf.hk = ((int32_t)frame[20] << 2) | (frame[21] >> 6);
+  }
+
+  return pf;
+}
+
+/*!
+ * @brief バイナリデータをPSEフレーム構造体に展開する
+ *
+ * @param[in] pr PSEレコード構造体
+ * @param[in] frame バイナリデータ
+ * @return PSEフレーム構造体を返す。
+ */
+pse_frame binary2pse_frame(pse_record pr, const unsigned char *frame) {
+  int i;
+  pse_frame pf;
+  int32_t la[15], lb[15], lc[15];
   
+  pf = binary2pse_frame_header(pr, frame);
+
   // set data part
   for(i=0; i<15; ++i) {
     la[i] = (int32_t)frame[12+i*4];
@@ -129,11 +129,20 @@ typedef struct tag_pse_frame {
   //! frame counter
   uint32_t prev_frame;
 
+  //! time corrected by clock_correct()
+  int64_t msec_of_year_corrected;
+
+  //! TIME_FLAG_*
+  uint32_t time_flag;
+
 } pse_frame;
 
 int check_pse_record(pse_record pr);
 int check_pse_frame(pse_frame pf, int apollo_station, int year);
+void check_pse_frames(pse_frame *pf, int nframe, int apollo_station, int year);
 pse_record binary2pse_record(const unsigned char *record);
+pse_frame binary2pse_frame_header(pse_record pr, const unsigned char *frame);
 pse_frame binary2pse_frame(pse_record pr, const unsigned char *frame);
+int binary2pse_frames(pse_record pr, const unsigned char *record, pse_frame *pf, int nframe);
 
 #endif
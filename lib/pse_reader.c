@@ -0,0 +1,118 @@
+/*! @file pse_reader.c
+ *  @brief sequential reader of PSE tapes returning the frames of a record
+ *  @date 2026/10/18
+ *
+ *  pse2pgcopy and the other PSE tools read through it, so the frames are
+ *  decoded and linked the same way everywhere: time_diff and prev_frame
+ *  refer to the previous frame (of the previous record for the first
+ *  frame), the first sample of sp_z (ALSEP word 2) is interpolated and
+ *  process_flag/error_flag are set.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "define.h"
+#include "error.h"
+#include "util.h"
+#include "pse.h"
+#include "pse_reader.h"
+
+/*!
+ * @brief open a PSE tape
+ *
+ * @param[out] rd reader
+ * @param[in] filename tape file
+ * @param[in] year_override year used instead of the header year (-1 to keep it)
+ * @return 0 on success, -1 if the file cannot be opened
+ */
+int pse_reader_open(pse_reader *rd, const char *filename, int year_override) {
+  memset(rd, 0, sizeof(pse_reader));
+  rd->f = fopen(filename, "rb");
+  if (rd->f == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "no such file: %s", filename);
+    return -1;
+  }
+  rd->year_override = year_override;
+  rd->process_flag = FLAG_FIRST_DATA_OF_FILE;
+  rd->msec_of_year_fmax = 0;
+  rd->prev_frame = -1;
+  return 0;
+}
+
+/*!
+ * @brief read and decode the next record
+ *
+ * @param[in,out] rd reader
+ * @return number of frames in rd->pf, 0 at the end of the file,
+ *  -1 for a short record at the end
+ */
+int pse_reader_next(pse_reader *rd) {
+  pse_frame *pf = rd->pf;
+  size_t r;
+  int i, nframe;
+
+  rd->rec_offset = ftell(rd->f);
+  r = fread(rd->record, sizeof(unsigned char), SIZE_RECORD, rd->f);
+  if (r == 0) {
+    return 0;
+  }
+  if (r != SIZE_RECORD) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "invalid data size: %zd", r);
+    return -1;
+  }
+
+  rd->pr = binary2pse_record(rd->record);
+  if (rd->year_override != -1) {
+    rd->pr.year = rd->year_override;
+  }
+  rd->pr.error_flag = check_pse_record(rd->pr);
+  rd->size_part = (rd->pr.format == FORMAT_OLD) ? SIZE_DATA_PART_OLD : SIZE_DATA_PART_NEW;
+
+  // a broken phys_records still gives the first frame (and at most a record)
+  nframe = binary2pse_frames(rd->pr, rd->record, pf, SIZE_LOGICAL_RECORD * rd->pr.phys_records);
+
+  pf[0].spz[0] = pf[0].spz[1];
+  pf[0].time_diff = pf[0].msec_of_year - rd->msec_of_year_fmax;
+  pf[0].prev_frame = rd->prev_frame;
+  pf[0].process_flag = rd->process_flag | FLAG_TOP_OF_RECORD | FLAG_FIRST_DATA_COPIED;
+  for (i = 1; i < nframe; i++) {
+    pf[i].time_diff = pf[i].msec_of_year - pf[i-1].msec_of_year;
+    pf[i].prev_frame = pf[i-1].frame_count;
+    pf[i].process_flag = 0;
+  }
+  check_pse_frames(pf, nframe, rd->pr.apollo_station, rd->pr.year);
+
+  for (i = 1; i < nframe; i++) {
+    if (pf[i].error_flag == ERROR_NONE) {
+      //! ALSEP WORD 2
+      pf[i].spz[0] = interp(pf[i-1].spz[30], pf[i-1].spz[31],
+                            pf[i].spz[1], pf[i].spz[2]);
+    } else {
+      pf[i].spz[0] = pf[i].spz[1];
+      pf[i].process_flag |= FLAG_FIRST_DATA_COPIED;
+    }
+  }
+
+  rd->nframe = nframe;
+  rd->msec_of_year_fmax = pf[nframe-1].msec_of_year;
+  rd->prev_frame = pf[nframe-1].frame_count;
+  rd->process_flag = 0;
+  return nframe;
+}
+
+/*!
+ * @brief file offset of the i-th frame of the record just read
+ */
+long pse_reader_frame_offset(const pse_reader *rd, int i) {
+  return rd->rec_offset + SIZE_PSE_HEADER + (long)rd->size_part * i;
+}
+
+/*!
+ * @brief close the tape
+ */
+void pse_reader_close(pse_reader *rd) {
+  if (rd->f) {
+    fclose(rd->f);
+    rd->f = NULL;
+  }
+}
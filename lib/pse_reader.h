@@ -0,0 +1,50 @@
+/*! @file pse_reader.h
+ *  @brief sequential reader of PSE tapes returning the frames of a record
+ *  @date 2026/10/18
+ */
+#ifndef __PSE_READER_H__
+#define __PSE_READER_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include "pse.h"
+
+typedef struct tag_pse_reader {
+
+  //! tape file
+  FILE *f;
+
+  //! year used instead of the header year (-1 to keep it)
+  int year_override;
+
+  //! record just read
+  unsigned char record[SIZE_RECORD];
+
+  //! file offset of the record just read
+  long rec_offset;
+
+  //! header of the record just read
+  pse_record pr;
+
+  //! frames of the record just read (linked to the previous record)
+  pse_frame pf[MAX_PSE_FRAME+1];
+
+  //! number of frames in pf
+  int nframe;
+
+  //! frame size (SIZE_DATA_PART_OLD or SIZE_DATA_PART_NEW)
+  int size_part;
+
+  //! state carried to the next record
+  uint32_t process_flag;
+  uint64_t msec_of_year_fmax;
+  int32_t prev_frame;
+
+} pse_reader;
+
+int pse_reader_open(pse_reader *rd, const char *filename, int year_override);
+int pse_reader_next(pse_reader *rd);
+long pse_reader_frame_offset(const pse_reader *rd, int i);
+void pse_reader_close(pse_reader *rd);
+
+#endif
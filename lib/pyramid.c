@@ -0,0 +1,121 @@
+/*! @file pyramid.c
+ *  @brief multi-resolution min/max/mean/count tiles of a sample stream
+ *  @date 2026/10/18
+ *
+ *  Samples are given with their index on an absolute grid (time x rate),
+ *  so the tiles of level k cover the samples [n 2^k, (n+1) 2^k) whatever
+ *  file they come from. Only the lowest level is fed with samples; a
+ *  completed tile is merged into its parent, so every sample is touched
+ *  once. Tiles of the same level and index emitted from different files
+ *  (at the file boundaries) are merged by min/max/sum on the query side.
+ */
+#include <string.h>
+#include "pyramid.h"
+
+/*!
+ * @brief index of the tile holding a sample (floor division by 2^level)
+ */
+int64_t pyramid_bin_index(int64_t sample_index, int level) {
+  if (sample_index >= 0) {
+    return sample_index >> level;
+  }
+  return -((-sample_index - 1) >> level) - 1;
+}
+
+/*!
+ * @brief initialize a pyramid
+ *
+ * @param[out] p pyramid
+ * @param[in] min_level lowest level (tiles of 2^min_level samples)
+ * @param[in] max_level highest level
+ * @param[in] emit function called for every completed tile
+ * @param[in] arg argument passed to emit
+ * @return 0 on success, -1 for invalid levels
+ */
+int pyramid_init(pyramid *p, int min_level, int max_level, pyramid_emit_func emit, void *arg) {
+  if (min_level < 0 || max_level > PYRAMID_MAX_LEVEL || min_level > max_level) {
+    return -1;
+  }
+  memset(p, 0, sizeof(pyramid));
+  p->min_level = min_level;
+  p->max_level = max_level;
+  p->emit = emit;
+  p->arg = arg;
+  return 0;
+}
+
+static void merge_bin(pyramid_bin *dst, const pyramid_bin *src, int64_t index) {
+  if (dst->count == 0) {
+    dst->index = index;
+    dst->min = src->min;
+    dst->max = src->max;
+    dst->sum = src->sum;
+    dst->count = src->count;
+    return;
+  }
+  if (src->min < dst->min) dst->min = src->min;
+  if (src->max > dst->max) dst->max = src->max;
+  dst->sum += src->sum;
+  dst->count += src->count;
+}
+
+/*!
+ * @brief emit the open tile of a level and merge it into the level above
+ */
+static void close_bin(pyramid *p, int level) {
+  pyramid_bin *b = &p->bin[level];
+  pyramid_bin *parent;
+  int64_t index;
+
+  p->emit(level, b, p->arg);
+
+  if (level < p->max_level) {
+    parent = &p->bin[level + 1];
+    index = pyramid_bin_index(b->index, 1);
+    if (parent->count > 0 && parent->index != index) {
+      close_bin(p, level + 1);
+    }
+    merge_bin(parent, b, index);
+  }
+  b->count = 0;
+}
+
+/*!
+ * @brief add a sample
+ *
+ * @param[in,out] p pyramid
+ * @param[in] sample_index index of the sample on the absolute grid
+ * @param[in] value sample value
+ */
+void pyramid_add(pyramid *p, int64_t sample_index, int32_t value) {
+  pyramid_bin *b = &p->bin[p->min_level];
+  int64_t index = pyramid_bin_index(sample_index, p->min_level);
+
+  if (b->count > 0 && b->index != index) {
+    close_bin(p, p->min_level);
+  }
+  if (b->count == 0) {
+    b->index = index;
+    b->min = value;
+    b->max = value;
+    b->sum = value;
+    b->count = 1;
+    return;
+  }
+  if (value < b->min) b->min = value;
+  if (value > b->max) b->max = value;
+  b->sum += value;
+  b->count++;
+}
+
+/*!
+ * @brief emit all open tiles (at the end of the stream)
+ */
+void pyramid_flush(pyramid *p) {
+  int level;
+  for (level = p->min_level; level <= p->max_level; level++) {
+    if (p->bin[level].count > 0) {
+      close_bin(p, level);
+    }
+  }
+}
@@ -0,0 +1,40 @@
+/*! @file pyramid.h
+ *  @brief multi-resolution min/max/mean/count tiles of a sample stream
+ *  @date 2026/10/18
+ */
+#ifndef __PYRAMID_H__
+#define __PYRAMID_H__
+
+#include <stdint.h>
+
+#define PYRAMID_MAX_LEVEL 40
+
+//! one tile: 2^level samples starting at sample index (index << level)
+typedef struct tag_pyramid_bin {
+  int64_t index;
+  int32_t min;
+  int32_t max;
+  int64_t sum;
+  int64_t count;
+} pyramid_bin;
+
+//! called for every completed tile
+typedef void (*pyramid_emit_func)(int level, const pyramid_bin *bin, void *arg);
+
+typedef struct tag_pyramid {
+  int min_level;
+  int max_level;
+
+  //! open tile of every level (count 0 if none)
+  pyramid_bin bin[PYRAMID_MAX_LEVEL+1];
+
+  pyramid_emit_func emit;
+  void *arg;
+} pyramid;
+
+int pyramid_init(pyramid *p, int min_level, int max_level, pyramid_emit_func emit, void *arg);
+void pyramid_add(pyramid *p, int64_t sample_index, int32_t value);
+void pyramid_flush(pyramid *p);
+int64_t pyramid_bin_index(int64_t sample_index, int level);
+
+#endif
@@ -0,0 +1,215 @@
+/*! @file quality.c
+ *  @brief choice of one of the tapes holding a time window by the quality of its frames
+ *  @date 2026/10/18
+ *
+ *  A time window of a station is often on several tapes: the PSE
+ *  original, a WTN work tape and a duplicated event tape (tape_type 2).
+ *  Each of them is scored by
+ *
+ *    coverage * quality, quality = 1 - (error_frames + QUALITY_GAP_WEIGHT * gaps) / frames
+ *
+ *  (quality at least 0; sync errors are among the error_frames) where
+ *  coverage is the part of the window between the first and the last
+ *  frame of the station in the file. The highest score is read; on a tie
+ *  a PSE original is taken before the copies and then the lowest file_id.
+ *  alsep_best_files() of quality.sql ranks the same way, so the SQL
+ *  functions and the tools read the same tape.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "error.h"
+#include "util.h"
+#include "samples.h"
+#include "quality.h"
+
+#define QUALITY_LINE 1024
+#define QUALITY_FIELDS 10
+
+/*!
+ * @brief parse a line "file_id ap_station type tape_type time_first time_last
+ *        frames error_frames sync_errors gaps" (tab separated)
+ *
+ * @return 0 on success, -1 for a malformed line
+ */
+static int parse_entry(char *line, quality_entry *q) {
+  char *field[QUALITY_FIELDS], *end;
+  int64_t v[QUALITY_FIELDS];
+  int k;
+
+  for (k = 0; k < QUALITY_FIELDS; k++) {
+    field[k] = line;
+    line = strchr(line, '\t');
+    if ((line == NULL) != (k == QUALITY_FIELDS - 1)) {
+      return -1;
+    }
+    if (line != NULL) {
+      *line++ = '\0';
+    }
+  }
+  for (k = 0; k < QUALITY_FIELDS; k++) {
+    if (k == 2 || k == 4 || k == 5) {
+      continue;
+    }
+    v[k] = strtoll(field[k], &end, 10);
+    if (end == field[k] || *end != '\0' || v[k] < 0) {
+      return -1;
+    }
+  }
+  memset(q, 0, sizeof(quality_entry));
+  q->file_id = (int)v[0];
+  q->apollo_station = (int)v[1];
+  q->type = samples_type(field[2]);
+  q->tape_type = (int)v[3];
+  q->frames = v[6];
+  q->error_frames = v[7];
+  q->sync_errors = v[8];
+  q->gaps = v[9];
+  if (q->type < 0 ||
+      date_string_to_epoch(field[4], &q->epoch_first) != 0 ||
+      date_string_to_epoch(field[5], &q->epoch_last) != 0 || q->epoch_last < q->epoch_first) {
+    return -1;
+  }
+  return 0;
+}
+
+/*!
+ * @brief read a catalog, e.g.
+ *        psql -At -F $'\t' -c "SELECT * FROM file_quality_catalog" alsep > quality.tsv
+ *
+ * @return 0 on success, -1 if the file cannot be read or has a malformed line
+ */
+int quality_read(const char *filename, quality_catalog *c) {
+  char line[QUALITY_LINE];
+  quality_entry *q;
+  int max = 0, lineno = 0;
+  FILE *f;
+
+  memset(c, 0, sizeof(quality_catalog));
+  f = fopen(filename, "r");
+  if (f == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "no such file: %s", filename);
+    return -1;
+  }
+  while (fgets(line, sizeof(line), f) != NULL) {
+    lineno++;
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] == '#' || line[0] == '\0') {
+      continue;
+    }
+    if (c->n >= max) {
+      max = (max > 0) ? max * 2 : 256;
+      q = (quality_entry *)realloc(c->q, max * sizeof(quality_entry));
+      if (q == NULL) {
+        log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+        break;
+      }
+      c->q = q;
+    }
+    if (parse_entry(line, &c->q[c->n]) != 0) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "invalid quality: %s line %d", filename, lineno);
+      break;
+    }
+    c->n++;
+  }
+  if (!feof(f)) {
+    fclose(f);
+    quality_free(c);
+    return -1;
+  }
+  fclose(f);
+  return 0;
+}
+
+void quality_free(quality_catalog *c) {
+  free(c->q);
+  c->q = NULL;
+  c->n = 0;
+}
+
+/*!
+ * @brief whether a catalog has the quality of a file
+ */
+int quality_known(const quality_catalog *c, int file_id) {
+  int i;
+
+  for (i = 0; i < c->n; i++) {
+    if (c->q[i].file_id == file_id) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*!
+ * @brief quality of the frames of a station in a file (0 ... 1)
+ */
+double quality_of(const quality_entry *q) {
+  double bad = q->error_frames + QUALITY_GAP_WEIGHT * q->gaps;
+  double r = 1.0 - bad / (double)((q->frames > 0) ? q->frames : 1);
+
+  return (r > 0.0) ? r : 0.0;
+}
+
+/*!
+ * @brief score of a file for the window t0 <= t < t1 [msec since the epoch]
+ *
+ * @return coverage times quality, -1 if the file has no frame in the window
+ */
+double quality_score(const quality_entry *q, int64_t t0, int64_t t1) {
+  int64_t lo = (q->epoch_first > t0) ? q->epoch_first : t0;
+  int64_t hi = (q->epoch_last < t1) ? q->epoch_last : t1;
+
+  if (q->epoch_first >= t1 || q->epoch_last < t0) {
+    return -1.0;
+  }
+  return (double)(hi - lo) / (double)((t1 - t0 > 0) ? t1 - t0 : 1) * quality_of(q);
+}
+
+/*!
+ * @brief whether a is read rather than b
+ */
+static int better(const quality_entry *a, double sa, const quality_entry *b, double sb) {
+  if (sa != sb) {
+    return sa > sb;
+  }
+  if ((a->tape_type == 1) != (b->tape_type == 1)) {
+    return a->tape_type == 1;
+  }
+  return a->file_id < b->file_id;
+}
+
+/*!
+ * @brief the file to read a window of a station from
+ *
+ * @param[in] file_ids files to choose from, NULL for all of the catalog
+ * @param[in] n number of file_ids
+ * @return entry of the file, NULL if no file of the catalog has frames in the window
+ */
+const quality_entry *quality_best(const quality_catalog *c, int apollo_station, int64_t t0, int64_t t1,
+                                  const int *file_ids, int n) {
+  const quality_entry *best = NULL;
+  double s, sbest = 0.0;
+  int i, j;
+
+  for (i = 0; i < c->n; i++) {
+    const quality_entry *q = &c->q[i];
+
+    if (q->apollo_station != apollo_station || (s = quality_score(q, t0, t1)) < 0.0) {
+      continue;
+    }
+    if (file_ids != NULL) {
+      for (j = 0; j < n && file_ids[j] != q->file_id; j++);
+      if (j == n) {
+        continue;
+      }
+    }
+    if (best == NULL || better(q, s, best, sbest)) {
+      best = q;
+      sbest = s;
+    }
+  }
+  return best;
+}
@@ -0,0 +1,49 @@
+/*! @file quality.h
+ *  @brief choice of one of the tapes holding a time window by the quality of its frames
+ *  @date 2026/10/18
+ */
+#ifndef __QUALITY_H__
+#define __QUALITY_H__
+
+#include <stdint.h>
+
+//! a gap (missing frames) counts as this many frames with errors
+#define QUALITY_GAP_WEIGHT 10.0
+
+/*!
+ * quality of the frames of a station in a file: a line of the view
+ * file_quality_catalog (quality.sql), written by pseinfo/wtninfo/wthinfo -Q
+ */
+typedef struct tag_quality_entry {
+  int file_id;
+  int apollo_station;
+
+  //! SAMPLES_TYPE_* and tape_type of a PSE file (1 original, 2 event tape, 0 work tape)
+  int type;
+  int tape_type;
+
+  //! first and last frame time [msec since the epoch]
+  int64_t epoch_first;
+  int64_t epoch_last;
+
+  //! frames, those with any error and those of them with a bad sync code
+  int64_t frames;
+  int64_t error_frames;
+  int64_t sync_errors;
+  int64_t gaps;
+} quality_entry;
+
+typedef struct tag_quality_catalog {
+  quality_entry *q;
+  int n;
+} quality_catalog;
+
+int quality_read(const char *filename, quality_catalog *c);
+void quality_free(quality_catalog *c);
+int quality_known(const quality_catalog *c, int file_id);
+double quality_of(const quality_entry *q);
+double quality_score(const quality_entry *q, int64_t t0, int64_t t1);
+const quality_entry *quality_best(const quality_catalog *c, int apollo_station, int64_t t0, int64_t t1,
+                                  const int *file_ids, int n);
+
+#endif
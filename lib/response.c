@@ -0,0 +1,632 @@
+/*! @file response.c
+ *  @brief instrument response removal: counts to ground motion by blocks of FFTs
+ *  @date 2026/10/18
+ *
+ *  Responses are poles and zeros in a tab separated text file, one line
+ *  per station, channel and epoch (the PSE peaked and flat modes, the
+ *  LSG and the LSPE geophones change with the commands of the mission):
+ *
+ *    station channel from to quantity sensitivity f_norm zeros poles
+ *
+ *  e.g. "12<TAB>lp_z<TAB>1969-11-19 00:00:00<TAB>1977-09-30 00:00:00<TAB>
+ *  displacement<TAB>3.0e9<TAB>0.45<TAB>0,0;0,0<TAB>-1.9,2.4;-1.9,-2.4".
+ *  The channel is a name of samples_channel(), the times are UTC, the
+ *  sensitivity is in counts per unit of the quantity (m, m/s or m/s^2)
+ *  at f_norm [Hz], and the zeros and poles are "re,im" pairs in rad/s
+ *  separated by ';' ("-" for none). Lines starting with '#' are comments.
+ *
+ *  A channel is deconvolved in blocks of nfft samples overlapping by half
+ *  (overlap-save): the spectrum of a block is multiplied by the inverse
+ *  transfer function and the middle half of the block is kept, so the
+ *  wrap-around of the FFT falls into the margins of nfft/4 samples. The
+ *  inverse is 1/H with a water level (|H| raised to the largest gain
+ *  times 10^(-water_level/20)), tapered by a cosine from 0 at f1 to 1 at
+ *  f2 and back to 0 from f3 to f4 (the prefilter), and times (i omega)^k
+ *  to the output quantity. The margin is at least two periods of f1, the
+ *  longest ringing the prefilter lets through.
+ *
+ *  The inverse of a definition, sample rate, output and prefilter is
+ *  computed once by resp_cache_get() and shared by all the blocks and
+ *  the streams. Ready blocks are transformed RESP_BATCH at a time by
+ *  fft_forward_batch(); every output depends only on its block, so the
+ *  result does not depend on how the input is split.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "error.h"
+#include "util.h"
+#include "samples.h"
+#include "response.h"
+
+#define RESP_LINE 2048
+
+//! periods of the lowest prefilter corner in a margin
+#define RESP_MARGIN_PERIODS 2.0
+
+static const char *quantity_names[] = {"displacement", "velocity", "acceleration"};
+static const char *quantity_short[] = {"disp", "vel", "acc"};
+
+/*!
+ * @brief RESP_* quantity of a name ("displacement" or "disp", ...)
+ *
+ * @return quantity, -1 for an unknown name
+ */
+int resp_quantity(const char *name) {
+  int i;
+
+  for (i = RESP_DISPLACEMENT; i <= RESP_ACCELERATION; i++) {
+    if (strcmp(name, quantity_names[i]) == 0 || strcmp(name, quantity_short[i]) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*!
+ * @brief parse "re,im;re,im;..." (or "-") into interleaved pairs
+ *
+ * @return number of pairs, -1 for a syntax error or too many
+ */
+static int parse_pz(char *s, double *pz) {
+  char *end;
+  int n = 0;
+
+  if (strcmp(s, "-") == 0 || *s == '\0') {
+    return 0;
+  }
+  for (;;) {
+    if (n >= RESP_MAX_PZ) {
+      return -1;
+    }
+    pz[2*n] = strtod(s, &end);
+    if (end == s || *end != ',') {
+      return -1;
+    }
+    s = end + 1;
+    pz[2*n+1] = strtod(s, &end);
+    if (end == s) {
+      return -1;
+    }
+    n++;
+    if (*end == '\0') {
+      return n;
+    }
+    if (*end != ';') {
+      return -1;
+    }
+    s = end + 1;
+  }
+}
+
+/*!
+ * @brief prod(s - zero) / prod(s - pole) at s = 2 pi i freq
+ */
+static void rational(const resp_def *d, double freq, double *re, double *im) {
+  double w = 2.0 * M_PI * freq;
+  double nr = 1.0, ni = 0.0, dr = 1.0, di = 0.0, ar, ai, t, m;
+  int k;
+
+  for (k = 0; k < d->nzero; k++) {
+    ar = -d->zero[2*k];
+    ai = w - d->zero[2*k+1];
+    t = nr * ar - ni * ai;
+    ni = nr * ai + ni * ar;
+    nr = t;
+  }
+  for (k = 0; k < d->npole; k++) {
+    ar = -d->pole[2*k];
+    ai = w - d->pole[2*k+1];
+    t = dr * ar - di * ai;
+    di = dr * ai + di * ar;
+    dr = t;
+  }
+  m = dr * dr + di * di;
+  if (m == 0.0) {
+    *re = HUGE_VAL;
+    *im = 0.0;
+    return;
+  }
+  *re = (nr * dr + ni * di) / m;
+  *im = (ni * dr - nr * di) / m;
+}
+
+/*!
+ * @brief response of a definition [counts per unit of its quantity]
+ */
+void resp_eval(const resp_def *d, double freq, double *re, double *im) {
+  rational(d, freq, re, im);
+  *re *= d->sensitivity * d->a0;
+  *im *= d->sensitivity * d->a0;
+}
+
+/*!
+ * @brief parse a line of a response file
+ *
+ * @return 0 on success, -1 for a malformed line
+ */
+static int parse_def(char *line, resp_def *d) {
+  char *field[9], *end;
+  double re, im;
+  int k;
+
+  memset(d, 0, sizeof(resp_def));
+  for (k = 0; k < 9; k++) {
+    field[k] = line;
+    line = strchr(line, '\t');
+    if ((line == NULL) != (k == 8)) {
+      return -1;
+    }
+    if (line != NULL) {
+      *line++ = '\0';
+    }
+  }
+  d->apollo_station = (int)strtol(field[0], &end, 10);
+  if (end == field[0] || *end != '\0') {
+    return -1;
+  }
+  d->channel = samples_channel(field[1]);
+  d->input = resp_quantity(field[4]);
+  if (d->channel < 0 || d->input < 0 ||
+      date_string_to_epoch(field[2], &d->from) != 0 ||
+      date_string_to_epoch(field[3], &d->to) != 0 || d->to <= d->from) {
+    return -1;
+  }
+  d->sensitivity = strtod(field[5], &end);
+  if (end == field[5] || d->sensitivity <= 0.0) {
+    return -1;
+  }
+  d->f_norm = strtod(field[6], &end);
+  if (end == field[6] || d->f_norm <= 0.0) {
+    return -1;
+  }
+  d->nzero = parse_pz(field[7], d->zero);
+  d->npole = parse_pz(field[8], d->pole);
+  if (d->nzero < 0 || d->npole < 0) {
+    return -1;
+  }
+
+  // normalized to 1 at f_norm
+  rational(d, d->f_norm, &re, &im);
+  if (!isfinite(re) || hypot(re, im) == 0.0) {
+    return -1;
+  }
+  d->a0 = 1.0 / hypot(re, im);
+  return 0;
+}
+
+/*!
+ * @brief read the definitions of a response file
+ *
+ * @return 0 on success, -1 if the file cannot be read or has a malformed line
+ */
+int resp_read(const char *filename, resp_table *t) {
+  char line[RESP_LINE];
+  resp_def *d;
+  int max = 0, lineno = 0;
+  FILE *f;
+
+  memset(t, 0, sizeof(resp_table));
+  f = fopen(filename, "r");
+  if (f == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "no such file: %s", filename);
+    return -1;
+  }
+  while (fgets(line, sizeof(line), f) != NULL) {
+    lineno++;
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] == '#' || line[0] == '\0') {
+      continue;
+    }
+    if (t->n >= max) {
+      max = (max > 0) ? max * 2 : 64;
+      d = (resp_def *)realloc(t->d, max * sizeof(resp_def));
+      if (d == NULL) {
+        log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+        break;
+      }
+      t->d = d;
+    }
+    if (parse_def(line, &t->d[t->n]) != 0) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "invalid response: %s line %d", filename, lineno);
+      break;
+    }
+    t->n++;
+  }
+  if (!feof(f)) {
+    fclose(f);
+    resp_table_free(t);
+    return -1;
+  }
+  fclose(f);
+  return 0;
+}
+
+void resp_table_free(resp_table *t) {
+  free(t->d);
+  t->d = NULL;
+  t->n = 0;
+}
+
+/*!
+ * @brief definition of a channel of a station at a time
+ *
+ * @return the first definition whose epoch contains it, NULL if none
+ */
+const resp_def *resp_find(const resp_table *t, int apollo_station, int channel, int64_t epoch) {
+  int i;
+
+  for (i = 0; i < t->n; i++) {
+    const resp_def *d = &t->d[i];
+
+    if (d->apollo_station == apollo_station && d->channel == channel &&
+        d->from <= epoch && epoch < d->to) {
+      return d;
+    }
+  }
+  return NULL;
+}
+
+/*!
+ * @brief parse "f1,f2,f3,f4" [Hz], 0 < f1 < f2 <= f3 < f4
+ *
+ * @return 0 on success, -1 for a syntax error
+ */
+int resp_parse_prefilter(const char *arg, double *f) {
+  char *end;
+  int k;
+
+  for (k = 0; k < 4; k++) {
+    f[k] = strtod(arg, &end);
+    if (end == arg || *end != ((k < 3) ? ',' : '\0')) {
+      return -1;
+    }
+    arg = end + 1;
+  }
+  return (f[0] > 0.0 && f[0] < f[1] && f[1] <= f[2] && f[2] < f[3]) ? 0 : -1;
+}
+
+/*!
+ * @brief prefilter of a sample rate without one given: from 512 samples
+ *        per period up to 0.9 of the Nyquist frequency
+ */
+void resp_default_prefilter(double rate, double *f) {
+  f[0] = rate / 512.0;
+  f[1] = rate / 256.0;
+  f[2] = rate * 0.4;
+  f[3] = rate * 0.45;
+}
+
+/*!
+ * @brief set up a cache of transfer functions
+ *
+ * @param[in] output RESP_* quantity of the outputs
+ * @param[in] prefilter f1 ... f4 [Hz], NULL for resp_default_prefilter() of each rate
+ * @param[in] water_level [dB] below the largest gain
+ */
+void resp_cache_init(resp_cache *c, const resp_table *table, int output,
+                     const double *prefilter, double water_level) {
+  memset(c, 0, sizeof(resp_cache));
+  c->table = table;
+  c->output = output;
+  if (prefilter != NULL) {
+    memcpy(c->prefilter, prefilter, 4 * sizeof(double));
+  }
+  c->water_level = water_level;
+}
+
+static void transfer_free(resp_transfer *t) {
+  fft_free(&t->fft);
+  free(t->inverse);
+  free(t);
+}
+
+void resp_cache_free(resp_cache *c) {
+  int i;
+
+  for (i = 0; i < c->n; i++) {
+    transfer_free(c->t[i]);
+  }
+  free(c->t);
+  c->t = NULL;
+  c->n = 0;
+  c->max = 0;
+}
+
+static double taper(const double *f, double freq) {
+  if (freq <= f[0] || freq >= f[3]) {
+    return 0.0;
+  }
+  if (freq < f[1]) {
+    return 0.5 - 0.5 * cos(M_PI * (freq - f[0]) / (f[1] - f[0]));
+  }
+  if (freq > f[2]) {
+    return 0.5 + 0.5 * cos(M_PI * (freq - f[2]) / (f[3] - f[2]));
+  }
+  return 1.0;
+}
+
+/*!
+ * @brief tabulate the inverse of a definition for a rate
+ *
+ * The upper corners of a prefilter above the Nyquist frequency are
+ * replaced by the default ones of the rate, so one prefilter serves
+ * channels of all rates.
+ *
+ * @return NULL for a prefilter out of the band of the rate or no memory
+ */
+static resp_transfer *transfer_new(const resp_cache *c, const resp_def *d, double rate) {
+  resp_transfer *t;
+  double re, im, g, gmax = 0.0, wl, freq, w, qr, qi, tr;
+  int k, j, nfreq, margin;
+
+  t = (resp_transfer *)calloc(1, sizeof(resp_transfer));
+  if (t == NULL) {
+    return NULL;
+  }
+  t->def = d;
+  t->rate = rate;
+  t->output = c->output;
+  resp_default_prefilter(rate, t->prefilter);
+  if (c->prefilter[3] > 0.0) {
+    t->prefilter[0] = c->prefilter[0];
+    t->prefilter[1] = c->prefilter[1];
+    if (c->prefilter[3] <= rate / 2.0) {
+      t->prefilter[2] = c->prefilter[2];
+      t->prefilter[3] = c->prefilter[3];
+    }
+  }
+  margin = (int)ceil(RESP_MARGIN_PERIODS * rate / t->prefilter[0]);
+  t->nfft = fft_size(4 * margin);
+  t->margin = t->nfft / 4;
+  if (t->prefilter[1] > t->prefilter[2] || t->nfft > RESP_MAX_FFT) {
+    free(t);
+    return NULL;
+  }
+  nfreq = t->nfft / 2 + 1;
+  t->inverse = (double *)malloc(2 * nfreq * sizeof(double));
+  if (t->inverse == NULL || fft_init(&t->fft, t->nfft) != 0) {
+    transfer_free(t);
+    return NULL;
+  }
+
+  // the response first, for the largest gain in the band
+  for (k = 0; k < nfreq; k++) {
+    freq = k * rate / t->nfft;
+    if (taper(t->prefilter, freq) > 0.0) {
+      resp_eval(d, freq, &t->inverse[2*k], &t->inverse[2*k+1]);
+      g = hypot(t->inverse[2*k], t->inverse[2*k+1]);
+      if (isfinite(g) && g > gmax) {
+        gmax = g;
+      }
+    }
+  }
+  wl = gmax * pow(10.0, -c->water_level / 20.0);
+
+  for (k = 0; k < nfreq; k++) {
+    freq = k * rate / t->nfft;
+    w = taper(t->prefilter, freq);
+    re = t->inverse[2*k];
+    im = t->inverse[2*k+1];
+    g = hypot(re, im);
+    if (w == 0.0 || !isfinite(g) || wl == 0.0) {
+      t->inverse[2*k] = 0.0;
+      t->inverse[2*k+1] = 0.0;
+      continue;
+    }
+    if (g < wl) {
+      if (g == 0.0) {
+        re = wl;
+        im = 0.0;
+      } else {
+        re *= wl / g;
+        im *= wl / g;
+      }
+      g = wl;
+    }
+    // w / H times (i omega)^(output - input)
+    qr = w * re / (g * g);
+    qi = -w * im / (g * g);
+    for (j = d->input; j < t->output; j++) {
+      tr = -qi * 2.0 * M_PI * freq;
+      qi = qr * 2.0 * M_PI * freq;
+      qr = tr;
+    }
+    for (j = t->output; j < d->input; j++) {
+      tr = qi / (2.0 * M_PI * freq);
+      qi = -qr / (2.0 * M_PI * freq);
+      qr = tr;
+    }
+    t->inverse[2*k] = qr;
+    t->inverse[2*k+1] = qi;
+  }
+  return t;
+}
+
+/*!
+ * @brief transfer function of a definition for a rate, computed on the first call
+ *
+ * @return NULL for a prefilter out of the band of the rate or no memory
+ */
+const resp_transfer *resp_cache_get(resp_cache *c, const resp_def *d, double rate) {
+  resp_transfer **t;
+  int i;
+
+  for (i = 0; i < c->n; i++) {
+    if (c->t[i]->def == d && c->t[i]->rate == rate) {
+      return c->t[i];
+    }
+  }
+  if (c->n >= c->max) {
+    c->max = (c->max > 0) ? c->max * 2 : 16;
+    t = (resp_transfer **)realloc(c->t, c->max * sizeof(resp_transfer *));
+    if (t == NULL) {
+      return NULL;
+    }
+    c->t = t;
+  }
+  c->t[c->n] = transfer_new(c, d, rate);
+  if (c->t[c->n] == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__,
+               "invalid prefilter for %g Hz: %g,%g,%g,%g", rate,
+               c->prefilter[0], c->prefilter[1], c->prefilter[2], c->prefilter[3]);
+    return NULL;
+  }
+  return c->t[c->n++];
+}
+
+/*!
+ * @brief set up the deconvolution of a channel with a transfer function
+ *
+ * @return 0 on success, -1 for no memory
+ */
+int resp_calib_init(resp_calib *c, const resp_transfer *t) {
+  int nfft = t->nfft;
+
+  memset(c, 0, sizeof(resp_calib));
+  c->t = t;
+  c->hop = nfft / 2;
+  c->max = nfft + RESP_BATCH * c->hop;
+  c->buf = (double *)malloc(c->max * sizeof(double));
+  c->x = (double *)malloc((size_t)RESP_BATCH * nfft * sizeof(double));
+  c->z = (double *)malloc((size_t)RESP_BATCH * (nfft + 2) * sizeof(double));
+  c->work = (double *)malloc((size_t)RESP_BATCH * nfft * sizeof(double));
+  if (c->buf == NULL || c->x == NULL || c->z == NULL || c->work == NULL) {
+    resp_calib_free(c);
+    return -1;
+  }
+  return 0;
+}
+
+/*!
+ * @brief start a new run (after a gap), dropping the samples not yet output
+ */
+void resp_calib_reset(resp_calib *c) {
+  c->fill = 0;
+  c->nin = 0;
+  c->nout = 0;
+}
+
+/*!
+ * @brief most outputs of resp_calib_process() of n samples or of resp_calib_flush()
+ */
+int resp_calib_max_output(const resp_calib *c, int n) {
+  return n + c->t->nfft;
+}
+
+/*!
+ * @brief deconvolve the complete blocks of the buffer
+ *
+ * @param[in] limit most outputs
+ * @return number of outputs
+ */
+static int run_blocks(resp_calib *c, float *y, int64_t limit) {
+  const resp_transfer *t = c->t;
+  int nfft = t->nfft, m = 0;
+  int nb, b, k, avail;
+  double re, im;
+
+  for (;;) {
+    avail = (c->fill >= nfft) ? (c->fill - nfft) / c->hop + 1 : 0;
+    nb = (avail < RESP_BATCH) ? avail : RESP_BATCH;
+    if (nb == 0 || m >= limit) {
+      return m;
+    }
+    for (b = 0; b < nb; b++) {
+      memcpy(&c->x[(size_t)b * nfft], &c->buf[b * c->hop], nfft * sizeof(double));
+    }
+    fft_forward_batch(&t->fft, c->x, nb, c->z, c->work);
+    for (b = 0; b < nb; b++) {
+      double *z = &c->z[(size_t)b * (nfft + 2)];
+      double *x = &c->x[(size_t)b * nfft];
+
+      for (k = 0; k <= nfft / 2; k++) {
+        re = z[2*k] * t->inverse[2*k] - z[2*k+1] * t->inverse[2*k+1];
+        im = z[2*k] * t->inverse[2*k+1] + z[2*k+1] * t->inverse[2*k];
+        z[2*k] = re;
+        z[2*k+1] = im;
+      }
+      fft_inverse(&t->fft, z, x);
+      for (k = 0; k < c->hop && m < limit; k++) {
+        y[m++] = (float)x[t->margin + k];
+      }
+    }
+    c->fill -= nb * c->hop;
+    memmove(c->buf, &c->buf[nb * c->hop], c->fill * sizeof(double));
+  }
+}
+
+/*!
+ * @brief deconvolve the next samples of a run
+ *
+ * The run starts on copies of its first sample. Output k is the ground
+ * motion at input k; the outputs lag the inputs by up to a block.
+ *
+ * @param[in] x n counts
+ * @param[out] y at most resp_calib_max_output(c, n) outputs
+ * @return number of outputs
+ */
+int resp_calib_process(resp_calib *c, const float *x, int n, float *y) {
+  int i, take, m = 0;
+
+  if (n <= 0) {
+    return 0;
+  }
+  if (c->nin == 0) {
+    for (i = 0; i < c->t->margin; i++) {
+      c->buf[i] = x[0];
+    }
+    c->fill = c->t->margin;
+  }
+  while (n > 0) {
+    take = c->max - c->fill;
+    if (take > n) {
+      take = n;
+    }
+    for (i = 0; i < take; i++) {
+      c->buf[c->fill + i] = x[i];
+    }
+    c->fill += take;
+    c->nin += take;
+    x += take;
+    n -= take;
+    m += run_blocks(c, &y[m], c->nin - c->nout - m);
+  }
+  c->nout += m;
+  return m;
+}
+
+/*!
+ * @brief the remaining outputs of a run (padded with copies of its last sample)
+ *
+ * @param[out] y at most resp_calib_max_output(c, 0) outputs
+ * @return number of outputs
+ */
+int resp_calib_flush(resp_calib *c, float *y) {
+  double last;
+  int m = 0;
+
+  if (c->nin == 0) {
+    return 0;
+  }
+  last = c->buf[c->fill - 1];
+  while (c->nout + m < c->nin) {
+    while (c->fill < c->t->nfft) {
+      c->buf[c->fill++] = last;
+    }
+    m += run_blocks(c, &y[m], c->nin - c->nout - m);
+  }
+  resp_calib_reset(c);
+  return m;
+}
+
+void resp_calib_free(resp_calib *c) {
+  free(c->buf);
+  free(c->x);
+  free(c->z);
+  free(c->work);
+  memset(c, 0, sizeof(resp_calib));
+}
@@ -0,0 +1,138 @@
+/*! @file response.h
+ *  @brief instrument response removal: counts to ground motion by blocks of FFTs
+ *  @date 2026/10/18
+ */
+#ifndef __RESPONSE_H__
+#define __RESPONSE_H__
+
+#include <stdint.h>
+#include "fft.h"
+
+//! quantity of ground motion (the power of i omega from displacement)
+#define RESP_DISPLACEMENT 0
+#define RESP_VELOCITY     1
+#define RESP_ACCELERATION 2
+
+//! poles or zeros of a definition
+#define RESP_MAX_PZ 16
+
+//! default water level below the largest gain [dB]
+#define RESP_WATER_LEVEL 60.0
+
+//! blocks deconvolved at once
+#define RESP_BATCH 8
+
+//! longest block
+#define RESP_MAX_FFT (1 << 20)
+
+/*!
+ * response of a channel of a station from one time to another (a line
+ * of a response file): H(s) = sensitivity * a0 * prod(s - zero) / prod(s - pole)
+ * in counts per unit of the input quantity, with |a0 ...| = 1 at f_norm
+ */
+typedef struct tag_resp_def {
+  int apollo_station;
+
+  //! SAMPLES_* channel
+  int channel;
+
+  //! from <= epoch < to [msec since the epoch]
+  int64_t from;
+  int64_t to;
+
+  //! RESP_* quantity the sensitivity is given for
+  int input;
+  double sensitivity;
+  double f_norm;
+  double a0;
+
+  //! zeros and poles [rad/s], interleaved re/im
+  int nzero;
+  int npole;
+  double zero[2 * RESP_MAX_PZ];
+  double pole[2 * RESP_MAX_PZ];
+} resp_def;
+
+//! definitions of a response file
+typedef struct tag_resp_table {
+  resp_def *d;
+  int n;
+} resp_table;
+
+/*!
+ * inverse transfer function of a definition for a sample rate, output
+ * quantity and prefilter: the spectrum of a block of counts times it is
+ * the spectrum of the ground motion
+ */
+typedef struct tag_resp_transfer {
+  const resp_def *def;
+  double rate;
+  int output;
+  double prefilter[4];
+
+  //! block of nfft samples, its first and last margin samples discarded
+  fft_plan fft;
+  int nfft;
+  int margin;
+
+  //! nfft/2+1 coefficients, interleaved re/im
+  double *inverse;
+} resp_transfer;
+
+/*!
+ * transfer functions computed so far, shared by the channels; entries
+ * are read only once made, so a cache is filled before threads use it
+ */
+typedef struct tag_resp_cache {
+  const resp_table *table;
+  int output;
+  double prefilter[4];
+  double water_level;
+
+  resp_transfer **t;
+  int n;
+  int max;
+} resp_cache;
+
+//! streaming deconvolution of a channel (overlap-save, half of a block per step)
+typedef struct tag_resp_calib {
+  const resp_transfer *t;
+  int hop;
+
+  //! margin, unprocessed samples and padding
+  double *buf;
+  int fill;
+  int max;
+
+  //! real inputs and outputs of the run
+  int64_t nin;
+  int64_t nout;
+
+  //! RESP_BATCH blocks and their spectra
+  double *x;
+  double *z;
+  double *work;
+} resp_calib;
+
+int resp_quantity(const char *name);
+int resp_read(const char *filename, resp_table *t);
+void resp_table_free(resp_table *t);
+const resp_def *resp_find(const resp_table *t, int apollo_station, int channel, int64_t epoch);
+void resp_eval(const resp_def *d, double freq, double *re, double *im);
+
+int resp_parse_prefilter(const char *arg, double *f);
+void resp_default_prefilter(double rate, double *f);
+
+void resp_cache_init(resp_cache *c, const resp_table *table, int output,
+                     const double *prefilter, double water_level);
+void resp_cache_free(resp_cache *c);
+const resp_transfer *resp_cache_get(resp_cache *c, const resp_def *d, double rate);
+
+int resp_calib_init(resp_calib *c, const resp_transfer *t);
+void resp_calib_reset(resp_calib *c);
+int resp_calib_max_output(const resp_calib *c, int n);
+int resp_calib_process(resp_calib *c, const float *x, int n, float *y);
+int resp_calib_flush(resp_calib *c, float *y);
+void resp_calib_free(resp_calib *c);
+
+#endif
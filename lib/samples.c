@@ -0,0 +1,412 @@
+/*! @file samples.c
+ *  @brief decoded seismometer samples of PSE/WTN/WTH files per station and channel
+ *  @date 2026/10/18
+ *
+ *  The analysis tools read the samples straight from the tapes instead of
+ *  tbl_pse and tbl_lspe. samples_scan() decodes a file frame by frame as the loaders
+ *  do (frame linking, checks and the clock model of every package) and
+ *  passes the samples of every station and channel to a callback.
+ *  samples_load() puts the samples of one channel on a regular grid of
+ *  the nominal rate, starting a new series at a gap of more than
+ *  SAMPLES_MAX_GAP or a step back before the start of the series.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "define.h"
+#include "error.h"
+#include "util.h"
+#include "pse.h"
+#include "wtn.h"
+#include "wth.h"
+#include "clock.h"
+#include "pse_reader.h"
+#include "wtn_demux.h"
+#include "samples.h"
+
+//! gap [msec] which starts a new series in samples_load()
+#define SAMPLES_MAX_GAP (6 * 3600 * 1000LL)
+
+//! apollo_station of the series of samples_load() 0 ... 17
+#define SAMPLES_MAX_STATION 17
+
+static const char *channel_names[SAMPLES_NUM_CHANNEL] = {
+  "sp_z", "lp_x", "lp_y", "lp_z", "lsg", "gp1", "gp2", "gp3", "gp4"
+};
+
+static const int channel_counts[SAMPLES_NUM_CHANNEL] = {
+  COUNTS_PER_FRAME_FOR_PSE_SP,
+  COUNTS_PER_FRAME_FOR_PSE_LP,
+  COUNTS_PER_FRAME_FOR_PSE_LP,
+  COUNTS_PER_FRAME_FOR_PSE_LP,
+  COUNTS_PER_FRAME_FOR_WTN_LSG,
+  COUNTS_PER_FRAME_FOR_WTH_GP,
+  COUNTS_PER_FRAME_FOR_WTH_GP,
+  COUNTS_PER_FRAME_FOR_WTH_GP,
+  COUNTS_PER_FRAME_FOR_WTH_GP,
+};
+
+typedef struct tag_load_arg {
+  int channel;
+  samples_series *s;
+  int n;
+  int max;
+
+  //! series being filled of every station (-1 if none)
+  int current[SAMPLES_MAX_STATION+1];
+  int64_t size[SAMPLES_MAX_STATION+1];
+
+  int error;
+} load_arg;
+
+/*!
+ * @brief SAMPLES_TYPE_* of "pse", "wtn" or "wth" (-1 if unknown)
+ */
+int samples_type(const char *name) {
+  if (strcmp(name, "pse") == 0) {
+    return SAMPLES_TYPE_PSE;
+  }
+  if (strcmp(name, "wtn") == 0) {
+    return SAMPLES_TYPE_WTN;
+  }
+  if (strcmp(name, "wth") == 0) {
+    return SAMPLES_TYPE_WTH;
+  }
+  return -1;
+}
+
+/*!
+ * @brief SAMPLES_* of a channel name of tbl_pse/tbl_lsg/tbl_lspe (-1 if unknown)
+ */
+int samples_channel(const char *name) {
+  int i;
+
+  for (i = 0; i < SAMPLES_NUM_CHANNEL; i++) {
+    if (strcmp(name, channel_names[i]) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+const char *samples_channel_name(int channel) {
+  return channel_names[channel];
+}
+
+int samples_per_frame(int channel) {
+  return channel_counts[channel];
+}
+
+/*!
+ * @brief msec per frame of a channel
+ */
+double samples_frame_msec(int channel) {
+  return (channel >= SAMPLES_GP_1) ? SAMPLES_FRAME_MSEC_WTH : SAMPLES_FRAME_MSEC;
+}
+
+/*!
+ * @brief nominal samples per second of a channel
+ */
+double samples_rate(int channel) {
+  return channel_counts[channel] * 1000.0 / samples_frame_msec(channel);
+}
+
+static int scan_pse(const char *filename, samples_func func, void *arg) {
+  pse_reader rd;
+  clock_model clock;
+  int64_t epoch;
+  int j, r;
+  int station;
+
+  if (pse_reader_open(&rd, filename, -1) != 0) {
+    return -1;
+  }
+  clock_init(&clock, VALID_FRAME_RATE, SIZE_LOGICAL_RECORD);
+
+  while ((r = pse_reader_next(&rd)) != 0) {
+    if (r < 0) {
+      if (feof(rd.f)) {
+        break;
+      }
+      continue;
+    }
+    station = rd.pr.apollo_station;
+    for (j = 0; j < r; j++) {
+      pse_frame *pf = &rd.pf[j];
+
+      pf->msec_of_year_corrected = clock_correct(&clock, pf->msec_of_year, pf->frame_count,
+                                                 pf->error_flag, &pf->time_flag);
+      if (pf->error_flag & SAMPLES_ERROR_MASK) {
+        continue;
+      }
+      epoch = msec_of_year_to_epoch(rd.pr.year, pf->msec_of_year_corrected);
+      if (rd.pr.format == FORMAT_OLD) {
+        func(station, SAMPLES_SP_Z, epoch, pf->spz, COUNTS_PER_FRAME_FOR_PSE_SP, arg);
+      }
+      func(station, SAMPLES_LP_X, epoch, pf->lpx, COUNTS_PER_FRAME_FOR_PSE_LP, arg);
+      func(station, SAMPLES_LP_Y, epoch, pf->lpy, COUNTS_PER_FRAME_FOR_PSE_LP, arg);
+      func(station, SAMPLES_LP_Z, epoch, pf->lpz, COUNTS_PER_FRAME_FOR_PSE_LP, arg);
+    }
+  }
+  pse_reader_close(&rd);
+  return 0;
+}
+
+static int scan_wtn(const char *filename, samples_func func, void *arg) {
+  unsigned char record[SIZE_HEADER];
+  unsigned char header[SIZE_HEADER];
+  unsigned char frame[SIZE_FRAME];
+  wtn_record wnr;
+  wtn_frame wnf;
+  wtn_demux demux;
+  clock_model clock[WTN_DEMUX_STREAMS];
+  int64_t epoch;
+  int i, s, station;
+  FILE *f;
+
+  f = fopen(filename, "rb");
+  if (f == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "no such file: %s", filename);
+    return -1;
+  }
+  if (fread(record, sizeof(unsigned char), SIZE_HEADER, f) != SIZE_HEADER ||
+      fread(header, sizeof(unsigned char), SIZE_HEADER, f) != SIZE_HEADER) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "invalid data size: %s", filename);
+    fclose(f);
+    return -1;
+  }
+  wnr = binary2wtn_record(record);
+
+  // check duplicated header
+  if (memcmp(record, header, SIZE_HEADER) != 0) {
+    fseek(f, -SIZE_HEADER, SEEK_CUR);
+  }
+
+  wtn_demux_init(&demux);
+  for (i = 0; i < WTN_DEMUX_STREAMS; i++) {
+    clock_init(&clock[i], VALID_FRAME_RATE, SIZE_LOGICAL_RECORD);
+  }
+
+  // a short last frame keeps the rest of the frame before it
+  memset(frame, 0, sizeof(frame));
+  while (fread(frame, sizeof(unsigned char), SIZE_FRAME, f) > 0) {
+    binary2wtn_frames(wnr, frame, &wnf, 1);
+    wtn_demux_link(&demux, &wnf);
+    check_wtn_frames(&wnf, 1, wnr.year);
+    s = wtn_demux_stream(wnf.alsep_package_id);
+    wnf.msec_of_year_corrected = clock_correct(&clock[s], wnf.msec_of_year, wnf.frame_count,
+                                               wnf.error_flag, &wnf.time_flag);
+    station = package_id2station_id(wnf.alsep_package_id);
+    if (station < 0 || (wnf.error_flag & SAMPLES_ERROR_MASK)) {
+      continue;
+    }
+
+    epoch = msec_of_year_to_epoch(wnr.year, wnf.msec_of_year_corrected);
+    if (station == 17) {
+      func(station, SAMPLES_LSG, epoch, wnf.lsg, COUNTS_PER_FRAME_FOR_WTN_LSG, arg);
+    } else {
+      func(station, SAMPLES_SP_Z, epoch, wnf.spz, COUNTS_PER_FRAME_FOR_WTN_SP, arg);
+      func(station, SAMPLES_LP_X, epoch, wnf.lpx, COUNTS_PER_FRAME_FOR_WTN_LP, arg);
+      func(station, SAMPLES_LP_Y, epoch, wnf.lpy, COUNTS_PER_FRAME_FOR_WTN_LP, arg);
+      func(station, SAMPLES_LP_Z, epoch, wnf.lpz, COUNTS_PER_FRAME_FOR_WTN_LP, arg);
+    }
+  }
+  fclose(f);
+  return 0;
+}
+
+static int scan_wth(const char *filename, samples_func func, void *arg) {
+  unsigned char record[SIZE_HEADER];
+  unsigned char header[SIZE_HEADER];
+  unsigned char frame[SIZE_FRAME];
+  wth_record whr;
+  wth_frame whf;
+  clock_model clock[WTN_DEMUX_STREAMS];
+  int64_t epoch, prev[WTN_DEMUX_STREAMS];
+  int i, p, station;
+  FILE *f;
+
+  f = fopen(filename, "rb");
+  if (f == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "no such file: %s", filename);
+    return -1;
+  }
+  if (fread(record, sizeof(unsigned char), SIZE_HEADER, f) != SIZE_HEADER ||
+      fread(header, sizeof(unsigned char), SIZE_HEADER, f) != SIZE_HEADER) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "invalid data size: %s", filename);
+    fclose(f);
+    return -1;
+  }
+  whr = binary2wth_record(record);
+
+  // check duplicated header
+  if (memcmp(record, header, SIZE_HEADER) != 0) {
+    fseek(f, -SIZE_HEADER, SEEK_CUR);
+  }
+
+  for (i = 0; i < WTN_DEMUX_STREAMS; i++) {
+    clock_init(&clock[i], VALID_FRAME_RATE_WTH, 0);
+    prev[i] = -1;
+  }
+
+  // a short last frame keeps the rest of the frame before it
+  memset(frame, 0, sizeof(frame));
+  while (fread(frame, sizeof(unsigned char), SIZE_FRAME, f) > 0) {
+    whf = binary2wth_frame(whr, frame);
+    p = wtn_demux_stream(whf.alsep_package_id);
+    whf.time_diff = (prev[p] >= 0) ? whf.msec_of_year - prev[p] : whf.msec_of_year;
+    prev[p] = whf.msec_of_year;
+    whf.error_flag = check_wth_frame(whf, whr.year);
+    whf.msec_of_year_corrected = clock_correct(&clock[p], whf.msec_of_year, -1,
+                                               whf.error_flag, &whf.time_flag);
+    station = package_id2station_id(whf.alsep_package_id);
+    if (station < 0 || (whf.error_flag & SAMPLES_ERROR_MASK)) {
+      continue;
+    }
+
+    epoch = msec_of_year_to_epoch(whr.year, whf.msec_of_year_corrected);
+    func(station, SAMPLES_GP_1, epoch, whf.dp1, COUNTS_PER_FRAME_FOR_WTH_GP, arg);
+    func(station, SAMPLES_GP_2, epoch, whf.dp6, COUNTS_PER_FRAME_FOR_WTH_GP, arg);
+    func(station, SAMPLES_GP_3, epoch, whf.dp11, COUNTS_PER_FRAME_FOR_WTH_GP, arg);
+    func(station, SAMPLES_GP_4, epoch, whf.dp16, COUNTS_PER_FRAME_FOR_WTH_GP, arg);
+  }
+  fclose(f);
+  return 0;
+}
+
+/*!
+ * @brief decode a file and pass the samples of every frame to func
+ *
+ * @param[in] type SAMPLES_TYPE_*
+ * @return 0 on success, -1 if the file cannot be read
+ */
+int samples_scan(int type, const char *filename, samples_func func, void *arg) {
+  if (type == SAMPLES_TYPE_PSE) {
+    return scan_pse(filename, func, arg);
+  }
+  if (type == SAMPLES_TYPE_WTH) {
+    return scan_wth(filename, func, arg);
+  }
+  return scan_wtn(filename, func, arg);
+}
+
+/*!
+ * @brief start a series of a station at a sample
+ */
+static samples_series *new_series(load_arg *la, int station, int64_t epoch) {
+  samples_series *t;
+
+  if (la->n >= la->max) {
+    la->max = (la->max > 0) ? la->max * 2 : 8;
+    t = (samples_series *)realloc(la->s, la->max * sizeof(samples_series));
+    if (t == NULL) {
+      return NULL;
+    }
+    la->s = t;
+  }
+  t = &la->s[la->n];
+  memset(t, 0, sizeof(samples_series));
+  t->apollo_station = station;
+  t->channel = la->channel;
+  t->rate = samples_rate(la->channel);
+  t->t0 = epoch;
+  la->current[station] = la->n++;
+  la->size[station] = 0;
+  return t;
+}
+
+static int grow_series(samples_series *s, int64_t *size, int64_t n) {
+  float *x;
+  int64_t i, m = (*size > 0) ? *size : 4096;
+
+  while (m < n) {
+    m *= 2;
+  }
+  if (m > *size) {
+    x = (float *)realloc(s->x, m * sizeof(float));
+    if (x == NULL) {
+      return -1;
+    }
+    s->x = x;
+    *size = m;
+  }
+  for (i = s->n; i < n; i++) {
+    s->x[i] = NAN;
+  }
+  s->n = n;
+  return 0;
+}
+
+static void load_frame(int station, int channel, int64_t epoch, const int32_t *data, int n, void *arg) {
+  load_arg *la = (load_arg *)arg;
+  samples_series *s = NULL;
+  int64_t index;
+  int k;
+
+  if (channel != la->channel || station < 0 || station > SAMPLES_MAX_STATION || la->error) {
+    return;
+  }
+  if (la->current[station] >= 0) {
+    s = &la->s[la->current[station]];
+    if (epoch < s->t0 || epoch > s->t0 + (int64_t)(s->n / s->rate * 1000.0) + SAMPLES_MAX_GAP) {
+      s = NULL;
+    }
+  }
+  if (s == NULL && (s = new_series(la, station, epoch)) == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+    la->error = 1;
+    return;
+  }
+
+  for (k = 0; k < n; k++) {
+    if (data[k] == DATA_NONE) {
+      continue;
+    }
+    index = llround((epoch - s->t0 + k * samples_frame_msec(channel) / n) * s->rate / 1000.0);
+    if (index >= s->n && grow_series(s, &la->size[station], index + 1) != 0) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+      la->error = 1;
+      return;
+    }
+    s->x[index] = (float)data[k];
+  }
+}
+
+/*!
+ * @brief samples of a channel of every station of a file on regular grids
+ *
+ * @param[in] type SAMPLES_TYPE_*
+ * @param[in] channel SAMPLES_*
+ * @param[out] s series (to be freed by samples_free())
+ * @param[out] n number of series
+ * @return 0 on success, -1 on error
+ */
+int samples_load(int type, const char *filename, int channel, samples_series **s, int *n) {
+  load_arg la;
+  int i;
+
+  memset(&la, 0, sizeof(la));
+  la.channel = channel;
+  for (i = 0; i <= SAMPLES_MAX_STATION; i++) {
+    la.current[i] = -1;
+  }
+  if (samples_scan(type, filename, load_frame, &la) != 0 || la.error) {
+    samples_free(la.s, la.n);
+    return -1;
+  }
+  *s = la.s;
+  *n = la.n;
+  return 0;
+}
+
+void samples_free(samples_series *s, int n) {
+  int i;
+
+  for (i = 0; i < n; i++) {
+    free(s[i].x);
+  }
+  free(s);
+}
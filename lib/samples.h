@@ -0,0 +1,69 @@
+/*! @file samples.h
+ *  @brief decoded seismometer samples of PSE/WTN/WTH files per station and channel
+ *  @date 2026/10/18
+ */
+#ifndef __SAMPLES_H__
+#define __SAMPLES_H__
+
+#include <stdint.h>
+#include "timebase.h"
+
+#define SAMPLES_TYPE_PSE 0
+#define SAMPLES_TYPE_WTN 1
+#define SAMPLES_TYPE_WTH 2
+
+#define SAMPLES_SP_Z 0
+#define SAMPLES_LP_X 1
+#define SAMPLES_LP_Y 2
+#define SAMPLES_LP_Z 3
+#define SAMPLES_LSG  4
+#define SAMPLES_GP_1 5
+#define SAMPLES_GP_2 6
+#define SAMPLES_GP_3 7
+#define SAMPLES_GP_4 8
+#define SAMPLES_NUM_CHANNEL 9
+
+//! msec per frame: 64 words/frame, 1060 bps, 10 bits/word
+#define SAMPLES_FRAME_MSEC (TIMEBASE_FRAME_BITS * 1000.0 / TIMEBASE_BIT_RATE)
+
+//! msec per subframe of the LSPE geophones (WTH): 20 words/subframe, 3533 bps, 30 bits/word
+#define SAMPLES_FRAME_MSEC_WTH (TIMEBASE_FRAME_BITS_WTH * 1000.0 / TIMEBASE_BIT_RATE_WTH)
+
+//! frames with one of these errors are left out (as warned by the loaders)
+#define SAMPLES_ERROR_MASK 0xff00
+
+/*!
+ * called for the samples of a channel of a frame in file order; sample k
+ * is at epoch + k * samples_frame_msec(channel) / n [msec since the epoch]
+ * and is DATA_NONE if missing
+ */
+typedef void (*samples_func)(int apollo_station, int channel, int64_t epoch,
+                             const int32_t *data, int n, void *arg);
+
+//! samples of a channel of a station on a regular grid
+typedef struct tag_samples_series {
+  int apollo_station;
+  int channel;
+
+  //! samples per second
+  double rate;
+
+  //! time of x[0] [msec since the epoch]
+  int64_t t0;
+
+  //! samples, NAN where missing
+  float *x;
+  int64_t n;
+} samples_series;
+
+int samples_type(const char *name);
+int samples_channel(const char *name);
+const char *samples_channel_name(int channel);
+int samples_per_frame(int channel);
+double samples_frame_msec(int channel);
+double samples_rate(int channel);
+int samples_scan(int type, const char *filename, samples_func func, void *arg);
+int samples_load(int type, const char *filename, int channel, samples_series **s, int *n);
+void samples_free(samples_series *s, int n);
+
+#endif
@@ -0,0 +1,574 @@
+/*! @file spectrogram.c
+ *  @brief tiles of STFT power spectra at several time and frequency zoom levels
+ *  @date 2026/10/18
+ *
+ *  The STFT of a channel takes Hann windows of nfft samples, nfft/2
+ *  samples apart, as one-sided PSDs in counts^2/Hz (windows with a
+ *  missing sample are left out). Columns are on a grid of the epoch, so
+ *  tiles of different files and runs line up: the first window of a
+ *  series belongs to the column of level 0 holding its centre and the
+ *  next ones to the next columns, a column of level l is the mean
+ *  of 2^l columns of level 0 and a tile is SPEC_TILE_COLS columns of one
+ *  level. Frequency levels are separate plans of 2, 4, ... times nfft.
+ *
+ *  spec_build() computes all tiles under one tile of the top level from
+ *  the decoded series, so the tiles of a top level tile are one job of a
+ *  pool. Pixels are dB in SPEC_DB_STEP steps in one byte.
+ *
+ *  A tile file starts with SPEC_MAGIC followed by the pixels of every
+ *  tile, the index (spec_entry in order of the key) and a footer of the
+ *  offset and length of the index and SPEC_MAGIC, all in host byte order.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "spectrogram.h"
+
+#define SPEC_MAGIC "ALSEPSG1"
+
+/*!
+ * @brief tabulate the STFT of a sample rate
+ *
+ * @param[in] nfft window [samples], a power of two
+ * @param[in] levels time levels 1 ... SPEC_MAX_LEVEL
+ * @return 0 on success, -1 for invalid parameters or no memory
+ */
+int spec_init(spec_plan *p, double rate, int nfft, int levels) {
+  double sum = 0.0;
+  int i;
+
+  memset(p, 0, sizeof(spec_plan));
+  if (rate <= 0.0 || levels < 1 || levels > SPEC_MAX_LEVEL || fft_init(&p->fft, nfft) != 0) {
+    return -1;
+  }
+  p->rate = rate;
+  p->nfft = nfft;
+  p->levels = levels;
+  p->taper = (double *)malloc(nfft * sizeof(double));
+  if (p->taper == NULL) {
+    spec_free(p);
+    return -1;
+  }
+  for (i = 0; i < nfft; i++) {
+    p->taper[i] = 0.5 - 0.5 * cos(2.0 * M_PI * i / nfft);
+    sum += p->taper[i] * p->taper[i];
+  }
+  p->scale = 2.0 / (rate * sum);
+  return 0;
+}
+
+void spec_free(spec_plan *p) {
+  fft_free(&p->fft);
+  free(p->taper);
+  memset(p, 0, sizeof(spec_plan));
+}
+
+/*!
+ * @brief width of a column [msec]
+ */
+double spec_column_msec(double rate, int nfft, int level) {
+  return (nfft / 2) * 1000.0 / rate * (double)(1LL << level);
+}
+
+/*!
+ * @brief pixels of a column
+ */
+int spec_rows(int nfft) {
+  return nfft / 2 + 1;
+}
+
+/*!
+ * @brief dB of a pixel (NAN for SPEC_NONE)
+ */
+double spec_db(uint8_t pixel) {
+  return (pixel == SPEC_NONE) ? NAN : SPEC_DB_MIN + pixel * SPEC_DB_STEP;
+}
+
+static uint8_t to_pixel(double power) {
+  double v;
+
+  if (!(power > 0.0)) {
+    return 0;
+  }
+  v = floor((10.0 * log10(power) - SPEC_DB_MIN) / SPEC_DB_STEP + 0.5);
+  return (v < 0.0) ? 0 : (v > SPEC_NONE - 1) ? SPEC_NONE - 1 : (uint8_t)v;
+}
+
+static int64_t floor_div(int64_t a, int64_t b) {
+  return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+/*!
+ * column of level 0 of the window k of a series: windows are one column
+ * apart, so the column of the first one is counted on (the centres of
+ * later windows may round to either side of a column boundary)
+ */
+static int64_t frame_column(const spec_plan *p, const samples_series *s, int64_t k) {
+  double center = s->t0 + (p->nfft / 2) * 1000.0 / p->rate;
+
+  return (int64_t)floor(center / spec_column_msec(p->rate, p->nfft, 0)) + k;
+}
+
+//! columns of level 0 under a tile of the top level
+static int64_t top_span(const spec_plan *p) {
+  return (int64_t)SPEC_TILE_COLS << (p->levels - 1);
+}
+
+/*!
+ * @brief tiles of the top level holding the windows of a series
+ *
+ * @return 0 on success, -1 if the series is shorter than a window
+ */
+int spec_top_range(const spec_plan *p, const samples_series *s, int64_t *first, int64_t *last) {
+  if (s->n < p->nfft) {
+    return -1;
+  }
+  *first = floor_div(frame_column(p, s, 0), top_span(p));
+  *last = floor_div(frame_column(p, s, (s->n - p->nfft) / (p->nfft / 2)), top_span(p));
+  return 0;
+}
+
+typedef struct tag_build_arg {
+  const spec_plan *p;
+  int rows;
+  float *sum;
+  int32_t *count;
+  double *buf;
+  double *z;
+  double *work;
+  int64_t col[SPEC_BATCH];
+  int nb;
+} build_arg;
+
+static void flush_frames(build_arg *a) {
+  const spec_plan *p = a->p;
+  double re, im, w;
+  int b, r;
+
+  if (a->nb == 0) {
+    return;
+  }
+  fft_forward_batch(&p->fft, a->buf, a->nb, a->z, a->work);
+  for (b = 0; b < a->nb; b++) {
+    const double *zb = &a->z[(size_t)b * (p->nfft + 2)];
+    float *col = &a->sum[(size_t)a->col[b] * a->rows];
+
+    for (r = 0; r < a->rows; r++) {
+      re = zb[2*r];
+      im = zb[2*r+1];
+      w = (r == 0 || r == a->rows - 1) ? p->scale / 2.0 : p->scale;
+      col[r] += (float)((re * re + im * im) * w);
+    }
+    a->count[a->col[b]]++;
+  }
+  a->nb = 0;
+}
+
+static int add_tile(const build_arg *a, const spec_key *key, int64_t c0, spec_tile **tiles, int *n, int *max) {
+  spec_tile *t;
+  int64_t c;
+  int r;
+
+  if (*n >= *max) {
+    *max = (*max > 0) ? *max * 2 : 16;
+    t = (spec_tile *)realloc(*tiles, *max * sizeof(spec_tile));
+    if (t == NULL) {
+      return -1;
+    }
+    *tiles = t;
+  }
+  t = &(*tiles)[*n];
+  t->key = *key;
+  t->rate = a->p->rate;
+  t->data = (uint8_t *)malloc((size_t)SPEC_TILE_COLS * a->rows);
+  if (t->data == NULL) {
+    return -1;
+  }
+  (*n)++;
+  for (c = 0; c < SPEC_TILE_COLS; c++) {
+    const float *col = &a->sum[(size_t)(c0 + c) * a->rows];
+    uint8_t *px = &t->data[(size_t)c * a->rows];
+    int32_t count = a->count[c0 + c];
+
+    for (r = 0; r < a->rows; r++) {
+      px[r] = (count > 0) ? to_pixel(col[r] / count) : SPEC_NONE;
+    }
+  }
+  return 0;
+}
+
+/*!
+ * @brief tiles of every level under a tile of the top level
+ *
+ * Tiles without data are left out.
+ *
+ * @param[in] s series (of any station and channel)
+ * @param[in] ns number of series
+ * @param[in] top index of the tile of level p->levels - 1
+ * @param[out] tiles tiles in order of level and index (spec_tiles_free())
+ * @param[out] n number of tiles
+ * @return 0 on success, -1 for no memory
+ */
+int spec_build(const spec_plan *p, const samples_series *s, int ns,
+               int apollo_station, int channel, int64_t top, spec_tile **tiles, int *n) {
+  int64_t span = top_span(p), c0 = top * span, c, k, klo, khi, kmax;
+  int hop = p->nfft / 2, max = 0, ret = -1;
+  int i, j, l, r;
+  double mean;
+  build_arg a;
+  spec_key key;
+
+  *tiles = NULL;
+  *n = 0;
+  memset(&a, 0, sizeof(a));
+  a.p = p;
+  a.rows = spec_rows(p->nfft);
+  a.sum = (float *)calloc((size_t)span * a.rows, sizeof(float));
+  a.count = (int32_t *)calloc(span, sizeof(int32_t));
+  a.buf = (double *)malloc((size_t)SPEC_BATCH * p->nfft * sizeof(double));
+  a.z = (double *)malloc((size_t)SPEC_BATCH * (p->nfft + 2) * sizeof(double));
+  a.work = (double *)malloc((size_t)SPEC_BATCH * p->nfft * sizeof(double));
+  if (a.sum == NULL || a.count == NULL || a.buf == NULL || a.z == NULL || a.work == NULL) {
+    goto build_finish;
+  }
+
+  for (j = 0; j < ns; j++) {
+    if (s[j].apollo_station != apollo_station || s[j].channel != channel || s[j].n < p->nfft) {
+      continue;
+    }
+    // windows in the columns c0 ... c0 + span - 1
+    kmax = (s[j].n - p->nfft) / hop;
+    klo = c0 - frame_column(p, &s[j], 0);
+    khi = klo + span - 1;
+    klo = (klo < 0) ? 0 : klo;
+    khi = (khi > kmax) ? kmax : khi;
+    for (k = klo; k <= khi; k++) {
+      const float *x = &s[j].x[k * hop];
+      double *d = &a.buf[(size_t)a.nb * p->nfft];
+
+      c = frame_column(p, &s[j], k) - c0;
+      mean = 0.0;
+      for (i = 0; i < p->nfft && !isnan(x[i]); i++) {
+        mean += x[i];
+      }
+      if (i < p->nfft) {
+        continue;
+      }
+      mean /= p->nfft;
+      for (i = 0; i < p->nfft; i++) {
+        d[i] = (x[i] - mean) * p->taper[i];
+      }
+      a.col[a.nb++] = c;
+      if (a.nb == SPEC_BATCH) {
+        flush_frames(&a);
+      }
+    }
+    flush_frames(&a);
+  }
+
+  key.apollo_station = apollo_station;
+  key.channel = channel;
+  key.nfft = p->nfft;
+  for (l = 0; l < p->levels; l++) {
+    int64_t ncol = span >> l;
+
+    key.level = l;
+    for (c = 0; c < ncol; c += SPEC_TILE_COLS) {
+      for (k = 0; k < SPEC_TILE_COLS && a.count[c + k] == 0; k++);
+      if (k == SPEC_TILE_COLS) {
+        continue;
+      }
+      key.index = top * (ncol / SPEC_TILE_COLS) + c / SPEC_TILE_COLS;
+      if (add_tile(&a, &key, c, tiles, n, &max) != 0) {
+        goto build_finish;
+      }
+    }
+
+    // pairs of columns to the next level, in place
+    for (c = 0; c < ncol / 2; c++) {
+      for (r = 0; r < a.rows; r++) {
+        a.sum[c * a.rows + r] = a.sum[2 * c * a.rows + r] + a.sum[(2 * c + 1) * a.rows + r];
+      }
+      a.count[c] = a.count[2 * c] + a.count[2 * c + 1];
+    }
+  }
+  ret = 0;
+
+ build_finish:
+  free(a.sum);
+  free(a.count);
+  free(a.buf);
+  free(a.z);
+  free(a.work);
+  if (ret != 0) {
+    spec_tiles_free(*tiles, *n);
+    *tiles = NULL;
+    *n = 0;
+  }
+  return ret;
+}
+
+void spec_tiles_free(spec_tile *t, int n) {
+  int i;
+
+  for (i = 0; i < n; i++) {
+    free(t[i].data);
+  }
+  free(t);
+}
+
+static int compare_key(const spec_key *x, const spec_key *y) {
+  if (x->apollo_station != y->apollo_station) {
+    return (x->apollo_station < y->apollo_station) ? -1 : 1;
+  }
+  if (x->channel != y->channel) {
+    return (x->channel < y->channel) ? -1 : 1;
+  }
+  if (x->nfft != y->nfft) {
+    return (x->nfft < y->nfft) ? -1 : 1;
+  }
+  if (x->level != y->level) {
+    return (x->level < y->level) ? -1 : 1;
+  }
+  if (x->index != y->index) {
+    return (x->index < y->index) ? -1 : 1;
+  }
+  return 0;
+}
+
+static int compare_entry(const void *a, const void *b) {
+  return compare_key(&((const spec_entry *)a)->key, &((const spec_entry *)b)->key);
+}
+
+/*!
+ * @brief create a tile file
+ *
+ * @return 0 on success, -1 if the file cannot be written
+ */
+int spec_writer_open(spec_writer *w, const char *filename) {
+  memset(w, 0, sizeof(spec_writer));
+  w->f = fopen(filename, "wb");
+  if (w->f == NULL || fwrite(SPEC_MAGIC, 1, 8, w->f) != 8) {
+    if (w->f != NULL) {
+      fclose(w->f);
+    }
+    w->f = NULL;
+    return -1;
+  }
+  w->offset = 8;
+  return 0;
+}
+
+/*!
+ * @brief write the pixels of a tile
+ *
+ * @return 0 on success, -1 on a write error or no memory
+ */
+int spec_writer_add(spec_writer *w, const spec_tile *t) {
+  size_t size = (size_t)SPEC_TILE_COLS * spec_rows(t->key.nfft);
+  spec_entry *e;
+
+  if (w->n >= w->max) {
+    w->max = (w->max > 0) ? w->max * 2 : 256;
+    e = (spec_entry *)realloc(w->index, w->max * sizeof(spec_entry));
+    if (e == NULL) {
+      return -1;
+    }
+    w->index = e;
+  }
+  if (fwrite(t->data, 1, size, w->f) != size) {
+    return -1;
+  }
+  e = &w->index[w->n++];
+  e->key = t->key;
+  e->rate = t->rate;
+  e->offset = w->offset;
+  w->offset += size;
+  return 0;
+}
+
+/*!
+ * @brief write the index and close
+ *
+ * @return 0 on success, -1 on a write error
+ */
+int spec_writer_close(spec_writer *w) {
+  int64_t footer[2];
+  int ret = 0;
+
+  qsort(w->index, w->n, sizeof(spec_entry), compare_entry);
+  footer[0] = w->offset;
+  footer[1] = w->n;
+  if (fwrite(w->index, sizeof(spec_entry), w->n, w->f) != (size_t)w->n ||
+      fwrite(footer, sizeof(int64_t), 2, w->f) != 2 ||
+      fwrite(SPEC_MAGIC, 1, 8, w->f) != 8) {
+    ret = -1;
+  }
+  if (fclose(w->f) != 0) {
+    ret = -1;
+  }
+  free(w->index);
+  memset(w, 0, sizeof(spec_writer));
+  return ret;
+}
+
+/*!
+ * @brief open a tile file and read its index
+ *
+ * @return 0 on success, -1 if it is not a tile file or no memory
+ */
+int spec_open(spec_file *sf, const char *filename) {
+  char magic[8], tail[8];
+  int64_t footer[2];
+
+  memset(sf, 0, sizeof(spec_file));
+  sf->f = fopen(filename, "rb");
+  if (sf->f == NULL) {
+    return -1;
+  }
+  if (fread(magic, 1, 8, sf->f) != 8 || memcmp(magic, SPEC_MAGIC, 8) != 0 ||
+      fseek(sf->f, -(long)(2 * sizeof(int64_t) + 8), SEEK_END) != 0 ||
+      fread(footer, sizeof(int64_t), 2, sf->f) != 2 ||
+      fread(tail, 1, 8, sf->f) != 8 || memcmp(tail, SPEC_MAGIC, 8) != 0 ||
+      footer[1] < 0 || footer[1] > INT32_MAX) {
+    spec_close(sf);
+    return -1;
+  }
+  sf->n = (int)footer[1];
+  sf->index = (spec_entry *)malloc((sf->n > 0 ? sf->n : 1) * sizeof(spec_entry));
+  if (sf->index == NULL || fseek(sf->f, (long)footer[0], SEEK_SET) != 0 ||
+      fread(sf->index, sizeof(spec_entry), sf->n, sf->f) != (size_t)sf->n) {
+    spec_close(sf);
+    return -1;
+  }
+  return 0;
+}
+
+void spec_close(spec_file *sf) {
+  if (sf->f != NULL) {
+    fclose(sf->f);
+  }
+  free(sf->index);
+  memset(sf, 0, sizeof(spec_file));
+}
+
+//! first entry not before a key
+static int lower_bound(const spec_file *sf, const spec_key *key) {
+  int lo = 0, hi = sf->n, mid;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (compare_key(&sf->index[mid].key, key) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+static int same_series(const spec_key *k, int apollo_station, int channel) {
+  return k->apollo_station == apollo_station && k->channel == channel;
+}
+
+/*!
+ * @brief read the tiles covering a view
+ *
+ * The frequency level is the smallest window with at least rows pixels
+ * per column (the largest if none), the time level the coarsest one
+ * with at least width columns in t0 ... t1 (level 0 if none). Missing
+ * tiles are left out. A spec_file is not shared by threads.
+ *
+ * @param[in] t0 start of the view [msec since the epoch]
+ * @param[in] t1 end of the view [msec since the epoch]
+ * @param[in] width columns wanted
+ * @param[in] rows pixels per column wanted
+ * @param[out] tiles tiles in order of time (spec_tiles_free())
+ * @param[out] n number of tiles
+ * @return 0 on success, -1 on a read error or no memory
+ */
+int spec_view(const spec_file *sf, int apollo_station, int channel, int64_t t0, int64_t t1,
+              int width, int rows, spec_tile **tiles, int *n) {
+  spec_key key;
+  spec_tile *t;
+  double col, tile = 0.0;
+  int64_t first, last;
+  int e, nfft = -1, level = -1, max = 0;
+  size_t size;
+
+  *tiles = NULL;
+  *n = 0;
+  memset(&key, 0, sizeof(key));
+  key.apollo_station = apollo_station;
+  key.channel = channel;
+  key.index = INT64_MIN;
+
+  // frequency level
+  for (e = lower_bound(sf, &key); e < sf->n && same_series(&sf->index[e].key, apollo_station, channel); ) {
+    nfft = sf->index[e].key.nfft;
+    if (spec_rows(nfft) >= rows) {
+      break;
+    }
+    key.nfft = nfft + 1;
+    e = lower_bound(sf, &key);
+  }
+  if (nfft < 0 || t1 <= t0) {
+    return 0;
+  }
+
+  // time level
+  key.nfft = nfft;
+  key.level = 0;
+  for (e = lower_bound(sf, &key); e < sf->n && same_series(&sf->index[e].key, apollo_station, channel) &&
+         sf->index[e].key.nfft == nfft; ) {
+    col = spec_column_msec(sf->index[e].rate, nfft, sf->index[e].key.level);
+    if (level >= 0 && (t1 - t0) / col < width) {
+      break;
+    }
+    level = sf->index[e].key.level;
+    tile = col * SPEC_TILE_COLS;
+    key.level = level + 1;
+    e = lower_bound(sf, &key);
+  }
+
+  // tiles of the level
+  first = (int64_t)floor(t0 / tile);
+  last = (int64_t)floor((t1 - 1) / tile);
+  key.level = level;
+  key.index = first;
+  size = (size_t)SPEC_TILE_COLS * spec_rows(nfft);
+  for (e = lower_bound(sf, &key); e < sf->n && same_series(&sf->index[e].key, apollo_station, channel) &&
+         sf->index[e].key.nfft == nfft && sf->index[e].key.level == level &&
+         sf->index[e].key.index <= last; e++) {
+    if (*n >= max) {
+      max = (max > 0) ? max * 2 : 16;
+      t = (spec_tile *)realloc(*tiles, max * sizeof(spec_tile));
+      if (t == NULL) {
+        goto view_error;
+      }
+      *tiles = t;
+    }
+    t = &(*tiles)[*n];
+    t->key = sf->index[e].key;
+    t->rate = sf->index[e].rate;
+    t->data = (uint8_t *)malloc(size);
+    if (t->data == NULL) {
+      goto view_error;
+    }
+    (*n)++;
+    if (fseek(sf->f, (long)sf->index[e].offset, SEEK_SET) != 0 ||
+        fread(t->data, 1, size, sf->f) != size) {
+      goto view_error;
+    }
+  }
+  return 0;
+
+ view_error:
+  spec_tiles_free(*tiles, *n);
+  *tiles = NULL;
+  *n = 0;
+  return -1;
+}
@@ -0,0 +1,102 @@
+/*! @file spectrogram.h
+ *  @brief tiles of STFT power spectra at several time and frequency zoom levels
+ *  @date 2026/10/18
+ */
+#ifndef __SPECTROGRAM_H__
+#define __SPECTROGRAM_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include "fft.h"
+#include "samples.h"
+
+//! columns of a tile
+#define SPEC_TILE_COLS 256
+
+//! time levels (a column of level l averages 2^l columns of level 0)
+#define SPEC_MAX_LEVEL 12
+#define SPEC_DEFAULT_LEVELS 8
+
+//! window of level 0 [samples]; frequency levels double it
+#define SPEC_DEFAULT_NFFT 128
+#define SPEC_MAX_FREQ 4
+#define SPEC_DEFAULT_FREQS 2
+
+//! frames transformed at once
+#define SPEC_BATCH 16
+
+//! pixels: (dB - SPEC_DB_MIN) / SPEC_DB_STEP in 0 ... 254 [dB re 1 count^2/Hz], SPEC_NONE if no data
+#define SPEC_DB_MIN -40.0
+#define SPEC_DB_STEP 0.5
+#define SPEC_NONE 255
+
+//! STFT of a sample rate: Hann windows of nfft samples, columns nfft/2 samples apart
+typedef struct tag_spec_plan {
+  fft_plan fft;
+  double rate;
+  int nfft;
+  int levels;
+
+  double *taper;
+  double scale;
+} spec_plan;
+
+//! tile index of columns index * SPEC_TILE_COLS ... of a level (column c from c * spec_column_msec())
+typedef struct tag_spec_key {
+  int32_t apollo_station;
+  int32_t channel;
+  int32_t nfft;
+  int32_t level;
+  int64_t index;
+} spec_key;
+
+//! SPEC_TILE_COLS columns of nfft/2+1 pixels, low frequencies first
+typedef struct tag_spec_tile {
+  spec_key key;
+  double rate;
+  uint8_t *data;
+} spec_tile;
+
+//! entry of the index of a tile file
+typedef struct tag_spec_entry {
+  spec_key key;
+  double rate;
+  int64_t offset;
+} spec_entry;
+
+typedef struct tag_spec_writer {
+  FILE *f;
+  int64_t offset;
+  spec_entry *index;
+  int n;
+  int max;
+} spec_writer;
+
+typedef struct tag_spec_file {
+  FILE *f;
+
+  //! in order of station, channel, nfft, level and index
+  spec_entry *index;
+  int n;
+} spec_file;
+
+int spec_init(spec_plan *p, double rate, int nfft, int levels);
+void spec_free(spec_plan *p);
+double spec_column_msec(double rate, int nfft, int level);
+int spec_rows(int nfft);
+double spec_db(uint8_t pixel);
+int spec_top_range(const spec_plan *p, const samples_series *s, int64_t *first, int64_t *last);
+int spec_build(const spec_plan *p, const samples_series *s, int ns,
+               int apollo_station, int channel, int64_t top, spec_tile **tiles, int *n);
+void spec_tiles_free(spec_tile *t, int n);
+
+int spec_writer_open(spec_writer *w, const char *filename);
+int spec_writer_add(spec_writer *w, const spec_tile *t);
+int spec_writer_close(spec_writer *w);
+
+int spec_open(spec_file *sf, const char *filename);
+void spec_close(spec_file *sf);
+int spec_view(const spec_file *sf, int apollo_station, int channel, int64_t t0, int64_t t1,
+              int width, int rows, spec_tile **tiles, int *n);
+
+#endif
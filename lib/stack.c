@@ -0,0 +1,425 @@
+/*! @file stack.c
+ *  @brief aligned linear and phase-weighted stacks of event windows
+ *  @date 2026/10/18
+ *
+ *  Every window holds len + 2 maxlag samples centred on the nominal
+ *  window of an event. The windows are first stacked at their nominal
+ *  position; each iteration then shifts every window by the lag (within
+ *  +-maxlag) of the largest normalized cross-correlation with the stack
+ *  of the previous iteration and stacks them again. The lags are centred
+ *  on their mean, so the stack does not drift from the nominal window.
+ *  The correlations of all lags of a window are one product of FFT
+ *  spectra, normalized by the running sums of the window. The stack
+ *  stops early when no lag changes.
+ *
+ *  The linear stack is the mean of the aligned windows, each with zero
+ *  mean and unit norm. The phase-weighted stack (Schimmel and Paulssen,
+ *  1997) multiplies it by |mean of exp(i phase)|^power, the phase taken
+ *  from the analytic signal (Hilbert transform by FFT) of each window.
+ *
+ *  The accumulation kernels have AVX2 versions (cpu.h). Each sum of a
+ *  sample is a separate lane, added window by window as in the scalar
+ *  loop, so a stack does not depend on the CPU it was made on.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "cpu.h"
+#include "fft.h"
+#include "stack.h"
+
+#ifdef CPU_X86
+#include <immintrin.h>
+#endif
+
+//! window variance taken as flat (not stacked)
+#define STACK_MIN_VARIANCE 1.0e-9
+
+typedef void (*add_func)(double *sum, const float *x, double mean, double scale, int n);
+typedef void (*phase_add_func)(double *re, double *im, const double *x, const double *h, int n);
+
+static void add_scalar(double *sum, const float *x, double mean, double scale, int n) {
+  int i;
+
+  for (i = 0; i < n; i++) {
+    sum[i] += (x[i] - mean) * scale;
+  }
+}
+
+static void phase_add_scalar(double *re, double *im, const double *x, const double *h, int n) {
+  double a;
+  int i;
+
+  for (i = 0; i < n; i++) {
+    a = x[i] * x[i] + h[i] * h[i];
+    if (a > 0.0) {
+      a = sqrt(a);
+      re[i] += x[i] / a;
+      im[i] += h[i] / a;
+    }
+  }
+}
+
+#ifdef CPU_X86
+
+__attribute__((target("avx2")))
+static void add_avx2(double *sum, const float *x, double mean, double scale, int n) {
+  const __m256d m = _mm256_set1_pd(mean);
+  const __m256d s = _mm256_set1_pd(scale);
+  __m256d v;
+  int i;
+
+  for (i = 0; i + 4 <= n; i += 4) {
+    v = _mm256_cvtps_pd(_mm_loadu_ps(&x[i]));
+    v = _mm256_mul_pd(_mm256_sub_pd(v, m), s);
+    _mm256_storeu_pd(&sum[i], _mm256_add_pd(_mm256_loadu_pd(&sum[i]), v));
+  }
+  add_scalar(&sum[i], &x[i], mean, scale, n - i);
+}
+
+__attribute__((target("avx2")))
+static void phase_add_avx2(double *re, double *im, const double *x, const double *h, int n) {
+  const __m256d zero = _mm256_setzero_pd();
+  __m256d vx, vh, a, nz;
+  int i;
+
+  for (i = 0; i + 4 <= n; i += 4) {
+    vx = _mm256_loadu_pd(&x[i]);
+    vh = _mm256_loadu_pd(&h[i]);
+    a = _mm256_add_pd(_mm256_mul_pd(vx, vx), _mm256_mul_pd(vh, vh));
+    nz = _mm256_cmp_pd(a, zero, _CMP_GT_OQ);
+    a = _mm256_sqrt_pd(a);
+    vx = _mm256_and_pd(_mm256_div_pd(vx, a), nz);
+    vh = _mm256_and_pd(_mm256_div_pd(vh, a), nz);
+    _mm256_storeu_pd(&re[i], _mm256_add_pd(_mm256_loadu_pd(&re[i]), vx));
+    _mm256_storeu_pd(&im[i], _mm256_add_pd(_mm256_loadu_pd(&im[i]), vh));
+  }
+  phase_add_scalar(&re[i], &im[i], &x[i], &h[i], n - i);
+}
+
+#endif
+
+//! kernels of a version
+typedef struct tag_stack_kernels {
+  add_func add;
+  phase_add_func phase_add;
+} stack_kernels;
+
+static const stack_kernels versions[CPU_NUM_ISA] = {
+  [CPU_ISA_SCALAR] = {add_scalar, phase_add_scalar},
+#ifdef CPU_X86
+  [CPU_ISA_AVX2] = {add_avx2, phase_add_avx2},
+#endif
+};
+static cpu_dispatch dispatch = CPU_DISPATCH_INIT(CPU_ISA_BIT(CPU_ISA_AVX2));
+
+/*!
+ * @brief select the version of the kernels (for tests and benchmarks)
+ *
+ * @param[in] isa CPU_ISA_SCALAR, CPU_ISA_AVX2 or CPU_ISA_AUTO
+ * @return 0 on success, -1 if the CPU does not support it
+ */
+int stack_set_isa(int isa) {
+  return cpu_dispatch_set(&dispatch, isa);
+}
+
+/*!
+ * @brief version of the kernels in use
+ */
+int stack_isa(void) {
+  return cpu_dispatch_isa(&dispatch);
+}
+
+/*!
+ * @brief sum[i] += (x[i] - mean) * scale
+ */
+void stack_add(double *sum, const float *x, double mean, double scale, int n) {
+  versions[cpu_dispatch_isa(&dispatch)].add(sum, x, mean, scale, n);
+}
+
+/*!
+ * @brief add the unit phasors (x + i h) / |x + i h| (none where zero)
+ */
+void stack_phase_add(double *re, double *im, const double *x, const double *h, int n) {
+  versions[cpu_dispatch_isa(&dispatch)].phase_add(re, im, x, h, n);
+}
+
+/*!
+ * @brief mean and 1 / norm of a window
+ *
+ * @return 0 on success, -1 for a flat window
+ */
+static int normalize(const float *x, int n, double *mean, double *scale) {
+  double m = 0.0, v = 0.0;
+  int i;
+
+  for (i = 0; i < n; i++) {
+    m += x[i];
+  }
+  m /= n;
+  for (i = 0; i < n; i++) {
+    v += (x[i] - m) * (x[i] - m);
+  }
+  if (v <= STACK_MIN_VARIANCE * n) {
+    return -1;
+  }
+  *mean = m;
+  *scale = 1.0 / sqrt(v);
+  return 0;
+}
+
+//! work buffers of stack_windows()
+typedef struct tag_stack_work {
+  fft_plan fft;
+  int nfft;
+
+  //! samples, spectrum, conjugate spectrum of the stack, correlations
+  double *a;
+  double *z;
+  double *ref;
+  double *c;
+} stack_work;
+
+/*!
+ * @brief stack the windows at their lags
+ *
+ * @return number of windows stacked
+ */
+static int stack_linear(const float *const *w, int nw, int len, int maxlag,
+                        const int *lag, double *sum) {
+  double mean, scale;
+  int j, count = 0;
+
+  memset(sum, 0, len * sizeof(double));
+  for (j = 0; j < nw; j++) {
+    const float *x = &w[j][maxlag + lag[j]];
+
+    if (normalize(x, len, &mean, &scale) == 0) {
+      stack_add(sum, x, mean, scale, len);
+      count++;
+    }
+  }
+  return count;
+}
+
+/*!
+ * @brief shift every window to its best correlation with the stack
+ *
+ * @return number of lags changed
+ */
+static int align(stack_work *k, const float *const *w, int nw, int len, int maxlag,
+                 const double *sum, int *lag) {
+  int m = len + 2 * maxlag;
+  double norm = 0.0, s1, s2, v, cc, best;
+  int i, j, l, t, changed = 0;
+
+  // conjugate spectrum of the stack
+  memset(k->a, 0, k->nfft * sizeof(double));
+  for (i = 0; i < len; i++) {
+    k->a[i] = sum[i];
+    norm += sum[i] * sum[i];
+  }
+  if (norm <= 0.0) {
+    return 0;
+  }
+  norm = sqrt(norm);
+  fft_forward(&k->fft, k->a, k->ref);
+  for (i = 0; i <= k->nfft / 2; i++) {
+    k->ref[2*i+1] = -k->ref[2*i+1];
+  }
+
+  for (j = 0; j < nw; j++) {
+    memset(k->a, 0, k->nfft * sizeof(double));
+    for (i = 0; i < m; i++) {
+      k->a[i] = w[j][i];
+    }
+    fft_forward(&k->fft, k->a, k->z);
+    for (i = 0; i <= k->nfft / 2; i++) {
+      double re = k->z[2*i] * k->ref[2*i] - k->z[2*i+1] * k->ref[2*i+1];
+      double im = k->z[2*i] * k->ref[2*i+1] + k->z[2*i+1] * k->ref[2*i];
+
+      k->z[2*i] = re;
+      k->z[2*i+1] = im;
+    }
+    fft_inverse(&k->fft, k->z, k->c);
+
+    // c[l] = sum of stack[i] * w[l + i]; the stack has zero mean, so
+    // only the norm of the window at l is needed
+    s1 = s2 = 0.0;
+    for (i = 0; i < len; i++) {
+      s1 += w[j][i];
+      s2 += (double)w[j][i] * w[j][i];
+    }
+    best = -2.0;
+    t = lag[j];
+    for (l = 0; l <= 2 * maxlag; l++) {
+      if (l > 0) {
+        s1 += w[j][l + len - 1] - w[j][l - 1];
+        s2 += (double)w[j][l + len - 1] * w[j][l + len - 1] - (double)w[j][l - 1] * w[j][l - 1];
+      }
+      v = s2 - s1 * s1 / len;
+      if (v <= STACK_MIN_VARIANCE * len) {
+        continue;
+      }
+      cc = k->c[l] / (norm * sqrt(v));
+      if (cc > best) {
+        best = cc;
+        t = l - maxlag;
+      }
+    }
+    if (t != lag[j]) {
+      lag[j] = t;
+      changed++;
+    }
+  }
+
+  // keep the stack at the nominal window: the lags are centred on their mean
+  for (j = 0, t = 0; j < nw; j++) {
+    t += lag[j];
+  }
+  t = (int)lround((double)t / nw);
+  for (j = 0; j < nw && t != 0; j++) {
+    lag[j] -= t;
+    if (lag[j] < -maxlag) {
+      lag[j] = -maxlag;
+    } else if (lag[j] > maxlag) {
+      lag[j] = maxlag;
+    }
+  }
+  return changed;
+}
+
+/*!
+ * @brief phase coherence |sum of exp(i phase)| of the aligned windows
+ */
+static void coherence(stack_work *k, const float *const *w, int nw, int len, int maxlag,
+                      const int *lag, double *re, double *im) {
+  double mean, scale;
+  int i, j;
+
+  memset(re, 0, len * sizeof(double));
+  memset(im, 0, len * sizeof(double));
+  for (j = 0; j < nw; j++) {
+    const float *x = &w[j][maxlag + lag[j]];
+
+    if (normalize(x, len, &mean, &scale) != 0) {
+      continue;
+    }
+    memset(k->a, 0, k->nfft * sizeof(double));
+    for (i = 0; i < len; i++) {
+      k->a[i] = (x[i] - mean) * scale;
+    }
+
+    // Hilbert transform: -i for positive, +i for negative frequencies
+    fft_forward(&k->fft, k->a, k->z);
+    k->z[0] = k->z[1] = 0.0;
+    k->z[k->nfft] = k->z[k->nfft + 1] = 0.0;
+    for (i = 1; i < k->nfft / 2; i++) {
+      double t = k->z[2*i];
+
+      k->z[2*i] = k->z[2*i+1];
+      k->z[2*i+1] = -t;
+    }
+    fft_inverse(&k->fft, k->z, k->c);
+    stack_phase_add(re, im, k->a, k->c, len);
+  }
+}
+
+/*!
+ * @brief align and stack windows
+ *
+ * @param[in] w windows of len + 2 * p->maxlag samples without NAN
+ * @param[in] nw number of windows
+ * @param[in] len samples of the stack
+ * @param[in] p alignment and weighting
+ * @param[out] r stacks, lags and correlations (stack_result_free())
+ * @return 0 on success, -1 for no memory or no window stacked
+ */
+int stack_windows(const float *const *w, int nw, int len, const stack_param *p, stack_result *r) {
+  stack_work k;
+  double *re = NULL, *im = NULL, norm, mean, scale, dot;
+  int i, j, it, ret = -1;
+
+  memset(r, 0, sizeof(stack_result));
+  memset(&k, 0, sizeof(k));
+  if (nw < 1 || len < 2 || p->maxlag < 0) {
+    return -1;
+  }
+  k.nfft = fft_size(2 * len + 2 * p->maxlag);
+  if (fft_init(&k.fft, k.nfft) != 0) {
+    return -1;
+  }
+  k.a = (double *)malloc(k.nfft * sizeof(double));
+  k.z = (double *)malloc((k.nfft + 2) * sizeof(double));
+  k.ref = (double *)malloc((k.nfft + 2) * sizeof(double));
+  k.c = (double *)malloc(k.nfft * sizeof(double));
+  re = (double *)malloc(len * sizeof(double));
+  im = (double *)malloc(len * sizeof(double));
+  r->linear = (double *)malloc(len * sizeof(double));
+  r->pws = (double *)malloc(len * sizeof(double));
+  r->lag = (int *)calloc(nw, sizeof(int));
+  r->cc = (double *)calloc(nw, sizeof(double));
+  if (k.a == NULL || k.z == NULL || k.ref == NULL || k.c == NULL || re == NULL || im == NULL ||
+      r->linear == NULL || r->pws == NULL || r->lag == NULL || r->cc == NULL) {
+    goto stack_finish;
+  }
+  r->n = len;
+
+  r->count = stack_linear(w, nw, len, p->maxlag, r->lag, r->linear);
+  for (it = 0; it < p->iterations && r->count > 0 && p->maxlag > 0; it++) {
+    if (align(&k, w, nw, len, p->maxlag, r->linear, r->lag) == 0) {
+      break;
+    }
+    r->count = stack_linear(w, nw, len, p->maxlag, r->lag, r->linear);
+  }
+  if (r->count == 0) {
+    goto stack_finish;
+  }
+
+  // correlation of every window with the stack
+  norm = 0.0;
+  for (i = 0; i < len; i++) {
+    norm += r->linear[i] * r->linear[i];
+  }
+  norm = sqrt(norm);
+  for (j = 0; j < nw; j++) {
+    const float *x = &w[j][p->maxlag + r->lag[j]];
+
+    if (norm > 0.0 && normalize(x, len, &mean, &scale) == 0) {
+      dot = 0.0;
+      for (i = 0; i < len; i++) {
+        dot += (x[i] - mean) * r->linear[i];
+      }
+      r->cc[j] = dot * scale / norm;
+    }
+  }
+
+  coherence(&k, w, nw, len, p->maxlag, r->lag, re, im);
+  for (i = 0; i < len; i++) {
+    r->linear[i] /= r->count;
+    r->pws[i] = r->linear[i] * pow(sqrt(re[i] * re[i] + im[i] * im[i]) / r->count, p->power);
+  }
+  ret = 0;
+
+ stack_finish:
+  free(re);
+  free(im);
+  free(k.a);
+  free(k.z);
+  free(k.ref);
+  free(k.c);
+  fft_free(&k.fft);
+  if (ret != 0) {
+    stack_result_free(r);
+  }
+  return ret;
+}
+
+void stack_result_free(stack_result *r) {
+  free(r->linear);
+  free(r->pws);
+  free(r->lag);
+  free(r->cc);
+  memset(r, 0, sizeof(stack_result));
+}
@@ -0,0 +1,48 @@
+/*! @file stack.h
+ *  @brief aligned linear and phase-weighted stacks of event windows
+ *  @date 2026/10/18
+ */
+#ifndef __STACK_H__
+#define __STACK_H__
+
+#include "cpu.h"
+
+#define STACK_DEFAULT_ITERATIONS 2
+#define STACK_DEFAULT_POWER 2.0
+
+//! alignment and weighting of a stack
+typedef struct tag_stack_param {
+  //! largest shift of a window [samples]
+  int maxlag;
+
+  //! alignments to the stack of the previous one (0: not aligned)
+  int iterations;
+
+  //! exponent of the phase coherence of the phase-weighted stack
+  double power;
+} stack_param;
+
+//! stack of the windows of a nest at a station and channel
+typedef struct tag_stack_result {
+  //! mean of the aligned windows (zero mean, unit norm each)
+  double *linear;
+
+  //! linear stack weighted by the phase coherence
+  double *pws;
+  int n;
+
+  //! shift of each window [samples] and its correlation with the linear stack
+  int *lag;
+  double *cc;
+  int count;
+} stack_result;
+
+int stack_windows(const float *const *w, int nw, int len, const stack_param *p, stack_result *r);
+void stack_result_free(stack_result *r);
+
+void stack_add(double *sum, const float *x, double mean, double scale, int n);
+void stack_phase_add(double *re, double *im, const double *x, const double *h, int n);
+int stack_isa(void);
+int stack_set_isa(int isa);
+
+#endif
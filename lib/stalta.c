@@ -0,0 +1,133 @@
+/*! @file stalta.c
+ *  @brief streaming recursive STA/LTA trigger of a sample stream
+ *  @date 2026/10/18
+ *
+ *  The short and long term averages of the characteristic function are
+ *  exponential (recursive) averages, so a sample is used once and the
+ *  state is a few numbers per channel; a whole tape is scanned in one
+ *  pass. The mean of the samples (the offset of the 10 bit counts) is
+ *  tracked with the long term window and removed first. Until a window is
+ *  filled its average is the plain mean of the samples so far, and no
+ *  trigger is switched on before the long term window is filled. A gap or
+ *  a step back in time switches the trigger off at the last sample and
+ *  restarts the averages.
+ */
+#include <string.h>
+#include <math.h>
+#include "stalta.h"
+
+//! defaults for the emergent lunar signals (minutes long)
+#define STALTA_DEFAULT_STA 10.0
+#define STALTA_DEFAULT_LTA 600.0
+#define STALTA_DEFAULT_ON 3.0
+#define STALTA_DEFAULT_OFF 1.5
+#define STALTA_DEFAULT_MAX_GAP 10000
+
+/*!
+ * @brief default parameters
+ */
+void stalta_default_param(stalta_param *p) {
+  p->sta = STALTA_DEFAULT_STA;
+  p->lta = STALTA_DEFAULT_LTA;
+  p->on = STALTA_DEFAULT_ON;
+  p->off = STALTA_DEFAULT_OFF;
+  p->cf = STALTA_CF_ENERGY;
+  p->max_gap = STALTA_DEFAULT_MAX_GAP;
+}
+
+/*!
+ * @brief initialize a detector
+ *
+ * @param[out] s detector
+ * @param[in] rate samples per second
+ * @param[in] p parameters
+ * @param[in] emit function called for every trigger
+ * @param[in] arg argument passed to emit
+ * @return 0 on success, -1 for invalid parameters
+ */
+int stalta_init(stalta *s, double rate, const stalta_param *p, stalta_emit_func emit, void *arg) {
+  if (rate <= 0.0 || p->sta <= 0.0 || p->lta <= p->sta || p->off > p->on ||
+      (p->cf != STALTA_CF_ENERGY && p->cf != STALTA_CF_ENVELOPE)) {
+    return -1;
+  }
+  memset(s, 0, sizeof(stalta));
+  s->p = *p;
+  s->c_sta = 1.0 / fmax(p->sta * rate, 1.0);
+  s->c_lta = 1.0 / fmax(p->lta * rate, 1.0);
+  s->warmup = (int64_t)ceil(p->lta * rate);
+  s->emit = emit;
+  s->arg = arg;
+  return 0;
+}
+
+/*!
+ * @brief feed a sample
+ *
+ * @param[in] msec time of the sample (msec since the epoch)
+ * @param[in] value sample
+ */
+void stalta_add(stalta *s, int64_t msec, double value) {
+  double c_sta, c_lta;
+  double x, cf, ratio;
+
+  if (s->n > 0 && (msec < s->last || msec - s->last > s->p.max_gap)) {
+    stalta_flush(s);
+  }
+  s->n++;
+  s->last = msec;
+
+  // plain means while the windows are filled
+  c_sta = fmax(s->c_sta, 1.0 / (double)s->n);
+  c_lta = fmax(s->c_lta, 1.0 / (double)s->n);
+
+  s->mean += c_lta * (value - s->mean);
+  x = value - s->mean;
+  cf = (s->p.cf == STALTA_CF_ENVELOPE) ? fabs(x) : x * x;
+  s->sta += c_sta * (cf - s->sta);
+  s->lta += c_lta * (cf - s->lta);
+
+  if (s->n < s->warmup || s->lta <= 0.0) {
+    return;
+  }
+  ratio = s->sta / s->lta;
+
+  if (!s->triggered) {
+    if (ratio >= s->p.on) {
+      s->triggered = 1;
+      s->t.on = msec;
+      s->t.off = msec;
+      s->t.ratio = ratio;
+      s->t.peak = fabs(x);
+    }
+    return;
+  }
+
+  if (ratio > s->t.ratio) {
+    s->t.ratio = ratio;
+  }
+  if (fabs(x) > s->t.peak) {
+    s->t.peak = fabs(x);
+  }
+  if (ratio < s->p.off) {
+    s->t.off = msec;
+    s->triggered = 0;
+    s->emit(&s->t, s->arg);
+  }
+}
+
+/*!
+ * @brief switch off the trigger at the last sample and restart the averages
+ *
+ * Called at the end of the stream.
+ */
+void stalta_flush(stalta *s) {
+  if (s->triggered) {
+    s->t.off = s->last;
+    s->triggered = 0;
+    s->emit(&s->t, s->arg);
+  }
+  s->n = 0;
+  s->mean = 0.0;
+  s->sta = 0.0;
+  s->lta = 0.0;
+}
@@ -0,0 +1,78 @@
+/*! @file stalta.h
+ *  @brief streaming recursive STA/LTA trigger of a sample stream
+ *  @date 2026/10/18
+ */
+#ifndef __STALTA_H__
+#define __STALTA_H__
+
+#include <stdint.h>
+
+//! characteristic function: squared amplitude
+#define STALTA_CF_ENERGY   0
+//! characteristic function: absolute amplitude (envelope)
+#define STALTA_CF_ENVELOPE 1
+
+typedef struct tag_stalta_param {
+  //! short and long term windows [sec]
+  double sta;
+  double lta;
+
+  //! STA/LTA ratio to switch the trigger on and off
+  double on;
+  double off;
+
+  //! STALTA_CF_*
+  int cf;
+
+  //! samples missing longer than this [msec] restart the averages
+  int64_t max_gap;
+} stalta_param;
+
+//! one trigger, times are msec since the epoch
+typedef struct tag_stalta_trigger {
+  int64_t on;
+  int64_t off;
+
+  //! largest STA/LTA ratio
+  double ratio;
+
+  //! largest amplitude from the long term mean [count]
+  double peak;
+} stalta_trigger;
+
+//! called for every trigger switched off
+typedef void (*stalta_emit_func)(const stalta_trigger *t, void *arg);
+
+typedef struct tag_stalta {
+  stalta_param p;
+
+  //! weights of the new sample in the averages (1 / window in samples)
+  double c_sta;
+  double c_lta;
+
+  //! mean of the samples (removed before the characteristic function)
+  double mean;
+  double sta;
+  double lta;
+
+  //! samples since the start or the last gap, and the samples to fill the LTA
+  int64_t n;
+  int64_t warmup;
+
+  //! time of the last sample
+  int64_t last;
+
+  //! trigger being on
+  int triggered;
+  stalta_trigger t;
+
+  stalta_emit_func emit;
+  void *arg;
+} stalta;
+
+void stalta_default_param(stalta_param *p);
+int stalta_init(stalta *s, double rate, const stalta_param *p, stalta_emit_func emit, void *arg);
+void stalta_add(stalta *s, int64_t msec, double value);
+void stalta_flush(stalta *s);
+
+#endif
@@ -0,0 +1,541 @@
+/*! @file summary.c
+ *  @brief header-only survey of PSE/WTN/WTH files (time coverage, station mix, errors)
+ *  @date 2026/10/18
+ *
+ *  Only the frame header (time, package id, sync code, frame counter) is
+ *  decoded with binary2*_frame_header(), and the frames are checked with
+ *  the same check_*_frame() and frame linking as the pgcopy tools, so the
+ *  error histogram matches what a full load would flag. Files are scanned
+ *  on a pool of threads and reported together as CSV or JSON, or as COPY
+ *  data of file_quality (quality.sql): the errors, sync errors and gaps
+ *  of every station of every file, by which the readers of quality.h
+ *  choose one of the tapes holding a time window.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
+
+#include "define.h"
+#include "error.h"
+#include "util.h"
+#include "pse.h"
+#include "wtn.h"
+#include "wth.h"
+#include "wtn_demux.h"
+#include "parallel.h"
+#include "summary.h"
+
+//! number of active stations of a WTN file at most
+#define MAX_ACTIVE_STATION 5
+
+typedef struct tag_linked_frame {
+  uint32_t package_id;
+  uint32_t frame_count;
+  int64_t msec_of_year;
+} linked_frame;
+
+typedef struct tag_summary_job {
+  int type;
+  file_summary *s;
+} summary_job;
+
+/*!
+ * @brief initialize a summary of a file
+ */
+void summary_init(file_summary *s, const char *filename) {
+  int i;
+
+  memset(s, 0, sizeof(file_summary));
+  s->filename = filename;
+  s->epoch_first = SUMMARY_NO_TIME;
+  s->epoch_last = SUMMARY_NO_TIME;
+  for (i = 0; i <= SUMMARY_MAX_STATION; i++) {
+    s->quality[i].epoch_first = SUMMARY_NO_TIME;
+    s->quality[i].epoch_last = SUMMARY_NO_TIME;
+    s->quality[i].epoch_prev = SUMMARY_NO_TIME;
+  }
+}
+
+/*!
+ * @brief count the errors and the gaps of a frame of a station
+ *
+ * @param[in] epoch frame time, SUMMARY_NO_TIME if invalid
+ */
+static void count_quality(file_summary *s, station_quality *q, int64_t epoch, uint32_t error_flag) {
+  int64_t period = (s->type == SUMMARY_TYPE_WTH) ? VALID_FRAME_RATE_WTH : VALID_FRAME_RATE;
+
+  if (error_flag) {
+    q->error_frames++;
+  }
+  if (error_flag & ERROR_INVALID_SYNC_CODE) {
+    q->sync_errors++;
+  }
+  if (epoch == SUMMARY_NO_TIME) {
+    return;
+  }
+  if (q->epoch_prev != SUMMARY_NO_TIME && epoch - q->epoch_prev > 3 * period / 2) {
+    q->gaps++;
+  }
+  q->epoch_prev = epoch;
+  if (q->epoch_first == SUMMARY_NO_TIME || epoch < q->epoch_first) {
+    q->epoch_first = epoch;
+  }
+  if (q->epoch_last == SUMMARY_NO_TIME || epoch > q->epoch_last) {
+    q->epoch_last = epoch;
+  }
+}
+
+static void count_frame(file_summary *s, int apollo_station, int64_t msec_of_year, uint32_t error_flag) {
+  station_quality *q = NULL;
+  int64_t epoch;
+  int i;
+
+  s->frames++;
+  if (apollo_station >= 0 && apollo_station <= SUMMARY_MAX_STATION) {
+    s->station_frames[apollo_station]++;
+    q = &s->quality[apollo_station];
+  }
+
+  if (error_flag) {
+    s->error_frames++;
+    if (error_flag & SUMMARY_SERIOUS_ERROR) {
+      s->serious_frames++;
+    }
+    for (i = 0; i < SUMMARY_NUM_ERROR_BIT; i++) {
+      if (error_flag & (1U << i)) {
+        s->error_bits[i]++;
+      }
+    }
+  }
+
+  if ((error_flag & ERROR_INVALID_DATETIME) || msec_of_year <= 0) {
+    if (q != NULL) {
+      count_quality(s, q, SUMMARY_NO_TIME, error_flag);
+    }
+    return;
+  }
+  epoch = msec_of_year_to_epoch(s->year, msec_of_year);
+  if (q != NULL) {
+    count_quality(s, q, epoch, error_flag);
+  }
+  if (s->epoch_first == SUMMARY_NO_TIME || epoch < s->epoch_first) {
+    s->epoch_first = epoch;
+  }
+  if (s->epoch_last == SUMMARY_NO_TIME || epoch > s->epoch_last) {
+    s->epoch_last = epoch;
+  }
+}
+
+static int scan_pse(file_summary *s, FILE *f) {
+  unsigned char record[SIZE_RECORD];
+  pse_record pr;
+  pse_frame pf, prev;
+  int64_t msec_of_year_fmax = 0;
+  int i, nframe, size_part;
+  size_t r;
+
+  memset(&prev, 0, sizeof(prev));
+  while ((r = fread(record, sizeof(unsigned char), SIZE_RECORD, f)) > 0) {
+    if (r != SIZE_RECORD) {
+      log_printf(LOG_WARNING, __FILE__, __LINE__,
+                 "invalid data size: %zd (%s)", r, s->filename);
+      return -1;
+    }
+
+    pr = binary2pse_record(record);
+    if (check_pse_record(pr) & ERROR_INVALID_FORMAT) {
+      log_printf(LOG_WARNING, __FILE__, __LINE__,
+                 "invalid format (%s)", s->filename);
+      return -1;
+    }
+    s->year = pr.year;
+    s->tape_type = pr.tape_type;
+    s->records++;
+
+    size_part = (pr.format == FORMAT_OLD) ? SIZE_DATA_PART_OLD : SIZE_DATA_PART_NEW;
+    nframe = SIZE_LOGICAL_RECORD * pr.phys_records;
+    if (nframe > (SIZE_RECORD - SIZE_PSE_HEADER) / size_part) {
+      nframe = (SIZE_RECORD - SIZE_PSE_HEADER) / size_part;
+    }
+
+    for (i = 0; i < nframe; i++) {
+      pf = binary2pse_frame_header(pr, &record[SIZE_PSE_HEADER + size_part * i]);
+      if (i == 0) {
+        pf.time_diff = pf.msec_of_year - msec_of_year_fmax;
+        pf.prev_frame = -1;
+      } else {
+        pf.time_diff = pf.msec_of_year - prev.msec_of_year;
+        pf.prev_frame = prev.frame_count;
+      }
+      pf.error_flag = check_pse_frame(pf, pr.apollo_station, pr.year);
+      count_frame(s, pr.apollo_station, pf.msec_of_year, pf.error_flag);
+      prev = pf;
+    }
+    msec_of_year_fmax = prev.msec_of_year;
+  }
+  return 0;
+}
+
+/*!
+ * @brief read the (duplicated) header of a WTN/WTH file
+ *
+ * @return 0 on success, -1 on a short file
+ */
+static int read_work_tape_header(file_summary *s, FILE *f, unsigned char *record) {
+  unsigned char header[SIZE_HEADER];
+
+  if (fread(record, sizeof(unsigned char), SIZE_HEADER, f) != SIZE_HEADER ||
+      fread(header, sizeof(unsigned char), SIZE_HEADER, f) != SIZE_HEADER) {
+    log_printf(LOG_WARNING, __FILE__, __LINE__,
+               "invalid data size (%s)", s->filename);
+    return -1;
+  }
+  if (memcmp(record, header, SIZE_HEADER) != 0) {
+    // as wtninfo -i, the second header is taken as frame data
+    log_printf(LOG_WARNING, __FILE__, __LINE__,
+               "header is not duplicated (%s)", s->filename);
+    fseek(f, -SIZE_HEADER, SEEK_CUR);
+  }
+  s->records++;
+  return 0;
+}
+
+static int scan_work_tape(file_summary *s, FILE *f, int type) {
+  unsigned char record[SIZE_HEADER];
+  unsigned char frame[SIZE_FRAME];
+  linked_frame last[MAX_ACTIVE_STATION];
+  wtn_demux demux;
+  wtn_record wnr;
+  wtn_frame wnf;
+  wth_record whr;
+  wth_frame whf;
+  uint32_t num_asta;
+  uint32_t error_flag;
+  uint32_t package_id;
+  int64_t msec_of_year;
+  int i, j;
+  size_t r;
+
+  if (read_work_tape_header(s, f, record) != 0) {
+    return -1;
+  }
+  if (type == SUMMARY_TYPE_WTN) {
+    wnr = binary2wtn_record(record);
+    error_flag = check_wtn_record(wnr);
+    num_asta = wnr.num_asta;
+    s->year = wnr.year;
+  } else {
+    whr = binary2wth_record(record);
+    error_flag = check_wth_record(whr);
+    num_asta = whr.num_asta;
+    s->year = whr.year;
+  }
+  if (error_flag & ERROR_INVALID_FORMAT) {
+    log_printf(LOG_WARNING, __FILE__, __LINE__,
+               "invalid format (%s)", s->filename);
+    return -1;
+  }
+
+  // frames of the active stations are interleaved: a WTN frame follows
+  // the last frame of its package (wtn_demux.h) as in wtn2pgcopy, a WTH
+  // frame the frame num_asta before it if that one is of the same package
+  // as in wth2pgcopy
+  wtn_demux_init(&demux);
+  for (i = 0; (r = fread(frame, sizeof(unsigned char), SIZE_FRAME, f)) == SIZE_FRAME; i++) {
+    if (type == SUMMARY_TYPE_WTN) {
+      wnf = binary2wtn_frame_header(wnr, frame);
+      wtn_demux_link(&demux, &wnf);
+      error_flag = check_wtn_frame(wnf, wnr.year);
+      package_id = wnf.alsep_package_id;
+      msec_of_year = wnf.msec_of_year;
+    } else {
+      whf = binary2wth_frame_header(whr, frame);
+      j = i % num_asta;
+      if (i >= (int)num_asta && whf.alsep_package_id == last[j].package_id) {
+        whf.time_diff = whf.msec_of_year - last[j].msec_of_year;
+      } else {
+        whf.time_diff = whf.msec_of_year;
+      }
+      error_flag = check_wth_frame(whf, whr.year);
+      package_id = whf.alsep_package_id;
+      msec_of_year = whf.msec_of_year;
+      last[j].package_id = package_id;
+      last[j].msec_of_year = msec_of_year;
+    }
+    count_frame(s, package_id2station_id(package_id), msec_of_year, error_flag);
+  }
+  if (r != 0) {
+    log_printf(LOG_WARNING, __FILE__, __LINE__,
+               "invalid data size: %zd (%s)", r, s->filename);
+    return -1;
+  }
+  return 0;
+}
+
+/*!
+ * @brief survey a file
+ *
+ * @param[in,out] s summary initialized by summary_init()
+ * @param[in] type SUMMARY_TYPE_PSE, SUMMARY_TYPE_WTN or SUMMARY_TYPE_WTH
+ * @return 0 if the whole file was read, -1 otherwise (also set to s->status)
+ */
+int summary_scan(file_summary *s, int type) {
+  FILE *f;
+
+  s->type = type;
+  f = fopen(s->filename, "rb");
+  if (f == NULL) {
+    log_printf(LOG_WARNING, __FILE__, __LINE__,
+               "no such file: %s", s->filename);
+    s->status = -1;
+    return -1;
+  }
+  if (type == SUMMARY_TYPE_PSE) {
+    s->status = scan_pse(s, f);
+  } else {
+    s->status = scan_work_tape(s, f, type);
+  }
+  fclose(f);
+  return s->status;
+}
+
+/*!
+ * @brief add a summary of a file to the total (status counts failed files)
+ */
+void summary_add(file_summary *total, const file_summary *s) {
+  int i;
+
+  if (s->status != 0) {
+    total->status++;
+  }
+  total->records += s->records;
+  total->frames += s->frames;
+  total->error_frames += s->error_frames;
+  total->serious_frames += s->serious_frames;
+  if (s->epoch_first != SUMMARY_NO_TIME &&
+      (total->epoch_first == SUMMARY_NO_TIME || s->epoch_first < total->epoch_first)) {
+    total->epoch_first = s->epoch_first;
+  }
+  if (s->epoch_last != SUMMARY_NO_TIME &&
+      (total->epoch_last == SUMMARY_NO_TIME || s->epoch_last > total->epoch_last)) {
+    total->epoch_last = s->epoch_last;
+  }
+  for (i = 0; i <= SUMMARY_MAX_STATION; i++) {
+    total->station_frames[i] += s->station_frames[i];
+  }
+  for (i = 0; i < SUMMARY_NUM_ERROR_BIT; i++) {
+    total->error_bits[i] += s->error_bits[i];
+  }
+}
+
+static void epoch_to_string(int64_t epoch, char *str) {
+  if (epoch == SUMMARY_NO_TIME) {
+    str[0] = '\0';
+    return;
+  }
+  epoch_to_date_string(epoch, str);
+}
+
+static void print_csv_line(FILE *out, const char *name, const file_summary *s, int total) {
+  char first[SIZE_TIME_STRING], last[SIZE_TIME_STRING];
+  int i;
+
+  epoch_to_string(s->epoch_first, first);
+  epoch_to_string(s->epoch_last, last);
+
+  fprintf(out, "%s,%d,", name, s->status);
+  if (!total) {
+    fprintf(out, "%d", s->year);
+  }
+  fprintf(out, ",%"PRId64",%"PRId64",%"PRId64",%"PRId64",%s,%s",
+          s->records, s->frames, s->error_frames, s->serious_frames, first, last);
+  for (i = 11; i <= SUMMARY_MAX_STATION; i++) {
+    if (i != 13) {
+      fprintf(out, ",%"PRId64, s->station_frames[i]);
+    }
+  }
+  for (i = 0; i < SUMMARY_NUM_ERROR_BIT; i++) {
+    fprintf(out, ",%"PRId64, s->error_bits[i]);
+  }
+  fputc('\n', out);
+}
+
+static void print_json_string(FILE *out, const char *str) {
+  const unsigned char *p;
+
+  fputc('"', out);
+  for (p = (const unsigned char *)str; *p; p++) {
+    if (*p == '"' || *p == '\\') {
+      fprintf(out, "\\%c", *p);
+    } else if (*p < 0x20) {
+      fprintf(out, "\\u%04x", *p);
+    } else {
+      fputc(*p, out);
+    }
+  }
+  fputc('"', out);
+}
+
+static void print_json_object(FILE *out, const file_summary *s, int total) {
+  char first[SIZE_TIME_STRING], last[SIZE_TIME_STRING];
+  int i, n;
+
+  epoch_to_string(s->epoch_first, first);
+  epoch_to_string(s->epoch_last, last);
+
+  fputc('{', out);
+  if (total) {
+    fprintf(out, "\"failed\":%d", s->status);
+  } else {
+    fprintf(out, "\"filename\":");
+    print_json_string(out, s->filename);
+    fprintf(out, ",\"status\":%d,\"year\":%d", s->status, s->year);
+  }
+  fprintf(out, ",\"records\":%"PRId64",\"frames\":%"PRId64
+          ",\"error_frames\":%"PRId64",\"serious_frames\":%"PRId64,
+          s->records, s->frames, s->error_frames, s->serious_frames);
+  if (s->epoch_first != SUMMARY_NO_TIME) {
+    fprintf(out, ",\"first\":\"%s\",\"last\":\"%s\"", first, last);
+  } else {
+    fprintf(out, ",\"first\":null,\"last\":null");
+  }
+
+  fprintf(out, ",\"stations\":{");
+  for (i = 0, n = 0; i <= SUMMARY_MAX_STATION; i++) {
+    if (s->station_frames[i] > 0) {
+      fprintf(out, "%s\"%d\":%"PRId64, n++ ? "," : "", i, s->station_frames[i]);
+    }
+  }
+  fprintf(out, "},\"errors\":{");
+  for (i = 0, n = 0; i < SUMMARY_NUM_ERROR_BIT; i++) {
+    if (s->error_bits[i] > 0) {
+      fprintf(out, "%s\"0x%04x\":%"PRId64, n++ ? "," : "", 1U << i, s->error_bits[i]);
+    }
+  }
+  fprintf(out, "}}");
+}
+
+/*!
+ * @brief COPY data of file_quality: a row per station of every file
+ *
+ * The name is the file name without its directory, as in file (files.sql).
+ */
+static void print_pgcopy(FILE *out, const file_summary *s, int n) {
+  static const char *type_names[] = {"pse", "wtn", "wth"};
+  char first[SIZE_TIME_STRING], last[SIZE_TIME_STRING];
+  const station_quality *q;
+  const char *name;
+  int i, j;
+
+  fprintf(out, "COPY file_quality ("
+          "name, type, tape_type, ap_station, time_first, time_last, frames, error_frames, sync_errors, gaps"
+          ") FROM stdin;\n");
+  for (i = 0; i < n; i++) {
+    name = strrchr(s[i].filename, '/');
+    name = (name != NULL) ? name + 1 : s[i].filename;
+    for (j = 0; j <= SUMMARY_MAX_STATION; j++) {
+      q = &s[i].quality[j];
+      if (q->epoch_first == SUMMARY_NO_TIME) {
+        continue;
+      }
+      epoch_to_date_string(q->epoch_first, first);
+      epoch_to_date_string(q->epoch_last, last);
+      fprintf(out, "%s\t%s\t%u\t%d\t%s\t%s\t%"PRId64"\t%"PRId64"\t%"PRId64"\t%"PRId64"\n",
+              name, type_names[s[i].type], s[i].tape_type, j, first, last,
+              s[i].station_frames[j], q->error_frames, q->sync_errors, q->gaps);
+    }
+  }
+  fprintf(out, "\\.\n");
+}
+
+/*!
+ * @brief print the summaries of files and their total
+ *
+ * CSV has a line per file and a last line "total" whose status is the
+ * number of failed files; JSON is {"files":[...],"total":{...}}.
+ * SUMMARY_FORMAT_PGCOPY has no total.
+ *
+ * @param[in] out output stream
+ * @param[in] format SUMMARY_FORMAT_CSV, SUMMARY_FORMAT_JSON or SUMMARY_FORMAT_PGCOPY
+ * @param[in] s summaries of the files
+ * @param[in] n number of files
+ */
+void summary_print(FILE *out, int format, const file_summary *s, int n) {
+  file_summary total;
+  int i;
+
+  if (format == SUMMARY_FORMAT_PGCOPY) {
+    print_pgcopy(out, s, n);
+    return;
+  }
+  summary_init(&total, "total");
+  for (i = 0; i < n; i++) {
+    summary_add(&total, &s[i]);
+  }
+
+  if (format == SUMMARY_FORMAT_JSON) {
+    fprintf(out, "{\"files\":[");
+    for (i = 0; i < n; i++) {
+      fprintf(out, "%s\n", i ? "," : "");
+      print_json_object(out, &s[i], 0);
+    }
+    fprintf(out, "\n],\"total\":");
+    print_json_object(out, &total, 1);
+    fprintf(out, "}\n");
+    return;
+  }
+
+  fprintf(out, "filename,status,year,records,frames,error_frames,serious_frames,first,last");
+  for (i = 11; i <= SUMMARY_MAX_STATION; i++) {
+    if (i != 13) {
+      fprintf(out, ",apollo%d", i);
+    }
+  }
+  for (i = 0; i < SUMMARY_NUM_ERROR_BIT; i++) {
+    fprintf(out, ",error_0x%04x", 1U << i);
+  }
+  fputc('\n', out);
+  for (i = 0; i < n; i++) {
+    print_csv_line(out, s[i].filename, &s[i], 0);
+  }
+  print_csv_line(out, "total", &total, 1);
+}
+
+static void scan_job(int index, void *arg) {
+  summary_job *job = (summary_job *)arg;
+  summary_scan(&job->s[index], job->type);
+}
+
+/*!
+ * @brief survey files in parallel and print the report to stdout
+ *
+ * @param[in] type SUMMARY_TYPE_PSE, SUMMARY_TYPE_WTN or SUMMARY_TYPE_WTH
+ * @param[in] filenames files
+ * @param[in] n number of files
+ * @param[in] jobs number of threads (<= 0 for the number of processors)
+ * @param[in] format SUMMARY_FORMAT_CSV, SUMMARY_FORMAT_JSON or SUMMARY_FORMAT_PGCOPY
+ * @return EXIT_SUCCESS, or EXIT_FAILURE if memory cannot be allocated
+ */
+int summary_run(int type, char **filenames, int n, int jobs, int format) {
+  summary_job job;
+  int i;
+
+  job.type = type;
+  job.s = (file_summary *)malloc(sizeof(file_summary) * (n > 0 ? n : 1));
+  if (job.s == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+    return EXIT_FAILURE;
+  }
+  for (i = 0; i < n; i++) {
+    summary_init(&job.s[i], filenames[i]);
+  }
+
+  parallel_for(n, jobs, scan_job, &job);
+  summary_print(stdout, format, job.s, n);
+
+  free(job.s);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,80 @@
+/*! @file summary.h
+ *  @brief header-only survey of PSE/WTN/WTH files (time coverage, station mix, errors)
+ *  @date 2026/10/18
+ */
+#ifndef __SUMMARY_H__
+#define __SUMMARY_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <limits.h>
+
+#define SUMMARY_TYPE_PSE 0
+#define SUMMARY_TYPE_WTN 1
+#define SUMMARY_TYPE_WTH 2
+
+#define SUMMARY_FORMAT_CSV  0
+#define SUMMARY_FORMAT_JSON 1
+#define SUMMARY_FORMAT_PGCOPY 2
+
+//! bits of error_flag (error.h)
+#define SUMMARY_NUM_ERROR_BIT 16
+
+//! frames are counted per apollo station 11 ... 17
+#define SUMMARY_MAX_STATION 17
+
+//! error_flag of serious errors (frames warned by the pgcopy tools)
+#define SUMMARY_SERIOUS_ERROR 0xff00
+
+//! epoch_first/epoch_last of a file without a valid frame time
+#define SUMMARY_NO_TIME INT64_MIN
+
+//! quality of the frames of a station in a file (a row of file_quality, quality.sql)
+typedef struct tag_station_quality {
+  //! frames with any error; sync_errors of them with ERROR_INVALID_SYNC_CODE
+  int64_t error_frames;
+  int64_t sync_errors;
+
+  //! frames more than 1.5 frame periods after the previous one of the station
+  int64_t gaps;
+
+  int64_t epoch_first;
+  int64_t epoch_last;
+  int64_t epoch_prev;
+} station_quality;
+
+typedef struct tag_file_summary {
+  const char *filename;
+
+  //! 0 if the whole file was read, -1 if reading stopped at an error
+  int status;
+
+  //! SUMMARY_TYPE_* and tape_type of a PSE file (0 for a work tape)
+  int type;
+  uint32_t tape_type;
+
+  uint32_t year;
+  int64_t records;
+  int64_t frames;
+
+  //! frames with any / with a serious error
+  int64_t error_frames;
+  int64_t serious_frames;
+
+  //! first and last valid frame time in msec since 1970-01-01
+  int64_t epoch_first;
+  int64_t epoch_last;
+
+  int64_t station_frames[SUMMARY_MAX_STATION+1];
+  int64_t error_bits[SUMMARY_NUM_ERROR_BIT];
+
+  station_quality quality[SUMMARY_MAX_STATION+1];
+} file_summary;
+
+void summary_init(file_summary *s, const char *filename);
+int summary_scan(file_summary *s, int type);
+void summary_add(file_summary *total, const file_summary *s);
+void summary_print(FILE *out, int format, const file_summary *s, int n);
+int summary_run(int type, char **filenames, int n, int jobs, int format);
+
+#endif
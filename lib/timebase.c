@@ -0,0 +1,39 @@
+/*! @file timebase.c
+ *  @brief integer sample times: offsets of the samples of a frame from its time tag
+ *  @date 2026/10/18
+ *
+ *  Sample i of n in a frame is i * bits / (bit_rate * n) seconds after
+ *  the frame. The exact fraction is reduced to msec and usec here with
+ *  integer division, so every tool gets the same times and the loops
+ *  over the samples only add a table entry to the frame time. The
+ *  periods of 1060 and 3533 bits/sec never give a fraction of exactly
+ *  one half, so the rounding has no ties.
+ */
+#include <stdint.h>
+#include <string.h>
+
+#include "timebase.h"
+
+/*!
+ * @brief tabulate the offsets of the samples of a channel
+ *
+ * @param[in] bits bits per frame (TIMEBASE_FRAME_BITS or TIMEBASE_FRAME_BITS_WTH)
+ * @param[in] bit_rate bits per second (TIMEBASE_BIT_RATE or TIMEBASE_BIT_RATE_WTH)
+ * @param[in] n samples per frame (1 ... TIMEBASE_MAX_COUNTS)
+ * @return 0 on success, -1 for a bad rate or number of samples
+ */
+int timebase_init(timebase *tb, int bits, int bit_rate, int n) {
+  uint64_t den = (uint64_t)bit_rate * n;
+  int i;
+
+  memset(tb, 0, sizeof(timebase));
+  if (bits <= 0 || bit_rate <= 0 || n <= 0 || n > TIMEBASE_MAX_COUNTS) {
+    return -1;
+  }
+  tb->n = n;
+  for (i = 0; i < n; i++) {
+    tb->msec[i] = (uint32_t)((uint64_t)i * bits * 1000 / den);
+    tb->usec[i] = (uint32_t)(((uint64_t)i * bits * 2000000 + den) / (2 * den));
+  }
+  return 0;
+}
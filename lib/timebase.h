@@ -0,0 +1,35 @@
+/*! @file timebase.h
+ *  @brief integer sample times: offsets of the samples of a frame from its time tag
+ *  @date 2026/10/18
+ */
+#ifndef __TIMEBASE_H__
+#define __TIMEBASE_H__
+
+#include <stdint.h>
+
+//! a PSE/WTN frame is 64 words of 10 bits at 1060 bits/sec
+#define TIMEBASE_FRAME_BITS 640
+#define TIMEBASE_BIT_RATE   1060
+
+//! a WTH subframe is 20 words of 30 bits at 3533 bits/sec
+#define TIMEBASE_FRAME_BITS_WTH 600
+#define TIMEBASE_BIT_RATE_WTH   3533
+
+//! most samples of a channel in a frame
+#define TIMEBASE_MAX_COUNTS 32
+
+/*!
+ * offsets of the n samples of a channel in a frame of bits / bit_rate
+ * seconds, computed in integers once: sample i of a frame tagged t
+ * [msec of year] is at t + msec[i] (truncated, as the CSV tools print
+ * it) or at t * 1000 + usec[i] microseconds (rounded)
+ */
+typedef struct tag_timebase {
+  int n;
+  uint32_t msec[TIMEBASE_MAX_COUNTS];
+  uint32_t usec[TIMEBASE_MAX_COUNTS];
+} timebase;
+
+int timebase_init(timebase *tb, int bits, int bit_rate, int n);
+
+#endif
@@ -8,6 +8,7 @@
 #include <stdint.h>
 #include <string.h>
 #include <unistd.h>
+#include <time.h>
 #include "define.h"
 #include "util.h"
 
@@ -19,17 +20,17 @@
  * @param[out] hh hours (0-23)
  * @param[out] mm minutes (0-59)
  * @param[out] ss seconds (0-59)
- * @param[out] us microseconds (0-999)
+ * @param[out] us microseconds (0-999999)
  * @attention minimum value of msec_of_year is 8,640,000,000[msec],
  *  the minimum value of doy output is 1.
  */
-void usec_of_year_to_date(double usec_of_year,
-                          uint32_t *doy, uint32_t *hh, uint32_t *mm, uint32_t *ss, double *us)
+void usec_of_year_to_date(int64_t usec_of_year,
+                          uint32_t *doy, uint32_t *hh, uint32_t *mm, uint32_t *ss, uint32_t *us)
 {
   uint32_t doy_rem, hh_rem;
-  uint32_t sec_of_year = (uint32_t)(usec_of_year / 1.0e6);
+  uint32_t sec_of_year = (uint32_t)(usec_of_year / 1000000);
 
-  *us = usec_of_year - sec_of_year*1.0e6;
+  *us = (uint32_t)(usec_of_year % 1000000);
 
   *doy = (uint32_t)(sec_of_year / 86400);
   doy_rem = (uint32_t)(sec_of_year % 86400);
@@ -110,28 +111,80 @@ int32_t doy_to_date_string(uint32_t year, uint32_t doy, char date_string[11]) {
  *
  * @param[in] year year
  * @param[in] msec_of_year milliseconds of year
- * @param[in] us_offset microseconds offset
+ * @param[in] us_offset microseconds offset (usec of a timebase)
  * @param[out] date_string date_string
  * @return TRUE if date conversion is success. Otherwise, FALSE.
  */
-int32_t msec_of_year_to_date_string(uint32_t year, int64_t msec_of_year, double us_offset, char *date_string) {
-  uint32_t doy, hh, mm, ss, ms;
-  double us;
+int32_t msec_of_year_to_date_string(uint32_t year, int64_t msec_of_year, int64_t us_offset, char *date_string) {
+  uint32_t doy, hh, mm, ss, us;
   char date[11]; /* YYYY-mm-dd */
   int32_t ret;
-  double usec_of_year = msec_of_year;
-  usec_of_year = usec_of_year * 1.0e3 + us_offset;
-  usec_of_year_to_date(usec_of_year, &doy, &hh, &mm, &ss, &us);
+  usec_of_year_to_date(msec_of_year * 1000 + us_offset, &doy, &hh, &mm, &ss, &us);
   ret = doy_to_date_string(year, doy, date);
   if (ret == FALSE) {
     memset(date_string, 0, SIZE_TIME_STRING);
     return ret;
   }
 
-  sprintf(date_string, "%s %02d:%02d:%02d.%06.0f", date, hh, mm, ss, us);
+  sprintf(date_string, "%s %02d:%02d:%02d.%06u", date, hh, mm, ss, us);
   return TRUE;
 }
 
+/*!
+ * @brief convert milliseconds of year to milliseconds since 1970-01-01 00:00:00
+ *
+ * @param[in] year year (1901-2099)
+ * @param[in] msec_of_year milliseconds of year (doy 1 starts at 86,400,000)
+ * @return milliseconds since the epoch (negative for 1969)
+ */
+int64_t msec_of_year_to_epoch(uint32_t year, int64_t msec_of_year) {
+  int64_t y = (int64_t)year - 1969;
+  // every fourth year is a leap year in 1901-2099
+  int64_t days = 365 * (y - 1) + (y >= 0 ? y / 4 : (y - 3) / 4);
+  return days * 86400000LL + msec_of_year - 86400000LL;
+}
+
+/*!
+ * @brief format milliseconds since the epoch as "YYYY-MM-DD hh:mm:ss.mmm" (UTC)
+ *
+ * @param[in] epoch milliseconds since the epoch
+ * @param[out] str at least SIZE_TIME_STRING characters
+ */
+void epoch_to_date_string(int64_t epoch, char *str) {
+  // floor, the data of 1969 are before the epoch
+  int64_t sec = (epoch >= 0) ? epoch / 1000 : -((-epoch + 999) / 1000);
+  time_t t = (time_t)sec;
+  struct tm tm;
+
+  gmtime_r(&t, &tm);
+  strftime(str, SIZE_TIME_STRING, "%Y-%m-%d %H:%M:%S", &tm);
+  sprintf(str + strlen(str), ".%03d", (int)(epoch - sec * 1000));
+}
+
+/*!
+ * @brief parse a timestamp of the event table "YYYY-MM-DD hh:mm:ss[.fff]" (UTC)
+ *
+ * @param[in] str timestamp (1901-2099)
+ * @param[out] epoch milliseconds since the epoch
+ * @return 0 on success, -1 for an invalid timestamp
+ */
+int date_string_to_epoch(const char *str, int64_t *epoch) {
+  static const int days[12] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+  int year, month, day, hh, mm;
+  double ss;
+  int64_t doy;
+
+  if (sscanf(str, "%d-%d-%d %d:%d:%lf", &year, &month, &day, &hh, &mm, &ss) != 6 ||
+      year < 1901 || year > 2099 || month < 1 || month > 12 || day < 1 || day > 31 ||
+      hh < 0 || hh > 23 || mm < 0 || mm > 59 || ss < 0.0 || ss >= 61.0) {
+    return -1;
+  }
+  doy = days[month - 1] + day + ((month > 2 && year % 4 == 0) ? 1 : 0);
+  *epoch = msec_of_year_to_epoch(year, doy * 86400000LL + (hh * 3600LL + mm * 60LL) * 1000LL) +
+    (int64_t)(ss * 1000.0 + 0.5);
+  return 0;
+}
+
 /*!
  * @brief 文字列が数値かどうか確認する。
  *
@@ -220,6 +273,80 @@ int32_t interp(int32_t x1, int32_t x2, int32_t x3, int32_t x4) {
   return ((x2+x3)*4-(x1+x4)+3)/6;
 }
 
+// ------------------------------
+// mission windows of the stations in msec_of_year, [lo, hi) for every
+// year 1969-1977 (day n of the year is [n, n+1) x 86400000 msec)
+// ------------------------------
+#define FIRST_YEAR 1969
+#define LAST_YEAR  1977
+#define NUM_YEAR   (LAST_YEAR - FIRST_YEAR + 1)
+
+#define MSEC_OF_DOY(doy) ((uint64_t)(doy) * 86400000U)
+#define DAYS(first, last) {MSEC_OF_DOY(first), MSEC_OF_DOY((last) + 1)}
+#define NONE {0, 0}
+
+//! every day of a year (stations without a mission period)
+#define YEAR365 {DAYS(1, 365), NONE}
+#define YEAR366 {DAYS(1, 366), NONE}
+
+//! 0: other stations, 1-6: station 11, 12, 14, 15, 16, 17
+static const date_window mission_windows[7][NUM_YEAR][DATE_WINDOWS] = {
+  // other stations: only the days of the year are checked
+  {YEAR365, YEAR365, YEAR365, YEAR366, YEAR365, YEAR365, YEAR365, YEAR366, YEAR365},
+
+  // 11: 1969/202 - 1969/214, 1969/231 - 1969/237
+  {{DAYS(202, 214), DAYS(231, 237)},
+   {NONE, NONE}, {NONE, NONE}, {NONE, NONE}, {NONE, NONE},
+   {NONE, NONE}, {NONE, NONE}, {NONE, NONE}, {NONE, NONE}},
+
+  // 12: 1969/323-1977/273
+  {{DAYS(323, 365), NONE}, YEAR365, YEAR365, YEAR366, YEAR365, YEAR365, YEAR365, YEAR366,
+   {DAYS(1, 273), NONE}},
+
+  // 14: 1971/036-1977/273
+  {{NONE, NONE}, {NONE, NONE}, {DAYS(36, 365), NONE}, YEAR366, YEAR365, YEAR365, YEAR365, YEAR366,
+   {DAYS(1, 273), NONE}},
+
+  // 15: 1971/212-1977/273
+  {{NONE, NONE}, {NONE, NONE}, {DAYS(212, 365), NONE}, YEAR366, YEAR365, YEAR365, YEAR365, YEAR366,
+   {DAYS(1, 273), NONE}},
+
+  // 16: 1972/112-1977/273
+  {{NONE, NONE}, {NONE, NONE}, {NONE, NONE}, {DAYS(112, 366), NONE}, YEAR365, YEAR365, YEAR365, YEAR366,
+   {DAYS(1, 273), NONE}},
+
+  // 17: LSPE:1976/228-1977/115, LSG: 1976/061-1977/273
+  {{NONE, NONE}, {NONE, NONE}, {NONE, NONE}, {NONE, NONE}, {NONE, NONE}, {NONE, NONE}, {NONE, NONE},
+   {DAYS(61, 366), NONE}, {DAYS(1, 273), NONE}},
+};
+
+static const date_window no_window[DATE_WINDOWS] = {NONE, NONE};
+
+//! index of mission_windows of the stations 0 ... 17
+static const int station_index[18] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 0, 3, 4, 5, 6
+};
+
+/*!
+ * @brief mission windows of a station in a year
+ *
+ * The windows are looked up once (e.g. per record) and a frame time is
+ * checked by in_date_windows() without converting it to a date.
+ *
+ * @param[in] apollo_station apollo station (any other number for the year check only)
+ * @param[in] year year
+ * @return DATE_WINDOWS windows, empty for a year out of 1969-1977
+ */
+const date_window *date_windows(int apollo_station, int year) {
+  int i;
+
+  if (year < FIRST_YEAR || year > LAST_YEAR) {
+    return no_window;
+  }
+  i = (apollo_station >= 0 && apollo_station < 18) ? station_index[apollo_station] : 0;
+  return mission_windows[i][year - FIRST_YEAR];
+}
+
 /*!
  * @brief Validate date
  *
@@ -228,95 +355,5 @@ int32_t interp(int32_t x1, int32_t x2, int32_t x3, int32_t x4) {
  * @return True if the year and msec is valid
  */
 int validate_date(int apollo_station, int year, uint64_t msec) {
-  uint32_t doy, hh, mm, ss, ms;
-  
-  msec_of_year_to_date(msec, &doy, &hh, &mm, &ss, &ms);
-  
-  if (doy < 1) {
-    return FALSE;
-  }
-
-  // check year and doy considering leap year
-  switch(year) {
-  case 1969:
-  case 1970:
-  case 1971:
-  case 1973:
-  case 1974:
-  case 1975:
-  case 1977:
-    if (doy > 365) {
-      return FALSE;
-    }
-    break;
-    
-  case 1972:
-  case 1976:
-    if (doy > 366) {
-      return FALSE;
-    }
-    break;
-    
-  default:
-    return FALSE;
-    break;
-  }
-  
-
-  // check year and doy considering mission period
-  switch (apollo_station) {
-  case 11:
-    // 1969/202 - 1969/214, 1969/231 - 1969/237
-    if (!(year == 1969 && ((doy >=202 && doy <= 214) || (doy >= 231 && doy <= 237)))) {
-      return FALSE;
-    }
-    break;
-    
-  case 12: 
-    // 1969/323-1977/273
-    if (!((year == 1969 && doy >= 323) ||
-	  (year >= 1970 && year <= 1976) ||
-	  (year == 1977 && doy <= 273))) {
-      return FALSE;
-    }
-    break;
-    
-  case 14:
-    // 1971/036-1977/273
-    if (!((year == 1971 && doy >= 36) ||
-	  (year >= 1972 && year <= 1976) ||
-	  (year == 1977 && doy <= 273))) {
-      return FALSE;
-    }
-    break;
-    
-    // 1971/212-1977/273
-  case 15:
-    if (!((year == 1971 && doy >= 212) ||
-	  (year >= 1972 && year <= 1976) ||
-	  (year == 1977 && doy <= 273))) {
-      return FALSE;
-    }
-    break;
-    
-    // 1972/112-1977/273
-  case 16:
-    if (!((year == 1972 && doy >= 112) ||
-	  (year >= 1973 && year <= 1976) ||
-	  (year == 1977 && doy <= 273))) {
-      return FALSE;
-    }
-    break;
-
-    // LSPE:1976/228-1977/115    
-    // LSG: 1976/061-1977/273
-  case 17:
-    if (!((year == 1976 && doy >= 61) ||
-	  (year == 1977 && doy <= 273))) {
-      return FALSE;
-    }
-    break;
-  }
-
-  return TRUE;
+  return in_date_windows(date_windows(apollo_station, year), msec);
 }
@@ -14,13 +14,33 @@
 #define FALSE 0
 #endif
 
+//! number of windows per station and year in date_windows()
+#define DATE_WINDOWS 2
+
+//! valid msec_of_year in [lo, hi)
+typedef struct tag_date_window {
+  uint64_t lo;
+  uint64_t hi;
+} date_window;
+
+/*!
+ * @brief check msec_of_year against the windows of date_windows() (no branch)
+ */
+static inline int in_date_windows(const date_window *w, uint64_t msec) {
+  return ((msec >= w[0].lo) & (msec < w[0].hi)) | ((msec >= w[1].lo) & (msec < w[1].hi));
+}
+
 void msec_of_year_to_date(int64_t msec_of_year, uint32_t *doy, uint32_t* hh, uint32_t *mm, uint32_t *ss, uint32_t *ms);
 int is_numeric(const char *s);
 char* intary2str(int *data, size_t size, char *str, size_t maxstr);
 ssize_t filesize(const char *filename);
 int32_t interp(int32_t x1, int32_t x2, int32_t x3, int32_t x4);
 int validate_date(int apollo_station, int year, uint64_t msec);
+const date_window *date_windows(int apollo_station, int year);
 int doy_to_date_string(uint32_t year, uint32_t doy, char date_string[11]);
-int32_t msec_of_year_to_date_string(uint32_t year, int64_t msec_of_year, double us_offset, char *date_string);
+int32_t msec_of_year_to_date_string(uint32_t year, int64_t msec_of_year, int64_t us_offset, char *date_string);
+int64_t msec_of_year_to_epoch(uint32_t year, int64_t msec_of_year);
+void epoch_to_date_string(int64_t epoch, char *str);
+int date_string_to_epoch(const char *str, int64_t *epoch);
 
 #endif
@@ -5,6 +5,7 @@
 #include "define.h"
 #include "util.h"
 #include "wth.h"
+#include "wth_unpack.h"
 
 int validate_lspe_date(int year, uint64_t msec);
 
@@ -124,18 +125,18 @@ wth_record binary2wth_record(const unsigned char *header) {
 }
 
 /*!
- * @brief バイナリデータをWTHフレーム構造体に展開する
+ * @brief バイナリデータからWTHフレームのヘッダ部のみを展開する
  *
- * @param[in] wnr WTHレコード構造体
+ * 時刻、パッケージID、同期コード、フレームカウンタ等、フレームの検査に
+ * 必要な項目だけを取り出す。データ部は展開しない。
+ *
+ * @param[in] whr WTHレコード構造体
  * @param[in] frame バイナリデータ
- * @return WTHフレーム構造体を返す。
+ * @return WTHフレーム構造体を返す（データ部は0）。
  */
-wth_frame binary2wth_frame(wth_record whr, const unsigned char *frame) {
-  int i, j;
-  int part1, part2, part3, part4;
+wth_frame binary2wth_frame_header(wth_record whr, const unsigned char *frame) {
   wth_frame whf;
-  int sub_frame_array[] = {-1, 2, 3, 1};
-  
+
   memset(&whf, 0, sizeof(whf));
   
   // Set header part
@@ -166,6 +167,22 @@ wth_frame binary2wth_frame(wth_record whr, const unsigned char *frame) {
   whf.sync_code = frame[8];
   whf.sync_code = (whf.sync_code << 2) + (frame[9] >> 6);
 
+  return whf;
+}
+
+/*!
+ * @brief バイナリデータをWTHフレーム構造体に展開する
+ *
+ * @param[in] wnr WTHレコード構造体
+ * @param[in] frame バイナリデータ
+ * @return WTHフレーム構造体を返す。
+ */
+wth_frame binary2wth_frame(wth_record whr, const unsigned char *frame) {
+  wth_frame whf;
+  int sub_frame_array[] = {-1, 2, 3, 1};
+  
+  whf = binary2wth_frame_header(whr, frame);
+
   whf.status[0] = -1;
   whf.dp1[0] = (frame[9] >> 1) & 0x1f;
   whf.dp1[0] <<= 3;
@@ -181,45 +198,23 @@ wth_frame binary2wth_frame(wth_record whr, const unsigned char *frame) {
   whf.dp16[0] = (frame[11] >> 2) & 0x1f;
   whf.dp16[0] <<= 3;
 
-  for(i=1; i<20; ++i) {
-    j = (i+2)*4;
-
-    part1 = frame[j] >> 1;
-    part1 <<= 1;
+  // words 1 ... 19: four 7-bit samples and the status bits each
+  wth_unpack_groups(frame, &whf.dp1[1], &whf.dp6[1], &whf.dp11[1], &whf.dp16[1], &whf.status[1]);
 
-    part2 = frame[j] & 0x01;
-    part2 = (part2 << 6) | (frame[j+1] >> 2);
-    part2 <<= 1;
-
-    part3 = frame[j+1] & 0x03;
-    part3 = (part3 << 5) | (frame[j+2] >> 3);
-    part3 <<= 1;
-
-    part4 = frame[j+2] & 0x07;
-    part4 = (part4 << 4) | (frame[j+3] >> 4);
-    part4 <<= 1;
-    
-    whf.dp1[i] = part1;
-    whf.dp6[i] = part2;
-    whf.dp11[i] = part3;
-    whf.dp16[i] = part4;
-
-    whf.status[i] = (frame[j+3] >> 2) & 0x03;
-  }
   whf.sub_frame = sub_frame_array[whf.status[19]];
 
   return whf;
 }
 
-int validate_lspe_date(int year, uint64_t msec) {
-  uint32_t doy, hh, mm, ss, ms;
-  
-  msec_of_year_to_date(msec, &doy, &hh, &mm, &ss, &ms);
+//! LSPE:1976/228-1977/115 in msec_of_year (windows of date_windows())
+static const date_window lspe_windows[2][DATE_WINDOWS] = {
+  {{228 * 86400000ULL, UINT64_MAX}, {0, 0}},
+  {{0, 116 * 86400000ULL}, {0, 0}},
+};
 
-  if (!((year == 1976 && doy >= 228) ||
-	(year == 1977 && doy <= 115))) {
+int validate_lspe_date(int year, uint64_t msec) {
+  if (year != 1976 && year != 1977) {
     return FALSE;
   }
-
-  return TRUE;
+  return in_date_windows(lspe_windows[year - 1976], msec);
 }
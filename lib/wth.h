@@ -34,7 +34,7 @@
 
 #define COUNTS_PER_FRAME_FOR_WTH_GP   20
 
-#define ALSEP_PACKAGE_ID_APOLLO_17 5
+#define ALSEP_PACKAGE_ID_APOLLO_17 5U
 
 typedef struct tag_wth_record {
 
@@ -120,11 +120,18 @@ typedef struct tag_wth_frame {
   //! frame counter
   uint32_t prev_frame;
 
+  //! time corrected by clock_correct()
+  int64_t msec_of_year_corrected;
+
+  //! TIME_FLAG_*
+  uint32_t time_flag;
+
 } wth_frame;
 
 int check_wth_record(wth_record whr);
 int check_wth_frame(wth_frame whf, int year);
 wth_record binary2wth_record(const unsigned char *header);
+wth_frame binary2wth_frame_header(wth_record whr, const unsigned char *frame);
 wth_frame binary2wth_frame(wth_record whr, const unsigned char *frame);
 int package_id2station_id(uint32_t package_id);
 
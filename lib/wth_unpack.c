@@ -0,0 +1,143 @@
+/*! @file wth_unpack.c
+ *  @brief unpack the 7-bit LSPE geophone samples of WTH frames (SIMD with runtime dispatch)
+ *  @date 2026/10/18
+ *
+ *  Bytes 12-87 of a WTH frame are 19 big-endian 32-bit groups
+ *
+ *    bit 31-25 dp1, 24-18 dp6, 17-11 dp11, 10-4 dp16, 3-2 status
+ *
+ *  and every sample is stored shifted left by one bit (8-bit scale), as
+ *  binary2wth_frame() always did. The SIMD versions byte-swap 4 (SSSE3)
+ *  or 8 (AVX2) groups at once and extract each field with one shift and
+ *  one mask; the groups left over go through the scalar code. The
+ *  version is chosen from the CPU (cpu.h).
+ */
+#include "cpu.h"
+#include "wth_unpack.h"
+
+#ifdef CPU_X86
+#include <immintrin.h>
+#endif
+
+typedef void (*unpack_func)(const unsigned char *frame,
+                            int32_t *dp1, int32_t *dp6, int32_t *dp11, int32_t *dp16,
+                            int32_t *status);
+
+//! groups first ... 18
+static void unpack_tail(const unsigned char *frame,
+                        int32_t *dp1, int32_t *dp6, int32_t *dp11, int32_t *dp16,
+                        int32_t *status, int first) {
+  const unsigned char *p;
+  uint32_t w;
+  int i;
+
+  for (i = first; i < WTH_UNPACK_GROUPS; i++) {
+    p = &frame[WTH_UNPACK_OFFSET + i * 4];
+    w = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    dp1[i]    = (int32_t)(((w >> 25) & 0x7fU) << 1);
+    dp6[i]    = (int32_t)(((w >> 18) & 0x7fU) << 1);
+    dp11[i]   = (int32_t)(((w >> 11) & 0x7fU) << 1);
+    dp16[i]   = (int32_t)(((w >>  4) & 0x7fU) << 1);
+    status[i] = (int32_t)((w >> 2) & 0x03U);
+  }
+}
+
+static void unpack_scalar(const unsigned char *frame,
+                          int32_t *dp1, int32_t *dp6, int32_t *dp11, int32_t *dp16,
+                          int32_t *status) {
+  unpack_tail(frame, dp1, dp6, dp11, dp16, status, 0);
+}
+
+#ifdef CPU_X86
+
+//! the samples are extracted already shifted left: (w >> (shift - 1)) & 0xfe
+#define FIELD(v, shift, mask) _mm_and_si128(_mm_srli_epi32((v), (shift)), _mm_set1_epi32(mask))
+#define FIELD256(v, shift, mask) _mm256_and_si256(_mm256_srli_epi32((v), (shift)), _mm256_set1_epi32(mask))
+
+__attribute__((target("ssse3")))
+static void unpack_ssse3(const unsigned char *frame,
+                         int32_t *dp1, int32_t *dp6, int32_t *dp11, int32_t *dp16,
+                         int32_t *status) {
+  const __m128i bswap = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+  __m128i w;
+  int i;
+
+  for (i = 0; i + 4 <= WTH_UNPACK_GROUPS; i += 4) {
+    w = _mm_loadu_si128((const __m128i *)&frame[WTH_UNPACK_OFFSET + i * 4]);
+    w = _mm_shuffle_epi8(w, bswap);
+    _mm_storeu_si128((__m128i *)&dp1[i],    FIELD(w, 24, 0xfe));
+    _mm_storeu_si128((__m128i *)&dp6[i],    FIELD(w, 17, 0xfe));
+    _mm_storeu_si128((__m128i *)&dp11[i],   FIELD(w, 10, 0xfe));
+    _mm_storeu_si128((__m128i *)&dp16[i],   FIELD(w,  3, 0xfe));
+    _mm_storeu_si128((__m128i *)&status[i], FIELD(w,  2, 0x03));
+  }
+  unpack_tail(frame, dp1, dp6, dp11, dp16, status, i);
+}
+
+__attribute__((target("avx2")))
+static void unpack_avx2(const unsigned char *frame,
+                        int32_t *dp1, int32_t *dp6, int32_t *dp11, int32_t *dp16,
+                        int32_t *status) {
+  const __m256i bswap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                         3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+  __m256i w;
+  int i;
+
+  for (i = 0; i + 8 <= WTH_UNPACK_GROUPS; i += 8) {
+    w = _mm256_loadu_si256((const __m256i *)&frame[WTH_UNPACK_OFFSET + i * 4]);
+    w = _mm256_shuffle_epi8(w, bswap);
+    _mm256_storeu_si256((__m256i *)&dp1[i],    FIELD256(w, 24, 0xfe));
+    _mm256_storeu_si256((__m256i *)&dp6[i],    FIELD256(w, 17, 0xfe));
+    _mm256_storeu_si256((__m256i *)&dp11[i],   FIELD256(w, 10, 0xfe));
+    _mm256_storeu_si256((__m256i *)&dp16[i],   FIELD256(w,  3, 0xfe));
+    _mm256_storeu_si256((__m256i *)&status[i], FIELD256(w,  2, 0x03));
+  }
+  unpack_tail(frame, dp1, dp6, dp11, dp16, status, i);
+}
+
+#endif
+
+static const unpack_func versions[CPU_NUM_ISA] = {
+  [CPU_ISA_SCALAR] = unpack_scalar,
+#ifdef CPU_X86
+  [CPU_ISA_SSSE3] = unpack_ssse3,
+  [CPU_ISA_AVX2] = unpack_avx2,
+#endif
+};
+static cpu_dispatch dispatch = CPU_DISPATCH_INIT(CPU_ISA_BIT(CPU_ISA_SSSE3) | CPU_ISA_BIT(CPU_ISA_AVX2));
+
+/*!
+ * @brief select the version of the unpacker (for tests and benchmarks)
+ *
+ * @param[in] isa CPU_ISA_SCALAR, CPU_ISA_SSSE3, CPU_ISA_AVX2 or CPU_ISA_AUTO
+ * @return 0 on success, -1 if the CPU does not support it
+ */
+int wth_unpack_set_isa(int isa) {
+  return cpu_dispatch_set(&dispatch, isa);
+}
+
+/*!
+ * @brief version of the unpacker in use
+ */
+int wth_unpack_isa(void) {
+  return cpu_dispatch_isa(&dispatch);
+}
+
+/*!
+ * @brief unpack the samples and status of the 19 groups of a frame
+ *
+ * The group i (i = 0 ... 18) is written to index i of every array, so
+ * binary2wth_frame() passes &whf.dp1[1] etc. for the words 1 ... 19.
+ *
+ * @param[in] frame binary data of a frame (96 octets)
+ * @param[out] dp1 geophone 1 (WTH_UNPACK_GROUPS samples)
+ * @param[out] dp6 geophone 2
+ * @param[out] dp11 geophone 3
+ * @param[out] dp16 geophone 4
+ * @param[out] status status bits
+ */
+void wth_unpack_groups(const unsigned char *frame,
+                       int32_t *dp1, int32_t *dp6, int32_t *dp11, int32_t *dp16,
+                       int32_t *status) {
+  versions[cpu_dispatch_isa(&dispatch)](frame, dp1, dp6, dp11, dp16, status);
+}
@@ -0,0 +1,23 @@
+/*! @file wth_unpack.h
+ *  @brief unpack the 7-bit LSPE geophone samples of WTH frames (SIMD with runtime dispatch)
+ *  @date 2026/10/18
+ */
+#ifndef __WTH_UNPACK_H__
+#define __WTH_UNPACK_H__
+
+#include <stdint.h>
+#include "cpu.h"
+
+//! 4-byte groups of geophone samples in a frame (words 1 ... 19)
+#define WTH_UNPACK_GROUPS 19
+
+//! first byte of the groups in a frame
+#define WTH_UNPACK_OFFSET 12
+
+void wth_unpack_groups(const unsigned char *frame,
+                       int32_t *dp1, int32_t *dp6, int32_t *dp11, int32_t *dp16,
+                       int32_t *status);
+int wth_unpack_isa(void);
+int wth_unpack_set_isa(int isa);
+
+#endif
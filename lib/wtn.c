@@ -39,52 +39,68 @@ int check_wtn_record(wtn_record wnr) {
 
 
 /*!
- * @brief WTNフレームをチェックしエラーを返す。
+ * @brief WTNフレームのエラー番号マスク値 (条件分岐なし)
  *
  * @param[in] wnf WTNフレーム構造体
- * @return 成功したときは0を返す。
- * 失敗したときはエラー番号マスク値を返す。
+ * @param[in] year 年
  */
-int check_wtn_frame(wtn_frame wnf, int year) {
-  int error_flag = 0;
+static inline uint32_t wtn_frame_error(const wtn_frame *wnf, int year) {
+  uint32_t error_flag;
   int64_t delta;
-  
-  if ( wnf.alsep_package_id < 1U || wnf.alsep_package_id > 5U ) {
-    error_flag |= ERROR_INVALID_APOLLO_STATION;
-  }
-  
-  if (!validate_date(package_id2station_id(wnf.alsep_package_id),
-                     year, wnf.msec_of_year)) {
-    error_flag |= ERROR_INVALID_DATETIME;
-  }
-  
-  if ( wnf.frame_count >= SIZE_LOGICAL_RECORD ) {
-    error_flag |= ERROR_INVALID_FORMAT;
-  }
-  
-  if (wnf.sync_code != VALID_SYNC_CODE) {
-    error_flag |= ERROR_INVALID_SYNC_CODE;
-  }
-  
+
+  error_flag = (uint32_t)((wnf->alsep_package_id < 1U) | (wnf->alsep_package_id > 5U))
+    * ERROR_INVALID_APOLLO_STATION;
+
+  error_flag |= (uint32_t)!in_date_windows(
+    date_windows(package_id2station_id(wnf->alsep_package_id), year),
+    wnf->msec_of_year) * ERROR_INVALID_DATETIME;
+
+  error_flag |= (uint32_t)(wnf->frame_count >= SIZE_LOGICAL_RECORD) * ERROR_INVALID_FORMAT;
+
+  error_flag |= (uint32_t)(wnf->sync_code != VALID_SYNC_CODE) * ERROR_INVALID_SYNC_CODE;
+
   //! these judgment using 10, 100 below is not so meaningful.
-  delta = wnf.time_diff - VALID_FRAME_RATE;
+  delta = wnf->time_diff - VALID_FRAME_RATE;
   delta = (delta < 0) ? -delta : delta;
-  if (delta >10 && delta <= 100) {
-    error_flag |= ERROR_FRAME_SMALL_TIME_ERROR;
-  }
-  if (delta >100) {
-    error_flag |= ERROR_FRAME_LARGE_TIME_ERROR;
-  }
-  
-  if (wnf.frame_count - wnf.prev_frame != 1U) {
-    if (!(wnf.frame_count == 0U && wnf.prev_frame == 89U)) {
-      error_flag |= ERROR_FRAME_COUNT_SEQUENCE;
-    }
-  }
+  error_flag |= (uint32_t)((delta > 10) & (delta <= 100)) * ERROR_FRAME_SMALL_TIME_ERROR;
+  error_flag |= (uint32_t)(delta > 100) * ERROR_FRAME_LARGE_TIME_ERROR;
+
+  error_flag |= (uint32_t)((wnf->frame_count - wnf->prev_frame != 1U) &
+                           !((wnf->frame_count == 0U) & (wnf->prev_frame == 89U)))
+    * ERROR_FRAME_COUNT_SEQUENCE;
 
   return error_flag;
 }
 
+/*!
+ * @brief WTNフレームをチェックしエラーを返す。
+ *
+ * @param[in] wnf WTNフレーム構造体
+ * @return 成功したときは0を返す。
+ * 失敗したときはエラー番号マスク値を返す。
+ */
+int check_wtn_frame(wtn_frame wnf, int year) {
+  return wtn_frame_error(&wnf, year);
+}
+
+/*!
+ * @brief WTNフレームの配列をチェックしerror_flagに設定する。
+ *
+ * 観測所はフレームごとに異なるため、観測期間はパッケージIDから表を引く。
+ * time_diff, prev_frameは設定済みであること。
+ *
+ * @param[in,out] wnf WTNフレーム構造体の配列
+ * @param[in] nframe フレーム数
+ * @param[in] year 年
+ */
+void check_wtn_frames(wtn_frame *wnf, int nframe, int year) {
+  int i;
+
+  for (i = 0; i < nframe; i++) {
+    wnf[i].error_flag = wtn_frame_error(&wnf[i], year);
+  }
+}
+
 /*!
  * @brief バイナリデータをWTNレコード構造体に展開する
  *
@@ -134,16 +150,17 @@ wtn_record binary2wtn_record(const unsigned char *header) {
 }
 
 /*!
- * @brief バイナリデータをWTNフレーム構造体に展開する
+ * @brief バイナリデータからWTNフレームのヘッダ部のみを展開する
+ *
+ * 時刻、パッケージID、同期コード、フレームカウンタ等、フレームの検査に
+ * 必要な項目だけを取り出す。データ部は展開しない。
  *
  * @param[in] wnr WTNレコード構造体
  * @param[in] frame バイナリデータ
- * @return WTNフレーム構造体を返す。
+ * @return WTNフレーム構造体を返す（データ部は0）。
  */
-wtn_frame binary2wtn_frame(wtn_record wnr, const unsigned char *frame) {
-  int i, j;
+wtn_frame binary2wtn_frame_header(wtn_record wnr, const unsigned char *frame) {
   wtn_frame wnf;
-  int32_t la[21], lb[21], lc[21];
 
   memset(&wnf, 0, sizeof(wnf));
   
@@ -181,6 +198,23 @@ wtn_frame binary2wtn_frame(wtn_record wnr, const unsigned char *frame) {
   wnf.frame_count = frame[11] >> 1;
   wnf.mode_bit = frame[11] & 0x01U;
 
+  return wnf;
+}
+
+/*!
+ * @brief バイナリデータをWTNフレーム構造体に展開する
+ *
+ * @param[in] wnr WTNレコード構造体
+ * @param[in] frame バイナリデータ
+ * @return WTNフレーム構造体を返す。
+ */
+wtn_frame binary2wtn_frame(wtn_record wnr, const unsigned char *frame) {
+  int i, j;
+  wtn_frame wnf;
+  int32_t la[21], lb[21], lc[21];
+
+  wnf = binary2wtn_frame_header(wnr, frame);
+
   // Set data part
   for(i=0; i<=20; ++i){
     la[i] = (int32_t)frame[12+i*4];
@@ -36,7 +36,7 @@
 #define COUNTS_PER_FRAME_FOR_WTN_LP    4
 #define COUNTS_PER_FRAME_FOR_WTN_LSG  31
 #define COUNTS_PER_FRAME_FOR_WTN_LSM   6
-#define SIZE_LOGICAL_RECORD           90U
+#define SIZE_LOGICAL_RECORD           90
 
 #define ALSEP_PACKAGE_ID_APOLLO_12 1U
 #define ALSEP_PACKAGE_ID_APOLLO_15 2U
@@ -172,13 +172,22 @@ typedef struct tag_wtn_frame {
   
   //! frame counter
   uint32_t prev_frame;
+
+  //! time corrected by clock_correct()
+  int64_t msec_of_year_corrected;
+
+  //! TIME_FLAG_*
+  uint32_t time_flag;
   
 } wtn_frame;
 
 int check_wtn_record(wtn_record wnr);
 int check_wtn_frame(wtn_frame wnf, int year);
+void check_wtn_frames(wtn_frame *wnf, int nframe, int year);
 wtn_record binary2wtn_record(const unsigned char *header);
+wtn_frame binary2wtn_frame_header(wtn_record wnr, const unsigned char *frame);
 wtn_frame binary2wtn_frame(wtn_record wnr, const unsigned char *frame);
+void binary2wtn_frames(wtn_record wnr, const unsigned char *frames, wtn_frame *wnf, int nframe);
 int package_id2station_id(uint32_t package_id);
 
 #endif
@@ -0,0 +1,123 @@
+/*! @file wtn_demux.c
+ *  @brief demultiplexing of the interleaved stations of a WTN block
+ *  @date 2026/10/18
+ *
+ *  The stations of a WTN block are interleaved, usually with a stride of
+ *  num_asta frames, but dropouts break the stride. Each frame is linked
+ *  to the last frame of its own alsep_package_id instead, so time_diff,
+ *  prev_frame and the spz[0] interpolation stay valid over dropouts.
+ */
+#include <stdint.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "define.h"
+#include "util.h"
+#include "wtn.h"
+#include "wtn_demux.h"
+
+/*!
+ * @brief start a demultiplexer with no station seen
+ */
+void wtn_demux_init(wtn_demux *d) {
+  memset(d, 0, sizeof(wtn_demux));
+}
+
+/*!
+ * @brief link a frame to the last frame of its station s (none if not valid)
+ */
+static void link_frame(const wtn_stream *s, wtn_frame *wnf) {
+  int lsg = (wnf->alsep_package_id == ALSEP_PACKAGE_ID_APOLLO_17);
+
+  if (s->valid) {
+    if (!lsg) {
+      //! ALSEP WORD 2
+      wnf->spz[0] = interp(s->spz30, s->spz31, wnf->spz[1], wnf->spz[2]);
+    }
+    wnf->time_diff = wnf->msec_of_year - s->msec_of_year;
+    wnf->prev_frame = s->frame_count;
+  } else {
+    if (!lsg) {
+      wnf->spz[0] = wnf->spz[1];
+      wnf->process_flag |= FLAG_FIRST_DATA_COPIED;
+    }
+    wnf->time_diff = wnf->msec_of_year;
+    wnf->prev_frame = -1;
+  }
+}
+
+/*!
+ * @brief link a frame to the last frame of its station
+ *
+ * Sets time_diff, prev_frame and spz[0] of the frame. The first frame of
+ * a station other than Apollo 17 (no SP data) gets FLAG_FIRST_DATA_COPIED
+ * (spz[1] is copied into spz[0]).
+ * Frames must be given in the order of the block.
+ *
+ * @return index of the station stream (alsep_package_id)
+ */
+int wtn_demux_link(wtn_demux *d, wtn_frame *wnf) {
+  int id = wtn_demux_stream(wnf->alsep_package_id);
+  wtn_stream *s = &d->stream[id];
+
+  link_frame(s, wnf);
+
+  s->valid = 1;
+  s->msec_of_year = wnf->msec_of_year;
+  s->frame_count = wnf->frame_count;
+  s->spz30 = wnf->spz[30];
+  s->spz31 = wnf->spz[31];
+  return id;
+}
+
+/*!
+ * @brief link the frames of a block in one pass
+ */
+void wtn_demux_frames(wtn_demux *d, wtn_frame *wnf, int nframe) {
+  int i;
+
+  for (i = 0; i < nframe; i++) {
+    wtn_demux_link(d, &wnf[i]);
+  }
+}
+
+/*!
+ * @brief join a chunk of frames linked on its own to the frames before it
+ *
+ * The chunk was linked by wtn_demux_frames() starting from an empty
+ * demultiplexer chunk. The first frame of each station in the chunk is
+ * linked again to the last frame of the station in carry, then carry
+ * takes the state after the chunk. Joining the chunks of a block in order
+ * gives the same frames as wtn_demux_frames() over the whole block.
+ *
+ * @param[in,out] carry state after the frames before the chunk
+ * @param[in] chunk state after the chunk
+ * @param[in,out] wnf frames of the chunk
+ * @param[in] nframe number of frames of the chunk
+ */
+void wtn_demux_join(wtn_demux *carry, const wtn_demux *chunk, wtn_frame *wnf, int nframe) {
+  int seen[WTN_DEMUX_STREAMS] = {0};
+  int i, id, left = 0;
+
+  for (id = 0; id < WTN_DEMUX_STREAMS; id++) {
+    left += chunk->stream[id].valid;
+  }
+  for (i = 0; i < nframe && left > 0; i++) {
+    id = wtn_demux_stream(wnf[i].alsep_package_id);
+    if (seen[id]) {
+      continue;
+    }
+    seen[id] = 1;
+    left--;
+    if (carry->stream[id].valid) {
+      wnf[i].process_flag &= ~FLAG_FIRST_DATA_COPIED;
+      link_frame(&carry->stream[id], &wnf[i]);
+    }
+  }
+
+  for (id = 0; id < WTN_DEMUX_STREAMS; id++) {
+    if (chunk->stream[id].valid) {
+      carry->stream[id] = chunk->stream[id];
+    }
+  }
+}
@@ -0,0 +1,46 @@
+/*! @file wtn_demux.h
+ *  @brief demultiplexing of the interleaved stations of a WTN block
+ *  @date 2026/10/18
+ */
+#ifndef __WTN_DEMUX_H__
+#define __WTN_DEMUX_H__
+
+#include <stdint.h>
+#include "wtn.h"
+
+//! alsep_package_id is 3 bits
+#define WTN_DEMUX_STREAMS 8
+
+/*!
+ * @brief stream of an alsep_package_id: the index of the per-package state
+ *        (demultiplexer, clock model, despiker) of every WTN and WTH tool
+ */
+static inline int wtn_demux_stream(uint32_t alsep_package_id) {
+  return (int)(alsep_package_id % WTN_DEMUX_STREAMS);
+}
+
+//! last frame of a station
+typedef struct tag_wtn_stream {
+
+  //! a frame of the station was seen
+  int valid;
+
+  int64_t msec_of_year;
+  uint32_t frame_count;
+
+  //! last two SP samples of the last frame for the spz[0] interpolation
+  int32_t spz30;
+  int32_t spz31;
+
+} wtn_stream;
+
+typedef struct tag_wtn_demux {
+  wtn_stream stream[WTN_DEMUX_STREAMS];
+} wtn_demux;
+
+void wtn_demux_init(wtn_demux *d);
+int wtn_demux_link(wtn_demux *d, wtn_frame *wnf);
+void wtn_demux_frames(wtn_demux *d, wtn_frame *wnf, int nframe);
+void wtn_demux_join(wtn_demux *carry, const wtn_demux *chunk, wtn_frame *wnf, int nframe);
+
+#endif
@@ -0,0 +1,322 @@
+/*! @file alsep2psd.c
+ *  @brief Compute Welch PSDs and PPSD histograms of PSE, WTN and WTH raw data per station-day
+ *  @date 2026/10/18
+ *
+ *  The selected channels of the files are decoded into series (files on
+ *  a pool of threads) and every day of every station and channel is a
+ *  job of the pool: the PSD of each hour, the mean PSD of the day and
+ *  the histogram of the hourly PSDs in octave bands (psd.h). The days
+ *  are written in order of station, channel and day to a PSD file, read
+ *  back by psd_read_header() and psd_day_read(). A day is complete when
+ *  all files holding it are given in one run.
+ *
+ *  usage: alsep2psd [-j jobs] [-c channels] [-s segment] -o output {pse|wtn|wth} id filename ...
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include <getopt.h>
+
+#include "define.h"
+#include "error.h"
+#include "util.h"
+#include "parallel.h"
+#include "samples.h"
+#include "psd.h"
+
+//! station-days computed before they are written
+#define DAYS_PER_ROUND 256
+
+typedef struct tag_file_in {
+  int type;
+  int file_id;
+  const char *filename;
+  int channel;
+  samples_series *s;
+  int ns;
+  int error;
+} file_in;
+
+typedef struct tag_day_job {
+  int apollo_station;
+  int channel;
+  int64_t day;
+  psd_day d;
+
+  //! 0: computed, 1: no data, -1: no memory
+  int status;
+} day_job;
+
+typedef struct tag_day_arg {
+  day_job *job;
+  const psd_plan *plan;
+  const samples_series *s;
+  int ns;
+} day_arg;
+
+static int enabled[SAMPLES_NUM_CHANNEL] = {1, 0, 0, 1, 0};
+
+void usage(const char* cmd) {
+  fprintf(stderr, "%s [-j jobs] [-c channels] [-s segment] -o output "
+          "{pse|wtn|wth} id filename [{pse|wtn|wth} id filename ...]\n", cmd);
+  fprintf(stderr, "  channels: comma separated list of sp_z,lp_x,lp_y,lp_z,lsg,gp1,gp2,gp3,gp4 (default sp_z,lp_z)\n");
+  fprintf(stderr, "  segment: longest Welch segment [sec] (default %g)\n", PSD_DEFAULT_SEGMENT);
+}
+
+/*!
+ * @brief enable only the channels of a comma separated list
+ *
+ * @return 0 on success, -1 for an unknown channel
+ */
+static int select_channels(char *list) {
+  char *name;
+  int i;
+
+  for (i = 0; i < SAMPLES_NUM_CHANNEL; i++) {
+    enabled[i] = 0;
+  }
+  for (name = strtok(list, ","); name != NULL; name = strtok(NULL, ",")) {
+    i = samples_channel(name);
+    if (i < 0) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "unknown channel: %s", name);
+      return -1;
+    }
+    enabled[i] = 1;
+  }
+  return 0;
+}
+
+static void load_job(int i, void *arg) {
+  file_in *in = &((file_in *)arg)[i];
+
+  log_printf(LOG_INFO, __FILE__, __LINE__, "processing: %s (%s)",
+             in->filename, samples_channel_name(in->channel));
+  if (samples_load(in->type, in->filename, in->channel, &in->s, &in->ns) != 0) {
+    in->error = 1;
+  }
+}
+
+static void day_job_run(int i, void *arg) {
+  day_arg *da = (day_arg *)arg;
+  day_job *job = &da->job[i];
+
+  job->status = psd_day_compute(&da->plan[job->channel], da->s, da->ns,
+                                job->apollo_station, job->channel, job->day, &job->d);
+}
+
+static int compare_day(const void *a, const void *b) {
+  const day_job *x = (const day_job *)a;
+  const day_job *y = (const day_job *)b;
+
+  if (x->apollo_station != y->apollo_station) {
+    return x->apollo_station - y->apollo_station;
+  }
+  if (x->channel != y->channel) {
+    return x->channel - y->channel;
+  }
+  if (x->day != y->day) {
+    return (x->day < y->day) ? -1 : 1;
+  }
+  return 0;
+}
+
+/*!
+ * @brief 00:00 of the day of a time [msec since the epoch]
+ */
+static int64_t day_of(int64_t epoch) {
+  return ((epoch >= 0) ? epoch / PSD_DAY_MSEC : -((-epoch + PSD_DAY_MSEC - 1) / PSD_DAY_MSEC)) * PSD_DAY_MSEC;
+}
+
+int main(int argc, char** argv) {
+
+  // ----------------------------------------
+  // Generic variables
+  // ----------------------------------------
+  const char *cmd = argv[0];
+  int i, j, k, c, nfile, nin = 0, ns = 0, njob = 0, maxjob = 0, nday = 0;
+  int ret = EXIT_FAILURE;
+  file_in *in = NULL;
+  samples_series *s = NULL;
+  day_job *job = NULL, *x;
+  psd_plan plan[SAMPLES_NUM_CHANNEL];
+  day_arg da;
+  FILE *f = NULL;
+
+  // ----------------------------------------
+  // getopt
+  // ----------------------------------------
+  int ch;
+  extern char *optarg;
+  extern int optind, opterr;
+  int jobs = 0;
+  double segment = PSD_DEFAULT_SEGMENT;
+  const char *output = NULL;
+
+  while ((ch = getopt(argc, argv, "j:c:s:o:")) != -1) {
+    switch(ch) {
+    case 'j':
+      jobs = atoi(optarg);
+      break;
+    case 'c':
+      if (select_channels(optarg) != 0) {
+        return EXIT_FAILURE;
+      }
+      break;
+    case 's':
+      segment = atof(optarg);
+      break;
+    case 'o':
+      output = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  argc -= optind;
+  if (argc < 3 || argc % 3 != 0 || output == NULL) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  argv += optind;
+
+  // ----------------------------------------
+  // PROGRAM MAIN
+  // ----------------------------------------
+  memset(plan, 0, sizeof(plan));
+  for (c = 0; c < SAMPLES_NUM_CHANNEL; c++) {
+    if (enabled[c] && psd_init(&plan[c], samples_rate(c), segment) != 0) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "invalid segment for %s: %g", samples_channel_name(c), segment);
+      goto main_finish;
+    }
+  }
+
+  // one load job per file and channel
+  nfile = argc / 3;
+  in = (file_in *)calloc(nfile * SAMPLES_NUM_CHANNEL, sizeof(file_in));
+  if (in == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+    goto main_finish;
+  }
+  for (i = 0; i < nfile; i++) {
+    int type = samples_type(argv[3*i]);
+
+    if (type < 0) {
+      usage(cmd);
+      goto main_finish;
+    }
+    for (c = 0; c < SAMPLES_NUM_CHANNEL; c++) {
+      if (enabled[c]) {
+        in[nin].type = type;
+        in[nin].file_id = atoi(argv[3*i+1]);
+        in[nin].filename = argv[3*i+2];
+        in[nin].channel = c;
+        nin++;
+      }
+    }
+  }
+  parallel_for(nin, jobs, load_job, in);
+  for (i = 0; i < nin; i++) {
+    if (in[i].error) {
+      goto main_finish;
+    }
+    ns += in[i].ns;
+  }
+
+  // all series and the days they touch
+  s = (samples_series *)malloc((ns > 0 ? ns : 1) * sizeof(samples_series));
+  if (s == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+    goto main_finish;
+  }
+  for (i = 0, k = 0; i < nin; i++) {
+    for (j = 0; j < in[i].ns; j++) {
+      int64_t d, last;
+
+      s[k] = in[i].s[j];
+      last = s[k].t0 + llround((s[k].n - 1) * 1000.0 / s[k].rate);
+      for (d = day_of(s[k].t0); d <= last; d += PSD_DAY_MSEC) {
+        if (njob >= maxjob) {
+          maxjob = (maxjob > 0) ? maxjob * 2 : 256;
+          x = (day_job *)realloc(job, maxjob * sizeof(day_job));
+          if (x == NULL) {
+            log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+            goto main_finish;
+          }
+          job = x;
+        }
+        memset(&job[njob], 0, sizeof(day_job));
+        job[njob].apollo_station = s[k].apollo_station;
+        job[njob].channel = s[k].channel;
+        job[njob].day = d;
+        njob++;
+      }
+      k++;
+    }
+  }
+  qsort(job, njob, sizeof(day_job), compare_day);
+  for (i = 0, k = 0; i < njob; i++) {
+    if (k == 0 || compare_day(&job[k-1], &job[i]) != 0) {
+      job[k++] = job[i];
+    }
+  }
+  njob = k;
+  log_printf(LOG_INFO, __FILE__, __LINE__, "series: %d, station-days: %d", ns, njob);
+
+  f = fopen(output, "wb");
+  if (f == NULL || psd_write_header(f) != 0) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot write: %s", output);
+    goto main_finish;
+  }
+
+  // station-days on the pool, written in order a round at a time
+  da.plan = plan;
+  da.s = s;
+  da.ns = ns;
+  for (i = 0; i < njob; i += DAYS_PER_ROUND) {
+    int n = (njob - i < DAYS_PER_ROUND) ? njob - i : DAYS_PER_ROUND;
+
+    da.job = &job[i];
+    parallel_for(n, jobs, day_job_run, &da);
+    for (j = i; j < i + n; j++) {
+      if (job[j].status < 0) {
+        log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+        goto main_finish;
+      }
+      if (job[j].status == 0) {
+        if (psd_day_write(f, &job[j].d) != 0) {
+          log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot write: %s", output);
+          goto main_finish;
+        }
+        nday++;
+      }
+      psd_day_free(&job[j].d);
+    }
+  }
+  log_printf(LOG_INFO, __FILE__, __LINE__, "days written: %d", nday);
+  ret = EXIT_SUCCESS;
+
+ main_finish:
+  if (f != NULL && fclose(f) != 0 && ret == EXIT_SUCCESS) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot write: %s", output);
+    ret = EXIT_FAILURE;
+  }
+  for (i = 0; i < njob; i++) {
+    psd_day_free(&job[i].d);
+  }
+  free(job);
+  free(s);
+  if (in != NULL) {
+    for (i = 0; i < nin; i++) {
+      samples_free(in[i].s, in[i].ns);
+    }
+  }
+  free(in);
+  for (c = 0; c < SAMPLES_NUM_CHANNEL; c++) {
+    psd_free(&plan[c]);
+  }
+  return ret;
+}
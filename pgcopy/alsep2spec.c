@@ -0,0 +1,338 @@
+/*! @file alsep2spec.c
+ *  @brief Compute spectrogram tiles of PSE, WTN and WTH raw data for browsing
+ *  @date 2026/10/18
+ *
+ *  The selected channels of the files are decoded into series (files on
+ *  a pool of threads) and every tile of the top time level of every
+ *  station, channel and window is a job of the pool computing all tiles
+ *  under it (spectrogram.h). The tiles are written in order a round of
+ *  jobs at a time to a tile file, read back by spec_open() and
+ *  spec_view(). Tiles are complete when all files holding them are given
+ *  in one run.
+ *
+ *  usage: alsep2spec [-j jobs] [-c channels] [-n nfft] [-f freqs] [-l levels] -o output
+ *                    {pse|wtn|wth} id filename ...
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <getopt.h>
+
+#include "define.h"
+#include "error.h"
+#include "util.h"
+#include "parallel.h"
+#include "samples.h"
+#include "spectrogram.h"
+
+//! top level tiles computed before they are written
+#define TOPS_PER_ROUND 64
+
+typedef struct tag_file_in {
+  int type;
+  const char *filename;
+  int channel;
+  samples_series *s;
+  int ns;
+  int error;
+} file_in;
+
+typedef struct tag_top_job {
+  int apollo_station;
+  int channel;
+  int freq;
+  int64_t top;
+  spec_tile *tiles;
+  int ntile;
+  int error;
+} top_job;
+
+typedef struct tag_top_arg {
+  top_job *job;
+  spec_plan (*plan)[SPEC_MAX_FREQ];
+  const samples_series *s;
+  int ns;
+} top_arg;
+
+static int enabled[SAMPLES_NUM_CHANNEL] = {1, 1, 1, 1, 1, 1, 1, 1, 1};
+
+void usage(const char* cmd) {
+  fprintf(stderr, "%s [-j jobs] [-c channels] [-n nfft] [-f freqs] [-l levels] -o output "
+          "{pse|wtn|wth} id filename [{pse|wtn|wth} id filename ...]\n", cmd);
+  fprintf(stderr, "  channels: comma separated list of sp_z,lp_x,lp_y,lp_z,lsg,gp1,gp2,gp3,gp4 (default all)\n");
+  fprintf(stderr, "  nfft: window of the finest frequency level [samples] (default %d)\n", SPEC_DEFAULT_NFFT);
+  fprintf(stderr, "  freqs: frequency levels 1 ... %d (default %d)\n", SPEC_MAX_FREQ, SPEC_DEFAULT_FREQS);
+  fprintf(stderr, "  levels: time levels 1 ... %d (default %d)\n", SPEC_MAX_LEVEL, SPEC_DEFAULT_LEVELS);
+}
+
+/*!
+ * @brief enable only the channels of a comma separated list
+ *
+ * @return 0 on success, -1 for an unknown channel
+ */
+static int select_channels(char *list) {
+  char *name;
+  int i;
+
+  for (i = 0; i < SAMPLES_NUM_CHANNEL; i++) {
+    enabled[i] = 0;
+  }
+  for (name = strtok(list, ","); name != NULL; name = strtok(NULL, ",")) {
+    i = samples_channel(name);
+    if (i < 0) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "unknown channel: %s", name);
+      return -1;
+    }
+    enabled[i] = 1;
+  }
+  return 0;
+}
+
+static void load_job(int i, void *arg) {
+  file_in *in = &((file_in *)arg)[i];
+
+  log_printf(LOG_INFO, __FILE__, __LINE__, "processing: %s (%s)",
+             in->filename, samples_channel_name(in->channel));
+  if (samples_load(in->type, in->filename, in->channel, &in->s, &in->ns) != 0) {
+    in->error = 1;
+  }
+}
+
+static void top_job_run(int i, void *arg) {
+  top_arg *ta = (top_arg *)arg;
+  top_job *job = &ta->job[i];
+
+  if (spec_build(&ta->plan[job->channel][job->freq], ta->s, ta->ns,
+                 job->apollo_station, job->channel, job->top, &job->tiles, &job->ntile) != 0) {
+    job->error = 1;
+  }
+}
+
+static int compare_top(const void *a, const void *b) {
+  const top_job *x = (const top_job *)a;
+  const top_job *y = (const top_job *)b;
+
+  if (x->apollo_station != y->apollo_station) {
+    return x->apollo_station - y->apollo_station;
+  }
+  if (x->channel != y->channel) {
+    return x->channel - y->channel;
+  }
+  if (x->freq != y->freq) {
+    return x->freq - y->freq;
+  }
+  if (x->top != y->top) {
+    return (x->top < y->top) ? -1 : 1;
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+
+  // ----------------------------------------
+  // Generic variables
+  // ----------------------------------------
+  const char *cmd = argv[0];
+  int i, j, k, c, q, nfile, nin = 0, ns = 0, njob = 0, maxjob = 0, ntile = 0;
+  int ret = EXIT_FAILURE, opened = 0;
+  file_in *in = NULL;
+  samples_series *s = NULL;
+  top_job *job = NULL, *x;
+  spec_plan plan[SAMPLES_NUM_CHANNEL][SPEC_MAX_FREQ];
+  spec_writer w;
+  top_arg ta;
+
+  // ----------------------------------------
+  // getopt
+  // ----------------------------------------
+  int ch;
+  extern char *optarg;
+  extern int optind, opterr;
+  int jobs = 0;
+  int nfft = SPEC_DEFAULT_NFFT;
+  int freqs = SPEC_DEFAULT_FREQS;
+  int levels = SPEC_DEFAULT_LEVELS;
+  const char *output = NULL;
+
+  while ((ch = getopt(argc, argv, "j:c:n:f:l:o:")) != -1) {
+    switch(ch) {
+    case 'j':
+      jobs = atoi(optarg);
+      break;
+    case 'c':
+      if (select_channels(optarg) != 0) {
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'n':
+      nfft = atoi(optarg);
+      break;
+    case 'f':
+      freqs = atoi(optarg);
+      break;
+    case 'l':
+      levels = atoi(optarg);
+      break;
+    case 'o':
+      output = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  argc -= optind;
+  if (argc < 3 || argc % 3 != 0 || output == NULL || freqs < 1 || freqs > SPEC_MAX_FREQ) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  argv += optind;
+
+  // ----------------------------------------
+  // PROGRAM MAIN
+  // ----------------------------------------
+  memset(plan, 0, sizeof(plan));
+  for (c = 0; c < SAMPLES_NUM_CHANNEL; c++) {
+    for (q = 0; q < freqs && enabled[c]; q++) {
+      if (spec_init(&plan[c][q], samples_rate(c), nfft << q, levels) != 0) {
+        log_printf(LOG_ERROR, __FILE__, __LINE__, "invalid nfft or levels: %d, %d", nfft << q, levels);
+        goto main_finish;
+      }
+    }
+  }
+
+  // one load job per file and channel
+  nfile = argc / 3;
+  in = (file_in *)calloc(nfile * SAMPLES_NUM_CHANNEL, sizeof(file_in));
+  if (in == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+    goto main_finish;
+  }
+  for (i = 0; i < nfile; i++) {
+    int type = samples_type(argv[3*i]);
+
+    if (type < 0) {
+      usage(cmd);
+      goto main_finish;
+    }
+    for (c = 0; c < SAMPLES_NUM_CHANNEL; c++) {
+      if (enabled[c]) {
+        in[nin].type = type;
+        in[nin].filename = argv[3*i+2];
+        in[nin].channel = c;
+        nin++;
+      }
+    }
+  }
+  parallel_for(nin, jobs, load_job, in);
+  for (i = 0; i < nin; i++) {
+    if (in[i].error) {
+      goto main_finish;
+    }
+    ns += in[i].ns;
+  }
+
+  // all series and the top level tiles they touch
+  s = (samples_series *)malloc((ns > 0 ? ns : 1) * sizeof(samples_series));
+  if (s == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+    goto main_finish;
+  }
+  for (i = 0, k = 0; i < nin; i++) {
+    for (j = 0; j < in[i].ns; j++, k++) {
+      s[k] = in[i].s[j];
+      for (q = 0; q < freqs; q++) {
+        int64_t top, first, last;
+
+        if (spec_top_range(&plan[s[k].channel][q], &s[k], &first, &last) != 0) {
+          continue;
+        }
+        for (top = first; top <= last; top++) {
+          if (njob >= maxjob) {
+            maxjob = (maxjob > 0) ? maxjob * 2 : 256;
+            x = (top_job *)realloc(job, maxjob * sizeof(top_job));
+            if (x == NULL) {
+              log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+              goto main_finish;
+            }
+            job = x;
+          }
+          memset(&job[njob], 0, sizeof(top_job));
+          job[njob].apollo_station = s[k].apollo_station;
+          job[njob].channel = s[k].channel;
+          job[njob].freq = q;
+          job[njob].top = top;
+          njob++;
+        }
+      }
+    }
+  }
+  qsort(job, njob, sizeof(top_job), compare_top);
+  for (i = 0, k = 0; i < njob; i++) {
+    if (k == 0 || compare_top(&job[k-1], &job[i]) != 0) {
+      job[k++] = job[i];
+    }
+  }
+  njob = k;
+  log_printf(LOG_INFO, __FILE__, __LINE__, "series: %d, top level tiles: %d", ns, njob);
+
+  if (spec_writer_open(&w, output) != 0) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot write: %s", output);
+    goto main_finish;
+  }
+  opened = 1;
+
+  // top level tiles on the pool, written in order a round at a time
+  ta.plan = plan;
+  ta.s = s;
+  ta.ns = ns;
+  for (i = 0; i < njob; i += TOPS_PER_ROUND) {
+    int n = (njob - i < TOPS_PER_ROUND) ? njob - i : TOPS_PER_ROUND;
+
+    ta.job = &job[i];
+    parallel_for(n, jobs, top_job_run, &ta);
+    for (j = i; j < i + n; j++) {
+      if (job[j].error) {
+        log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+        goto main_finish;
+      }
+      for (k = 0; k < job[j].ntile; k++) {
+        if (spec_writer_add(&w, &job[j].tiles[k]) != 0) {
+          log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot write: %s", output);
+          goto main_finish;
+        }
+      }
+      ntile += job[j].ntile;
+      spec_tiles_free(job[j].tiles, job[j].ntile);
+      job[j].tiles = NULL;
+      job[j].ntile = 0;
+    }
+  }
+  log_printf(LOG_INFO, __FILE__, __LINE__, "tiles written: %d", ntile);
+  ret = EXIT_SUCCESS;
+
+ main_finish:
+  if (opened && spec_writer_close(&w) != 0 && ret == EXIT_SUCCESS) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot write: %s", output);
+    ret = EXIT_FAILURE;
+  }
+  for (i = 0; i < njob; i++) {
+    spec_tiles_free(job[i].tiles, job[i].ntile);
+  }
+  free(job);
+  free(s);
+  if (in != NULL) {
+    for (i = 0; i < nin; i++) {
+      samples_free(in[i].s, in[i].ns);
+    }
+  }
+  free(in);
+  for (c = 0; c < SAMPLES_NUM_CHANNEL; c++) {
+    for (q = 0; q < SPEC_MAX_FREQ; q++) {
+      spec_free(&plan[c][q]);
+    }
+  }
+  return ret;
+}
@@ -0,0 +1,515 @@
+/*! @file match2pgcopy.c
+ *  @brief Register matched-filter detections of deep moonquake nests to RDBMS
+ *  @date 2026/10/18
+ *
+ *  A template of every deep_nest and station is stacked from the windows
+ *  of the catalogued events of the nest (events.sql) in the given files,
+ *  or read from a template file of an earlier run. The continuous samples
+ *  of the files are then correlated with all templates of their station
+ *  (matched.h); blocks of the series and groups of templates are
+ *  correlated on a pool of threads. The detections are written as COPY
+ *  data of event_match (trigger.sql), whose first columns are those of
+ *  event.
+ *
+ *  usage: match2pgcopy [-j jobs] [-c channel] [-E events] [-w window] [-p pre] [-m min_stack]
+ *                      [-i templates] [-o templates] [-t threshold] [-T table]
+ *                      {pse|wtn|wth} id filename ...
+ *  example:
+ *    psql -At -F $'\t' -c "SELECT datetime, deep_nest FROM event WHERE deep_nest IS NOT NULL" alsep > nests.tsv
+ *    match2pgcopy -E nests.tsv -o nests.mf pse 1 pse.12.001 ... | psql alsep
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include <getopt.h>
+
+#include "define.h"
+#include "error.h"
+#include "util.h"
+#include "parallel.h"
+#include "samples.h"
+#include "matched.h"
+
+#define DEFAULT_WINDOW 300.0
+#define DEFAULT_PRE 30.0
+#define DEFAULT_THRESHOLD 0.5
+
+//! templates of apollo_station 0 ... 17
+#define MAX_STATION 17
+
+typedef struct tag_file_in {
+  int type;
+  int file_id;
+  const char *filename;
+  samples_series *s;
+  int ns;
+  int error;
+} file_in;
+
+typedef struct tag_load_arg {
+  file_in *in;
+  int channel;
+} load_arg;
+
+//! templates of a station and their spectra
+typedef struct tag_station_plan {
+  int apollo_station;
+  mf_template *t;
+  int nt;
+  mf_plan plan;
+} station_plan;
+
+//! a block of a series against a group of templates
+typedef struct tag_match_job {
+  station_plan *sp;
+  const samples_series *s;
+  int file_id;
+  int64_t block;
+  int t0;
+  int t1;
+  mf_detections d;
+  int error;
+} match_job;
+
+typedef struct tag_match_arg {
+  match_job *job;
+  double threshold;
+} match_arg;
+
+void print_pg_copy_init(const char *table);
+void print_pg_copy(const match_job *job, const mf_detection *d);
+
+void usage(const char* cmd) {
+  fprintf(stderr, "%s [-j jobs] [-c channel] [-E events] [-w window] [-p pre] [-m min_stack] "
+          "[-i templates] [-o templates] [-t threshold] [-T table] "
+          "{pse|wtn|wth} id filename [{pse|wtn|wth} id filename ...]\n", cmd);
+  fprintf(stderr, "  events: \"datetime<TAB>deep_nest\" lines of the event table\n");
+  fprintf(stderr, "  window, pre: template length and start before the event [sec]\n");
+  fprintf(stderr, "  channel: sp_z, lp_x, lp_y, lp_z or lsg (default lp_z)\n");
+}
+
+static int compare_event(const void *a, const void *b) {
+  return strcmp(((const mf_event *)a)->nest, ((const mf_event *)b)->nest);
+}
+
+static int compare_template(const void *a, const void *b) {
+  const mf_template *x = (const mf_template *)a;
+  const mf_template *y = (const mf_template *)b;
+
+  if (x->channel != y->channel) {
+    return x->channel - y->channel;
+  }
+  if (x->apollo_station != y->apollo_station) {
+    return x->apollo_station - y->apollo_station;
+  }
+  return strcmp(x->nest, y->nest);
+}
+
+static void load_job(int i, void *arg) {
+  load_arg *la = (load_arg *)arg;
+  file_in *in = &la->in[i];
+
+  log_printf(LOG_INFO, __FILE__, __LINE__, "processing: %s", in->filename);
+  if (samples_load(in->type, in->filename, la->channel, &in->s, &in->ns) != 0) {
+    in->error = 1;
+  }
+}
+
+/*!
+ * @brief stack the windows of the events of every nest at every station
+ *
+ * @return number of templates, -1 on error
+ */
+static int build_templates(mf_event *ev, int nev, const file_in *in, int nin, int channel,
+                           double window, double pre, int min_stack, mf_template **tp) {
+  double rate = samples_rate(channel);
+  int n = (int)llround(window * rate);
+  int64_t offset = -llround(pre * 1000.0);
+  mf_template *t = NULL, *x;
+  double *sum;
+  int nt = 0, max = 0;
+  int i, j, k, l, st, count;
+
+  sum = (double *)malloc(n * sizeof(double));
+  if (sum == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+    return -1;
+  }
+  qsort(ev, nev, sizeof(mf_event), compare_event);
+
+  for (i = 0; i < nev; i = j) {
+    for (j = i; j < nev && strcmp(ev[i].nest, ev[j].nest) == 0; j++);
+
+    for (st = 0; st <= MAX_STATION; st++) {
+      memset(sum, 0, n * sizeof(double));
+      count = 0;
+      for (k = i; k < j; k++) {
+        int found = 0;
+
+        for (l = 0; l < nin && !found; l++) {
+          const samples_series *s;
+          int m;
+
+          for (m = 0; m < in[l].ns && !found; m++) {
+            int64_t first;
+
+            s = &in[l].s[m];
+            if (s->apollo_station != st) {
+              continue;
+            }
+            first = llround((ev[k].epoch + offset - s->t0) * s->rate / 1000.0);
+            if (first >= 0 && first + n <= s->n) {
+              found = 1;
+              if (mf_stack_add(sum, &s->x[first], n) == 0) {
+                count++;
+              }
+            }
+          }
+        }
+      }
+      if (count < min_stack || count == 0) {
+        continue;
+      }
+
+      if (nt >= max) {
+        max = (max > 0) ? max * 2 : 64;
+        x = (mf_template *)realloc(t, max * sizeof(mf_template));
+        if (x == NULL) {
+          goto build_error;
+        }
+        t = x;
+      }
+      memset(&t[nt], 0, sizeof(mf_template));
+      strcpy(t[nt].nest, ev[i].nest);
+      t[nt].apollo_station = st;
+      t[nt].channel = channel;
+      t[nt].rate = rate;
+      t[nt].offset = offset;
+      if (mf_stack_finish(&t[nt], sum, n, count) != 0) {
+        continue;
+      }
+      log_printf(LOG_INFO, __FILE__, __LINE__,
+                 "template: nest %s station %d (%d events)", ev[i].nest, st, count);
+      nt++;
+    }
+  }
+  free(sum);
+  *tp = t;
+  return nt;
+
+ build_error:
+  log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+  free(sum);
+  mf_template_free(t, nt);
+  return -1;
+}
+
+static void match_job_run(int i, void *arg) {
+  match_arg *ma = (match_arg *)arg;
+  match_job *job = &ma->job[i];
+
+  if (mf_correlate(&job->sp->plan, job->s->x, job->s->n, job->block, job->t0, job->t1,
+                   ma->threshold, &job->d) != 0) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+    job->error = 1;
+  }
+}
+
+/*!
+ * @brief append the detections of a job
+ */
+static int append_detections(mf_detections *d, const mf_detections *x) {
+  mf_detection *t;
+
+  if (d->n + x->n > d->max) {
+    d->max = d->n + x->n;
+    t = (mf_detection *)realloc(d->d, d->max * sizeof(mf_detection));
+    if (t == NULL) {
+      return -1;
+    }
+    d->d = t;
+  }
+  memcpy(&d->d[d->n], x->d, x->n * sizeof(mf_detection));
+  d->n += x->n;
+  return 0;
+}
+
+int main(int argc, char** argv) {
+
+  // ----------------------------------------
+  // Generic variables
+  // ----------------------------------------
+  const char *cmd = argv[0];
+  int i, j, k, lo, hi, nin, nev = 0, nt = 0, njob = 0, maxjob = 0;
+  int ret = EXIT_FAILURE;
+  file_in *in = NULL;
+  mf_event *ev = NULL;
+  mf_template *t = NULL;
+  station_plan sp[MAX_STATION+1];
+  match_job *job = NULL, *x;
+  load_arg la;
+  match_arg ma;
+  mf_detections d;
+  FILE *f;
+
+  // ----------------------------------------
+  // getopt
+  // ----------------------------------------
+  int ch;
+  extern char *optarg;
+  extern int optind, opterr;
+  int jobs = 0;
+  int channel = SAMPLES_LP_Z;
+  const char *events = NULL;
+  const char *template_in = NULL;
+  const char *template_out = NULL;
+  double window = DEFAULT_WINDOW;
+  double pre = DEFAULT_PRE;
+  double threshold = DEFAULT_THRESHOLD;
+  int min_stack = 1;
+  const char *table = "event_match";
+
+  while ((ch = getopt(argc, argv, "j:c:E:w:p:m:i:o:t:T:")) != -1) {
+    switch(ch) {
+    case 'j':
+      jobs = atoi(optarg);
+      break;
+    case 'c':
+      channel = samples_channel(optarg);
+      if (channel < 0) {
+        log_printf(LOG_ERROR, __FILE__, __LINE__, "unknown channel: %s", optarg);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'E':
+      events = optarg;
+      break;
+    case 'w':
+      window = atof(optarg);
+      break;
+    case 'p':
+      pre = atof(optarg);
+      break;
+    case 'm':
+      min_stack = atoi(optarg);
+      break;
+    case 'i':
+      template_in = optarg;
+      break;
+    case 'o':
+      template_out = optarg;
+      break;
+    case 't':
+      threshold = atof(optarg);
+      break;
+    case 'T':
+      table = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  argc -= optind;
+  if (argc < 3 || argc % 3 != 0 || (events == NULL) == (template_in == NULL) ||
+      window * samples_rate(channel) < 2.0) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  argv += optind;
+
+  // ----------------------------------------
+  // PROGRAM MAIN
+  // ----------------------------------------
+  nin = argc / 3;
+  in = (file_in *)calloc(nin, sizeof(file_in));
+  memset(&d, 0, sizeof(d));
+  memset(sp, 0, sizeof(sp));
+  if (in == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+    return EXIT_FAILURE;
+  }
+  for (i = 0; i < nin; i++) {
+    in[i].type = samples_type(argv[3*i]);
+    in[i].file_id = atoi(argv[3*i+1]);
+    in[i].filename = argv[3*i+2];
+    if (in[i].type < 0) {
+      usage(cmd);
+      goto main_finish;
+    }
+  }
+
+  la.in = in;
+  la.channel = channel;
+  parallel_for(nin, jobs, load_job, &la);
+  for (i = 0; i < nin; i++) {
+    if (in[i].error) {
+      goto main_finish;
+    }
+  }
+
+  // templates
+  if (events != NULL) {
+    if (mf_event_read(events, &ev, &nev) != 0) {
+      goto main_finish;
+    }
+    nt = build_templates(ev, nev, in, nin, channel, window, pre, min_stack, &t);
+    if (nt < 0) {
+      nt = 0;
+      goto main_finish;
+    }
+  } else {
+    f = fopen(template_in, "rb");
+    if (f == NULL || mf_template_read(f, &t, &nt) != 0) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "invalid template file: %s", template_in);
+      if (f != NULL) {
+        fclose(f);
+      }
+      goto main_finish;
+    }
+    fclose(f);
+  }
+  if (template_out != NULL) {
+    f = fopen(template_out, "wb");
+    if (f == NULL || mf_template_write(f, t, nt) != 0) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot write: %s", template_out);
+      if (f != NULL) {
+        fclose(f);
+      }
+      goto main_finish;
+    }
+    fclose(f);
+  }
+  log_printf(LOG_INFO, __FILE__, __LINE__, "templates: %d", nt);
+
+  // templates of the channel sorted by station, one plan per station
+  qsort(t, nt, sizeof(mf_template), compare_template);
+  for (lo = 0; lo < nt && t[lo].channel != channel; lo++);
+  for (hi = lo; hi < nt && t[hi].channel == channel; hi++);
+  if (hi - lo < nt) {
+    log_printf(LOG_WARNING, __FILE__, __LINE__, "templates of other channels: %d", nt - (hi - lo));
+  }
+  for (i = lo; i < hi; i = j) {
+    station_plan *p;
+
+    for (j = i; j < hi && t[j].apollo_station == t[i].apollo_station; j++);
+    if (t[i].apollo_station < 0 || t[i].apollo_station > MAX_STATION) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "invalid station of templates: %d", t[i].apollo_station);
+      goto main_finish;
+    }
+    p = &sp[t[i].apollo_station];
+    p->apollo_station = t[i].apollo_station;
+    p->t = &t[i];
+    p->nt = j - i;
+    if (mf_init(&p->plan, &t[i], j - i) != 0) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+      goto main_finish;
+    }
+  }
+
+  // blocks of every series against groups of the templates of its station
+  for (i = 0; i < nin; i++) {
+    for (j = 0; j < in[i].ns; j++) {
+      const samples_series *s = &in[i].s[j];
+      station_plan *p = &sp[s->apollo_station];
+      int64_t b;
+      int g;
+
+      if (p->nt == 0) {
+        continue;
+      }
+      for (b = 0; b < mf_blocks(&p->plan, s->n); b++) {
+        for (g = 0; g < p->nt; g += MF_TEMPLATE_GROUP) {
+          if (njob >= maxjob) {
+            maxjob = (maxjob > 0) ? maxjob * 2 : 1024;
+            x = (match_job *)realloc(job, maxjob * sizeof(match_job));
+            if (x == NULL) {
+              log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+              goto main_finish;
+            }
+            job = x;
+          }
+          memset(&job[njob], 0, sizeof(match_job));
+          job[njob].sp = p;
+          job[njob].s = s;
+          job[njob].file_id = in[i].file_id;
+          job[njob].block = b;
+          job[njob].t0 = g;
+          job[njob].t1 = (g + MF_TEMPLATE_GROUP < p->nt) ? g + MF_TEMPLATE_GROUP : p->nt;
+          njob++;
+        }
+      }
+    }
+  }
+
+  ma.job = job;
+  ma.threshold = threshold;
+  parallel_for(njob, jobs, match_job_run, &ma);
+
+  // the detections of a series are declustered together
+  print_pg_copy_init(table);
+  for (i = 0; i < njob; i = j) {
+    d.n = 0;
+    for (j = i; j < njob && job[j].s == job[i].s; j++) {
+      if (job[j].error || append_detections(&d, &job[j].d) != 0) {
+        log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+        goto main_finish;
+      }
+    }
+    mf_decluster(&d, &job[i].sp->plan);
+    for (k = 0; k < d.n; k++) {
+      print_pg_copy(&job[i], &d.d[k]);
+    }
+  }
+  printf("\\.\n");
+  ret = EXIT_SUCCESS;
+
+ main_finish:
+  for (i = 0; i < njob; i++) {
+    free(job[i].d.d);
+  }
+  free(job);
+  free(d.d);
+  for (i = 0; i <= MAX_STATION; i++) {
+    if (sp[i].nt > 0) {
+      mf_free(&sp[i].plan);
+    }
+  }
+  if (t != NULL) {
+    mf_template_free(t, nt);
+  }
+  free(ev);
+  for (i = 0; i < nin; i++) {
+    samples_free(in[i].s, in[i].ns);
+  }
+  free(in);
+  return ret;
+}
+
+void print_pg_copy_init(const char *table) {
+  printf("COPY %s ("
+         "datetime, type, deep_nest, comments, ap_station, channel, cc, nstack, file_id"
+         ") FROM stdin;\n", table);
+}
+
+void print_pg_copy(const match_job *job, const mf_detection *d) {
+  const mf_template *t = &job->sp->plan.t[d->t];
+  char time[SIZE_TIME_STRING];
+  int64_t epoch;
+
+  // the event time is the time of the template start less its offset
+  epoch = job->s->t0 + llround(d->index * 1000.0 / job->s->rate) - t->offset;
+  epoch_to_date_string(epoch, time);
+
+  printf("%s\tDeep Moonquake\t%s\tmatched filter\t%d\t%s\t%.3f\t%d\t%d\n",
+         time,
+         t->nest,
+         t->apollo_station,
+         samples_channel_name(t->channel),
+         d->cc,
+         t->nstack,
+         job->file_id);
+}
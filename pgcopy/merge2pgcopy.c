@@ -0,0 +1,417 @@
+/*! @file merge2pgcopy.c
+ *  @brief Register PSE and WTN raw data of the same stations to RDBMS without duplicates
+ *  @date 2026/10/18
+ *
+ *  In 1976-1977 a station is recorded both on its PSE tapes and on the
+ *  normal bit rate work tapes. The files are decoded as streams and merged
+ *  in time order; of the frames of a station which overlap within the
+ *  tolerance only the one with the fewest errors is registered.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <string.h>
+#include <inttypes.h>
+#include <getopt.h>
+
+#include "define.h"
+#include "pse.h"
+#include "wtn.h"
+#include "error.h"
+#include "util.h"
+#include "clock.h"
+#include "pse_reader.h"
+#include "wtn_demux.h"
+#include "merge.h"
+
+typedef struct tag_pse_source {
+  pse_reader rd;
+  clock_model clock;
+  int file_id;
+
+  //! next frame of rd.pf
+  int i;
+} pse_source;
+
+typedef struct tag_wtn_source {
+  FILE *f;
+  wtn_record wnr;
+  wtn_demux demux;
+  clock_model clock[WTN_DEMUX_STREAMS];
+  int file_id;
+  int num_header;
+
+  //! frames read so far
+  int n;
+
+  //! a short last frame keeps the rest of the frame before it
+  unsigned char frame[SIZE_FRAME];
+} wtn_source;
+
+typedef struct tag_source {
+  pse_source *pse;
+  wtn_source *wtn;
+} source;
+
+void print_pg_copy_init(const char *table);
+void print_pg_copy(merge_frame *mf);
+
+void usage(const char* cmd) {
+  fprintf(stderr, "%s [-t tolerance] [-T table] {pse|wtn} id filename [{pse|wtn} id filename ...]\n", cmd);
+}
+
+static int pse_source_next(void *arg, merge_frame *mf) {
+  pse_source *ps = (pse_source *)arg;
+  pse_frame *pf;
+  int r;
+
+  while (ps->i >= ps->rd.nframe) {
+    ps->i = 0;
+    r = pse_reader_next(&ps->rd);
+    if (r == 0 || (r < 0 && feof(ps->rd.f))) {
+      ps->rd.nframe = 0;
+      return 0;
+    }
+    if (r < 0) {
+      ps->rd.nframe = 0;
+    }
+  }
+
+  pf = &ps->rd.pf[ps->i];
+  pf->msec_of_year_corrected = clock_correct(&ps->clock, pf->msec_of_year, pf->frame_count,
+                                             pf->error_flag, &pf->time_flag);
+  if (pf->error_flag >= 0x0100) {
+    log_printf(LOG_WARNING, __FILE__, __LINE__,
+               "frame error: code=0x%04x file_id=%d offset=%ld msec_of_year=%"PRId64,
+               pf->error_flag, ps->file_id, pse_reader_frame_offset(&ps->rd, ps->i),
+               pf->msec_of_year);
+  }
+
+  mf->apollo_station = ps->rd.pr.apollo_station;
+  mf->year = ps->rd.pr.year;
+  mf->format = ps->rd.pr.format;
+  mf->file_id = ps->file_id;
+  mf->pos = pse_reader_frame_offset(&ps->rd, ps->i);
+  mf->len = ps->rd.size_part;
+  mf->pf = *pf;
+  ps->i++;
+  return 1;
+}
+
+/*!
+ * @brief the columns of tbl_pse of a WTN frame
+ */
+static void wtn2pse_frame(const wtn_frame *wnf, pse_frame *pf) {
+  memset(pf, 0, sizeof(pse_frame));
+  pf->msec_of_year = wnf->msec_of_year;
+  pf->alsep_tracking_station_id = wnf->alsep_tracking_station_id;
+  pf->sync_code = wnf->sync_code;
+  pf->sync_code_comp = wnf->sync_code_comp;
+  pf->frame_count = wnf->frame_count;
+  pf->mode_bit = wnf->mode_bit;
+  memcpy(pf->spz, wnf->spz, sizeof(pf->spz));
+  memcpy(pf->lpx, wnf->lpx, sizeof(pf->lpx));
+  memcpy(pf->lpy, wnf->lpy, sizeof(pf->lpy));
+  memcpy(pf->lpz, wnf->lpz, sizeof(pf->lpz));
+  pf->TidX = wnf->TidX;
+  pf->TidY = wnf->TidY;
+  pf->TidZ = wnf->TidZ;
+  pf->InstT = wnf->InstT;
+  pf->hk = wnf->hk;
+  pf->cv = wnf->cv;
+  pf->time_diff = wnf->time_diff;
+  pf->process_flag = wnf->process_flag;
+  pf->error_flag = wnf->error_flag;
+  pf->prev_frame = wnf->prev_frame;
+  pf->msec_of_year_corrected = wnf->msec_of_year_corrected;
+  pf->time_flag = wnf->time_flag;
+}
+
+static int wtn_source_next(void *arg, merge_frame *mf) {
+  wtn_source *ws = (wtn_source *)arg;
+  wtn_frame wnf;
+  long offset;
+  size_t r;
+  int station;
+
+  for (;;) {
+    r = fread(ws->frame, sizeof(unsigned char), SIZE_FRAME, ws->f);
+    if (r == 0) {
+      return 0;
+    }
+    offset = SIZE_HEADER * ws->num_header + (long)SIZE_FRAME * ws->n;
+
+    binary2wtn_frames(ws->wnr, ws->frame, &wnf, 1);
+    wtn_demux_link(&ws->demux, &wnf);
+    if (ws->n < (int)ws->wnr.num_asta) {
+      wnf.process_flag |= FLAG_TOP_OF_RECORD | ((ws->n == 0) ? FLAG_FIRST_DATA_OF_FILE : 0);
+    }
+    ws->n++;
+    check_wtn_frames(&wnf, 1, ws->wnr.year);
+    wnf.msec_of_year_corrected =
+      clock_correct(&ws->clock[wtn_demux_stream(wnf.alsep_package_id)], wnf.msec_of_year, wnf.frame_count,
+                    wnf.error_flag, &wnf.time_flag);
+    if (wnf.error_flag >= 0x0100) {
+      log_printf(LOG_WARNING, __FILE__, __LINE__,
+                 "frame error: error code=0x%04x file_id=%d offset=%ld msec_of_year=%"PRId64,
+                 wnf.error_flag, ws->file_id, offset, wnf.msec_of_year);
+    }
+
+    // LSG frames of Apollo 17 are not in tbl_pse
+    station = package_id2station_id(wnf.alsep_package_id);
+    if (station < 0 || station == 17) {
+      continue;
+    }
+
+    mf->apollo_station = station;
+    mf->year = ws->wnr.year;
+    mf->format = FORMAT_OLD;
+    mf->file_id = ws->file_id;
+    mf->pos = offset;
+    mf->len = SIZE_FRAME;
+    wtn2pse_frame(&wnf, &mf->pf);
+    return 1;
+  }
+}
+
+/*!
+ * @brief open a WTN file and read its header
+ */
+static int wtn_source_open(wtn_source *ws, const char *filename, int file_id) {
+  unsigned char record[SIZE_HEADER];
+  unsigned char header[SIZE_HEADER];
+  int i;
+
+  memset(ws, 0, sizeof(wtn_source));
+  ws->file_id = file_id;
+  ws->num_header = 2;
+  ws->f = fopen(filename, "rb");
+  if (ws->f == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "no such file: %s", filename);
+    return -1;
+  }
+
+  if (fread(record, sizeof(unsigned char), SIZE_HEADER, ws->f) != SIZE_HEADER ||
+      fread(header, sizeof(unsigned char), SIZE_HEADER, ws->f) != SIZE_HEADER) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "invalid data size: %s", filename);
+    return -1;
+  }
+  ws->wnr = binary2wtn_record(record);
+  ws->wnr.error_flag = check_wtn_record(ws->wnr);
+
+  // check duplicated header
+  if (memcmp(record, header, SIZE_HEADER) != 0) {
+    log_printf(LOG_WARNING, __FILE__, __LINE__, "header is not duplicated.");
+    fseek(ws->f, -SIZE_HEADER, SEEK_CUR);
+    ws->num_header = 1;
+  }
+
+  wtn_demux_init(&ws->demux);
+  for (i = 0; i < WTN_DEMUX_STREAMS; i++) {
+    clock_init(&ws->clock[i], VALID_FRAME_RATE, SIZE_LOGICAL_RECORD);
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+
+  // ----------------------------------------
+  // Generic variables
+  // ----------------------------------------
+  const char *cmd = argv[0];
+  int i, nsource = 0;
+  int ret = EXIT_FAILURE;
+  source *src = NULL;
+  merge_source *ms = NULL;
+  merger m;
+  merge_frame mf;
+  int merging = 0;
+
+  // ----------------------------------------
+  // getopt
+  // ----------------------------------------
+  int ch;
+  extern char *optarg;
+  extern int optind, opterr;
+  int64_t tolerance = MERGE_TOLERANCE;
+  const char *table = "tbl_pse";
+
+  while ((ch = getopt(argc, argv, "t:T:")) != -1) {
+    switch(ch) {
+    case 't':
+      tolerance = atoi(optarg);
+      break;
+    case 'T':
+      table = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  argc -= optind;
+  if (argc < 3 || argc % 3 != 0){
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  argv += optind;
+
+  // ----------------------------------------
+  // PROGRAM MAIN
+  // ----------------------------------------
+  nsource = argc / 3;
+  src = (source *)calloc(nsource, sizeof(source));
+  ms = (merge_source *)calloc(nsource, sizeof(merge_source));
+  if (src == NULL || ms == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+    goto main_finish;
+  }
+
+  for (i = 0; i < nsource; i++) {
+    const char *type = argv[3*i];
+    int file_id = atoi(argv[3*i+1]);
+    const char *filename = argv[3*i+2];
+
+    log_printf(LOG_INFO, __FILE__, __LINE__, "processing: %s", filename);
+    if (strcmp(type, "pse") == 0) {
+      src[i].pse = (pse_source *)calloc(1, sizeof(pse_source));
+      if (src[i].pse == NULL) {
+        log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+        goto main_finish;
+      }
+      if (pse_reader_open(&src[i].pse->rd, filename, -1) < 0) {
+        goto main_finish;
+      }
+      src[i].pse->file_id = file_id;
+      clock_init(&src[i].pse->clock, VALID_FRAME_RATE, SIZE_LOGICAL_RECORD);
+      ms[i].next = pse_source_next;
+      ms[i].arg = src[i].pse;
+    } else if (strcmp(type, "wtn") == 0) {
+      src[i].wtn = (wtn_source *)calloc(1, sizeof(wtn_source));
+      if (src[i].wtn == NULL) {
+        log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+        goto main_finish;
+      }
+      if (wtn_source_open(src[i].wtn, filename, file_id) < 0) {
+        goto main_finish;
+      }
+      ms[i].next = wtn_source_next;
+      ms[i].arg = src[i].wtn;
+    } else {
+      usage(cmd);
+      goto main_finish;
+    }
+  }
+
+  if (merge_init(&m, ms, nsource, tolerance) < 0) {
+    goto main_finish;
+  }
+  merging = 1;
+
+  print_pg_copy_init(table);
+  while (merge_next(&m, &mf) == 1) {
+    print_pg_copy(&mf);
+  }
+  printf("\\.\n");
+
+  log_printf(LOG_INFO, __FILE__, __LINE__,
+             "duplicated frames: %"PRIu64, m.nduplicate);
+  ret = EXIT_SUCCESS;
+
+ main_finish:
+  if (merging) {
+    merge_free(&m);
+  }
+  for (i = 0; src && i < nsource; i++) {
+    if (src[i].pse) {
+      pse_reader_close(&src[i].pse->rd);
+      free(src[i].pse);
+    }
+    if (src[i].wtn) {
+      if (src[i].wtn->f) {
+        fclose(src[i].wtn->f);
+      }
+      free(src[i].wtn);
+    }
+  }
+  free(src);
+  free(ms);
+
+  putchar('\n');
+  return ret;
+}
+
+void print_pg_copy_init(const char *table) {
+  printf("COPY %s ("
+	 "file_id, pos, length, frame_count, ap_station, ground_station,"
+	 "time_original, \"time\", time_diff, sp_z, lp_x, lp_y, lp_z,"
+	 "tidal_x, tidal_y, tidal_z, inst_temp, process_flag, error_flag, time_flag"
+	 ") FROM stdin;\n", table);
+}
+
+void print_pg_copy(merge_frame *mf) {
+
+  pse_frame *pf = &mf->pf;
+  char time_org[SIZE_TIME_STRING];
+  char time[SIZE_TIME_STRING];
+  uint32_t doy, hh, mm, ss, ms;
+  char sql_spz[SIZE_SQL];
+  char sql_lpx[SIZE_SQL], sql_lpy[SIZE_SQL], sql_lpz[SIZE_SQL];
+
+  msec_of_year_to_date(pf->msec_of_year, &doy, &hh, &mm, &ss, &ms);
+
+  if (doy >= 1 && doy <= 366) {
+    sprintf(time_org,"%04d.%03d %02d:%02d:%02d.%03d", mf->year, doy, hh,mm,ss,ms);
+  } else {
+    sprintf(time_org,"\\N");
+  }
+
+  msec_of_year_to_date(pf->msec_of_year_corrected, &doy, &hh, &mm, &ss, &ms);
+
+  if (doy >= 1 && doy <= 366) {
+    sprintf(time,"%04d.%03d %02d:%02d:%02d.%03d", mf->year, doy, hh,mm,ss,ms);
+  } else {
+    sprintf(time,"\\N");
+  }
+
+  printf(
+	 "%d\t"
+	 "%ld\t"
+	 "%d\t"
+	 "%d\t"
+	 "%d\t"
+	 "%d\t"
+	 "%s\t"
+	 "%s\t"
+	 "%"PRId64"\t"
+	 "{%s}\t"
+	 "{%s}\t"
+	 "{%s}\t"
+	 "{%s}\t"
+	 "%d\t"
+	 "%d\t"
+	 "%d\t"
+	 "%d\t"
+	 "%d\t"
+	 "%d\t"
+	 "%d\n",
+	 mf->file_id,
+	 mf->pos,
+	 mf->len,
+	 pf->frame_count,
+	 mf->apollo_station,
+	 pf->alsep_tracking_station_id,
+	 time_org,
+	 time,
+	 pf->time_diff,
+	 (mf->format == FORMAT_OLD) ? intary2str(pf->spz,COUNTS_PER_FRAME_FOR_PSE_SP,sql_spz,SIZE_SQL) : "",
+	 intary2str(pf->lpx,COUNTS_PER_FRAME_FOR_PSE_LP,sql_lpx,SIZE_SQL),
+	 intary2str(pf->lpy,COUNTS_PER_FRAME_FOR_PSE_LP,sql_lpy,SIZE_SQL),
+	 intary2str(pf->lpz,COUNTS_PER_FRAME_FOR_PSE_LP,sql_lpz,SIZE_SQL),
+	 pf->TidX, pf->TidY, pf->TidZ, pf->InstT,
+	 pf->process_flag,
+	 pf->error_flag,
+	 pf->time_flag);
+}
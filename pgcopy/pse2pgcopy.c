@@ -17,16 +17,18 @@
 #include "pse.h"
 #include "error.h"
 #include "util.h"
-
-#define SET_ARG(var,n,size) {strncpy(var, argv[n], size); var[size] = '\0';}
+#include "clock.h"
+#include "pse_reader.h"
+#include "despike.h"
 
 void print_sql(int id, int offset, int len, pse_record pr, pse_frame pf);
 
-void print_pg_copy_init();
+void print_pg_copy_init(const char *table);
 void print_pg_copy(int id, int offset, int len, pse_record pr, pse_frame pf);
 
 void usage(const char* cmd) {
-  fprintf(stderr, "%s [-y year] id filename\n", cmd);
+  fprintf(stderr, "%s [-s] [-y year] [-T table] id filename\n", cmd);
+  fprintf(stderr, "  -s  replace spikes of spz, lpx, lpy and lpz by the running median\n");
 }
 
 int main(int argc, char** argv) {
@@ -35,17 +37,9 @@ int main(int argc, char** argv) {
   // Generic variables
   // ----------------------------------------
   int id;
-  FILE *f;
-  size_t r;
   char filename[PATH_MAX+1];
-  uint32_t process_flag;
-  int size_part;
-  int i;
-  long rec_offset, frame_offset;
-  
-  //initial value of Frame time error at last frame in one record
-  uint64_t msec_of_year_fmax = 0;
-  int32_t prev_frame = -1;
+  int i, nframe;
+  long frame_offset;
 
   // ----------------------------------------
   // getopt
@@ -54,19 +48,28 @@ int main(int argc, char** argv) {
   extern char *optarg;
   extern int optind, opterr;
   int year_override = -1;
+  const char *table = "tbl_pse";
+  int despiking = 0;
   
   // ----------------------------------------
   // Apollo related variables
   // ----------------------------------------
-  unsigned char record[SIZE_RECORD];
-  pse_record pr;
-  pse_frame pf[MAX_PSE_FRAME+1];
+  pse_reader rd;
+  pse_frame *pf = rd.pf;
+  clock_model clock;
+  despike_set ds;
 
-  while ((ch = getopt(argc, argv, "y:")) != -1) {
+  while ((ch = getopt(argc, argv, "sy:T:")) != -1) {
     switch(ch) {
+    case 's':
+      despiking = 1;
+      break;
     case 'y':
       year_override = atoi(optarg);
       break;
+    case 'T':
+      table = optarg;
+      break;
     default:
       usage(argv[0]);
       break;
@@ -85,10 +88,7 @@ int main(int argc, char** argv) {
   id = atoi(argv[0]);
   SET_ARG(filename,1,PATH_MAX);
   
-  f=fopen(filename, "rb");
-  if(f==NULL) {
-    log_printf(LOG_ERROR, __FILE__, __LINE__,
-	       "no such file: %s", filename);
+  if (pse_reader_open(&rd, filename, year_override) != 0) {
     return -1;
   }
   
@@ -97,91 +97,39 @@ int main(int argc, char** argv) {
   // ----------------------------------------
   // Frame registration
   // ----------------------------------------
-  process_flag = FLAG_FIRST_DATA_OF_FILE;
-  rec_offset = ftell(f);
-  while ((r=fread(record, sizeof(unsigned char), SIZE_RECORD, f))>0) {
-    if (r != SIZE_RECORD) {
-      log_printf(LOG_ERROR, __FILE__, __LINE__,
-                 "invalid data size: %zd", r);
-      goto main_finish;
-    }
-    
-    pr = binary2pse_record(record);
-    if (year_override != -1) {
-      pr.year = year_override;
+  clock_init(&clock, VALID_FRAME_RATE, SIZE_LOGICAL_RECORD);
+  despike_set_init(&ds);
+  while ((nframe = pse_reader_next(&rd)) > 0) {
+    for (i = 0; i < nframe; i++) {
+      pf[i].msec_of_year_corrected = clock_correct(&clock, pf[i].msec_of_year, pf[i].frame_count,
+                                                   pf[i].error_flag, &pf[i].time_flag);
     }
-
-    pr.error_flag = check_pse_record(pr);
-
-    if (pr.format == FORMAT_OLD) {
-      size_part = SIZE_DATA_PART_OLD;
-    } else {
-      size_part = SIZE_DATA_PART_NEW;
+    if (despiking && despike_pse_frames(&ds, pf, nframe, rd.pr.format) < 0) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__,
+		 "cannot allocate memory");
+      break;
     }
 
-    // register first frame into database
-    frame_offset = SIZE_PSE_HEADER;
-    pf[0] = binary2pse_frame(pr,&record[frame_offset]);
-    pf[0].spz[0] = pf[0].spz[1];
-    pf[0].time_diff = pf[0].msec_of_year - msec_of_year_fmax;
-    pf[0].prev_frame = prev_frame;
-    pf[0].process_flag = process_flag | FLAG_TOP_OF_RECORD | FLAG_FIRST_DATA_COPIED;
-    pf[0].error_flag = check_pse_frame(pf[0], pr.apollo_station, pr.year);
-    if (pf[0].error_flag >= 0x0100) {
-	log_printf(LOG_WARNING, __FILE__, __LINE__,
-		   "frame error: code=0x%04x %s offset=%d msec_of_year=%"PRId64,
-                   pf[i].error_flag,
-                   filename,
-		   frame_offset,
-                   pf[i].msec_of_year);      
-    }
-      
-    print_pg_copy_init();    
-    print_pg_copy(id, rec_offset+frame_offset, size_part, pr,pf[0]);
-    
-    // register remnant frames into database
-    for(i = 1; i < (SIZE_LOGICAL_RECORD * pr.phys_records);i++) {
-      frame_offset = SIZE_PSE_HEADER+size_part*i;
-      unsigned char* frame = &record[frame_offset];
-      pf[i] = binary2pse_frame(pr,frame);
-      pf[i].time_diff = pf[i].msec_of_year - pf[i-1].msec_of_year;      
-      pf[i].prev_frame = pf[i-1].frame_count;
-      pf[i].process_flag = 0;
-      pf[i].error_flag = check_pse_frame(pf[i], pr.apollo_station, pr.year);
+    print_pg_copy_init(table);    
+    for(i = 0; i < nframe;i++) {
+      frame_offset = pse_reader_frame_offset(&rd, i);
 
       if (pf[i].error_flag >= 0x0100) {
 	  log_printf(LOG_WARNING, __FILE__, __LINE__,
-		     "frame error: code=0x%04x %s offset=%d msec_of_year=%"PRId64,
+		     "frame error: code=0x%04x %s offset=%ld msec_of_year=%"PRId64,
 		     pf[i].error_flag,
                      filename,
-		     frame_offset,
+		     frame_offset - rd.rec_offset,
 		     pf[i].msec_of_year);      
       }
-      
-      if (pf[i].error_flag == ERROR_NONE) {
-	//! ALSEP WORD 2
-	pf[i].spz[0] = interp(
-			      pf[i-1].spz[30],
-			      pf[i-1].spz[31],
-			      pf[i  ].spz[ 1],
-			      pf[i  ].spz[ 2]);
-      } else {
-	pf[i].spz[0] = pf[i].spz[1];
-	pf[i].process_flag |= FLAG_FIRST_DATA_COPIED;
-      }
 
-      print_pg_copy(id, rec_offset+frame_offset, size_part, pr,pf[i]);
+      print_pg_copy(id, frame_offset, rd.size_part, rd.pr, pf[i]);
     }
-    msec_of_year_fmax = pf[i-1].msec_of_year;
-    prev_frame = pf[i-1].frame_count;
-    rec_offset = ftell(f);
     printf("\\.\n");
   }
 
-main_finish:
-  if (f) {
-    fclose(f);
-  }
+  despike_set_free(&ds);
+  pse_reader_close(&rd);
   
   putchar('\n');
   
@@ -260,12 +208,12 @@ void print_sql(int id, int offset, int len, pse_record pr, pse_frame pf) {
 	 0);
 }
 
-void print_pg_copy_init() {
-  printf("COPY tbl_pse ("
+void print_pg_copy_init(const char *table) {
+  printf("COPY %s ("
 	 "file_id, pos, length, frame_count, ap_station, ground_station,"
 	 "time_original, \"time\", time_diff, sp_z, lp_x, lp_y, lp_z,"
 	 "tidal_x, tidal_y, tidal_z, inst_temp, process_flag, error_flag, time_flag"
-	 ") FROM stdin;\n");
+	 ") FROM stdin;\n", table);
 }
 
 void print_pg_copy(int id, int offset, int len, pse_record pr, pse_frame pf) {
@@ -278,12 +226,19 @@ void print_pg_copy(int id, int offset, int len, pse_record pr, pse_frame pf) {
   
   msec_of_year_to_date(pf.msec_of_year, &doy, &hh, &mm, &ss, &ms);
   
+  if (doy >= 1 && doy <= 366) {
+    sprintf(time_org,"%04d.%03d %02d:%02d:%02d.%03d", pr.year, doy, hh,mm,ss,ms);
+  } else {
+    sprintf(time_org,"\\N");
+  }
+
+  msec_of_year_to_date(pf.msec_of_year_corrected, &doy, &hh, &mm, &ss, &ms);
+  
   if (doy >= 1 && doy <= 366) {
     sprintf(time,"%04d.%03d %02d:%02d:%02d.%03d", pr.year, doy, hh,mm,ss,ms);
   } else {
     sprintf(time,"\\N");
   }
-  strcpy(time_org, time);
   
   printf(
 	 "%d\t"
@@ -313,7 +268,7 @@ void print_pg_copy(int id, int offset, int len, pse_record pr, pse_frame pf) {
 	 pr.apollo_station,
 	 pf.alsep_tracking_station_id,
 	 time_org,
-	 time_org,
+	 time,
 	 pf.time_diff,
 	 (pr.format == FORMAT_OLD) ? intary2str(pf.spz,COUNTS_PER_FRAME_FOR_PSE_SP,sql_spz,SIZE_SQL) : "",
 	 intary2str(pf.lpx,COUNTS_PER_FRAME_FOR_PSE_LP,sql_lpx,SIZE_SQL),
@@ -322,5 +277,5 @@ void print_pg_copy(int id, int offset, int len, pse_record pr, pse_frame pf) {
 	 pf.TidX, pf.TidY, pf.TidZ, pf.InstT,
 	 pf.process_flag,
 	 pf.error_flag,
-	 0);
+	 pf.time_flag);
 }
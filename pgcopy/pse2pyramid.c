@@ -0,0 +1,266 @@
+/*! @file pse2pyramid.c
+ *  @brief Register min/max pyramid tiles of PSE raw data to RDBMS
+ *  @date 2026/10/18
+ *
+ *  Every channel of tbl_pse is reduced to min/max/sum/count tiles of 2^k
+ *  samples (k = min_level ... max_level) aligned to an absolute sample
+ *  grid, and written as COPY data of tbl_pyramid (pyramid.sql).
+ *
+ *  usage: pse2pyramid [-y year] [-l min_level] [-L max_level] [-c channels] id filename
+ *  example:
+ *    sed -e 's/pse2pgcopy/pse2pyramid/' register_pse.sh | sh | psql alsep
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include <getopt.h>
+
+#include "define.h"
+#include "pse.h"
+#include "error.h"
+#include "util.h"
+#include "pse_reader.h"
+#include "pyramid.h"
+
+#define DEFAULT_MIN_LEVEL 8
+#define DEFAULT_MAX_LEVEL 24
+
+//! frames with one of these errors are left out (as warned by pse2pgcopy)
+#define ERROR_MASK_PYRAMID 0xff00
+
+//! ALSEP word rate: 64 words/frame, 1060 bps, 10 bits/word
+#define FRAMES_PER_SEC (1060.0 / 640.0)
+
+#define NUM_CHANNEL 8
+
+typedef struct tag_channel {
+  const char *name;
+  int count_per_frame;
+
+  //! frame_count % 2 of the frames holding the channel (-1 for every frame)
+  int parity;
+  int enabled;
+  double rate;
+  pyramid p;
+} channel;
+
+typedef struct tag_emit_arg {
+  int id;
+  int apollo_station;
+  channel *ch;
+} emit_arg;
+
+//! rate and p are set in main()
+static channel channels[NUM_CHANNEL] = {
+  {.name = "sp_z", .count_per_frame = COUNTS_PER_FRAME_FOR_PSE_SP, .parity = -1, .enabled = 1},
+  {.name = "lp_x", .count_per_frame = COUNTS_PER_FRAME_FOR_PSE_LP, .parity = -1, .enabled = 1},
+  {.name = "lp_y", .count_per_frame = COUNTS_PER_FRAME_FOR_PSE_LP, .parity = -1, .enabled = 1},
+  {.name = "lp_z", .count_per_frame = COUNTS_PER_FRAME_FOR_PSE_LP, .parity = -1, .enabled = 1},
+  {.name = "tidal_x", .count_per_frame = 1, .parity = 0, .enabled = 1},
+  {.name = "tidal_y", .count_per_frame = 1, .parity = 0, .enabled = 1},
+  {.name = "tidal_z", .count_per_frame = 1, .parity = 1, .enabled = 1},
+  {.name = "inst_temp", .count_per_frame = 1, .parity = 1, .enabled = 1},
+};
+
+static emit_arg emit_args[NUM_CHANNEL];
+
+static pse_reader rd;
+
+void usage(const char* cmd) {
+  fprintf(stderr, "%s [-y year] [-l min_level] [-L max_level] [-c channels] id filename\n", cmd);
+  fprintf(stderr, "  channels: comma separated list of sp_z,lp_x,lp_y,lp_z,tidal_x,tidal_y,tidal_z,inst_temp\n");
+}
+
+/*!
+ * @brief enable only the channels of a comma separated list
+ *
+ * @return 0 on success, -1 for an unknown channel
+ */
+static int select_channels(char *list) {
+  char *name;
+  int i, found;
+
+  for (i = 0; i < NUM_CHANNEL; i++) {
+    channels[i].enabled = 0;
+  }
+  for (name = strtok(list, ","); name != NULL; name = strtok(NULL, ",")) {
+    found = 0;
+    for (i = 0; i < NUM_CHANNEL; i++) {
+      if (strcmp(name, channels[i].name) == 0) {
+        channels[i].enabled = 1;
+        found = 1;
+      }
+    }
+    if (!found) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "unknown channel: %s", name);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static const int32_t *channel_data(const pse_frame *pf, int i) {
+  switch (i) {
+  case 0: return pf->spz;
+  case 1: return pf->lpx;
+  case 2: return pf->lpy;
+  case 3: return pf->lpz;
+  case 4: return &pf->TidX;
+  case 5: return &pf->TidY;
+  case 6: return &pf->TidZ;
+  default: return &pf->InstT;
+  }
+}
+
+void print_pg_copy_init() {
+  printf("COPY tbl_pyramid ("
+         "file_id, ap_station, channel, level, \"time\", min, max, sum, count"
+         ") FROM stdin;\n");
+}
+
+/*!
+ * @brief print a completed tile as a COPY line, time is the start of the tile
+ */
+void print_pg_copy(int level, const pyramid_bin *bin, void *arg) {
+  const emit_arg *ea = (const emit_arg *)arg;
+  double start = ldexp((double)bin->index, level) / ea->ch->rate;
+  int64_t usec = (int64_t)llround(start * 1.0e6);
+  int64_t sec = (usec >= 0) ? usec / 1000000 : -((-usec + 999999) / 1000000);
+  time_t t = (time_t)sec;
+  struct tm tm;
+  char time[SIZE_TIME_STRING];
+
+  gmtime_r(&t, &tm);
+  strftime(time, sizeof(time), "%Y-%m-%d %H:%M:%S", &tm);
+
+  printf("%d\t%d\t%s\t%d\t%s.%06"PRId64"\t%d\t%d\t%"PRId64"\t%"PRId64"\n",
+         ea->id,
+         ea->apollo_station,
+         ea->ch->name,
+         level,
+         time, usec - sec * 1000000,
+         bin->min,
+         bin->max,
+         bin->sum,
+         bin->count);
+}
+
+int main(int argc, char** argv) {
+  int id;
+  int i, j, k, n;
+  int year_override = -1;
+  int min_level = DEFAULT_MIN_LEVEL;
+  int max_level = DEFAULT_MAX_LEVEL;
+  int apollo_station = -1;
+  int ch;
+  int ret = EXIT_FAILURE;
+  char filename[PATH_MAX+1];
+  extern char *optarg;
+  extern int optind, opterr;
+
+  while ((ch = getopt(argc, argv, "y:l:L:c:")) != -1) {
+    switch(ch) {
+    case 'y':
+      year_override = atoi(optarg);
+      break;
+    case 'l':
+      min_level = atoi(optarg);
+      break;
+    case 'L':
+      max_level = atoi(optarg);
+      break;
+    case 'c':
+      if (select_channels(optarg) != 0) {
+        return EXIT_FAILURE;
+      }
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  argc -= optind;
+  if (argc != 2){
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  argv += optind;
+
+  id = atoi(argv[0]);
+  SET_ARG(filename,1,PATH_MAX);
+
+  for (i = 0; i < NUM_CHANNEL; i++) {
+    channels[i].rate = channels[i].count_per_frame * FRAMES_PER_SEC;
+    if (channels[i].parity != -1) {
+      // tidal and temperature words alternate between even and odd frames
+      channels[i].rate /= 2;
+    }
+    emit_args[i].id = id;
+    emit_args[i].ch = &channels[i];
+    if (pyramid_init(&channels[i].p, min_level, max_level, print_pg_copy, &emit_args[i]) != 0) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__,
+                 "invalid levels: %d-%d (0-%d)", min_level, max_level, PYRAMID_MAX_LEVEL);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (pse_reader_open(&rd, filename, year_override) != 0) {
+    return EXIT_FAILURE;
+  }
+
+  log_printf(LOG_INFO, __FILE__, __LINE__, "processing: %s", filename);
+  print_pg_copy_init();
+
+  while ((n = pse_reader_next(&rd)) > 0) {
+    if (apollo_station == -1) {
+      apollo_station = rd.pr.apollo_station;
+      for (i = 0; i < NUM_CHANNEL; i++) {
+        emit_args[i].apollo_station = apollo_station;
+      }
+    }
+    for (j = 0; j < n; j++) {
+      const pse_frame *pf = &rd.pf[j];
+      int64_t msec;
+
+      if (pf->error_flag & ERROR_MASK_PYRAMID) {
+        continue;
+      }
+      msec = msec_of_year_to_epoch(rd.pr.year, pf->msec_of_year);
+
+      for (i = 0; i < NUM_CHANNEL; i++) {
+        const int32_t *data = channel_data(pf, i);
+        int64_t first;
+
+        if (!channels[i].enabled || (i == 0 && rd.pr.format != FORMAT_OLD)) {
+          continue;
+        }
+        if (channels[i].parity != -1 && (int)(pf->frame_count % 2U) != channels[i].parity) {
+          continue;
+        }
+        first = llround(msec * channels[i].rate / 1000.0);
+        for (k = 0; k < channels[i].count_per_frame; k++) {
+          if (data[k] != DATA_NONE) {
+            pyramid_add(&channels[i].p, first + k, data[k]);
+          }
+        }
+      }
+    }
+  }
+  if (n == 0) {
+    ret = EXIT_SUCCESS;
+  }
+
+  for (i = 0; i < NUM_CHANNEL; i++) {
+    pyramid_flush(&channels[i].p);
+  }
+  printf("\\.\n");
+
+  pse_reader_close(&rd);
+
+  return ret;
+}
@@ -0,0 +1,790 @@
+/*! @file stack2pgcopy.c
+ *  @brief Register aligned stacks of deep moonquake nests to RDBMS
+ *  @date 2026/10/18
+ *
+ *  The windows of all catalogued events of all nests (events.sql) are
+ *  cut from the tapes in one pass: every file is decoded once (files on
+ *  a pool of threads) and each frame is put into the windows of the
+ *  events around its time, at every station and selected channel. The
+ *  pieces of a window in several files are joined. The windows of every
+ *  deep_nest, station and channel are then aligned by cross-correlation
+ *  and stacked (stack.h), the nests on a pool of threads. The linear and
+ *  phase-weighted stacks are written as COPY data of nest_stack, the
+ *  lags of the windows as COPY data of nest_stack_lag (stack.sql).
+ *  With a quality catalog (-Q, quality.sql) a window of a station held
+ *  by several tapes is cut from the best of them only, and catalogued
+ *  files that are the best for no window are not decoded.
+ *
+ *  usage: stack2pgcopy [-j jobs] [-c channels] -E events [-w window] [-p pre] [-l maxlag]
+ *                      [-n iterations] [-v power] [-m min_stack] [-o templates] [-T table]
+ *                      [-Q quality] {pse|wtn|wth} id filename ...
+ *  example:
+ *    psql -At -F $'\t' -c "SELECT datetime, deep_nest FROM event WHERE deep_nest IS NOT NULL" alsep > nests.tsv
+ *    stack2pgcopy -E nests.tsv -o nests.mf pse 1 pse.12.001 ... | psql alsep
+ *    psql -At -F $'\t' -c "SELECT * FROM file_quality_catalog" alsep > quality.tsv
+ *    stack2pgcopy -E nests.tsv -Q quality.tsv pse 1 pse.12.001 wtn 7216 wtn.1.1 ... | psql alsep
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include <getopt.h>
+
+#include "define.h"
+#include "error.h"
+#include "util.h"
+#include "parallel.h"
+#include "samples.h"
+#include "matched.h"
+#include "stack.h"
+#include "quality.h"
+
+#define DEFAULT_WINDOW 300.0
+#define DEFAULT_PRE 30.0
+#define DEFAULT_MAXLAG 10.0
+
+//! windows of apollo_station 0 ... 17
+#define MAX_STATION 17
+
+//! window of an event at a station and channel (NAN where missing)
+typedef struct tag_window {
+  int nest;
+  int event;
+  int apollo_station;
+  int channel;
+  float *x;
+} window;
+
+//! events, sorted by time, and the windows of every channel
+typedef struct tag_stack_plan {
+  mf_event *ev;
+  int nev;
+
+  //! index of the nest of every event
+  int *nest;
+
+  //! samples of a window: len + 2 maxlag
+  int len[SAMPLES_NUM_CHANNEL];
+  int maxlag[SAMPLES_NUM_CHANNEL];
+
+  //! time of the first sample from the event time [msec]
+  double start[SAMPLES_NUM_CHANNEL];
+
+  //! longest window and frame [msec]
+  int64_t span;
+
+  //! input to cut every event and station from, -1 for all; NULL without a catalog
+  int *best;
+} stack_plan;
+
+typedef struct tag_file_job {
+  int index;
+  int type;
+  int file_id;
+  const char *filename;
+
+  //! no window is cut from the file
+  int skip;
+
+  //! windows cut from the file
+  window *w;
+  int nw;
+  int maxw;
+
+  //! index in w of (event, station, channel), -1 if none
+  int *slot;
+
+  int error;
+} file_job;
+
+typedef struct tag_cut_arg {
+  const stack_plan *p;
+  file_job *job;
+} cut_arg;
+
+typedef struct tag_gather_arg {
+  const stack_plan *p;
+  file_job *job;
+} gather_arg;
+
+//! windows of a nest at a station and channel
+typedef struct tag_stack_job {
+  const char *nest;
+  int apollo_station;
+  int channel;
+  const window **w;
+  const float **x;
+  int nw;
+  stack_result r;
+  int error;
+} stack_job;
+
+typedef struct tag_stack_arg {
+  stack_job *job;
+  const stack_plan *p;
+  stack_param param;
+} stack_arg;
+
+static int enabled[SAMPLES_NUM_CHANNEL] = {0, 1, 1, 1, 0};
+
+void print_pg_copy_init(const char *table);
+void print_pg_copy(const stack_job *job, double rate, int64_t offset);
+void print_pg_copy_lag_init(const char *table);
+void print_pg_copy_lag(const stack_job *job, const stack_plan *p);
+
+void usage(const char* cmd) {
+  fprintf(stderr, "%s [-j jobs] [-c channels] -E events [-w window] [-p pre] [-l maxlag] "
+          "[-n iterations] [-v power] [-m min_stack] [-o templates] [-T table] [-Q quality] "
+          "{pse|wtn|wth} id filename [{pse|wtn|wth} id filename ...]\n", cmd);
+  fprintf(stderr, "  events: \"datetime<TAB>deep_nest\" lines of the event table\n");
+  fprintf(stderr, "  window, pre, maxlag: stack length, start before the event and largest shift [sec]\n");
+  fprintf(stderr, "  channels: comma separated list of sp_z,lp_x,lp_y,lp_z,lsg,gp1,gp2,gp3,gp4 (default lp_x,lp_y,lp_z)\n");
+  fprintf(stderr, "  quality: file_quality_catalog lines (quality.sql) to cut a window from its best file only\n");
+}
+
+/*!
+ * @brief enable only the channels of a comma separated list
+ *
+ * @return 0 on success, -1 for an unknown channel
+ */
+static int select_channels(char *list) {
+  char *name;
+  int i;
+
+  for (i = 0; i < SAMPLES_NUM_CHANNEL; i++) {
+    enabled[i] = 0;
+  }
+  for (name = strtok(list, ","); name != NULL; name = strtok(NULL, ",")) {
+    i = samples_channel(name);
+    if (i < 0) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "unknown channel: %s", name);
+      return -1;
+    }
+    enabled[i] = 1;
+  }
+  return 0;
+}
+
+static int compare_epoch(const void *a, const void *b) {
+  const mf_event *x = (const mf_event *)a;
+  const mf_event *y = (const mf_event *)b;
+
+  if (x->epoch != y->epoch) {
+    return (x->epoch < y->epoch) ? -1 : 1;
+  }
+  return strcmp(x->nest, y->nest);
+}
+
+static int compare_nest(const void *a, const void *b) {
+  return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+static int compare_window(const void *a, const void *b) {
+  const window *x = (const window *)a;
+  const window *y = (const window *)b;
+
+  if (x->nest != y->nest) {
+    return x->nest - y->nest;
+  }
+  if (x->apollo_station != y->apollo_station) {
+    return x->apollo_station - y->apollo_station;
+  }
+  if (x->channel != y->channel) {
+    return x->channel - y->channel;
+  }
+  return x->event - y->event;
+}
+
+/*!
+ * @brief sort the events by time and number their nests in order of the label
+ *
+ * @return number of nests, -1 for no memory
+ */
+static int number_nests(stack_plan *p) {
+  const char **label;
+  int i, j, nn = 0;
+
+  qsort(p->ev, p->nev, sizeof(mf_event), compare_epoch);
+  p->nest = (int *)malloc(p->nev * sizeof(int));
+  label = (const char **)malloc(p->nev * sizeof(char *));
+  if (p->nest == NULL || label == NULL) {
+    free(label);
+    return -1;
+  }
+  for (i = 0; i < p->nev; i++) {
+    label[i] = p->ev[i].nest;
+  }
+  qsort(label, p->nev, sizeof(char *), compare_nest);
+  for (i = 0; i < p->nev; i = j) {
+    for (j = i; j < p->nev && strcmp(label[i], label[j]) == 0; j++);
+    label[nn++] = label[i];
+  }
+  for (i = 0; i < p->nev; i++) {
+    const char *key = p->ev[i].nest;
+    const char **found = (const char **)bsearch(&key, label, nn, sizeof(char *), compare_nest);
+
+    p->nest[i] = (int)(found - label);
+  }
+  free(label);
+  return nn;
+}
+
+/*!
+ * @brief choose the input to cut every event and station from by a quality
+ *        catalog and skip the catalogued inputs chosen for no window
+ *
+ * @return 0 on success, -1 for no memory
+ */
+static int choose_sources(stack_plan *p, const quality_catalog *c, file_job *in, int nin) {
+  const quality_entry *q;
+  double first = 0.0, last = 0.0, end;
+  int *ids, e, s, i, ch, *b;
+
+  p->best = (int *)malloc((size_t)p->nev * (MAX_STATION + 1) * sizeof(int));
+  ids = (int *)malloc(nin * sizeof(int));
+  if (p->best == NULL || ids == NULL) {
+    free(ids);
+    return -1;
+  }
+  for (i = 0; i < nin; i++) {
+    ids[i] = in[i].file_id;
+    in[i].skip = quality_known(c, in[i].file_id);
+  }
+
+  // the windows of all channels
+  for (ch = 0; ch < SAMPLES_NUM_CHANNEL; ch++) {
+    if (!enabled[ch]) {
+      continue;
+    }
+    end = p->start[ch] + (p->len[ch] + 2 * p->maxlag[ch]) * 1000.0 / samples_rate(ch);
+    first = (p->start[ch] < first) ? p->start[ch] : first;
+    last = (end > last) ? end : last;
+  }
+  for (e = 0; e < p->nev; e++) {
+    for (s = 0; s <= MAX_STATION; s++) {
+      b = &p->best[e * (MAX_STATION + 1) + s];
+      *b = -1;
+      q = quality_best(c, s, p->ev[e].epoch + llround(first), p->ev[e].epoch + llround(last), ids, nin);
+      if (q == NULL) {
+        continue;
+      }
+      for (i = 0; i < nin && in[i].file_id != q->file_id; i++);
+      *b = i;
+      in[i].skip = 0;
+    }
+  }
+  free(ids);
+  return 0;
+}
+
+/*!
+ * @brief window of an event at a station and channel of a file, allocated on first use
+ */
+static float *window_of(const stack_plan *p, file_job *job, int e, int apollo_station, int channel) {
+  int *slot = &job->slot[(e * (MAX_STATION + 1) + apollo_station) * SAMPLES_NUM_CHANNEL + channel];
+  int m = p->len[channel] + 2 * p->maxlag[channel];
+  window *t;
+  int i;
+
+  if (*slot >= 0) {
+    return job->w[*slot].x;
+  }
+  if (job->nw >= job->maxw) {
+    job->maxw = (job->maxw > 0) ? job->maxw * 2 : 256;
+    t = (window *)realloc(job->w, job->maxw * sizeof(window));
+    if (t == NULL) {
+      return NULL;
+    }
+    job->w = t;
+  }
+  t = &job->w[job->nw];
+  t->x = (float *)malloc(m * sizeof(float));
+  if (t->x == NULL) {
+    return NULL;
+  }
+  for (i = 0; i < m; i++) {
+    t->x[i] = NAN;
+  }
+  t->nest = p->nest[e];
+  t->event = e;
+  t->apollo_station = apollo_station;
+  t->channel = channel;
+  *slot = job->nw++;
+  return t->x;
+}
+
+/*!
+ * @brief put the samples of a frame into the windows of the events around it
+ */
+static void cut(int apollo_station, int channel, int64_t epoch,
+                const int32_t *data, int n, void *arg) {
+  cut_arg *ca = (cut_arg *)arg;
+  const stack_plan *p = ca->p;
+  double rate = samples_rate(channel);
+  int m = p->len[channel] + 2 * p->maxlag[channel];
+  int lo = 0, hi = p->nev, mid, e, k, b;
+  int64_t idx;
+  double t0;
+  float *x;
+
+  if (!enabled[channel] || apollo_station < 0 || apollo_station > MAX_STATION || ca->job->error) {
+    return;
+  }
+
+  // first event whose windows may hold the frame
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if (p->ev[mid].epoch < epoch - p->span) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  for (e = lo; e < p->nev && p->ev[e].epoch <= epoch + p->span; e++) {
+    if (p->best != NULL) {
+      b = p->best[e * (MAX_STATION + 1) + apollo_station];
+      if (b >= 0 && b != ca->job->index) {
+        continue;
+      }
+    }
+    t0 = p->ev[e].epoch + p->start[channel];
+    x = NULL;
+    for (k = 0; k < n; k++) {
+      if (data[k] == DATA_NONE) {
+        continue;
+      }
+      idx = llround((epoch + k * samples_frame_msec(channel) / n - t0) * rate / 1000.0);
+      if (idx < 0 || idx >= m) {
+        continue;
+      }
+      if (x == NULL) {
+        x = window_of(p, ca->job, e, apollo_station, channel);
+        if (x == NULL) {
+          log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+          ca->job->error = 1;
+          return;
+        }
+      }
+      x[idx] = (float)data[k];
+    }
+  }
+}
+
+static void gather_job(int i, void *arg) {
+  gather_arg *ga = (gather_arg *)arg;
+  file_job *job = &ga->job[i];
+  cut_arg ca;
+  size_t n = (size_t)ga->p->nev * (MAX_STATION + 1) * SAMPLES_NUM_CHANNEL;
+
+  if (job->skip) {
+    log_printf(LOG_INFO, __FILE__, __LINE__, "skipped: %s (better tapes hold its windows)", job->filename);
+    return;
+  }
+  log_printf(LOG_INFO, __FILE__, __LINE__, "processing: %s", job->filename);
+  job->slot = (int *)malloc(n * sizeof(int));
+  if (job->slot == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+    job->error = 1;
+    return;
+  }
+  memset(job->slot, 0xff, n * sizeof(int));
+  ca.p = ga->p;
+  ca.job = job;
+  if (samples_scan(job->type, job->filename, cut, &ca) != 0) {
+    job->error = 1;
+  }
+  free(job->slot);
+  job->slot = NULL;
+}
+
+static void stack_job_run(int i, void *arg) {
+  stack_arg *sa = (stack_arg *)arg;
+  stack_job *job = &sa->job[i];
+  stack_param param = sa->param;
+
+  param.maxlag = sa->p->maxlag[job->channel];
+  if (stack_windows(job->x, job->nw, sa->p->len[job->channel], &param, &job->r) != 0) {
+    job->error = 1;
+  }
+}
+
+/*!
+ * @brief whether a window has a missing sample
+ */
+static int has_gap(const float *x, int m) {
+  int i;
+
+  for (i = 0; i < m; i++) {
+    if (isnan(x[i])) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+
+  // ----------------------------------------
+  // Generic variables
+  // ----------------------------------------
+  const char *cmd = argv[0];
+  int i, j, k, c, m, nin, nn, nw = 0, nt = 0, njob = 0, maxjob = 0;
+  int ret = EXIT_FAILURE;
+  file_job *in = NULL;
+  window *w = NULL;
+  const window **wp = NULL;
+  const float **xp = NULL;
+  stack_job *job = NULL, *x;
+  mf_template *t = NULL;
+  stack_plan p;
+  quality_catalog qc;
+  gather_arg ga;
+  stack_arg sa;
+  FILE *f;
+
+  // ----------------------------------------
+  // getopt
+  // ----------------------------------------
+  int ch;
+  extern char *optarg;
+  extern int optind, opterr;
+  int jobs = 0;
+  const char *events = NULL;
+  const char *template_out = NULL;
+  const char *quality = NULL;
+  double window_sec = DEFAULT_WINDOW;
+  double pre = DEFAULT_PRE;
+  double maxlag = DEFAULT_MAXLAG;
+  int min_stack = 2;
+  const char *table = "nest_stack";
+  char lag_table[256];
+
+  sa.param.iterations = STACK_DEFAULT_ITERATIONS;
+  sa.param.power = STACK_DEFAULT_POWER;
+  while ((ch = getopt(argc, argv, "j:c:E:w:p:l:n:v:m:o:T:Q:")) != -1) {
+    switch(ch) {
+    case 'j':
+      jobs = atoi(optarg);
+      break;
+    case 'c':
+      if (select_channels(optarg) != 0) {
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'E':
+      events = optarg;
+      break;
+    case 'w':
+      window_sec = atof(optarg);
+      break;
+    case 'p':
+      pre = atof(optarg);
+      break;
+    case 'l':
+      maxlag = atof(optarg);
+      break;
+    case 'n':
+      sa.param.iterations = atoi(optarg);
+      break;
+    case 'v':
+      sa.param.power = atof(optarg);
+      break;
+    case 'm':
+      min_stack = atoi(optarg);
+      break;
+    case 'o':
+      template_out = optarg;
+      break;
+    case 'T':
+      table = optarg;
+      break;
+    case 'Q':
+      quality = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  argc -= optind;
+  if (argc < 3 || argc % 3 != 0 || events == NULL || window_sec <= 0.0 || maxlag < 0.0 ||
+      sa.param.iterations < 0) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  argv += optind;
+
+  // ----------------------------------------
+  // PROGRAM MAIN
+  // ----------------------------------------
+  memset(&p, 0, sizeof(p));
+  memset(&qc, 0, sizeof(qc));
+  for (c = 0; c < SAMPLES_NUM_CHANNEL; c++) {
+    double rate = samples_rate(c);
+
+    p.len[c] = (int)llround(window_sec * rate);
+    p.maxlag[c] = (int)llround(maxlag * rate);
+    p.start[c] = -pre * 1000.0 - p.maxlag[c] * 1000.0 / rate;
+    if (enabled[c] && p.len[c] < 2) {
+      usage(cmd);
+      return EXIT_FAILURE;
+    }
+  }
+  p.span = llround((pre + window_sec + 2.0 * maxlag) * 1000.0 + 2.0 * SAMPLES_FRAME_MSEC);
+  snprintf(lag_table, sizeof(lag_table), "%s_lag", table);
+
+  nin = argc / 3;
+  in = (file_job *)calloc(nin, sizeof(file_job));
+  if (in == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+    return EXIT_FAILURE;
+  }
+  for (i = 0; i < nin; i++) {
+    in[i].index = i;
+    in[i].type = samples_type(argv[3*i]);
+    in[i].file_id = atoi(argv[3*i+1]);
+    in[i].filename = argv[3*i+2];
+    if (in[i].type < 0) {
+      usage(cmd);
+      goto main_finish;
+    }
+  }
+
+  if (mf_event_read(events, &p.ev, &p.nev) != 0) {
+    goto main_finish;
+  }
+  nn = number_nests(&p);
+  if (nn < 0) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+    goto main_finish;
+  }
+  log_printf(LOG_INFO, __FILE__, __LINE__, "events: %d, nests: %d", p.nev, nn);
+  if (quality != NULL) {
+    if (quality_read(quality, &qc) != 0) {
+      goto main_finish;
+    }
+    if (choose_sources(&p, &qc, in, nin) != 0) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+      goto main_finish;
+    }
+    for (i = 0, k = 0; i < nin; i++) {
+      k += !in[i].skip;
+    }
+    log_printf(LOG_INFO, __FILE__, __LINE__, "quality: %d catalogued, %d of %d files read", qc.n, k, nin);
+  }
+
+  // one pass over the files
+  ga.p = &p;
+  ga.job = in;
+  parallel_for(nin, jobs, gather_job, &ga);
+  for (i = 0; i < nin; i++) {
+    if (in[i].error) {
+      goto main_finish;
+    }
+    nw += in[i].nw;
+  }
+
+  // the pieces of a window in several files are joined into the first
+  w = (window *)malloc((nw > 0 ? nw : 1) * sizeof(window));
+  wp = (const window **)malloc((nw > 0 ? nw : 1) * sizeof(window *));
+  xp = (const float **)malloc((nw > 0 ? nw : 1) * sizeof(float *));
+  if (w == NULL || wp == NULL || xp == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+    goto main_finish;
+  }
+  for (i = 0, k = 0; i < nin; i++) {
+    memcpy(&w[k], in[i].w, in[i].nw * sizeof(window));
+    k += in[i].nw;
+    free(in[i].w);
+    in[i].w = NULL;
+    in[i].nw = 0;
+  }
+  qsort(w, nw, sizeof(window), compare_window);
+  for (i = 0, k = 0; i < nw; i = j) {
+    m = p.len[w[i].channel] + 2 * p.maxlag[w[i].channel];
+    for (j = i + 1; j < nw && compare_window(&w[i], &w[j]) == 0; j++) {
+      for (c = 0; c < m; c++) {
+        if (isnan(w[i].x[c])) {
+          w[i].x[c] = w[j].x[c];
+        }
+      }
+    }
+    if (has_gap(w[i].x, m)) {
+      continue;
+    }
+    wp[k] = &w[i];
+    xp[k] = w[i].x;
+    k++;
+  }
+  log_printf(LOG_INFO, __FILE__, __LINE__, "windows: %d without gaps", k);
+
+  // one job per nest, station and channel
+  for (i = 0; i < k; i = j) {
+    for (j = i; j < k && wp[j]->nest == wp[i]->nest && wp[j]->apollo_station == wp[i]->apollo_station &&
+           wp[j]->channel == wp[i]->channel; j++);
+    if (j - i < min_stack) {
+      continue;
+    }
+    if (njob >= maxjob) {
+      maxjob = (maxjob > 0) ? maxjob * 2 : 256;
+      x = (stack_job *)realloc(job, maxjob * sizeof(stack_job));
+      if (x == NULL) {
+        log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+        goto main_finish;
+      }
+      job = x;
+    }
+    memset(&job[njob], 0, sizeof(stack_job));
+    job[njob].nest = p.ev[wp[i]->event].nest;
+    job[njob].apollo_station = wp[i]->apollo_station;
+    job[njob].channel = wp[i]->channel;
+    job[njob].w = &wp[i];
+    job[njob].x = &xp[i];
+    job[njob].nw = j - i;
+    njob++;
+  }
+
+  sa.job = job;
+  sa.p = &p;
+  parallel_for(njob, jobs, stack_job_run, &sa);
+
+  print_pg_copy_init(table);
+  for (i = 0; i < njob; i++) {
+    c = job[i].channel;
+    if (job[i].error) {
+      log_printf(LOG_WARNING, __FILE__, __LINE__, "no stack: nest %s station %d channel %s",
+                 job[i].nest, job[i].apollo_station, samples_channel_name(c));
+      continue;
+    }
+    log_printf(LOG_INFO, __FILE__, __LINE__, "stack: nest %s station %d channel %s (%d of %d windows)",
+               job[i].nest, job[i].apollo_station, samples_channel_name(c), job[i].r.count, job[i].nw);
+    print_pg_copy(&job[i], samples_rate(c), llround(-pre * 1000.0));
+  }
+  printf("\\.\n");
+  print_pg_copy_lag_init(lag_table);
+  for (i = 0; i < njob; i++) {
+    if (!job[i].error) {
+      print_pg_copy_lag(&job[i], &p);
+    }
+  }
+  printf("\\.\n");
+
+  // the linear stacks as templates of match2pgcopy
+  if (template_out != NULL) {
+    t = (mf_template *)calloc(njob > 0 ? njob : 1, sizeof(mf_template));
+    if (t == NULL) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+      goto main_finish;
+    }
+    for (i = 0; i < njob; i++) {
+      if (job[i].error) {
+        continue;
+      }
+      strcpy(t[nt].nest, job[i].nest);
+      t[nt].apollo_station = job[i].apollo_station;
+      t[nt].channel = job[i].channel;
+      t[nt].rate = samples_rate(job[i].channel);
+      t[nt].offset = llround(-pre * 1000.0);
+      if (mf_stack_finish(&t[nt], job[i].r.linear, job[i].r.n, job[i].r.count) == 0) {
+        nt++;
+      }
+    }
+    f = fopen(template_out, "wb");
+    if (f == NULL || mf_template_write(f, t, nt) != 0) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot write: %s", template_out);
+      if (f != NULL) {
+        fclose(f);
+      }
+      goto main_finish;
+    }
+    fclose(f);
+  }
+  ret = EXIT_SUCCESS;
+
+ main_finish:
+  if (t != NULL) {
+    mf_template_free(t, nt);
+  }
+  for (i = 0; i < njob; i++) {
+    stack_result_free(&job[i].r);
+  }
+  free(job);
+  free(xp);
+  free(wp);
+  if (w != NULL) {
+    for (i = 0; i < nw; i++) {
+      free(w[i].x);
+    }
+    free(w);
+  }
+  for (i = 0; i < nin; i++) {
+    for (j = 0; j < in[i].nw; j++) {
+      free(in[i].w[j].x);
+    }
+    free(in[i].w);
+  }
+  free(in);
+  free(p.ev);
+  free(p.nest);
+  free(p.best);
+  quality_free(&qc);
+  return ret;
+}
+
+/*!
+ * @brief print a stack as a COPY array literal
+ */
+static void print_array(const double *x, int n) {
+  int i;
+
+  putchar('{');
+  for (i = 0; i < n; i++) {
+    printf(i > 0 ? ",%.6g" : "%.6g", x[i]);
+  }
+  putchar('}');
+}
+
+void print_pg_copy_init(const char *table) {
+  printf("COPY %s ("
+         "deep_nest, ap_station, channel, rate, time_offset, nstack, linear, pws"
+         ") FROM stdin;\n", table);
+}
+
+void print_pg_copy(const stack_job *job, double rate, int64_t offset) {
+  printf("%s\t%d\t%s\t%.6f\t%" PRId64 "\t%d\t",
+         job->nest,
+         job->apollo_station,
+         samples_channel_name(job->channel),
+         rate,
+         offset,
+         job->r.count);
+  print_array(job->r.linear, job->r.n);
+  putchar('\t');
+  print_array(job->r.pws, job->r.n);
+  putchar('\n');
+}
+
+void print_pg_copy_lag_init(const char *table) {
+  printf("COPY %s ("
+         "deep_nest, ap_station, channel, datetime, lag, cc"
+         ") FROM stdin;\n", table);
+}
+
+void print_pg_copy_lag(const stack_job *job, const stack_plan *p) {
+  double rate = samples_rate(job->channel);
+  char time[SIZE_TIME_STRING];
+  int i;
+
+  for (i = 0; i < job->nw; i++) {
+    epoch_to_date_string(p->ev[job->w[i]->event].epoch, time);
+    printf("%s\t%d\t%s\t%s\t%.3f\t%.3f\n",
+           job->nest,
+           job->apollo_station,
+           samples_channel_name(job->channel),
+           time,
+           job->r.lag[i] / rate,
+           job->r.cc[i]);
+  }
+}
@@ -0,0 +1,572 @@
+/*! @file stalta2pgcopy.c
+ *  @brief Register STA/LTA triggers of PSE, WTN and WTH raw data to RDBMS
+ *  @date 2026/10/18
+ *
+ *  The SPZ and LSG (and optionally LP) samples of every station are
+ *  decoded from the tapes and fed to a recursive STA/LTA detector in one
+ *  pass, without going through tbl_pse or CSV. Files are scanned on a
+ *  pool of threads; the triggers are written as COPY data of
+ *  event_trigger (trigger.sql), whose first columns are those of event.
+ *
+ *  With -N the triggers of all files are merged in time order and
+ *  associated (coincidence.h): the triggers of at least N stations within
+ *  the window are written as one event of event_coincidence. With -I the
+ *  triggers are read from an export of event_trigger instead of being
+ *  detected on the tapes, so the events of the triggers stored for the
+ *  whole mission are associated in one pass.
+ *
+ *  usage: stalta2pgcopy [-j jobs] [-s sta] [-l lta] [-o on] [-f off] [-g max_gap] [-e]
+ *                       [-c channels] [-T table] [-N stations [-W window] [-C table]]
+ *                       {pse|wtn|wth} id filename ...
+ *         stalta2pgcopy -I triggers -N stations [-W window] [-C table]
+ *  example:
+ *    psql -At -F $'\t' -c "SELECT datetime, time_off, ap_station, channel, sta_lta, peak FROM event_trigger" alsep > triggers.tsv
+ *    stalta2pgcopy -I triggers.tsv -N 3 | psql alsep
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+#include <getopt.h>
+
+#include "define.h"
+#include "error.h"
+#include "util.h"
+#include "parallel.h"
+#include "samples.h"
+#include "stalta.h"
+#include "coincidence.h"
+
+//! detectors of apollo_station 0 ... 17
+#define MAX_STATION 17
+
+#define DEFAULT_WINDOW 60.0
+
+//! longest line of a trigger list
+#define SIZE_LINE 256
+
+typedef struct tag_trigger {
+  int apollo_station;
+  int channel;
+  stalta_trigger t;
+} trigger;
+
+typedef struct tag_file_job {
+  int type;
+  int file_id;
+  const char *filename;
+
+  //! triggers of the file
+  trigger *trig;
+  int ntrig;
+  int maxtrig;
+
+  int error;
+} file_job;
+
+typedef struct tag_emit_arg {
+  file_job *job;
+  int apollo_station;
+  int channel;
+} emit_arg;
+
+//! detectors of the channels of a station
+typedef struct tag_station {
+  stalta s[SAMPLES_NUM_CHANNEL];
+  emit_arg ea[SAMPLES_NUM_CHANNEL];
+} station;
+
+typedef struct tag_scan_arg {
+  file_job *job;
+  const stalta_param *p;
+  station *st[MAX_STATION+1];
+} scan_arg;
+
+typedef struct tag_run_arg {
+  file_job *job;
+  stalta_param p;
+} run_arg;
+
+static int enabled[SAMPLES_NUM_CHANNEL] = {1, 0, 0, 0, 1};
+
+void print_pg_copy_init(const char *table);
+void print_pg_copy(const file_job *job, const trigger *t, int cf);
+void print_pg_copy_coinc_init(const char *table);
+void print_pg_copy_coinc(const coinc_event *e, const coinc_trigger *t, int n, void *arg);
+
+void usage(const char* cmd) {
+  fprintf(stderr, "%s [-j jobs] [-s sta] [-l lta] [-o on] [-f off] [-g max_gap] [-e] [-c channels] [-T table] "
+          "[-N stations [-W window] [-C table]] {pse|wtn|wth} id filename [{pse|wtn|wth} id filename ...]\n", cmd);
+  fprintf(stderr, "%s -I triggers -N stations [-W window] [-C table]\n", cmd);
+  fprintf(stderr, "  sta, lta: windows [sec], on, off: STA/LTA ratios, max_gap: [msec]\n");
+  fprintf(stderr, "  -e: envelope (absolute amplitude) instead of energy\n");
+  fprintf(stderr, "  channels: comma separated list of sp_z,lp_x,lp_y,lp_z,lsg,gp1,gp2,gp3,gp4 (default sp_z,lsg)\n");
+  fprintf(stderr, "  stations, window: triggers of this many stations within window [sec] are an event\n");
+  fprintf(stderr, "  triggers: \"datetime<TAB>time_off<TAB>ap_station<TAB>channel<TAB>sta_lta<TAB>peak\" lines\n");
+}
+
+/*!
+ * @brief enable only the channels of a comma separated list
+ *
+ * @return 0 on success, -1 for an unknown channel
+ */
+static int select_channels(char *list) {
+  char *name;
+  int i;
+
+  for (i = 0; i < SAMPLES_NUM_CHANNEL; i++) {
+    enabled[i] = 0;
+  }
+  for (name = strtok(list, ","); name != NULL; name = strtok(NULL, ",")) {
+    i = samples_channel(name);
+    if (i < 0) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "unknown channel: %s", name);
+      return -1;
+    }
+    enabled[i] = 1;
+  }
+  return 0;
+}
+
+static void add_trigger(const stalta_trigger *t, void *arg) {
+  emit_arg *ea = (emit_arg *)arg;
+  file_job *job = ea->job;
+  trigger *tr;
+
+  if (job->ntrig >= job->maxtrig) {
+    job->maxtrig = (job->maxtrig > 0) ? job->maxtrig * 2 : 64;
+    tr = (trigger *)realloc(job->trig, job->maxtrig * sizeof(trigger));
+    if (tr == NULL) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+      job->error = 1;
+      return;
+    }
+    job->trig = tr;
+  }
+  tr = &job->trig[job->ntrig++];
+  tr->apollo_station = ea->apollo_station;
+  tr->channel = ea->channel;
+  tr->t = *t;
+}
+
+static station *new_station(int apollo_station, const stalta_param *p, file_job *job) {
+  station *st;
+  int i;
+
+  st = (station *)malloc(sizeof(station));
+  if (st == NULL) {
+    return NULL;
+  }
+  for (i = 0; i < SAMPLES_NUM_CHANNEL; i++) {
+    st->ea[i].job = job;
+    st->ea[i].apollo_station = apollo_station;
+    st->ea[i].channel = i;
+    stalta_init(&st->s[i], samples_rate(i), p, add_trigger, &st->ea[i]);
+  }
+  return st;
+}
+
+/*!
+ * @brief feed the samples of a channel of a frame
+ */
+static void feed(int apollo_station, int channel, int64_t epoch, const int32_t *data, int n, void *arg) {
+  scan_arg *sa = (scan_arg *)arg;
+  station *st;
+  int k;
+
+  if (!enabled[channel] || apollo_station < 0 || apollo_station > MAX_STATION) {
+    return;
+  }
+  st = sa->st[apollo_station];
+  if (st == NULL) {
+    st = sa->st[apollo_station] = new_station(apollo_station, sa->p, sa->job);
+    if (st == NULL) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+      sa->job->error = 1;
+      return;
+    }
+  }
+  for (k = 0; k < n; k++) {
+    if (data[k] != DATA_NONE) {
+      stalta_add(&st->s[channel], epoch + llround(k * samples_frame_msec(channel) / n), data[k]);
+    }
+  }
+}
+
+static int compare_trigger(const void *a, const void *b) {
+  const trigger *x = (const trigger *)a;
+  const trigger *y = (const trigger *)b;
+
+  if (x->t.on != y->t.on) {
+    return (x->t.on < y->t.on) ? -1 : 1;
+  }
+  if (x->apollo_station != y->apollo_station) {
+    return x->apollo_station - y->apollo_station;
+  }
+  return x->channel - y->channel;
+}
+
+static void scan_job(int i, void *arg) {
+  run_arg *ra = (run_arg *)arg;
+  file_job *job = &ra->job[i];
+  scan_arg sa;
+  int j, k;
+
+  memset(&sa, 0, sizeof(sa));
+  sa.job = job;
+  sa.p = &ra->p;
+
+  log_printf(LOG_INFO, __FILE__, __LINE__, "processing: %s", job->filename);
+  if (samples_scan(job->type, job->filename, feed, &sa) != 0) {
+    job->error = 1;
+  }
+  for (j = 0; j <= MAX_STATION; j++) {
+    if (sa.st[j] != NULL) {
+      for (k = 0; k < SAMPLES_NUM_CHANNEL; k++) {
+        stalta_flush(&sa.st[j]->s[k]);
+      }
+      free(sa.st[j]);
+    }
+  }
+  qsort(job->trig, job->ntrig, sizeof(trigger), compare_trigger);
+}
+
+/*!
+ * @brief read "datetime<TAB>time_off<TAB>ap_station<TAB>channel<TAB>sta_lta<TAB>peak" lines
+ *
+ * @return 0 on success, -1 on error
+ */
+static int read_triggers(file_job *job) {
+  char line[SIZE_LINE];
+  char *field[6], *p;
+  trigger *tr;
+  int i;
+  FILE *f;
+
+  f = fopen(job->filename, "r");
+  if (f == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "no such file: %s", job->filename);
+    return -1;
+  }
+  while (fgets(line, sizeof(line), f) != NULL) {
+    line[strcspn(line, "\r\n")] = '\0';
+    for (i = 0, p = line; i < 6 && p != NULL; i++) {
+      field[i] = p;
+      p = strchr(p, '\t');
+      if (p != NULL) {
+        *p++ = '\0';
+      }
+    }
+    if (i < 6) {
+      continue;
+    }
+    if (job->ntrig >= job->maxtrig) {
+      job->maxtrig = (job->maxtrig > 0) ? job->maxtrig * 2 : 1024;
+      tr = (trigger *)realloc(job->trig, job->maxtrig * sizeof(trigger));
+      if (tr == NULL) {
+        log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+        fclose(f);
+        return -1;
+      }
+      job->trig = tr;
+    }
+    tr = &job->trig[job->ntrig];
+    memset(tr, 0, sizeof(trigger));
+    tr->apollo_station = atoi(field[2]);
+    tr->channel = samples_channel(field[3]);
+    if (date_string_to_epoch(field[0], &tr->t.on) != 0 ||
+        date_string_to_epoch(field[1], &tr->t.off) != 0 || tr->channel < 0) {
+      log_printf(LOG_WARNING, __FILE__, __LINE__, "invalid trigger: %s", line);
+      continue;
+    }
+    tr->t.ratio = atof(field[4]);
+    tr->t.peak = atof(field[5]);
+    job->ntrig++;
+  }
+  fclose(f);
+  qsort(job->trig, job->ntrig, sizeof(trigger), compare_trigger);
+  return 0;
+}
+
+/*!
+ * @brief next trigger of the file job[i] of the heap
+ */
+static const trigger *head_of(const file_job *job, const int *next, int i) {
+  return &job[i].trig[next[i]];
+}
+
+static void sift_down(const file_job *job, const int *next, int *heap, int n, int k) {
+  int c, t;
+
+  for (; (c = 2 * k + 1) < n; k = c) {
+    if (c + 1 < n && compare_trigger(head_of(job, next, heap[c + 1]), head_of(job, next, heap[c])) < 0) {
+      c++;
+    }
+    if (compare_trigger(head_of(job, next, heap[c]), head_of(job, next, heap[k])) >= 0) {
+      break;
+    }
+    t = heap[k];
+    heap[k] = heap[c];
+    heap[c] = t;
+  }
+}
+
+/*!
+ * @brief feed the triggers of all files to the coincidence trigger in time order
+ *
+ * The triggers of a file are sorted; a heap of the next trigger of every
+ * file merges them.
+ *
+ * @return 0 on success, -1 for no memory
+ */
+static int associate(const file_job *job, int njob, coinc *c) {
+  int *heap, *next;
+  int i, n = 0, ret = 0;
+  const trigger *tr;
+  coinc_trigger ct;
+
+  heap = (int *)malloc((njob + 1) * sizeof(int));
+  next = (int *)calloc(njob + 1, sizeof(int));
+  if (heap == NULL || next == NULL) {
+    free(heap);
+    free(next);
+    return -1;
+  }
+  for (i = 0; i < njob; i++) {
+    if (job[i].ntrig > 0) {
+      heap[n++] = i;
+    }
+  }
+  for (i = n / 2 - 1; i >= 0; i--) {
+    sift_down(job, next, heap, n, i);
+  }
+  while (n > 0 && ret == 0) {
+    i = heap[0];
+    tr = head_of(job, next, i);
+    ct.on = tr->t.on;
+    ct.off = tr->t.off;
+    ct.apollo_station = tr->apollo_station;
+    ct.channel = tr->channel;
+    ct.ratio = tr->t.ratio;
+    ct.peak = tr->t.peak;
+    ret = coinc_add(c, &ct);
+    if (++next[i] >= job[i].ntrig) {
+      heap[0] = heap[--n];
+    }
+    sift_down(job, next, heap, n, 0);
+  }
+  coinc_flush(c);
+  free(heap);
+  free(next);
+  return ret;
+}
+
+int main(int argc, char** argv) {
+
+  // ----------------------------------------
+  // Generic variables
+  // ----------------------------------------
+  const char *cmd = argv[0];
+  int i, j, njob;
+  int ret = EXIT_SUCCESS;
+  file_job *job;
+  run_arg ra;
+  stalta dummy;
+  coinc c;
+  coinc_param cp;
+
+  // ----------------------------------------
+  // getopt
+  // ----------------------------------------
+  int ch;
+  extern char *optarg;
+  extern int optind, opterr;
+  int jobs = 0;
+  const char *table = "event_trigger";
+  const char *coinc_table = "event_coincidence";
+  const char *trigger_list = NULL;
+  double window = DEFAULT_WINDOW;
+
+  stalta_default_param(&ra.p);
+  cp.min_stations = 0;
+  while ((ch = getopt(argc, argv, "j:s:l:o:f:g:ec:T:N:W:C:I:")) != -1) {
+    switch(ch) {
+    case 'j':
+      jobs = atoi(optarg);
+      break;
+    case 's':
+      ra.p.sta = atof(optarg);
+      break;
+    case 'l':
+      ra.p.lta = atof(optarg);
+      break;
+    case 'o':
+      ra.p.on = atof(optarg);
+      break;
+    case 'f':
+      ra.p.off = atof(optarg);
+      break;
+    case 'g':
+      ra.p.max_gap = atoll(optarg);
+      break;
+    case 'e':
+      ra.p.cf = STALTA_CF_ENVELOPE;
+      break;
+    case 'c':
+      if (select_channels(optarg) != 0) {
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'T':
+      table = optarg;
+      break;
+    case 'N':
+      cp.min_stations = atoi(optarg);
+      break;
+    case 'W':
+      window = atof(optarg);
+      break;
+    case 'C':
+      coinc_table = optarg;
+      break;
+    case 'I':
+      trigger_list = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  argc -= optind;
+  if ((trigger_list == NULL && (argc < 3 || argc % 3 != 0)) ||
+      (trigger_list != NULL && (argc != 0 || cp.min_stations < 1)) || window < 0.0) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  argv += optind;
+
+  if (stalta_init(&dummy, 1.0, &ra.p, NULL, NULL) != 0) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__,
+               "invalid parameters: sta=%g lta=%g on=%g off=%g", ra.p.sta, ra.p.lta, ra.p.on, ra.p.off);
+    return EXIT_FAILURE;
+  }
+  cp.window = llround(window * 1000.0);
+
+  // ----------------------------------------
+  // PROGRAM MAIN
+  // ----------------------------------------
+  njob = (trigger_list != NULL) ? 1 : argc / 3;
+  job = (file_job *)calloc(njob, sizeof(file_job));
+  if (job == NULL) {
+    log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+    return EXIT_FAILURE;
+  }
+
+  if (trigger_list != NULL) {
+    job[0].filename = trigger_list;
+    if (read_triggers(&job[0]) != 0) {
+      ret = EXIT_FAILURE;
+    }
+  } else {
+    for (i = 0; i < njob; i++) {
+      job[i].type = samples_type(argv[3*i]);
+      job[i].file_id = atoi(argv[3*i+1]);
+      job[i].filename = argv[3*i+2];
+      if (job[i].type < 0) {
+        usage(cmd);
+        free(job);
+        return EXIT_FAILURE;
+      }
+    }
+
+    ra.job = job;
+    parallel_for(njob, jobs, scan_job, &ra);
+
+    print_pg_copy_init(table);
+    for (i = 0; i < njob; i++) {
+      if (job[i].error) {
+        ret = EXIT_FAILURE;
+      }
+      for (j = 0; j < job[i].ntrig; j++) {
+        print_pg_copy(&job[i], &job[i].trig[j], ra.p.cf);
+      }
+      log_printf(LOG_INFO, __FILE__, __LINE__, "triggers: %d (%s)", job[i].ntrig, job[i].filename);
+    }
+    printf("\\.\n");
+  }
+
+  // events of the triggers of several stations
+  if (cp.min_stations > 0 && ret == EXIT_SUCCESS) {
+    coinc_init(&c, &cp, print_pg_copy_coinc, NULL);
+    print_pg_copy_coinc_init(coinc_table);
+    if (associate(job, njob, &c) != 0) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__, "cannot allocate memory");
+      ret = EXIT_FAILURE;
+    }
+    printf("\\.\n");
+    if (c.nlate > 0) {
+      log_printf(LOG_WARNING, __FILE__, __LINE__, "triggers dropped: %" PRIu64, c.nlate);
+    }
+    coinc_free(&c);
+  }
+
+  for (i = 0; i < njob; i++) {
+    free(job[i].trig);
+  }
+  free(job);
+  return ret;
+}
+
+void print_pg_copy_init(const char *table) {
+  printf("COPY %s ("
+         "datetime, type, ap_station, channel, time_off, sta_lta, peak, file_id"
+         ") FROM stdin;\n", table);
+}
+
+void print_pg_copy(const file_job *job, const trigger *t, int cf) {
+  char on[SIZE_TIME_STRING];
+  char off[SIZE_TIME_STRING];
+
+  epoch_to_date_string(t->t.on, on);
+  epoch_to_date_string(t->t.off, off);
+
+  printf("%s\t%s\t%d\t%s\t%s\t%.3f\t%.1f\t%d\n",
+         on,
+         (cf == STALTA_CF_ENVELOPE) ? "STA/LTA envelope" : "STA/LTA",
+         t->apollo_station,
+         samples_channel_name(t->channel),
+         off,
+         t->t.ratio,
+         t->t.peak,
+         job->file_id);
+}
+
+void print_pg_copy_coinc_init(const char *table) {
+  printf("COPY %s ("
+         "datetime, type, time_off, nstation, stations, ntrigger, sta_lta"
+         ") FROM stdin;\n", table);
+}
+
+void print_pg_copy_coinc(const coinc_event *e, const coinc_trigger *t, int n, void *arg) {
+  char on[SIZE_TIME_STRING];
+  char off[SIZE_TIME_STRING];
+  int i, first = 1;
+
+  // the event carries all that is printed; the triggers are counted only
+  (void)t;
+  (void)arg;
+
+  epoch_to_date_string(e->on, on);
+  epoch_to_date_string(e->off, off);
+
+  printf("%s\tSTA/LTA coincidence\t%s\t%d\t{", on, off, e->nstation);
+  for (i = 0; i <= COINC_MAX_STATION; i++) {
+    if (e->stations & (1U << i)) {
+      printf(first ? "%d" : ",%d", i);
+      first = 0;
+    }
+  }
+  printf("}\t%d\t%.3f\n", n, e->ratio);
+}
@@ -17,14 +17,56 @@
 #include "wth.h"
 #include "error.h"
 #include "util.h"
+#include "clock.h"
+#include "wtn_demux.h"
+#include "parallel.h"
+#include "despike.h"
 
-#define SET_ARG(var,n,size) {strncpy(var, argv[n], size); var[size] = '\0';}
+//! frames decoded by one job
+#define CHUNK_FRAMES 4096
 
-void print_pg_copy_init();
-void print_pg_copy(int id, int offset, int len, wth_record whr, wth_frame whf);
+typedef struct tag_decode_arg {
+  wth_record whr;
+  const unsigned char *block;
+  wth_frame *whf;
+  int nframe;
+} decode_arg;
+
+typedef struct tag_print_arg {
+  int id;
+  int num_header;
+  wth_record whr;
+  const wth_frame *whf;
+} print_arg;
+
+void print_pg_copy_init(const char *table);
+void print_pg_copy(FILE *out, int id, int offset, int len, wth_record whr, wth_frame whf);
 void set_independent_data(wth_frame* whf);
 void set_related_data(wth_frame* whf, wth_frame* before);
 
+void usage(const char* cmd) {
+  fprintf(stderr, "%s [-s] [-j jobs] [-T table] id filename\n", cmd);
+  fprintf(stderr, "  -s  replace spikes of dp1, dp6, dp11 and dp16 by the running median\n");
+}
+
+/*!
+ * @brief decode a chunk of frames (frames are decoded independently)
+ */
+static void decode_chunk(int c, void *arg) {
+  decode_arg *a = (decode_arg *)arg;
+  int i;
+
+  for (i = c * CHUNK_FRAMES; i < (c + 1) * CHUNK_FRAMES && i < a->nframe; i++) {
+    a->whf[i] = binary2wth_frame(a->whr, &a->block[(size_t)i * SIZE_FRAME]);
+  }
+}
+
+static void print_frame(FILE *out, int i, void *arg) {
+  const print_arg *a = (const print_arg *)arg;
+
+  print_pg_copy(out, a->id, SIZE_HEADER*a->num_header+i*SIZE_FRAME, SIZE_FRAME, a->whr, a->whf[i]);
+}
+
 int main(int argc, char** argv) {
   
   //Generic variables
@@ -45,21 +87,54 @@ int main(int argc, char** argv) {
   // ----------------------------------------
   unsigned char record[SIZE_HEADER];
   unsigned char header[SIZE_HEADER];
-  unsigned char frame[SIZE_FRAME];
+  unsigned char *frame;
+  unsigned char *block = NULL;
   wth_record whr;
   wth_frame* whf = NULL;
+  clock_model clock[WTN_DEMUX_STREAMS];
+  despike_set ds;
   int fsize;
   int max_wth_frame;
   int num_header = 2;
-  
-  // PROGRAM MAIN
-  if (argc < 3){
-    fprintf(stderr, "%s id filename\n", argv[0]);
+  decode_arg da;
+  print_arg pa;
+
+  // ----------------------------------------
+  // getopt
+  // ----------------------------------------
+  int ch;
+  extern char *optarg;
+  extern int optind, opterr;
+  int jobs = 0;
+  const char *table = "tbl_lspe";
+  int despiking = 0;
+
+  while ((ch = getopt(argc, argv, "sj:T:")) != -1) {
+    switch(ch) {
+    case 's':
+      despiking = 1;
+      break;
+    case 'j':
+      jobs = atoi(optarg);
+      break;
+    case 'T':
+      table = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return -1;
+    }
+  }
+  argc -= optind;
+  if (argc < 2){
+    usage(argv[0]);
     return -1;
   }
+  argv += optind;
   
-  id = atoi(argv[1]);
-  SET_ARG(filename,2,PATH_MAX);
+  id = atoi(argv[0]);
+  SET_ARG(filename,1,PATH_MAX);
+  despike_set_init(&ds);
   
   f=fopen(filename, "rb");
   if(f==NULL) {
@@ -81,6 +156,9 @@ int main(int argc, char** argv) {
   // Frame registration
   // ----------------------------------------
   process_flag = FLAG_FIRST_DATA_OF_FILE;
+  for (i = 0; i < WTN_DEMUX_STREAMS; i++) {
+    clock_init(&clock[i], VALID_FRAME_RATE_WTH, 0);
+  }
   rec_offset = ftell(f);
   while ((r=fread(record, sizeof(unsigned char), SIZE_HEADER, f))>0) {
     if (r != SIZE_HEADER) {
@@ -116,25 +194,38 @@ int main(int argc, char** argv) {
       max_wth_frame++;
     }
     whf = (wth_frame*)malloc(max_wth_frame * sizeof(wth_frame));
-    if (whf == NULL) {
+    block = (unsigned char*)calloc(max_wth_frame, SIZE_FRAME);
+    if (whf == NULL || block == NULL) {
       log_printf(LOG_ERROR, __FILE__, __LINE__,
 		 "cannot allocate memory\n");
       goto main_finish;
     }
     
-    print_pg_copy_init();
+    print_pg_copy_init(table);
     
     // Read Frame
     int fmax = 0;
-    while ((r=fread(frame, sizeof(unsigned char), SIZE_FRAME, f))>0) {
-      if ( fmax >= max_wth_frame ) {
-	log_printf(LOG_ERROR, __FILE__, __LINE__,
-		   "max_wth_frame is %d\n", max_wth_frame);
-	goto main_finish;
+    while (fmax < max_wth_frame &&
+	   (r=fread(&block[fmax*SIZE_FRAME], sizeof(unsigned char), SIZE_FRAME, f))>0) {
+      frame = &block[fmax*SIZE_FRAME];
+      if (r != SIZE_FRAME && fmax > 0) {
+	// a short frame at the end keeps the rest of the frame before it
+	memcpy(&frame[r], &frame[(int)r-SIZE_FRAME], SIZE_FRAME-r);
       }
-      whf[fmax] = binary2wth_frame(whr,frame);
       fmax++;
     }
+    if (fmax >= max_wth_frame && fgetc(f) != EOF) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__,
+		 "max_wth_frame is %d\n", max_wth_frame);
+      goto main_finish;
+    }
+
+    // decode concurrently, link and check in order
+    da.whr = whr;
+    da.block = block;
+    da.whf = whf;
+    da.nframe = fmax;
+    parallel_for((fmax + CHUNK_FRAMES - 1) / CHUNK_FRAMES, jobs, decode_chunk, &da);
     
     // Register first frame into database
     for (i=0; i<whr.num_asta; i++) {
@@ -150,7 +241,9 @@ int main(int argc, char** argv) {
 		   SIZE_HEADER*num_header+SIZE_FRAME*i,
                    whf[i].msec_of_year);
       }
-      print_pg_copy(id, SIZE_HEADER*num_header+i*SIZE_FRAME, SIZE_FRAME, whr, whf[i]);
+      whf[i].msec_of_year_corrected =
+        clock_correct(&clock[wtn_demux_stream(whf[i].alsep_package_id)], whf[i].msec_of_year, -1,
+                      whf[i].error_flag, &whf[i].time_flag);
     }
     
     for(i = whr.num_asta; i<fmax ;i++) {
@@ -170,8 +263,23 @@ int main(int argc, char** argv) {
                    whf[i].msec_of_year);
       }
       
-      print_pg_copy(id, SIZE_HEADER*num_header+i*SIZE_FRAME, SIZE_FRAME, whr, whf[i]);
+      whf[i].msec_of_year_corrected =
+        clock_correct(&clock[wtn_demux_stream(whf[i].alsep_package_id)], whf[i].msec_of_year, -1,
+                      whf[i].error_flag, &whf[i].time_flag);
+    }
+    
+    if (despiking && despike_wth_frames(&ds, whf, fmax) < 0) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__,
+		 "cannot allocate memory");
+      goto main_finish;
     }
+
+    // Register frames into database (formatted concurrently, written in order)
+    pa.id = id;
+    pa.num_header = num_header;
+    pa.whr = whr;
+    pa.whf = whf;
+    parallel_print(stdout, fmax, jobs, print_frame, &pa);
     
     msec_of_year_fmax = whf[i-1].msec_of_year;
   }
@@ -186,20 +294,26 @@ int main(int argc, char** argv) {
     free(whf);
     whf = NULL;
   }
+
+  if (block) {
+    free(block);
+    block = NULL;
+  }
+  despike_set_free(&ds);
   
   putchar('\n');
   return 0;
 }
 
-void print_pg_copy_init() {
-  printf("COPY tbl_lspe ("
+void print_pg_copy_init(const char *table) {
+  printf("COPY %s ("
 	 "file_id, pos, length, ap_station, ground_station,"
 	 " time_original, \"time\", time_diff, gp1, gp2, gp3, gp4, status,"
 	 " process_flag, error_flag, time_flag"
-	 ") FROM stdin;\n");
+	 ") FROM stdin;\n", table);
 }
 
-void print_pg_copy(int id, int offset, int len, wth_record whr, wth_frame whf) {
+void print_pg_copy(FILE *out, int id, int offset, int len, wth_record whr, wth_frame whf) {
 
   int apollo_station;
 
@@ -211,19 +325,26 @@ void print_pg_copy(int id, int offset, int len, wth_record whr, wth_frame whf) {
   
   msec_of_year_to_date(whf.msec_of_year, &doy, &hh, &mm, &ss, &ms);
   
+  if (doy >= 1 && doy <= 366) {
+    sprintf(time_org,"%04d.%03d %02d:%02d:%02d.%03d", whr.year, doy, hh,mm,ss,ms);
+  } else {
+    sprintf(time_org,"\\N");
+  }
+
+  msec_of_year_to_date(whf.msec_of_year_corrected, &doy, &hh, &mm, &ss, &ms);
+  
   if (doy >= 1 && doy <= 366) {
     sprintf(time,"%04d.%03d %02d:%02d:%02d.%03d", whr.year, doy, hh,mm,ss,ms);
   } else {
     sprintf(time,"\\N");
   }
-  strcpy(time_org, time);
 
   apollo_station = package_id2station_id(whf.alsep_package_id);
   if (apollo_station != 17) {
     return;
   }
   
-  printf(
+  fprintf(out,
 	 "%d\t"
 	 "%d\t"
 	 "%d\t"
@@ -246,7 +367,7 @@ void print_pg_copy(int id, int offset, int len, wth_record whr, wth_frame whf) {
 	 apollo_station,
 	 whf.alsep_tracking_station_id,
 	 time_org,
-	 time_org,
+	 time,
 	 whf.time_diff,
 	 intary2str(whf.dp1,COUNTS_PER_FRAME_FOR_WTH_GP,sql_gp1,SIZE_SQL),
 	 intary2str(whf.dp6,COUNTS_PER_FRAME_FOR_WTH_GP,sql_gp2,SIZE_SQL),
@@ -255,7 +376,7 @@ void print_pg_copy(int id, int offset, int len, wth_record whr, wth_frame whf) {
 	 intary2str(whf.status,COUNTS_PER_FRAME_FOR_WTH_GP,sql_status,SIZE_SQL),
 	 whf.process_flag,
 	 whf.error_flag,
-	 0);
+	 whf.time_flag);
 }
 
 
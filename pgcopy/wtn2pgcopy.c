@@ -10,18 +10,74 @@
 #include <time.h>
 #include <string.h>
 #include <inttypes.h>
+#include <getopt.h>
 
 #include "define.h"
 #include "wtn.h"
 #include "error.h"
 #include "util.h"
+#include "clock.h"
+#include "wtn_demux.h"
+#include "parallel.h"
+#include "despike.h"
 
-#define SET_ARG(var,n,size) {strncpy(var, argv[n], size); var[size] = '\0';}
+//! frames decoded by one job
+#define CHUNK_FRAMES 4096
 
-void print_pg_copy_init();
-void print_pg_copy(int id, int offset, int len, wtn_record wnr, wtn_frame wnf);
-void set_independent_data(wtn_frame* wnf);
-void set_related_data(wtn_frame* wnf, wtn_frame* before);
+typedef struct tag_decode_arg {
+  wtn_record wnr;
+  const unsigned char *block;
+  wtn_frame *wnf;
+  int nframe;
+
+  //! demultiplexer of every chunk, joined in order after decoding
+  wtn_demux *demux;
+} decode_arg;
+
+typedef struct tag_print_arg {
+  int id;
+  int num_header;
+  wtn_record wnr;
+  const wtn_frame *wnf;
+} print_arg;
+
+void print_pg_copy_init(const char *table);
+void print_pg_copy(FILE *out, int id, int offset, int len, wtn_record wnr, wtn_frame wnf);
+
+void usage(const char* cmd) {
+  fprintf(stderr, "%s [-s] [-j jobs] [-T table] id filename\n", cmd);
+  fprintf(stderr, "  -s  replace spikes of spz, lpx, lpy, lpz and lsg by the running median\n");
+}
+
+static int chunk_size(int c, int nframe) {
+  int n = nframe - c * CHUNK_FRAMES;
+  return (n < CHUNK_FRAMES) ? n : CHUNK_FRAMES;
+}
+
+/*!
+ * @brief decode a chunk of frames and link them within the chunk
+ */
+static void decode_chunk(int c, void *arg) {
+  decode_arg *a = (decode_arg *)arg;
+  int first = c * CHUNK_FRAMES;
+  int n = chunk_size(c, a->nframe);
+
+  binary2wtn_frames(a->wnr, &a->block[(size_t)first * SIZE_FRAME], &a->wnf[first], n);
+  wtn_demux_init(&a->demux[c]);
+  wtn_demux_frames(&a->demux[c], &a->wnf[first], n);
+}
+
+static void check_chunk(int c, void *arg) {
+  decode_arg *a = (decode_arg *)arg;
+
+  check_wtn_frames(&a->wnf[c * CHUNK_FRAMES], chunk_size(c, a->nframe), a->wnr.year);
+}
+
+static void print_frame(FILE *out, int i, void *arg) {
+  const print_arg *a = (const print_arg *)arg;
+
+  print_pg_copy(out, a->id, SIZE_HEADER*a->num_header+i*SIZE_FRAME, SIZE_FRAME, a->wnr, a->wnf[i]);
+}
 
 int main(int argc, char** argv) {
   
@@ -35,29 +91,64 @@ int main(int argc, char** argv) {
   
   long rec_offset;
   
-  //initial value of Frame time error at last frame in one record
-  uint32_t msec_of_year_fmax = 0;
-  
   // ----------------------------------------
   // Apollo related variables
   // ----------------------------------------
   unsigned char record[SIZE_HEADER];
   unsigned char header[SIZE_HEADER];
-  unsigned char frame[SIZE_FRAME];
+  unsigned char *frame;
+  unsigned char *block = NULL;
   wtn_record wnr;
   wtn_frame* wnf = NULL;
+  clock_model clock[WTN_DEMUX_STREAMS];
+  wtn_demux demux;
+  despike_set ds[WTN_DEMUX_STREAMS];
   int fsize;
   int max_wtn_frame;
   int num_header = 2;
-  
-  // PROGRAM MAIN
-  if (argc < 3){
-    fprintf(stderr, "%s id filename\n", argv[0]);
+  wtn_demux *chunk_demux = NULL;
+  decode_arg da;
+  print_arg pa;
+  int c, nchunk;
+
+  // ----------------------------------------
+  // getopt
+  // ----------------------------------------
+  int ch;
+  extern char *optarg;
+  extern int optind, opterr;
+  int jobs = 0;
+  const char *table = "tbl_pse";
+  int despiking = 0;
+
+  while ((ch = getopt(argc, argv, "sj:T:")) != -1) {
+    switch(ch) {
+    case 's':
+      despiking = 1;
+      break;
+    case 'j':
+      jobs = atoi(optarg);
+      break;
+    case 'T':
+      table = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return -1;
+    }
+  }
+  argc -= optind;
+  if (argc < 2){
+    usage(argv[0]);
     return -1;
   }
+  argv += optind;
   
-  id = atoi(argv[1]);
-  SET_ARG(filename,2,PATH_MAX);
+  id = atoi(argv[0]);
+  SET_ARG(filename,1,PATH_MAX);
+  for (i = 0; i < WTN_DEMUX_STREAMS; i++) {
+    despike_set_init(&ds[i]);
+  }
   
   f=fopen(filename, "rb");
   if(f==NULL) {
@@ -79,6 +170,10 @@ int main(int argc, char** argv) {
   // Frame registration
   // ----------------------------------------
   process_flag = FLAG_FIRST_DATA_OF_FILE;
+  for (i = 0; i < WTN_DEMUX_STREAMS; i++) {
+    clock_init(&clock[i], VALID_FRAME_RATE, SIZE_LOGICAL_RECORD);
+  }
+  wtn_demux_init(&demux);
   rec_offset = ftell(f);
   while ((r=fread(record, sizeof(unsigned char), SIZE_HEADER, f))>0) {
     if (r != SIZE_HEADER) {
@@ -114,52 +209,65 @@ int main(int argc, char** argv) {
       max_wtn_frame++;
     }
     wnf = (wtn_frame*)malloc(max_wtn_frame * sizeof(wtn_frame));
-    if (wnf == NULL) {
+    block = (unsigned char*)calloc(max_wtn_frame, SIZE_FRAME);
+    if (wnf == NULL || block == NULL) {
       log_printf(LOG_ERROR, __FILE__, __LINE__,
 		 "cannot allocate memory\n");
       goto main_finish;
     }
     
-    print_pg_copy_init();
+    print_pg_copy_init(table);
 
     // Read Frame
     int fmax = 0;
-    while ((r=fread(frame, sizeof(unsigned char), SIZE_FRAME, f))>0) {
-      if ( fmax >= max_wtn_frame ) {
-	log_printf(LOG_ERROR, __FILE__, __LINE__,
-		   "max_wtn_frame is %d\n", max_wtn_frame);
-	goto main_finish;
+    while (fmax < max_wtn_frame &&
+	   (r=fread(&block[fmax*SIZE_FRAME], sizeof(unsigned char), SIZE_FRAME, f))>0) {
+      frame = &block[fmax*SIZE_FRAME];
+      if (r != SIZE_FRAME && fmax > 0) {
+	// a short frame at the end keeps the rest of the frame before it
+	memcpy(&frame[r], &frame[(int)r-SIZE_FRAME], SIZE_FRAME-r);
       }
-      wnf[fmax] = binary2wtn_frame(wnr,frame);
       fmax++;
     }
-    
-    // Register first frame into database
-    for (i=0; i<wnr.num_asta; i++) {
-      
-      set_independent_data(&wnf[i]);
+    if (fmax >= max_wtn_frame && fgetc(f) != EOF) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__,
+		 "max_wtn_frame is %d\n", max_wtn_frame);
+      goto main_finish;
+    }
+
+    // decode the chunks concurrently, then join them in order
+    nchunk = (fmax + CHUNK_FRAMES - 1) / CHUNK_FRAMES;
+    free(chunk_demux);
+    chunk_demux = (wtn_demux*)calloc(nchunk + 1, sizeof(wtn_demux));
+    if (chunk_demux == NULL) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__,
+		 "cannot allocate memory\n");
+      goto main_finish;
+    }
+    da.wnr = wnr;
+    da.block = block;
+    da.wnf = wnf;
+    da.nframe = fmax;
+    da.demux = chunk_demux;
+    parallel_for(nchunk, jobs, decode_chunk, &da);
+    for (c = 0; c < nchunk; c++) {
+      wtn_demux_join(&demux, &chunk_demux[c], &wnf[c * CHUNK_FRAMES], chunk_size(c, fmax));
+    }
+
+    for (i=0; i<wnr.num_asta && i<fmax; i++) {
       wnf[i].process_flag |= process_flag | FLAG_TOP_OF_RECORD;
-      
-      wnf[i].error_flag = check_wtn_frame(wnf[i], wnr.year);
-      if (wnf[i].error_flag >= 0x0100) {
-	log_printf(LOG_WARNING, __FILE__, __LINE__,
-		   "frame error: error code=0x%04x  file offset=%d msec_of_year=%"PRId64,
-                   wnf[i].error_flag,
-		   SIZE_HEADER*num_header+SIZE_FRAME*i,
-                   wnf[i].msec_of_year);
-      }
-      print_pg_copy(id, SIZE_HEADER*num_header+i*SIZE_FRAME, SIZE_FRAME, wnr, wnf[i]);
     }
-    
-    for(i = wnr.num_asta; i<fmax ;i++) {
-      
-      if (wnf[i].alsep_package_id != wnf[i-wnr.num_asta].alsep_package_id) {
-	set_independent_data(&wnf[i]);
-      } else {
-	set_related_data(&wnf[i], &wnf[i-wnr.num_asta]);
-      }
-      
-      wnf[i].error_flag = check_wtn_frame(wnf[i], wnr.year);
+    parallel_for(nchunk, jobs, check_chunk, &da);
+    // streams carry over the chunks, so despiking is sequential
+    if (despiking && despike_wtn_frames(ds, wnf, fmax) < 0) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__,
+		 "cannot allocate memory");
+      goto main_finish;
+    }
+    for (i=0; i<fmax; i++) {
+      wnf[i].msec_of_year_corrected =
+        clock_correct(&clock[wtn_demux_stream(wnf[i].alsep_package_id)], wnf[i].msec_of_year, wnf[i].frame_count,
+                      wnf[i].error_flag, &wnf[i].time_flag);
       if (wnf[i].error_flag >= 0x0100) {
 	log_printf(LOG_WARNING, __FILE__, __LINE__,
 		   "frame error: error code=0x%04x  file offset=%d msec_of_year=%"PRId64,
@@ -167,11 +275,14 @@ int main(int argc, char** argv) {
 		   SIZE_HEADER*num_header+SIZE_FRAME*i,
                    wnf[i].msec_of_year);
       }
-      
-      print_pg_copy(id, SIZE_HEADER*num_header+i*SIZE_FRAME, SIZE_FRAME, wnr, wnf[i]);
     }
     
-    msec_of_year_fmax = wnf[i-1].msec_of_year;
+    // Register frames into database (formatted concurrently, written in order)
+    pa.id = id;
+    pa.num_header = num_header;
+    pa.wnr = wnr;
+    pa.wnf = wnf;
+    parallel_print(stdout, fmax, jobs, print_frame, &pa);
   }
   printf("\\.\n");
   
@@ -184,20 +295,30 @@ int main(int argc, char** argv) {
     free(wnf);
     wnf = NULL;
   }
+
+  if (block) {
+    free(block);
+    block = NULL;
+  }
+
+  free(chunk_demux);
+  for (i = 0; i < WTN_DEMUX_STREAMS; i++) {
+    despike_set_free(&ds[i]);
+  }
   
   putchar('\n');
   return 0;
 }
 
-void print_pg_copy_init() {
-  printf("COPY tbl_pse ("
+void print_pg_copy_init(const char *table) {
+  printf("COPY %s ("
 	 "file_id, pos, length, frame_count, ap_station, ground_station,"
 	 "time_original, \"time\", time_diff, sp_z, lp_x, lp_y, lp_z,"
 	 "tidal_x, tidal_y, tidal_z, inst_temp, process_flag, error_flag, time_flag"
-	 ") FROM stdin;\n");
+	 ") FROM stdin;\n", table);
 }
 
-void print_pg_copy(int id, int offset, int len, wtn_record wnr, wtn_frame wnf) {
+void print_pg_copy(FILE *out, int id, int offset, int len, wtn_record wnr, wtn_frame wnf) {
 
   int apollo_station;
 
@@ -209,12 +330,19 @@ void print_pg_copy(int id, int offset, int len, wtn_record wnr, wtn_frame wnf) {
   
   msec_of_year_to_date(wnf.msec_of_year, &doy, &hh, &mm, &ss, &ms);
   
+  if (doy >= 1 && doy <= 366) {
+    sprintf(time_org,"%04d.%03d %02d:%02d:%02d.%03d", wnr.year, doy, hh,mm,ss,ms);
+  } else {
+    sprintf(time_org,"\\N");
+  }
+
+  msec_of_year_to_date(wnf.msec_of_year_corrected, &doy, &hh, &mm, &ss, &ms);
+  
   if (doy >= 1 && doy <= 366) {
     sprintf(time,"%04d.%03d %02d:%02d:%02d.%03d", wnr.year, doy, hh,mm,ss,ms);
   } else {
     sprintf(time,"\\N");
   }
-  strcpy(time_org, time);
 
   apollo_station = package_id2station_id(wnf.alsep_package_id);
   if (apollo_station < 0 ||
@@ -222,7 +350,7 @@ void print_pg_copy(int id, int offset, int len, wtn_record wnr, wtn_frame wnf) {
     return;
   }
   
-  printf(
+  fprintf(out,
 	 "%d\t"
 	 "%d\t"
 	 "%d\t"
@@ -250,7 +378,7 @@ void print_pg_copy(int id, int offset, int len, wtn_record wnr, wtn_frame wnf) {
 	 apollo_station,
 	 wnf.alsep_tracking_station_id,
 	 time_org,
-	 time_org,
+	 time,
 	 wnf.time_diff,
 	 intary2str(wnf.spz,COUNTS_PER_FRAME_FOR_WTN_SP,sql_spz,SIZE_SQL),
 	 intary2str(wnf.lpx,COUNTS_PER_FRAME_FOR_WTN_LP,sql_lpx,SIZE_SQL),
@@ -259,27 +387,6 @@ void print_pg_copy(int id, int offset, int len, wtn_record wnr, wtn_frame wnf) {
 	 wnf.TidX, wnf.TidY, wnf.TidZ, wnf.InstT,
 	 wnf.process_flag,
 	 wnf.error_flag,
-	 0);
-}
-
-
-void set_independent_data(wtn_frame* wnf) {
-  if (wnf->alsep_package_id != ALSEP_PACKAGE_ID_APOLLO_17) {
-    wnf->spz[0] = wnf->spz[1];
-    wnf->process_flag = FLAG_FIRST_DATA_COPIED;
-  }
-  wnf->time_diff = wnf->msec_of_year;
-  wnf->prev_frame = -1;
+	 wnf.time_flag);
 }
 
-void set_related_data(wtn_frame* wnf, wtn_frame* before) {
-  if (wnf->alsep_package_id != ALSEP_PACKAGE_ID_APOLLO_17) {
-    //! ALSEP WORD 2
-    wnf->spz[0] = interp(before->spz[30],
-			 before->spz[31],
-			 wnf->spz[1],
-			 wnf->spz[2]);
-  }
-  wnf->time_diff = wnf->msec_of_year - before->msec_of_year;
-  wnf->prev_frame = before->frame_count;
-}
@@ -10,20 +10,35 @@
 #include <time.h>
 #include <string.h>
 #include <inttypes.h>
+#include <getopt.h>
 
 #include "define.h"
 #include "wtn.h"
 #include "error.h"
 #include "util.h"
+#include "clock.h"
+#include "wtn_demux.h"
+#include "despike.h"
 
-#define SET_ARG(var,n,size) {strncpy(var, argv[n], size); var[size] = '\0';}
-
-void print_pg_copy_init();
+void print_pg_copy_init(const char *table);
 void print_pg_copy(int id, int offset, int len, wtn_record wnr, wtn_frame wnf);
 
 void set_independent_data(wtn_frame* wnf);
 void set_related_data(wtn_frame* wnf, wtn_frame* before);
 
+void usage(const char* cmd) {
+  fprintf(stderr, "%s [-s] [-T table] id filename\n", cmd);
+  fprintf(stderr, "  -s  replace spikes of lsg by the running median\n");
+}
+
+/*!
+ * @brief frames at the top of a record registered as LSG frames (never the first one)
+ */
+static int top_lsg_frame(const wtn_frame *wnf, int i) {
+  return i > 0 && wnf[i].alsep_package_id == ALSEP_PACKAGE_ID_APOLLO_17 &&
+         wnf[i].alsep_package_id == wnf[i-1].alsep_package_id;
+}
+
 int main(int argc, char** argv) {
   
   //Generic variables
@@ -47,18 +62,47 @@ int main(int argc, char** argv) {
   unsigned char frame[SIZE_FRAME];
   wtn_record wnr;
   wtn_frame* wnf = NULL;
+  clock_model clock[WTN_DEMUX_STREAMS];
+  despike_set ds[WTN_DEMUX_STREAMS];
   int fsize;
   int max_wtn_frame;
   int count_header = 2;
-  
-  // PROGRAM MAIN
+
+  // ----------------------------------------
+  // getopt
+  // ----------------------------------------
+  int ch;
+  extern char *optarg;
+  extern int optind, opterr;
+  const char *table = "tbl_lsg";
+  int despiking = 0;
+
+  while ((ch = getopt(argc, argv, "sT:")) != -1) {
+    switch(ch) {
+    case 's':
+      despiking = 1;
+      break;
+    case 'T':
+      table = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return -1;
+    }
+  }
+  argc -= optind;
   if (argc < 2){
-    fprintf(stderr, "%s id filename\n", argv[0]);
+    usage(argv[0]);
     return -1;
   }
+  argv += optind;
   
-  id = atoi(argv[1]);
-  SET_ARG(filename,2,PATH_MAX);
+  // PROGRAM MAIN
+  id = atoi(argv[0]);
+  SET_ARG(filename,1,PATH_MAX);
+  for (i = 0; i < WTN_DEMUX_STREAMS; i++) {
+    despike_set_init(&ds[i]);
+  }
   
   f=fopen(filename, "rb");
   if(f==NULL) {
@@ -79,6 +123,9 @@ int main(int argc, char** argv) {
   // Frame registration
   // ----------------------------------------
   process_flag = FLAG_FIRST_DATA_OF_FILE;
+  for (i = 0; i < WTN_DEMUX_STREAMS; i++) {
+    clock_init(&clock[i], VALID_FRAME_RATE, SIZE_LOGICAL_RECORD);
+  }
   rec_offset = ftell(f);
   while ((r=fread(record, sizeof(unsigned char), SIZE_HEADER, f))>0) {
     if (r != SIZE_HEADER) {
@@ -120,7 +167,7 @@ int main(int argc, char** argv) {
       goto main_finish;
     }
     
-    print_pg_copy_init();
+    print_pg_copy_init(table);
     
     // Read Frame
     int fmax = 0;
@@ -136,13 +183,14 @@ int main(int argc, char** argv) {
     
     // Register first frame into database
     for (i=0; i<wnr.num_asta; i++) {
-      if (wnf[i].alsep_package_id == ALSEP_PACKAGE_ID_APOLLO_17 &&
-          wnf[i].alsep_package_id == wnf[i-1].alsep_package_id) {
+      if (top_lsg_frame(wnf, i)) {
 	set_independent_data(&wnf[i]);
 	wnf[i].process_flag |= process_flag | FLAG_TOP_OF_RECORD;
 
 	wnf[i].error_flag = check_wtn_frame(wnf[i], wnr.year);
-	print_pg_copy(id, SIZE_HEADER*count_header+i*SIZE_FRAME, SIZE_FRAME, wnr, wnf[i]);
+	wnf[i].msec_of_year_corrected =
+	  clock_correct(&clock[wtn_demux_stream(wnf[i].alsep_package_id)], wnf[i].msec_of_year, wnf[i].frame_count,
+	                wnf[i].error_flag, &wnf[i].time_flag);
       }
     }
     
@@ -152,7 +200,20 @@ int main(int argc, char** argv) {
 	set_related_data(&wnf[i], &wnf[i-wnr.num_asta]);
       }
       wnf[i].error_flag = check_wtn_frame(wnf[i], wnr.year);      
-      print_pg_copy(id, SIZE_HEADER*count_header+i*SIZE_FRAME, SIZE_FRAME, wnr, wnf[i]);
+      wnf[i].msec_of_year_corrected =
+        clock_correct(&clock[wtn_demux_stream(wnf[i].alsep_package_id)], wnf[i].msec_of_year, wnf[i].frame_count,
+                      wnf[i].error_flag, &wnf[i].time_flag);
+    }
+
+    if (despiking && despike_wtn_frames(ds, wnf, fmax) < 0) {
+      log_printf(LOG_ERROR, __FILE__, __LINE__,
+		 "cannot allocate memory");
+      goto main_finish;
+    }
+    for (i = 0; i < fmax; i++) {
+      if (i >= (int)wnr.num_asta || top_lsg_frame(wnf, i)) {
+	print_pg_copy(id, SIZE_HEADER*count_header+i*SIZE_FRAME, SIZE_FRAME, wnr, wnf[i]);
+      }
     }
     
     msec_of_year_fmax = wnf[i-1].msec_of_year;
@@ -168,17 +229,20 @@ int main(int argc, char** argv) {
     free(wnf);
     wnf = NULL;
   }
+  for (i = 0; i < WTN_DEMUX_STREAMS; i++) {
+    despike_set_free(&ds[i]);
+  }
   
   putchar('\n');
   return 0;
 }
 
-void print_pg_copy_init() {
-  printf("COPY tbl_lsg ("
+void print_pg_copy_init(const char *table) {
+  printf("COPY %s ("
 	 "file_id, pos, length, frame_count, ap_station, ground_station,"
 	 "time_original, \"time\", time_diff,"
 	 "lsg,lsg_tide,lsg_free,lsg_temp, process_flag, error_flag, time_flag"
-	 ") FROM stdin;\n");
+	 ") FROM stdin;\n", table);
 }
 
 void print_pg_copy(int id, int offset, int len, wtn_record wnr, wtn_frame wnf) {
@@ -198,12 +262,19 @@ void print_pg_copy(int id, int offset, int len, wtn_record wnr, wtn_frame wnf) {
   
   msec_of_year_to_date(wnf.msec_of_year, &doy, &hh, &mm, &ss, &ms);
   
+  if (doy >= 1 && doy <= 366) {
+    sprintf(time_org,"%04d.%03d %02d:%02d:%02d.%03d", wnr.year, doy, hh,mm,ss,ms);
+  } else {
+    sprintf(time_org,"\\N");
+  }
+
+  msec_of_year_to_date(wnf.msec_of_year_corrected, &doy, &hh, &mm, &ss, &ms);
+  
   if (doy >= 1 && doy <= 366) {
     sprintf(time,"%04d.%03d %02d:%02d:%02d.%03d", wnr.year, doy, hh,mm,ss,ms);
   } else {
     sprintf(time,"\\N");
   }
-  strcpy(time_org, time);
   
   
   printf(
@@ -230,7 +301,7 @@ void print_pg_copy(int id, int offset, int len, wtn_record wnr, wtn_frame wnf) {
 	 apollo_station,
 	 wnf.alsep_tracking_station_id,
 	 time_org,
-	 time_org,
+	 time,
 	 wnf.time_diff,
 	 intary2str(wnf.lsg,COUNTS_PER_FRAME_FOR_WTN_LSG,sql_lsg,SIZE_SQL),
 	 wnf.lsg_tide,
@@ -238,7 +309,7 @@ void print_pg_copy(int id, int offset, int len, wtn_record wnr, wtn_frame wnf) {
 	 wnf.lsg_temp,
 	 wnf.process_flag,
 	 wnf.error_flag,
-	 0);
+	 wnf.time_flag);
 }
 
 void set_independent_data(wtn_frame* wnf) {
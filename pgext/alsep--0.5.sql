@@ -0,0 +1,295 @@
+-- complain if script is sourced in psql, rather than via CREATE EXTENSION
+\echo Use "CREATE EXTENSION alsep" to load this file. \quit
+
+--
+-- decoded frame types
+--	the columns follow tbl_pse, tbl_lsg and tbl_lspe of init.sql
+--	(file_id is left to the caller)
+--
+
+CREATE TYPE alsep_pse_frame AS (
+	pos	bigint
+	, length	smallint
+	, frame_count	smallint
+	, ap_station	smallint
+	, ground_station	smallint
+	, "time"	timestamp without time zone
+	, time_diff	bigint
+	, sp_z	smallint[]
+	, lp_x	smallint[]
+	, lp_y	smallint[]
+	, lp_z	smallint[]
+	, tidal_x	smallint
+	, tidal_y	smallint
+	, tidal_z	smallint
+	, inst_temp	smallint
+	, process_flag	smallint
+	, error_flag	smallint
+);
+
+CREATE TYPE alsep_wtn_frame AS (
+	pos	bigint
+	, length	smallint
+	, frame_count	smallint
+	, package_id	smallint
+	, ap_station	smallint
+	, ground_station	smallint
+	, "time"	timestamp without time zone
+	, time_diff	bigint
+	, sp_z	smallint[]
+	, lp_x	smallint[]
+	, lp_y	smallint[]
+	, lp_z	smallint[]
+	, tidal_x	smallint
+	, tidal_y	smallint
+	, tidal_z	smallint
+	, inst_temp	smallint
+	, lsg	smallint[]
+	, lsg_tide	smallint
+	, lsg_free	smallint
+	, lsg_temp	smallint
+	, process_flag	smallint
+	, error_flag	smallint
+);
+
+CREATE TYPE alsep_wth_frame AS (
+	pos	bigint
+	, length	smallint
+	, ap_station	smallint
+	, ground_station	smallint
+	, "time"	timestamp without time zone
+	, time_diff	bigint
+	, gp1	smallint[]
+	, gp2	smallint[]
+	, gp3	smallint[]
+	, gp4	smallint[]
+	, status	smallint[]
+	, process_flag	smallint
+	, error_flag	smallint
+);
+
+--
+-- alsep_decode_pse(), alsep_decode_wtn(), alsep_decode_wth()
+--	decode raw tape bytes. raw must start at a record boundary (PSE) or
+--	with the record header (WTN/WTH). base_pos is added to the offsets
+--	in raw so that pos matches the file offset of a range read.
+--
+-- example:
+--   SELECT * FROM alsep_decode_pse(pg_read_binary_file('/data/p12s/pse.a12.1.1'));
+--
+
+CREATE FUNCTION alsep_decode_pse(raw bytea, base_pos bigint DEFAULT 0, year int DEFAULT NULL)
+RETURNS SETOF alsep_pse_frame
+AS 'MODULE_PATHNAME', 'alsep_decode_pse'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION alsep_decode_wtn(raw bytea, base_pos bigint DEFAULT 0)
+RETURNS SETOF alsep_wtn_frame
+AS 'MODULE_PATHNAME', 'alsep_decode_wtn'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+CREATE FUNCTION alsep_decode_wth(raw bytea, base_pos bigint DEFAULT 0)
+RETURNS SETOF alsep_wth_frame
+AS 'MODULE_PATHNAME', 'alsep_decode_wth'
+LANGUAGE C IMMUTABLE PARALLEL SAFE;
+
+--
+-- alsep_file_path()
+--	path of a tape file of the file table, laid out as in register_*.sh
+--	(p11s/pse.a11.1.1, wtns/wtn.1.1, wths/wth.1.1) under the directory
+--	given by the alsep.data_directory setting.
+--
+-- example:
+--   ALTER DATABASE alsep SET alsep.data_directory = '/data/alsep';
+--
+CREATE FUNCTION alsep_file_path(id int) RETURNS text AS $$
+DECLARE
+  fname text;	-- file name in the file table
+  subdir text;	-- p11s, ..., p16s, wtns or wths
+BEGIN
+  SELECT f.name INTO fname FROM file f WHERE f.id = alsep_file_path.id;
+  IF fname IS NULL THEN
+    RAISE EXCEPTION 'no such file id: %', id;
+  END IF;
+
+  IF fname LIKE 'pse.a%' THEN
+    subdir := 'p' || substr(split_part(fname, '.', 2), 2) || 's';
+  ELSE
+    subdir := split_part(fname, '.', 1) || 's';
+  END IF;
+
+  RETURN current_setting('alsep.data_directory') || '/' || subdir || '/' || fname;
+END;
+$$ LANGUAGE plpgsql STABLE STRICT PARALLEL SAFE;
+
+--
+-- alsep_pse_file(), alsep_wtn_file(), alsep_wth_file()
+--	decode a range of a tape file taken from the file table.
+--	PSE ranges are counted in records, WTN/WTH ranges in frames.
+--
+-- example:
+--   SELECT * FROM alsep_pse_file(2259, 10, 2, 1976);
+--   SELECT count(*) FROM alsep_wtn_file(7216, 0, 1000) WHERE error_flag = 0;
+--
+CREATE FUNCTION alsep_pse_file(id int, first_record int DEFAULT 0, nrecord int DEFAULT NULL, year int DEFAULT NULL)
+RETURNS SETOF alsep_pse_frame AS $$
+  SELECT d.* FROM
+    (SELECT alsep_file_path($1) AS path, $2::bigint * 19456 AS off) p,
+    LATERAL alsep_decode_pse(
+      pg_read_binary_file(p.path, p.off,
+        COALESCE($3::bigint * 19456, (pg_stat_file(p.path)).size - p.off)),
+      p.off, $4) d;
+$$ LANGUAGE sql;
+
+CREATE FUNCTION alsep_wtn_file(id int, first_frame int DEFAULT 0, nframe int DEFAULT NULL)
+RETURNS SETOF alsep_wtn_frame AS $$
+  SELECT d.* FROM
+    (SELECT alsep_file_path($1) AS path, $2::bigint * 96 AS off) p,
+    LATERAL alsep_decode_wtn(
+      pg_read_binary_file(p.path, 0, 32) ||
+      pg_read_binary_file(p.path, 32 + p.off,
+        COALESCE($3::bigint * 96, (pg_stat_file(p.path)).size - 32 - p.off)),
+      p.off) d;
+$$ LANGUAGE sql;
+
+CREATE FUNCTION alsep_wth_file(id int, first_frame int DEFAULT 0, nframe int DEFAULT NULL)
+RETURNS SETOF alsep_wth_frame AS $$
+  SELECT d.* FROM
+    (SELECT alsep_file_path($1) AS path, $2::bigint * 96 AS off) p,
+    LATERAL alsep_decode_wth(
+      pg_read_binary_file(p.path, 0, 32) ||
+      pg_read_binary_file(p.path, 32 + p.off,
+        COALESCE($3::bigint * 96, (pg_stat_file(p.path)).size - 32 - p.off)),
+      p.off) d;
+$$ LANGUAGE sql;
+
+--
+-- sample level time series
+--	a frame array (sp_z, lp_x, ..., lsg, gp1, ...) holds the samples taken
+--	from the frame time on at the sample rate [Hz]
+--
+
+--
+-- alsep_sample_rate()
+--	nominal sample rate of a frame array column
+--	(64 words/frame at 1060 bps, 20 words/subframe x 30 bits at 3533 bps)
+--
+CREATE FUNCTION alsep_sample_rate(channel text) RETURNS float8 AS $$
+  SELECT CASE
+    WHEN $1 = 'sp_z' THEN 32 * 1060 / 640.0
+    WHEN $1 IN ('lp_x', 'lp_y', 'lp_z') THEN 4 * 1060 / 640.0
+    WHEN $1 = 'lsg' THEN 31 * 1060 / 640.0
+    WHEN $1 IN ('gp1', 'gp2', 'gp3', 'gp4') THEN 20 * 3533 / 600.0
+  END::float8;
+$$ LANGUAGE sql IMMUTABLE STRICT PARALLEL SAFE;
+
+--
+-- alsep_samples()
+--	expand a frame array to time-stamped samples
+--
+-- example:
+--   SELECT f.ap_station, s.* FROM tbl_pse f,
+--     LATERAL alsep_samples(f.sp_z, f.time, alsep_sample_rate('sp_z')) s
+--   WHERE f.time >= '1972-12-02 01:30:55' AND f.time < '1972-12-02 01:31:05';
+--
+CREATE FUNCTION alsep_samples(data smallint[], "time" timestamp, rate float8)
+RETURNS TABLE(nc int, "time" timestamp, value smallint)
+AS 'MODULE_PATHNAME', 'alsep_samples'
+LANGUAGE C IMMUTABLE STRICT PARALLEL SAFE;
+
+--
+-- alsep_decimate()
+--	aggregate the samples of frame arrays into nbin bins of [t0, t1)
+--	without expanding them to rows. The window is taken from the first
+--	row; min, max and mean are null for empty bins.
+--
+CREATE TYPE alsep_trace AS (
+	t0	timestamp without time zone
+	, t1	timestamp without time zone
+	, nbin	int
+	, min	smallint[]
+	, max	smallint[]
+	, mean	float8[]
+	, count	bigint[]
+);
+
+CREATE FUNCTION alsep_decimate_trans(internal, smallint[], timestamp, float8, timestamp, timestamp, int)
+RETURNS internal
+AS 'MODULE_PATHNAME', 'alsep_decimate_trans'
+LANGUAGE C PARALLEL SAFE;
+
+CREATE FUNCTION alsep_decimate_combine(internal, internal)
+RETURNS internal
+AS 'MODULE_PATHNAME', 'alsep_decimate_combine'
+LANGUAGE C PARALLEL SAFE;
+
+CREATE FUNCTION alsep_decimate_serial(internal)
+RETURNS bytea
+AS 'MODULE_PATHNAME', 'alsep_decimate_serial'
+LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION alsep_decimate_deserial(bytea, internal)
+RETURNS internal
+AS 'MODULE_PATHNAME', 'alsep_decimate_deserial'
+LANGUAGE C STRICT PARALLEL SAFE;
+
+CREATE FUNCTION alsep_decimate_final(internal)
+RETURNS alsep_trace
+AS 'MODULE_PATHNAME', 'alsep_decimate_final'
+LANGUAGE C PARALLEL SAFE;
+
+CREATE AGGREGATE alsep_decimate(data smallint[], "time" timestamp, rate float8,
+                                t0 timestamp, t1 timestamp, nbin int) (
+  SFUNC = alsep_decimate_trans,
+  STYPE = internal,
+  FINALFUNC = alsep_decimate_final,
+  COMBINEFUNC = alsep_decimate_combine,
+  SERIALFUNC = alsep_decimate_serial,
+  DESERIALFUNC = alsep_decimate_deserial,
+  PARALLEL = SAFE
+);
+
+--
+-- alsep_trace_bins()
+--	one row per bin of an alsep_decimate() result, time is the start of the bin
+--
+CREATE FUNCTION alsep_trace_bins(tr alsep_trace)
+RETURNS TABLE(bin int, "time" timestamp, min smallint, max smallint, mean float8, count bigint) AS $$
+  SELECT b, ($1).t0 + interval '1 microsecond' *
+              div(extract(epoch FROM ($1).t1 - ($1).t0) * 1000000 * (b - 1), ($1).nbin),
+         ($1).min[b], ($1).max[b], ($1).mean[b], ($1).count[b]
+  FROM generate_series(1, ($1).nbin) b;
+$$ LANGUAGE sql IMMUTABLE STRICT PARALLEL SAFE;
+
+--
+-- alsep_trace()
+--	decimated trace of a station and channel for plotting; sp_z and lp_*
+--	are read from tbl_pse, lsg from tbl_lsg and gp* from tbl_lspe.
+--	Frames with error_flag set are left out.
+--
+-- example:
+--   SELECT * FROM alsep_trace(12, 'lp_z', '1972-12-01', '1972-12-08', 1200);
+--
+CREATE FUNCTION alsep_trace(station int, channel text, t0 timestamp, t1 timestamp, nbin int)
+RETURNS TABLE(bin int, "time" timestamp, min smallint, max smallint, mean float8, count bigint) AS $$
+DECLARE
+  tbl text;	-- table holding the channel
+BEGIN
+  tbl := CASE
+    WHEN channel IN ('sp_z', 'lp_x', 'lp_y', 'lp_z') THEN 'tbl_pse'
+    WHEN channel = 'lsg' THEN 'tbl_lsg'
+    WHEN channel IN ('gp1', 'gp2', 'gp3', 'gp4') THEN 'tbl_lspe'
+  END;
+  IF tbl IS NULL THEN
+    RAISE EXCEPTION 'unknown channel: %', channel;
+  END IF;
+
+  -- a frame starting up to one second before t0 may hold samples of the window
+  RETURN QUERY EXECUTE format(
+    'SELECT b.* FROM (SELECT alsep_decimate(%I, "time", $1, $2, $3, $4) AS tr FROM %I'
+    ' WHERE ap_station = $5 AND error_flag = 0'
+    ' AND "time" >= $2 - interval ''1 second'' AND "time" < $3) s,'
+    ' LATERAL alsep_trace_bins(s.tr) b', channel, tbl)
+  USING alsep_sample_rate(channel), t0, t1, nbin, station;
+END;
+$$ LANGUAGE plpgsql STABLE STRICT PARALLEL SAFE;
@@ -0,0 +1,409 @@
+/*! @file alsep.c
+ *  @brief PostgreSQL extension decoding raw ALSEP frames inside the server
+ *  @date 2026/10/18
+ *
+ *  The set-returning functions take the raw bytes of a PSE, WTN or WTH
+ *  tape (or a range of it read by pg_read_binary_file()) and return the
+ *  same columns the pgcopy tools write into tbl_pse, tbl_lsg and tbl_lspe.
+ */
+#include "postgres.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "catalog/pg_type.h"
+#include "utils/array.h"
+#include "utils/builtins.h"
+#include "utils/datetime.h"
+#include "utils/timestamp.h"
+#include "utils/tuplestore.h"
+
+#include <stdint.h>
+#include "define.h"
+#include "error.h"
+#include "util.h"
+#include "pse.h"
+#include "wtn.h"
+#include "wth.h"
+#include "wtn_demux.h"
+#include "alsep.h"
+
+PG_MODULE_MAGIC;
+
+PG_FUNCTION_INFO_V1(alsep_decode_pse);
+PG_FUNCTION_INFO_V1(alsep_decode_wtn);
+PG_FUNCTION_INFO_V1(alsep_decode_wth);
+
+#define NATTR_PSE 17
+#define NATTR_WTN 22
+#define NATTR_WTH 13
+
+/*!
+ * @brief prepare a materialized SRF result and return its tuple store
+ */
+Tuplestorestate *alsep_init_srf(FunctionCallInfo fcinfo, TupleDesc *tupdesc) {
+  ReturnSetInfo *rsinfo = (ReturnSetInfo *)fcinfo->resultinfo;
+  MemoryContext oldcontext;
+  Tuplestorestate *tupstore;
+
+  if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo) ||
+      !(rsinfo->allowedModes & SFRM_Materialize)) {
+    ereport(ERROR,
+            (errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+             errmsg("materialize mode required, but it is not allowed in this context")));
+  }
+  if (get_call_result_type(fcinfo, NULL, tupdesc) != TYPEFUNC_COMPOSITE) {
+    elog(ERROR, "return type must be a row type");
+  }
+
+  oldcontext = MemoryContextSwitchTo(rsinfo->econtext->ecxt_per_query_memory);
+  *tupdesc = CreateTupleDescCopy(*tupdesc);
+  tupstore = tuplestore_begin_heap(true, false, work_mem);
+  rsinfo->returnMode = SFRM_Materialize;
+  rsinfo->setResult = tupstore;
+  rsinfo->setDesc = *tupdesc;
+  MemoryContextSwitchTo(oldcontext);
+
+  return tupstore;
+}
+
+/*!
+ * @brief convert year and milliseconds of year to a timestamp
+ *
+ * @return false if the day of year is out of range (NULL in tbl_pse)
+ */
+static bool msec_of_year_to_timestamp(uint32_t year, int64_t msec_of_year, Timestamp *ts) {
+  uint32_t doy, hh, mm, ss, ms;
+  int64_t days;
+
+  msec_of_year_to_date(msec_of_year, &doy, &hh, &mm, &ss, &ms);
+  if (doy < 1 || doy > 366) {
+    return false;
+  }
+  days = date2j(year, 1, 1) - POSTGRES_EPOCH_JDATE;
+  *ts = days * USECS_PER_DAY + (msec_of_year - 86400000LL) * 1000LL;
+  return true;
+}
+
+static Datum int2_array(const int32_t *data, int size) {
+  Datum *elems = (Datum *)palloc(sizeof(Datum) * (size > 0 ? size : 1));
+  int i;
+  for (i = 0; i < size; ++i) {
+    elems[i] = Int16GetDatum((int16)data[i]);
+  }
+  return PointerGetDatum(construct_array(elems, size, INT2OID, 2, true, 's'));
+}
+
+static void set_time(Datum *values, bool *nulls, int n, uint32_t year, int64_t msec_of_year) {
+  Timestamp ts;
+  if (msec_of_year_to_timestamp(year, msec_of_year, &ts)) {
+    values[n] = TimestampGetDatum(ts);
+  } else {
+    nulls[n] = true;
+  }
+}
+
+static void put_pse_frame(Tuplestorestate *tupstore, TupleDesc tupdesc,
+                          int64 pos, int len, pse_record pr, pse_frame pf) {
+  Datum values[NATTR_PSE];
+  bool nulls[NATTR_PSE];
+
+  memset(nulls, 0, sizeof(nulls));
+  values[0] = Int64GetDatum(pos);
+  values[1] = Int16GetDatum(len);
+  values[2] = Int16GetDatum(pf.frame_count);
+  values[3] = Int16GetDatum(pr.apollo_station);
+  values[4] = Int16GetDatum(pf.alsep_tracking_station_id);
+  set_time(values, nulls, 5, pr.year, pf.msec_of_year);
+  values[6] = Int64GetDatum(pf.time_diff);
+  values[7] = int2_array(pf.spz, (pr.format == FORMAT_OLD) ? COUNTS_PER_FRAME_FOR_PSE_SP : 0);
+  values[8] = int2_array(pf.lpx, COUNTS_PER_FRAME_FOR_PSE_LP);
+  values[9] = int2_array(pf.lpy, COUNTS_PER_FRAME_FOR_PSE_LP);
+  values[10] = int2_array(pf.lpz, COUNTS_PER_FRAME_FOR_PSE_LP);
+  values[11] = Int16GetDatum(pf.TidX);
+  values[12] = Int16GetDatum(pf.TidY);
+  values[13] = Int16GetDatum(pf.TidZ);
+  values[14] = Int16GetDatum(pf.InstT);
+  values[15] = Int16GetDatum(pf.process_flag);
+  values[16] = Int16GetDatum(pf.error_flag);
+  tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+}
+
+static void put_wtn_frame(Tuplestorestate *tupstore, TupleDesc tupdesc,
+                          int64 pos, wtn_record wnr, wtn_frame wnf) {
+  Datum values[NATTR_WTN];
+  bool nulls[NATTR_WTN];
+  int lsg = (wnf.alsep_package_id == ALSEP_PACKAGE_ID_APOLLO_17);
+
+  memset(nulls, 0, sizeof(nulls));
+  values[0] = Int64GetDatum(pos);
+  values[1] = Int16GetDatum(SIZE_FRAME);
+  values[2] = Int16GetDatum(wnf.frame_count);
+  values[3] = Int16GetDatum(wnf.alsep_package_id);
+  values[4] = Int16GetDatum(package_id2station_id(wnf.alsep_package_id));
+  values[5] = Int16GetDatum(wnf.alsep_tracking_station_id);
+  set_time(values, nulls, 6, wnr.year, wnf.msec_of_year);
+  values[7] = Int64GetDatum(wnf.time_diff);
+  if (!lsg) {
+    values[8] = int2_array(wnf.spz, COUNTS_PER_FRAME_FOR_WTN_SP);
+    values[9] = int2_array(wnf.lpx, COUNTS_PER_FRAME_FOR_WTN_LP);
+    values[10] = int2_array(wnf.lpy, COUNTS_PER_FRAME_FOR_WTN_LP);
+    values[11] = int2_array(wnf.lpz, COUNTS_PER_FRAME_FOR_WTN_LP);
+    values[12] = Int16GetDatum(wnf.TidX);
+    values[13] = Int16GetDatum(wnf.TidY);
+    values[14] = Int16GetDatum(wnf.TidZ);
+    values[15] = Int16GetDatum(wnf.InstT);
+    nulls[16] = nulls[17] = nulls[18] = nulls[19] = true;
+  } else {
+    nulls[8] = nulls[9] = nulls[10] = nulls[11] = true;
+    nulls[12] = nulls[13] = nulls[14] = nulls[15] = true;
+    values[16] = int2_array(wnf.lsg, COUNTS_PER_FRAME_FOR_WTN_LSG);
+    values[17] = Int16GetDatum(wnf.lsg_tide);
+    values[18] = Int16GetDatum(wnf.lsg_free);
+    values[19] = Int16GetDatum(wnf.lsg_temp);
+  }
+  values[20] = Int16GetDatum(wnf.process_flag);
+  values[21] = Int16GetDatum(wnf.error_flag);
+  tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+}
+
+static void put_wth_frame(Tuplestorestate *tupstore, TupleDesc tupdesc,
+                          int64 pos, wth_record whr, wth_frame whf) {
+  Datum values[NATTR_WTH];
+  bool nulls[NATTR_WTH];
+
+  memset(nulls, 0, sizeof(nulls));
+  values[0] = Int64GetDatum(pos);
+  values[1] = Int16GetDatum(SIZE_FRAME);
+  values[2] = Int16GetDatum(package_id2station_id(whf.alsep_package_id));
+  values[3] = Int16GetDatum(whf.alsep_tracking_station_id);
+  set_time(values, nulls, 4, whr.year, whf.msec_of_year);
+  values[5] = Int64GetDatum(whf.time_diff);
+  values[6] = int2_array(whf.dp1, COUNTS_PER_FRAME_FOR_WTH_GP);
+  values[7] = int2_array(whf.dp6, COUNTS_PER_FRAME_FOR_WTH_GP);
+  values[8] = int2_array(whf.dp11, COUNTS_PER_FRAME_FOR_WTH_GP);
+  values[9] = int2_array(whf.dp16, COUNTS_PER_FRAME_FOR_WTH_GP);
+  values[10] = int2_array(whf.status, COUNTS_PER_FRAME_FOR_WTH_GP);
+  values[11] = Int16GetDatum(whf.process_flag);
+  values[12] = Int16GetDatum(whf.error_flag);
+  tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+}
+
+/*!
+ * @brief count the headers at the top of a WTN/WTH buffer
+ *
+ * @return 2 if the header is duplicated, otherwise 1
+ */
+static int count_headers(const unsigned char *buf, size_t size) {
+  if (size >= SIZE_HEADER * 2 && memcmp(buf, buf + SIZE_HEADER, SIZE_HEADER) == 0) {
+    return 2;
+  }
+  ereport(WARNING, (errmsg("header is not duplicated.")));
+  return 1;
+}
+
+/*!
+ * @brief decode PSE records (19456 octets each) into tbl_pse rows
+ *
+ * alsep_decode_pse(raw bytea, base_pos bigint, year int)
+ */
+Datum alsep_decode_pse(PG_FUNCTION_ARGS) {
+  TupleDesc tupdesc;
+  Tuplestorestate *tupstore = alsep_init_srf(fcinfo, &tupdesc);
+  bytea *raw;
+  const unsigned char *buf;
+  size_t size, rec_offset;
+  int64 base_pos;
+  int year_override;
+  uint32_t process_flag = FLAG_FIRST_DATA_OF_FILE;
+  uint64_t msec_of_year_fmax = 0;
+  int32_t prev_frame = -1;
+  pse_record pr;
+  pse_frame *pf;
+  int i, nframes, size_part;
+
+  if (PG_ARGISNULL(0)) {
+    return (Datum)0;
+  }
+  raw = PG_GETARG_BYTEA_PP(0);
+  buf = (const unsigned char *)VARDATA_ANY(raw);
+  size = VARSIZE_ANY_EXHDR(raw);
+  base_pos = PG_ARGISNULL(1) ? 0 : PG_GETARG_INT64(1);
+  year_override = PG_ARGISNULL(2) ? -1 : PG_GETARG_INT32(2);
+
+  pf = (pse_frame *)palloc(sizeof(pse_frame) * (MAX_PSE_FRAME + 1));
+
+  for (rec_offset = 0; rec_offset + SIZE_RECORD <= size; rec_offset += SIZE_RECORD) {
+    const unsigned char *record = buf + rec_offset;
+
+    CHECK_FOR_INTERRUPTS();
+
+    pr = binary2pse_record(record);
+    if (year_override != -1) {
+      pr.year = year_override;
+    }
+    pr.error_flag = check_pse_record(pr);
+
+    size_part = (pr.format == FORMAT_OLD) ? SIZE_DATA_PART_OLD : SIZE_DATA_PART_NEW;
+    nframes = SIZE_LOGICAL_RECORD * pr.phys_records;
+    if (nframes > (SIZE_RECORD - SIZE_PSE_HEADER) / size_part) {
+      nframes = (SIZE_RECORD - SIZE_PSE_HEADER) / size_part;
+    }
+    if (nframes < 1) {
+      continue;
+    }
+
+    pf[0] = binary2pse_frame(pr, &record[SIZE_PSE_HEADER]);
+    pf[0].spz[0] = pf[0].spz[1];
+    pf[0].time_diff = pf[0].msec_of_year - msec_of_year_fmax;
+    pf[0].prev_frame = prev_frame;
+    pf[0].process_flag = process_flag | FLAG_TOP_OF_RECORD | FLAG_FIRST_DATA_COPIED;
+    pf[0].error_flag = check_pse_frame(pf[0], pr.apollo_station, pr.year);
+    put_pse_frame(tupstore, tupdesc, base_pos + rec_offset + SIZE_PSE_HEADER,
+                  size_part, pr, pf[0]);
+
+    for (i = 1; i < nframes; i++) {
+      long frame_offset = SIZE_PSE_HEADER + size_part * i;
+      pf[i] = binary2pse_frame(pr, &record[frame_offset]);
+      pf[i].time_diff = pf[i].msec_of_year - pf[i-1].msec_of_year;
+      pf[i].prev_frame = pf[i-1].frame_count;
+      pf[i].process_flag = 0;
+      pf[i].error_flag = check_pse_frame(pf[i], pr.apollo_station, pr.year);
+
+      if (pf[i].error_flag == ERROR_NONE) {
+        //! ALSEP WORD 2
+        pf[i].spz[0] = interp(pf[i-1].spz[30], pf[i-1].spz[31],
+                              pf[i].spz[1], pf[i].spz[2]);
+      } else {
+        pf[i].spz[0] = pf[i].spz[1];
+        pf[i].process_flag |= FLAG_FIRST_DATA_COPIED;
+      }
+      put_pse_frame(tupstore, tupdesc, base_pos + rec_offset + frame_offset,
+                    size_part, pr, pf[i]);
+    }
+    msec_of_year_fmax = pf[nframes-1].msec_of_year;
+    prev_frame = pf[nframes-1].frame_count;
+    process_flag = 0;
+  }
+
+  if (rec_offset != size) {
+    ereport(WARNING, (errmsg("invalid data size: %zu", size - rec_offset)));
+  }
+
+  pfree(pf);
+  return (Datum)0;
+}
+
+/*!
+ * @brief decode a WTN buffer (header(s) followed by 96-octet frames)
+ *
+ * alsep_decode_wtn(raw bytea, base_pos bigint)
+ */
+Datum alsep_decode_wtn(PG_FUNCTION_ARGS) {
+  TupleDesc tupdesc;
+  Tuplestorestate *tupstore = alsep_init_srf(fcinfo, &tupdesc);
+  bytea *raw;
+  const unsigned char *buf;
+  size_t size;
+  int64 base_pos;
+  wtn_record wnr;
+  wtn_frame *wnf;
+  wtn_demux demux;
+  int i, fmax, num_header, num_asta, offset;
+
+  if (PG_ARGISNULL(0)) {
+    return (Datum)0;
+  }
+  raw = PG_GETARG_BYTEA_PP(0);
+  buf = (const unsigned char *)VARDATA_ANY(raw);
+  size = VARSIZE_ANY_EXHDR(raw);
+  base_pos = PG_ARGISNULL(1) ? 0 : PG_GETARG_INT64(1);
+
+  if (size < SIZE_HEADER) {
+    return (Datum)0;
+  }
+  wnr = binary2wtn_record(buf);
+  wnr.error_flag = check_wtn_record(wnr);
+  num_header = count_headers(buf, size);
+  offset = SIZE_HEADER * num_header;
+
+  fmax = (size - offset) / SIZE_FRAME;
+  if (fmax < 1) {
+    return (Datum)0;
+  }
+  wnf = (wtn_frame *)palloc(sizeof(wtn_frame) * fmax);
+  for (i = 0; i < fmax; i++) {
+    wnf[i] = binary2wtn_frame(wnr, &buf[offset + i * SIZE_FRAME]);
+  }
+
+  // every frame is linked to the last frame of its own station, as the loaders do
+  num_asta = (wnr.num_asta >= 1U && wnr.num_asta <= 5U) ? wnr.num_asta : 1;
+  wtn_demux_init(&demux);
+  for (i = 0; i < fmax; i++) {
+    CHECK_FOR_INTERRUPTS();
+    wtn_demux_link(&demux, &wnf[i]);
+    if (i < num_asta) {
+      wnf[i].process_flag |= FLAG_FIRST_DATA_OF_FILE | FLAG_TOP_OF_RECORD;
+    }
+    wnf[i].error_flag = check_wtn_frame(wnf[i], wnr.year);
+    put_wtn_frame(tupstore, tupdesc, base_pos + offset + i * SIZE_FRAME, wnr, wnf[i]);
+  }
+
+  pfree(wnf);
+  return (Datum)0;
+}
+
+/*!
+ * @brief decode a WTH buffer (header(s) followed by 96-octet frames)
+ *
+ * alsep_decode_wth(raw bytea, base_pos bigint)
+ */
+Datum alsep_decode_wth(PG_FUNCTION_ARGS) {
+  TupleDesc tupdesc;
+  Tuplestorestate *tupstore = alsep_init_srf(fcinfo, &tupdesc);
+  bytea *raw;
+  const unsigned char *buf;
+  size_t size;
+  int64 base_pos;
+  wth_record whr;
+  wth_frame whf, before;
+  int i, fmax, num_header, offset;
+
+  if (PG_ARGISNULL(0)) {
+    return (Datum)0;
+  }
+  raw = PG_GETARG_BYTEA_PP(0);
+  buf = (const unsigned char *)VARDATA_ANY(raw);
+  size = VARSIZE_ANY_EXHDR(raw);
+  base_pos = PG_ARGISNULL(1) ? 0 : PG_GETARG_INT64(1);
+
+  if (size < SIZE_HEADER) {
+    return (Datum)0;
+  }
+  whr = binary2wth_record(buf);
+  whr.error_flag = check_wth_record(whr);
+  num_header = count_headers(buf, size);
+  offset = SIZE_HEADER * num_header;
+
+  fmax = (size - offset) / SIZE_FRAME;
+  for (i = 0; i < fmax; i++) {
+    CHECK_FOR_INTERRUPTS();
+    whf = binary2wth_frame(whr, &buf[offset + i * SIZE_FRAME]);
+    if (i == 0 || whf.alsep_package_id != before.alsep_package_id) {
+      if (whf.alsep_package_id != ALSEP_PACKAGE_ID_APOLLO_17) {
+        whf.process_flag = FLAG_FIRST_DATA_COPIED;
+      }
+      whf.time_diff = whf.msec_of_year;
+      whf.prev_frame = -1;
+      if (i == 0) {
+        whf.process_flag |= FLAG_FIRST_DATA_OF_FILE | FLAG_TOP_OF_RECORD;
+      }
+    } else {
+      whf.time_diff = whf.msec_of_year - before.msec_of_year;
+    }
+    whf.error_flag = check_wth_frame(whf, whr.year);
+    put_wth_frame(tupstore, tupdesc, base_pos + offset + i * SIZE_FRAME, whr, whf);
+    before = whf;
+  }
+
+  return (Datum)0;
+}
@@ -0,0 +1,13 @@
+/*! @file alsep.h
+ *  @brief functions shared by the modules of the alsep extension
+ *  @date 2026/10/18
+ */
+#ifndef __ALSEP_EXT_H__
+#define __ALSEP_EXT_H__
+
+#include "funcapi.h"
+#include "utils/tuplestore.h"
+
+Tuplestorestate *alsep_init_srf(FunctionCallInfo fcinfo, TupleDesc *tupdesc);
+
+#endif
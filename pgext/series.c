@@ -0,0 +1,363 @@
+/*! @file series.c
+ *  @brief sample level time series functions over the frame arrays
+ *  @date 2026/10/18
+ *
+ *  A frame array (sp_z, lp_x, lsg, gp1, ...) holds the samples taken from
+ *  the frame time on at a fixed rate. alsep_samples() expands one array to
+ *  time-stamped samples and the alsep_decimate() aggregate reduces any
+ *  number of them to min/max/mean/count bins of a time window without
+ *  materializing the samples as rows.
+ */
+#include "postgres.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "access/htup_details.h"
+#include "catalog/pg_type.h"
+#include "libpq/pqformat.h"
+#include "utils/array.h"
+#include "utils/builtins.h"
+#include "utils/timestamp.h"
+#include "utils/tuplestore.h"
+
+#include <math.h>
+#include "alsep.h"
+
+PG_FUNCTION_INFO_V1(alsep_samples);
+PG_FUNCTION_INFO_V1(alsep_decimate_trans);
+PG_FUNCTION_INFO_V1(alsep_decimate_combine);
+PG_FUNCTION_INFO_V1(alsep_decimate_serial);
+PG_FUNCTION_INFO_V1(alsep_decimate_deserial);
+PG_FUNCTION_INFO_V1(alsep_decimate_final);
+
+#define NATTR_SAMPLE 3
+#define NATTR_TRACE 7
+#define MAX_NBIN 1000000
+
+//! state of alsep_decimate(), allocated in one chunk
+typedef struct tag_trace_state {
+  Timestamp t0, t1;
+  int nbin;
+  int32 *min, *max;
+  float8 *sum;
+  int64 *count;
+} trace_state;
+
+/*!
+ * @brief check that a frame array is a one dimensional smallint array
+ *
+ * @return number of elements (0 for an empty array)
+ */
+static int frame_array_size(ArrayType *arr) {
+  if (ARR_ELEMTYPE(arr) != INT2OID) {
+    ereport(ERROR, (errcode(ERRCODE_DATATYPE_MISMATCH),
+                    errmsg("frame array must be smallint[]")));
+  }
+  if (ARR_NDIM(arr) > 1) {
+    ereport(ERROR, (errcode(ERRCODE_ARRAY_SUBSCRIPT_ERROR),
+                    errmsg("frame array must be one-dimensional")));
+  }
+  return ArrayGetNItems(ARR_NDIM(arr), ARR_DIMS(arr));
+}
+
+static void check_rate(float8 rate) {
+  if (!(rate > 0.0) || isinf(rate)) {
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                    errmsg("sample rate must be positive: %g", rate)));
+  }
+}
+
+//! time of the i-th sample of a frame
+static inline Timestamp sample_time(Timestamp t, int i, float8 rate) {
+  return t + (int64)rint(i * (float8)USECS_PER_SEC / rate);
+}
+
+static inline bool is_null_elem(const bits8 *bitmap, int i) {
+  return bitmap != NULL && !(bitmap[i / 8] & (1 << (i % 8)));
+}
+
+/*!
+ * @brief expand a frame array to time-stamped samples
+ *
+ * alsep_samples(data smallint[], "time" timestamp, rate float8)
+ *   RETURNS TABLE(nc int, "time" timestamp, value smallint)
+ */
+Datum alsep_samples(PG_FUNCTION_ARGS) {
+  TupleDesc tupdesc;
+  Tuplestorestate *tupstore = alsep_init_srf(fcinfo, &tupdesc);
+  ArrayType *arr = PG_GETARG_ARRAYTYPE_P(0);
+  Timestamp t = PG_GETARG_TIMESTAMP(1);
+  float8 rate = PG_GETARG_FLOAT8(2);
+  const int16 *data = (const int16 *)ARR_DATA_PTR(arr);
+  const bits8 *bitmap = ARR_NULLBITMAP(arr);
+  Datum values[NATTR_SAMPLE];
+  bool nulls[NATTR_SAMPLE] = {false, false, false};
+  int i, k, n;
+
+  n = frame_array_size(arr);
+  check_rate(rate);
+
+  for (i = 0, k = 0; i < n; i++) {
+    if (is_null_elem(bitmap, i)) {
+      continue;
+    }
+    values[0] = Int32GetDatum(i + 1);
+    values[1] = TimestampGetDatum(sample_time(t, i, rate));
+    values[2] = Int16GetDatum(data[k++]);
+    tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+  }
+
+  return (Datum)0;
+}
+
+static trace_state *trace_state_new(MemoryContext context, Timestamp t0, Timestamp t1, int nbin) {
+  trace_state *st;
+  char *p;
+  int i;
+
+  if (t1 <= t0) {
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                    errmsg("end of window must be after its start")));
+  }
+  if (nbin < 1 || nbin > MAX_NBIN) {
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                    errmsg("number of bins must be between 1 and %d", MAX_NBIN)));
+  }
+
+  p = MemoryContextAllocZero(context, MAXALIGN(sizeof(trace_state)) +
+                             (sizeof(int32) * 2 + sizeof(float8) + sizeof(int64)) * nbin);
+  st = (trace_state *)p;
+  p += MAXALIGN(sizeof(trace_state));
+  st->sum = (float8 *)p;
+  p += sizeof(float8) * nbin;
+  st->count = (int64 *)p;
+  p += sizeof(int64) * nbin;
+  st->min = (int32 *)p;
+  p += sizeof(int32) * nbin;
+  st->max = (int32 *)p;
+
+  st->t0 = t0;
+  st->t1 = t1;
+  st->nbin = nbin;
+  for (i = 0; i < nbin; i++) {
+    st->min[i] = PG_INT32_MAX;
+    st->max[i] = PG_INT32_MIN;
+  }
+  return st;
+}
+
+//! offset of the start of bin b from t0, floor(b * (t1 - t0) / nbin)
+static inline int64 bin_start(const trace_state *st, int b) {
+  int64 span = st->t1 - st->t0;
+  return (span / st->nbin) * b + (span % st->nbin) * b / st->nbin;
+}
+
+//! bin holding the offset off from t0, estimated in float8 and fixed up on the edges
+static inline int bin_of(const trace_state *st, float8 scale, int64 off) {
+  int b = (int)((float8)off * scale);
+
+  if (b >= st->nbin) {
+    b = st->nbin - 1;
+  }
+  while (b > 0 && bin_start(st, b) > off) {
+    b--;
+  }
+  while (b + 1 < st->nbin && bin_start(st, b + 1) <= off) {
+    b++;
+  }
+  return b;
+}
+
+static void trace_state_add(trace_state *st, ArrayType *arr, Timestamp t, float8 rate) {
+  const int16 *data = (const int16 *)ARR_DATA_PTR(arr);
+  const bits8 *bitmap = ARR_NULLBITMAP(arr);
+  float8 scale = (float8)st->nbin / (float8)(st->t1 - st->t0);
+  int i, k, n, b;
+
+  n = frame_array_size(arr);
+  for (i = 0, k = 0; i < n; i++) {
+    Timestamp ts;
+    int32 v;
+
+    if (is_null_elem(bitmap, i)) {
+      continue;
+    }
+    v = data[k++];
+    ts = sample_time(t, i, rate);
+    if (ts < st->t0 || ts >= st->t1) {
+      continue;
+    }
+    b = bin_of(st, scale, ts - st->t0);
+    if (v < st->min[b]) st->min[b] = v;
+    if (v > st->max[b]) st->max[b] = v;
+    st->sum[b] += v;
+    st->count[b]++;
+  }
+}
+
+/*!
+ * @brief transition function of alsep_decimate()
+ *
+ * alsep_decimate(data smallint[], "time" timestamp, rate float8,
+ *                t0 timestamp, t1 timestamp, nbin int)
+ * The window (t0, t1, nbin) is taken from the first row.
+ */
+Datum alsep_decimate_trans(PG_FUNCTION_ARGS) {
+  MemoryContext aggcontext;
+  trace_state *st = PG_ARGISNULL(0) ? NULL : (trace_state *)PG_GETARG_POINTER(0);
+
+  if (!AggCheckCallContext(fcinfo, &aggcontext)) {
+    elog(ERROR, "alsep_decimate_trans called in non-aggregate context");
+  }
+
+  if (st == NULL) {
+    if (PG_ARGISNULL(4) || PG_ARGISNULL(5) || PG_ARGISNULL(6)) {
+      ereport(ERROR, (errcode(ERRCODE_NULL_VALUE_NOT_ALLOWED),
+                      errmsg("window of alsep_decimate() must not be null")));
+    }
+    st = trace_state_new(aggcontext, PG_GETARG_TIMESTAMP(4), PG_GETARG_TIMESTAMP(5),
+                         PG_GETARG_INT32(6));
+  }
+
+  // frames without data (e.g. sp_z of the new format) are skipped
+  if (!PG_ARGISNULL(1) && !PG_ARGISNULL(2) && !PG_ARGISNULL(3)) {
+    float8 rate = PG_GETARG_FLOAT8(3);
+    check_rate(rate);
+    trace_state_add(st, PG_GETARG_ARRAYTYPE_P(1), PG_GETARG_TIMESTAMP(2), rate);
+  }
+
+  PG_RETURN_POINTER(st);
+}
+
+Datum alsep_decimate_combine(PG_FUNCTION_ARGS) {
+  MemoryContext aggcontext;
+  trace_state *st1 = PG_ARGISNULL(0) ? NULL : (trace_state *)PG_GETARG_POINTER(0);
+  trace_state *st2 = PG_ARGISNULL(1) ? NULL : (trace_state *)PG_GETARG_POINTER(1);
+  int i;
+
+  if (!AggCheckCallContext(fcinfo, &aggcontext)) {
+    elog(ERROR, "alsep_decimate_combine called in non-aggregate context");
+  }
+  if (st2 == NULL) {
+    if (st1 == NULL) {
+      PG_RETURN_NULL();
+    }
+    PG_RETURN_POINTER(st1);
+  }
+
+  if (st1 == NULL) {
+    st1 = trace_state_new(aggcontext, st2->t0, st2->t1, st2->nbin);
+  } else if (st1->t0 != st2->t0 || st1->t1 != st2->t1 || st1->nbin != st2->nbin) {
+    ereport(ERROR, (errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+                    errmsg("window of alsep_decimate() must be the same for all rows")));
+  }
+
+  for (i = 0; i < st1->nbin; i++) {
+    if (st2->min[i] < st1->min[i]) st1->min[i] = st2->min[i];
+    if (st2->max[i] > st1->max[i]) st1->max[i] = st2->max[i];
+    st1->sum[i] += st2->sum[i];
+    st1->count[i] += st2->count[i];
+  }
+  PG_RETURN_POINTER(st1);
+}
+
+Datum alsep_decimate_serial(PG_FUNCTION_ARGS) {
+  trace_state *st = (trace_state *)PG_GETARG_POINTER(0);
+  StringInfoData buf;
+  int i;
+
+  if (!AggCheckCallContext(fcinfo, NULL)) {
+    elog(ERROR, "alsep_decimate_serial called in non-aggregate context");
+  }
+
+  pq_begintypsend(&buf);
+  pq_sendint64(&buf, st->t0);
+  pq_sendint64(&buf, st->t1);
+  pq_sendint32(&buf, st->nbin);
+  for (i = 0; i < st->nbin; i++) {
+    pq_sendint32(&buf, st->min[i]);
+    pq_sendint32(&buf, st->max[i]);
+    pq_sendfloat8(&buf, st->sum[i]);
+    pq_sendint64(&buf, st->count[i]);
+  }
+  PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+
+Datum alsep_decimate_deserial(PG_FUNCTION_ARGS) {
+  bytea *sstate = PG_GETARG_BYTEA_PP(0);
+  StringInfoData buf;
+  trace_state *st;
+  Timestamp t0, t1;
+  int i, nbin;
+
+  if (!AggCheckCallContext(fcinfo, NULL)) {
+    elog(ERROR, "alsep_decimate_deserial called in non-aggregate context");
+  }
+
+  initStringInfo(&buf);
+  appendBinaryStringInfo(&buf, VARDATA_ANY(sstate), VARSIZE_ANY_EXHDR(sstate));
+  t0 = pq_getmsgint64(&buf);
+  t1 = pq_getmsgint64(&buf);
+  nbin = pq_getmsgint(&buf, 4);
+  st = trace_state_new(CurrentMemoryContext, t0, t1, nbin);
+  for (i = 0; i < nbin; i++) {
+    st->min[i] = pq_getmsgint(&buf, 4);
+    st->max[i] = pq_getmsgint(&buf, 4);
+    st->sum[i] = pq_getmsgfloat8(&buf);
+    st->count[i] = pq_getmsgint64(&buf);
+  }
+  pq_getmsgend(&buf);
+  pfree(buf.data);
+
+  PG_RETURN_POINTER(st);
+}
+
+/*!
+ * @brief final function of alsep_decimate()
+ *
+ * @return alsep_trace(t0, t1, nbin, min, max, mean, count),
+ *         min/max/mean are null for empty bins
+ */
+Datum alsep_decimate_final(PG_FUNCTION_ARGS) {
+  trace_state *st = PG_ARGISNULL(0) ? NULL : (trace_state *)PG_GETARG_POINTER(0);
+  TupleDesc tupdesc;
+  Datum values[NATTR_TRACE];
+  bool nulls[NATTR_TRACE] = {false, false, false, false, false, false, false};
+  Datum *vmin, *vmax, *vmean, *vcount;
+  bool *empty;
+  int dims[1], lbs[1] = {1};
+  int i;
+
+  if (st == NULL) {
+    PG_RETURN_NULL();
+  }
+  if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE) {
+    elog(ERROR, "return type must be a row type");
+  }
+  tupdesc = BlessTupleDesc(tupdesc);
+
+  vmin = (Datum *)palloc(sizeof(Datum) * st->nbin);
+  vmax = (Datum *)palloc(sizeof(Datum) * st->nbin);
+  vmean = (Datum *)palloc(sizeof(Datum) * st->nbin);
+  vcount = (Datum *)palloc(sizeof(Datum) * st->nbin);
+  empty = (bool *)palloc(sizeof(bool) * st->nbin);
+  for (i = 0; i < st->nbin; i++) {
+    empty[i] = (st->count[i] == 0);
+    vmin[i] = Int16GetDatum(empty[i] ? 0 : (int16)st->min[i]);
+    vmax[i] = Int16GetDatum(empty[i] ? 0 : (int16)st->max[i]);
+    vmean[i] = Float8GetDatum(empty[i] ? 0.0 : st->sum[i] / st->count[i]);
+    vcount[i] = Int64GetDatum(st->count[i]);
+  }
+  dims[0] = st->nbin;
+
+  values[0] = TimestampGetDatum(st->t0);
+  values[1] = TimestampGetDatum(st->t1);
+  values[2] = Int32GetDatum(st->nbin);
+  values[3] = PointerGetDatum(construct_md_array(vmin, empty, 1, dims, lbs, INT2OID, 2, true, 's'));
+  values[4] = PointerGetDatum(construct_md_array(vmax, empty, 1, dims, lbs, INT2OID, 2, true, 's'));
+  values[5] = PointerGetDatum(construct_md_array(vmean, empty, 1, dims, lbs, FLOAT8OID, 8,
+                                                 FLOAT8PASSBYVAL, 'd'));
+  values[6] = PointerGetDatum(construct_md_array(vcount, NULL, 1, dims, lbs, INT8OID, 8,
+                                                 FLOAT8PASSBYVAL, 'd'));
+
+  PG_RETURN_DATUM(HeapTupleGetDatum(heap_form_tuple(tupdesc, values, nulls)));
+}
@@ -0,0 +1,47 @@
+CREATE EXTENSION alsep;
+
+-- one old format record of Apollo 12 in 1972 (3 x 90 frames, 604 msec apart)
+CREATE TEMP TABLE raw_pse AS
+SELECT decode('0001000c0001000107b4000000030000' || string_agg(
+    lpad(to_hex(msec >> 4), 8, '0') || to_hex(msec & 15) || '1' || '000000' ||
+    'e24000' || lpad(to_hex((i % 90) * 2), 2, '0') || repeat('00', 60),
+    '' ORDER BY i), 'hex') AS b
+FROM (SELECT i, 330 * 86400000::bigint + i * 604 AS msec
+      FROM generate_series(0, 269) i) s;
+
+SELECT count(*) AS frames, sum((error_flag = 0)::int) AS valid
+FROM alsep_decode_pse((SELECT b FROM raw_pse));
+
+SELECT pos, frame_count, process_flag, error_flag, time_diff
+FROM alsep_decode_pse((SELECT b FROM raw_pse), 19456) LIMIT 3;
+
+SELECT to_char("time", 'YYYY-MM-DD HH24:MI:SS.MS') AS time, ap_station, ground_station
+FROM alsep_decode_pse((SELECT b FROM raw_pse)) OFFSET 268;
+
+-- year override as with pse2pgcopy -y
+SELECT DISTINCT extract(year FROM "time") AS year
+FROM alsep_decode_pse((SELECT b FROM raw_pse), 0, 1976);
+
+-- trailing bytes of a broken record are ignored
+SELECT count(*) FROM alsep_decode_pse((SELECT b || '\x00'::bytea FROM raw_pse));
+
+SELECT count(*) FROM alsep_decode_pse(NULL);
+
+-- duplicated WTN header followed by Apollo 12 and 17 frames of 1976
+CREATE TEMP TABLE raw_wtn AS
+SELECT decode(repeat('000300000002000107b8000000000000', 2) || string_agg(
+    lpad(to_hex(msec >> 4), 8, '0') || to_hex(msec & 15) || '1' ||
+    CASE WHEN i % 2 = 0 THEN '20' ELSE 'a0' END || '0000' ||
+    'e24000' || lpad(to_hex((i / 2 % 90) * 2), 2, '0') || repeat('00', 84),
+    '' ORDER BY i), 'hex') AS b
+FROM (SELECT i, 100 * 86400000::bigint + i / 2 * 604 AS msec
+      FROM generate_series(0, 19) i) s;
+
+SELECT package_id, ap_station, count(*) AS frames, count(sp_z) AS sp_z,
+       count(lsg) AS lsg, sum((error_flag = 0)::int) AS valid
+FROM alsep_decode_wtn((SELECT b FROM raw_wtn))
+GROUP BY 1, 2 ORDER BY 1;
+
+SELECT pos, frame_count, time_diff, lsg[1] AS lsg1
+FROM alsep_decode_wtn((SELECT b FROM raw_wtn), 960)
+WHERE package_id = 5 LIMIT 2;
@@ -0,0 +1,23 @@
+SELECT alsep_sample_rate('sp_z') AS sp, alsep_sample_rate('lp_z') AS lp,
+       alsep_sample_rate('lsg') AS lsg, alsep_sample_rate('xx') AS unknown;
+SELECT nc, to_char("time", 'HH24:MI:SS.US') AS time, value
+FROM alsep_samples('{1,-2,NULL,4}', '1972-11-25 00:00:00', 6.625);
+SELECT count(*) FROM alsep_samples('{}', '1972-11-25 00:00:00', 53);
+SELECT * FROM alsep_samples('{1}', '1972-11-25 00:00:00', 0);
+-- two frames of 4 samples at 4 Hz, one frame without data
+CREATE TEMP TABLE frames (data smallint[], "time" timestamp);
+INSERT INTO frames VALUES
+  ('{0,10,-5,3}', '1972-11-25 00:00:00'),
+  ('{7,8,9,6}', '1972-11-25 00:00:01'),
+  (NULL, '1972-11-25 00:00:02');
+SELECT bin, to_char("time", 'HH24:MI:SS.MS') AS time, min, max, mean, count
+FROM (SELECT alsep_decimate(data, "time", 4, '1972-11-25 00:00:00', '1972-11-25 00:00:03', 6) AS tr
+      FROM frames) s, alsep_trace_bins(s.tr);
+-- samples outside of the window are dropped
+SELECT (alsep_decimate(data, "time", 4, '1972-11-25 00:00:00.5', '1972-11-25 00:00:01.5', 1)).count
+FROM frames;
+SELECT alsep_decimate(data, "time", 4, '1972-11-25 00:00:00', '1972-11-25 00:00:03', 1)
+FROM frames WHERE false;
+SELECT alsep_decimate(data, "time", 4, '1972-11-25 00:00:03', '1972-11-25 00:00:00', 1)
+FROM frames;
+SELECT * FROM alsep_trace(12, 'xx', '1972-11-25', '1972-11-26', 10);
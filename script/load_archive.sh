@@ -0,0 +1,176 @@
+#!/bin/bash
+#
+# load_archive.sh - initial ingest of the ALSEP archive into PostgreSQL
+#
+# The tables are created UNLOGGED, the register_*.sh command lists are run
+# as N parallel pgcopy streams (one psql session per tape file), the tables
+# are switched to LOGGED and the indexes of create_index.sql are built in
+# parallel with tuned maintenance settings. The elapsed time of every phase
+# is reported on stderr, with the commands that failed to load; the exit
+# status is 1 if any did.
+#
+# usage:
+#   load_archive.sh [-d dbname] [-j jobs] [-m maintenance_work_mem]
+#                   [-w parallel_workers] [-s sqldir] [-C datadir]
+#                   [-p phases] register_script ...
+#
+# example:
+#   load_archive.sh -d alsep -j 16 -m 2GB -C /data/alsep \
+#       register_pse.sh register_wtn.sh register_wtn_lsg.sh register_wth.sh
+#
+set -eu -o pipefail
+
+DBNAME=${PGDATABASE:-alsep}
+JOBS=$(nproc 2>/dev/null || echo 4)
+MAINTENANCE_WORK_MEM=1GB
+PARALLEL_WORKERS=4
+SQLDIR=
+for d in "$(dirname "$0")/../share/alsep_tools" "$(dirname "$0")/../sql"; do
+  if [ -z "$SQLDIR" ] && [ -f "$d/init.sql" ]; then
+    SQLDIR=$d
+  fi
+done
+DATADIR=.
+PHASES=schema,load,logged,index,analyze
+TABLES="tbl_pse tbl_lsg tbl_lspe"
+
+usage() {
+  echo "usage: $0 [-d dbname] [-j jobs] [-m maintenance_work_mem] [-w parallel_workers]" >&2
+  echo "          [-s sqldir] [-C datadir] [-p phases] register_script ..." >&2
+  echo "phases: $PHASES" >&2
+}
+
+log() {
+  echo "$(date '+%b %d %H:%M:%S') INFO: $*" >&2
+}
+
+while getopts "d:j:m:w:s:C:p:h" ch; do
+  case $ch in
+    d) DBNAME=$OPTARG ;;
+    j) JOBS=$OPTARG ;;
+    m) MAINTENANCE_WORK_MEM=$OPTARG ;;
+    w) PARALLEL_WORKERS=$OPTARG ;;
+    s) SQLDIR=$OPTARG ;;
+    C) DATADIR=$OPTARG ;;
+    p) PHASES=$OPTARG ;;
+    *) usage; exit 1 ;;
+  esac
+done
+shift $((OPTIND - 1))
+
+if [ -z "$SQLDIR" ]; then
+  echo "cannot find init.sql, use -s sqldir" >&2
+  exit 1
+fi
+
+PSQL="psql -X -q -v ON_ERROR_STOP=1 -d $DBNAME"
+SETTINGS="SET maintenance_work_mem = '$MAINTENANCE_WORK_MEM';
+SET max_parallel_maintenance_workers = $PARALLEL_WORKERS;"
+
+# resolve the command lists before changing to the data directory
+SCRIPTS=()
+for s in "$@"; do
+  SCRIPTS+=("$(cd "$(dirname "$s")" && pwd)/$(basename "$s")")
+done
+
+has_phase() {
+  case ",$PHASES," in
+    *",$1,"*) return 0 ;;
+    *) return 1 ;;
+  esac
+}
+
+# run every line of stdin as an SQL statement, $JOBS sessions at a time
+run_parallel_sql() {
+  local prefix=$1
+  tr '\n' '\0' | xargs -0 -r -P "$JOBS" -I{} \
+    $PSQL -c "$prefix {}"
+}
+
+declare -A ELAPSED
+ORDER=()
+run_phase() {
+  local name=$1
+  shift
+  local t0 t1
+  log "phase $name: start"
+  t0=$(date +%s)
+  "$@"
+  t1=$(date +%s)
+  ELAPSED[$name]=$((t1 - t0))
+  ORDER+=("$name")
+  log "phase $name: done in ${ELAPSED[$name]} sec"
+}
+
+phase_schema() {
+  # tables are written once and indexed afterwards; skip the WAL while loading
+  sed -e 's/^CREATE TABLE/CREATE UNLOGGED TABLE/' \
+      -e 's/^DROP TABLE \(tbl_[a-z]*\)/DROP TABLE IF EXISTS \1/' \
+      "$SQLDIR/init.sql" | $PSQL
+}
+
+# run one command of a list into psql, print its status and the command
+load_one() {
+  if bash -o pipefail -c "$1 | $PSQL" < /dev/null; then
+    printf 'loaded\t%s\n' "$1"
+  else
+    printf 'failed\t%s\n' "$1"
+  fi
+}
+export -f load_one
+export PSQL
+
+LOAD_FAILED=0
+phase_load() {
+  local status
+  if [ ${#SCRIPTS[@]} -eq 0 ]; then
+    log "no register script given"
+    return
+  fi
+  # each line is one "xxx2pgcopy [opts] id file" command emitting COPY data;
+  # a loader failing without output must not pass as an empty COPY
+  status=$(mktemp)
+  cat "${SCRIPTS[@]}" | grep -v -e '^[[:space:]]*#' -e '^[[:space:]]*$' |
+    (cd "$DATADIR" &&
+     tr '\n' '\0' | xargs -0 -r -n 1 -P "$JOBS" bash -c 'load_one "$1"' _) > "$status"
+  LOAD_FAILED=$(grep -c $'^failed\t' "$status" || true)
+  log "loaded $(grep -c $'^loaded\t' "$status" || true) files, failed $LOAD_FAILED"
+  grep $'^failed\t' "$status" | cut -f2- | sed 's/^/failed: /' >&2 || true
+  rm -f "$status"
+}
+
+phase_logged() {
+  for t in $TABLES; do
+    echo "ALTER TABLE $t SET LOGGED;"
+  done | run_parallel_sql ""
+}
+
+phase_index() {
+  # primary keys take an exclusive lock, build them first (one per table)
+  grep -i '^ALTER TABLE' "$SQLDIR/create_index.sql" | run_parallel_sql "$SETTINGS"
+  # plain index builds on the same table do not block each other
+  grep -i '^CREATE INDEX' "$SQLDIR/create_index.sql" | run_parallel_sql "$SETTINGS"
+}
+
+phase_analyze() {
+  for t in $TABLES; do
+    echo "ANALYZE $t;"
+  done | run_parallel_sql ""
+}
+
+T0=$(date +%s)
+for p in schema load logged index analyze; do
+  if has_phase $p; then
+    run_phase $p phase_$p
+  fi
+done
+T1=$(date +%s)
+
+echo "phase,seconds"
+for p in "${ORDER[@]}"; do
+  echo "$p,${ELAPSED[$p]}"
+done
+echo "total,$((T1 - T0))"
+if [ "$LOAD_FAILED" -gt 0 ]; then
+  exit 1
+fi
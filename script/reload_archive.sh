@@ -0,0 +1,204 @@
+#!/bin/bash
+#
+# reload_archive.sh - reload only the tape files changed since the last load
+#
+# alsephash lists, for every line of the register_*.sh command lists, the
+# CRC32C and size of the tape file and the decoder version of its loader.
+# A file is reloaded when one of them differs from the manifest of the
+# last load, or when its last load did not succeed. The rows of a file
+# are replaced in one transaction (DELETE of its file_id and COPY), so
+# readers see either the old or the new rows. The manifest is rewritten
+# at the end with the status of every file (loaded, failed or missing).
+#
+# With -s the tables must be partitioned by alsep_partition_table() of
+# partition.sql. The files are reloaded in batches of one partition: the
+# loaders write into a staging table (xxx2pgcopy -T), its indexes are
+# built and it replaces the partition in one short transaction, so no row
+# is deleted from the table.
+#
+# usage:
+#   reload_archive.sh [-d dbname] [-j jobs] [-C datadir] [-m manifest]
+#                     [-n] [-s] register_script ...
+#
+#   -n: only list the files which would be reloaded
+#   -s: swap partitions instead of DELETE and COPY
+#
+# manifest (tab separated):
+#   loader file_id decoder_version size crc32c status command
+#
+set -eu -o pipefail
+
+DBNAME=${PGDATABASE:-alsep}
+JOBS=$(nproc 2>/dev/null || echo 4)
+DATADIR=.
+MANIFEST=
+DRYRUN=0
+SWAP=0
+
+usage() {
+  echo "usage: $0 [-d dbname] [-j jobs] [-C datadir] [-m manifest] [-n] [-s] register_script ..." >&2
+}
+
+log() {
+  echo "$(date '+%b %d %H:%M:%S') INFO: $*" >&2
+}
+
+while getopts "d:j:C:m:nsh" ch; do
+  case $ch in
+    d) DBNAME=$OPTARG ;;
+    j) JOBS=$OPTARG ;;
+    C) DATADIR=$OPTARG ;;
+    m) MANIFEST=$OPTARG ;;
+    n) DRYRUN=1 ;;
+    s) SWAP=1 ;;
+    *) usage; exit 1 ;;
+  esac
+done
+shift $((OPTIND - 1))
+
+if [ $# -eq 0 ]; then
+  usage
+  exit 1
+fi
+if [ -z "$MANIFEST" ]; then
+  MANIFEST=$DATADIR/alsep_manifest.tsv
+fi
+
+PSQL="psql -X -q -v ON_ERROR_STOP=1 -d $DBNAME"
+export PSQL DATADIR
+
+# resolve the command lists before changing to the data directory
+SCRIPTS=()
+for s in "$@"; do
+  SCRIPTS+=("$(cd "$(dirname "$s")" && pwd)/$(basename "$s")")
+done
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+log "hashing the tape files"
+(cd "$DATADIR" && alsephash -j "$JOBS" "${SCRIPTS[@]}") > "$WORK/current.tsv"
+touch "$MANIFEST"
+
+# current entries not loaded with the same content and decoder version
+awk -F'\t' -v OFS='\t' '
+  FILENAME == ARGV[1] { old[$1 FS $2] = $3 FS $4 FS $5 FS $6; next }
+  $4 == -1 { next }
+  old[$1 FS $2] != $3 FS $4 FS $5 FS "loaded" { print $1, $2, $6 }
+' "$MANIFEST" "$WORK/current.tsv" > "$WORK/reload.tsv"
+
+log "$(wc -l < "$WORK/reload.tsv") of $(wc -l < "$WORK/current.tsv") files to reload"
+if [ $DRYRUN -eq 1 ]; then
+  cut -f3 "$WORK/reload.tsv"
+  exit 0
+fi
+
+# table written by a loader
+loader_table() {
+  case $1 in
+    pse2pgcopy|wtn2pgcopy) echo tbl_pse ;;
+    wtn2pgcopy_lsg) echo tbl_lsg ;;
+    wth2pgcopy) echo tbl_lspe ;;
+    *) return 1 ;;
+  esac
+}
+export -f loader_table
+
+# replace the rows of one file: loader file_id command
+reload_one() {
+  local loader=$1 id=$2 cmd=$3 table
+  set -o pipefail
+  if ! table=$(loader_table "$loader"); then
+    echo "failed"
+    return
+  fi
+  if { echo "BEGIN;"
+       echo "DELETE FROM $table WHERE file_id = $id;"
+       if (cd "$DATADIR" && sh -c "$cmd"); then
+         echo "COMMIT;"
+       else
+         echo "ROLLBACK;"
+         false
+       fi
+     } | $PSQL; then
+    echo "loaded"
+  else
+    echo "failed"
+  fi
+}
+export -f reload_one
+
+# replace the partition of a batch of files (a file of "loader file_id
+# command" lines of one partition) by a staging table
+reload_batch() {
+  local batch=$1 table ids stage= status loader id cmd
+  set -o pipefail
+  table=$(loader_table "$(head -n 1 "$batch" | cut -f1)")
+  ids="{$(cut -f2 "$batch" | paste -sd,)}"
+  if stage=$($PSQL -At -c "SELECT alsep_stage('$table', '$ids')") &&
+     while IFS=$'\t' read -r loader id cmd; do
+       (cd "$DATADIR" && sh -c "${cmd%% *} -T $stage ${cmd#* }" < /dev/null) || exit 1
+     done < "$batch" | $PSQL &&
+     $PSQL -c "SELECT alsep_stage_index('$table', '$ids')" > /dev/null &&
+     $PSQL -c "SELECT alsep_swap('$table', '$ids')" > /dev/null; then
+    status=loaded
+  else
+    status=failed
+    if [ -n "$stage" ]; then
+      $PSQL -c "DROP TABLE IF EXISTS $stage" || true
+    fi
+  fi
+  cut -f1,2 "$batch" | sed "s/\$/\t$status/"
+}
+export -f reload_batch
+
+T0=$(date +%s)
+: > "$WORK/status.tsv"
+if [ $SWAP -eq 1 ]; then
+  # batches of the files of one partition
+  $PSQL -At -F $'\t' -c "SELECT tbl, width FROM tbl_partition" > "$WORK/width.tsv"
+  mkdir "$WORK/batch"
+  while IFS=$'\t' read -r loader id cmd; do
+    if ! table=$(loader_table "$loader"); then
+      printf '%s\t%s\tfailed\n' "$loader" "$id" >> "$WORK/status.tsv"
+      continue
+    fi
+    width=$(awk -F'\t' -v t="$table" '$1 == t { print $2 }' "$WORK/width.tsv")
+    if [ -z "$width" ]; then
+      echo "$table is not partitioned, run alsep_partition_table() of partition.sql" >&2
+      exit 1
+    fi
+    printf '%s\t%s\t%s\n' "$loader" "$id" "$cmd" >> "$WORK/batch/${table}_$((id / width))"
+  done < "$WORK/reload.tsv"
+  find "$WORK/batch" -type f -print0 |
+    xargs -0 -r -n 1 -P "$JOBS" bash -c 'reload_batch "$1"' _ \
+    >> "$WORK/status.tsv"
+else
+  while IFS=$'\t' read -r loader id cmd; do
+    printf '%s\0%s\0%s\0' "$loader" "$id" "$cmd"
+  done < "$WORK/reload.tsv" |
+    xargs -0 -r -n 3 -P "$JOBS" bash -c \
+      'printf "%s\t%s\t%s\n" "$1" "$2" "$(reload_one "$1" "$2" "$3")"' _ \
+    >> "$WORK/status.tsv"
+fi
+T1=$(date +%s)
+
+# new manifest: status of this run, of the last run for unchanged files
+awk -F'\t' -v OFS='\t' '
+  FILENAME == ARGV[1] { old[$1 FS $2] = $6; next }
+  FILENAME == ARGV[2] { status[$1 FS $2] = $3; next }
+  {
+    k = $1 FS $2
+    if ($4 == -1) { s = "missing" }
+    else if (k in status) { s = status[k] }
+    else { s = old[k] }
+    print $1, $2, $3, $4, $5, s, $6
+  }
+' "$MANIFEST" "$WORK/status.tsv" "$WORK/current.tsv" > "$MANIFEST.tmp"
+mv "$MANIFEST.tmp" "$MANIFEST"
+
+log "reloaded $(grep -c $'\tloaded$' "$WORK/status.tsv" || true) files," \
+    "failed $(grep -c $'\tfailed$' "$WORK/status.tsv" || true) in $((T1 - T0)) sec"
+if grep -q $'\tfailed$' "$WORK/status.tsv"; then
+  exit 1
+fi
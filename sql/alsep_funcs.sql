@@ -1,3 +1,28 @@
+--
+-- alsep_source_claus()
+--	where clause reading every station of a window from one file only, the
+--	best of alsep_best_files() (quality.sql); empty without file_quality,
+--	and stations without catalogued files are read from all of them
+--
+DROP FUNCTION IF EXISTS  alsep_source_claus(time0 timestamp, time2 timestamp, types text);
+
+CREATE OR REPLACE FUNCTION alsep_source_claus(
+  tstamp0 timestamp
+  ,tstamp2 timestamp
+  ,types text		-- types of the table, e.g. '{pse,wtn}'
+) RETURNS text AS $$
+DECLARE
+  best text;	-- best files of the window
+BEGIN
+  IF to_regclass('file_quality') IS NULL THEN
+    RETURN '';
+  END IF;
+  best := 'alsep_best_files(''' || tstamp0 || ''', ''' || tstamp2 || ''', ''' || types || ''')';
+  RETURN ' AND ((f.ap_station, f.file_id) IN (SELECT ap_station, file_id FROM ' || best || ')'
+      || ' OR f.ap_station NOT IN (SELECT ap_station FROM ' || best || '))';
+END;
+$$ LANGUAGE plpgsql STABLE STRICT;
+
 --
 -- pse sp data retrieval functions
 --
@@ -65,6 +90,7 @@ BEGIN
 
 
   s_claus := '''' || tstamp1 || ''' <= f.time AND f.time <= ''' || tstamp3 || '''';
+  s_claus := s_claus || alsep_source_claus(tstamp0, tstamp2, '{pse,wtn}');
   e_claus := 'ORDER BY  e.ap_station, time';
   d_claus := '''' || tstamp0 || ''' <= d.time AND d.time < ''' || tstamp2 || '''';
 
@@ -232,6 +258,7 @@ BEGIN
   e_query := 'e.ap_station, e.ground_station,  e.file_id, e.pos, e.length, e.frame_count,  e.time_diff, (e.time + (' || dtstep::text || '* (e.nc-1)||'' milliseconds'')::interval)::timestamp without time zone as time, e.nc, e.lp_x, e.lp_y, e.lp_z,  e.process_flag, e.error_flag, e.time_flag ';
 
   s_claus := '''' || tstamp1 || ''' <= f.time AND f.time <= ''' || tstamp3 || '''';
+  s_claus := s_claus || alsep_source_claus(tstamp0, tstamp2, '{pse,wtn}');
   e_claus := 'ORDER BY  e.ap_station, time';
   d_claus := '''' || tstamp0 || ''' <= d.time AND d.time < ''' || tstamp2 || '''';
 
@@ -414,6 +441,7 @@ BEGIN
   -- set query string
   s_query := 'ap_station, ground_station, file_id, pos, length, frame_count,  time_diff, time, ' || tidal_c1 || ', ' || tidal_c2 || ', process_flag, error_flag, time_flag FROM tbl_pse f';
   s_claus := '(''' || tstamp0 || ''' <= time AND time <= ''' || tstamp2 || ''')';
+  s_claus := s_claus || alsep_source_claus(tstamp0, tstamp2, '{pse,wtn}');
   s_claus := s_claus || ' AND ' || condition || ' ORDER BY  ap_station, time';
 
   stmt := 'SELECT ' || s_query || ' WHERE ' || s_claus;
@@ -671,6 +699,7 @@ BEGIN
   --                                                                                      e.x.          (e.time + (      18.875          * (e.nc-1)|| ' milliseconds' )::interval)::timestamp 
 
   s_claus := '''' || tstamp1 || ''' <= f.time AND f.time <= ''' || tstamp3 || '''';
+  s_claus := s_claus || alsep_source_claus(tstamp0, tstamp2, '{wtn}');
   e_claus := 'ORDER BY  e.ap_station, time';
   d_claus := '''' || tstamp0 || ''' <= d.time AND d.time < ''' || tstamp2 || '''';
 
@@ -841,6 +870,7 @@ BEGIN
   --                                                                                      e.x.          (e.time + (      18.875          * (e.nc-1)|| ' milliseconds' )::interval)::timestamp 
 
   s_claus := '''' || tstamp1 || ''' <= f.time AND f.time <= ''' || tstamp3 || '''';
+  s_claus := s_claus || alsep_source_claus(tstamp0, tstamp2, '{wth}');
   e_claus := 'ORDER BY  e.ap_station, time';
   d_claus := '''' || tstamp0 || ''' <= d.time AND d.time < ''' || tstamp2 || '''';
 
@@ -0,0 +1,158 @@
+--
+-- file_id partitioned layout of tbl_pse, tbl_lsg and tbl_lspe
+--	A table is partitioned by ranges of "width" file_ids. The rows of a
+--	file are reloaded into a staging table which replaces its partition
+--	in one short transaction, so no row of the table is deleted:
+--
+--	  SELECT alsep_stage('tbl_pse', '{123}');	-- tbl_pse_f000123_stage
+--	  COPY tbl_pse_f000123_stage ... (xxx2pgcopy -T tbl_pse_f000123_stage)
+--	  SELECT alsep_stage_index('tbl_pse', '{123}');
+--	  SELECT alsep_swap('tbl_pse', '{123}');
+--
+--	With a width of 1 the swap replaces the partition of the file alone;
+--	with a larger width the other files of the partition are copied into
+--	the staging table by alsep_stage(). reload_archive.sh -s does this.
+--
+--	The indexes of create_index.sql are created on the partitioned table
+--	by alsep_partition_table(), create_index.sql is not used with it.
+--
+CREATE TABLE IF NOT EXISTS tbl_partition (
+    tbl text PRIMARY KEY,
+    width integer NOT NULL
+);
+
+--
+-- alsep_partition_name()
+--	partition holding a file_id
+--
+CREATE OR REPLACE FUNCTION alsep_partition_name(tbl text, file_id int) RETURNS text AS $$
+  SELECT format('%s_f%s', $1, lpad(((($2 / p.width) * p.width))::text, 6, '0'))
+    FROM tbl_partition p WHERE p.tbl = $1;
+$$ LANGUAGE sql STABLE STRICT;
+
+--
+-- alsep_partition_table()
+--	replace a table by a partitioned one with partitions of width
+--	file_ids up to max_file_id and the indexes of create_index.sql. The
+--	rows of the table are moved once.
+--
+CREATE OR REPLACE FUNCTION alsep_partition_table(tbl text, width int, max_file_id int) RETURNS int AS $$
+DECLARE
+  short text := substring(tbl from 5);	-- "pse" of "tbl_pse"
+  lo int;
+  n int := 0;
+BEGIN
+  EXECUTE format('CREATE TABLE %I (LIKE %I INCLUDING DEFAULTS INCLUDING CONSTRAINTS) PARTITION BY RANGE (file_id)',
+                 tbl || '_new', tbl);
+  INSERT INTO tbl_partition VALUES (tbl, width)
+    ON CONFLICT (tbl) DO UPDATE SET width = EXCLUDED.width;
+
+  lo := 0;
+  WHILE lo <= max_file_id LOOP
+    EXECUTE format('CREATE TABLE %I PARTITION OF %I FOR VALUES FROM (%s) TO (%s)',
+                   alsep_partition_name(tbl, lo), tbl || '_new', lo, lo + width);
+    lo := lo + width;
+    n := n + 1;
+  END LOOP;
+
+  EXECUTE format('INSERT INTO %I SELECT * FROM %I', tbl || '_new', tbl);
+  EXECUTE format('DROP TABLE %I CASCADE', tbl);
+  EXECUTE format('ALTER TABLE %I RENAME TO %I', tbl || '_new', tbl);
+
+  EXECUTE format('ALTER TABLE %I ADD CONSTRAINT %I PRIMARY KEY (file_id, pos)', tbl, tbl || '_pkey');
+  EXECUTE format('CREATE INDEX %I ON %I(file_id)', 'idx_' || short || '_file_id', tbl);
+  EXECUTE format('CREATE INDEX %I ON %I(ap_station)', 'idx_' || short || '_ap_station', tbl);
+  EXECUTE format('CREATE INDEX %I ON %I(ground_station)', 'idx_' || short || '_ground_station', tbl);
+  EXECUTE format('CREATE INDEX %I ON %I(time)', 'idx_' || short || '_time', tbl);
+  EXECUTE format('CREATE INDEX %I ON %I(process_flag)', 'idx_' || short || '_process_flag', tbl);
+  EXECUTE format('CREATE INDEX %I ON %I(error_flag)', 'idx_' || short || '_error_flag', tbl);
+  EXECUTE format('CREATE INDEX %I ON %I(time_flag)', 'idx_' || short || '_time_flag', tbl);
+  EXECUTE format('CREATE INDEX %I ON %I(ap_station,time)', 'idx_' || short || '_ap_station_time', tbl);
+  RETURN n;
+END;
+$$ LANGUAGE plpgsql;
+
+--
+-- alsep_stage()
+--	create the staging table of the partition of file_ids with the rows
+--	of the other files of the partition. All file_ids must be in one
+--	partition. Returns the name of the staging table.
+--
+CREATE OR REPLACE FUNCTION alsep_stage(tbl text, file_ids int[]) RETURNS text AS $$
+DECLARE
+  part text := alsep_partition_name(tbl, file_ids[1]);
+  stage text := part || '_stage';
+BEGIN
+  IF part IS NULL THEN
+    RAISE EXCEPTION '% is not partitioned by alsep_partition_table()', tbl;
+  END IF;
+  IF EXISTS (SELECT 1 FROM unnest(file_ids) f WHERE alsep_partition_name(tbl, f) <> part) THEN
+    RAISE EXCEPTION 'file_ids % are not in one partition of %', file_ids, tbl;
+  END IF;
+
+  EXECUTE format('DROP TABLE IF EXISTS %I', stage);
+  EXECUTE format('CREATE TABLE %I (LIKE %I INCLUDING DEFAULTS INCLUDING CONSTRAINTS)', stage, tbl);
+  IF to_regclass(quote_ident(part)) IS NOT NULL THEN
+    EXECUTE format('INSERT INTO %I SELECT * FROM %I WHERE NOT (file_id = ANY(%L))', stage, part, file_ids);
+  END IF;
+  RETURN stage;
+END;
+$$ LANGUAGE plpgsql;
+
+--
+-- alsep_stage_index()
+--	build the indexes of the partitioned table and the partition bound
+--	on the staging table, so that alsep_swap() neither builds an index
+--	nor scans the rows. The primary key index backs a primary key
+--	constraint, or ATTACH PARTITION would not take it for the parent's.
+--
+CREATE OR REPLACE FUNCTION alsep_stage_index(tbl text, file_ids int[]) RETURNS void AS $$
+DECLARE
+  part text := alsep_partition_name(tbl, file_ids[1]);
+  stage text := part || '_stage';
+  width int := (SELECT p.width FROM tbl_partition p WHERE p.tbl = alsep_stage_index.tbl);
+  lo int := (file_ids[1] / width) * width;
+  r record;
+  n int := 0;
+BEGIN
+  FOR r IN SELECT pg_get_indexdef(i.indexrelid) AS def, i.indisprimary
+             FROM pg_index i WHERE i.indrelid = tbl::regclass ORDER BY i.indexrelid LOOP
+    n := n + 1;
+    EXECUTE regexp_replace(r.def, '^CREATE (UNIQUE )?INDEX \S+ ON (ONLY )?\S+',
+                           'CREATE \1INDEX ' || quote_ident(stage || '_' || n) || ' ON ' || quote_ident(stage));
+    IF r.indisprimary THEN
+      EXECUTE format('ALTER TABLE %I ADD CONSTRAINT %I PRIMARY KEY USING INDEX %I',
+                     stage, stage || '_' || n, stage || '_' || n);
+    END IF;
+  END LOOP;
+  EXECUTE format('ALTER TABLE %I ADD CONSTRAINT alsep_bound CHECK (file_id >= %s AND file_id < %s)',
+                 stage, lo, lo + width);
+  EXECUTE format('ANALYZE %I', stage);
+END;
+$$ LANGUAGE plpgsql;
+
+--
+-- alsep_swap()
+--	replace the partition of file_ids by its staging table
+--
+CREATE OR REPLACE FUNCTION alsep_swap(tbl text, file_ids int[]) RETURNS void AS $$
+DECLARE
+  part text := alsep_partition_name(tbl, file_ids[1]);
+  stage text := part || '_stage';
+  width int := (SELECT p.width FROM tbl_partition p WHERE p.tbl = alsep_swap.tbl);
+  lo int := (file_ids[1] / width) * width;
+  r record;
+BEGIN
+  IF to_regclass(quote_ident(part)) IS NOT NULL THEN
+    EXECUTE format('ALTER TABLE %I DETACH PARTITION %I', tbl, part);
+    EXECUTE format('DROP TABLE %I', part);
+  END IF;
+  EXECUTE format('ALTER TABLE %I ATTACH PARTITION %I FOR VALUES FROM (%s) TO (%s)',
+                 tbl, stage, lo, lo + width);
+  EXECUTE format('ALTER TABLE %I RENAME TO %I', stage, part);
+  FOR r IN SELECT c.relname FROM pg_index i JOIN pg_class c ON c.oid = i.indexrelid
+             WHERE i.indrelid = part::regclass AND c.relname LIKE stage || '\_%' LOOP
+    EXECUTE format('ALTER INDEX %I RENAME TO %I', r.relname, part || substring(r.relname from length(stage) + 1));
+  END LOOP;
+END;
+$$ LANGUAGE plpgsql;
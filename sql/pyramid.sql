@@ -0,0 +1,86 @@
+--
+-- min/max pyramid of the PSE channels (loaded by pse2pyramid)
+--	a tile of level k holds min/max/sum/count of 2^k samples starting at
+--	"time". Tiles are aligned to an absolute sample grid, a tile at a
+--	file boundary is stored once per file and merged by alsep_pyramid().
+--
+DROP TABLE IF EXISTS tbl_pyramid CASCADE;
+CREATE TABLE tbl_pyramid (
+    file_id integer NOT NULL,
+    ap_station smallint NOT NULL,
+    channel text NOT NULL,
+    level smallint NOT NULL,
+    "time" timestamp without time zone NOT NULL,
+    min smallint,
+    max smallint,
+    sum bigint,
+    count integer
+);
+CREATE INDEX idx_pyramid_file_id ON tbl_pyramid(file_id);
+CREATE INDEX idx_pyramid_tile ON tbl_pyramid(ap_station, channel, level, "time");
+
+--
+-- alsep_pyramid_rate()
+--	sample rate [Hz] of a channel of the pyramid (1060 bps, 64 words/frame,
+--	tidal and temperature words in every other frame)
+--
+CREATE OR REPLACE FUNCTION alsep_pyramid_rate(channel text) RETURNS float8 AS $$
+  SELECT CASE
+    WHEN $1 = 'sp_z' THEN 32
+    WHEN $1 IN ('lp_x', 'lp_y', 'lp_z') THEN 4
+    WHEN $1 IN ('tidal_x', 'tidal_y', 'tidal_z', 'inst_temp') THEN 0.5
+  END * 1060 / 640.0::float8;
+$$ LANGUAGE sql IMMUTABLE STRICT;
+
+--
+-- alsep_pyramid()
+--	tiles of a station and channel between tstamp0 and tstamp9 at the
+--	lowest level giving at most npix tiles (one per pixel of a plot).
+--	The level is clamped to the stored levels; when it is the lowest
+--	one the caller may read tbl_pse instead.
+--
+-- example:
+--   psql -c "SELECT * FROM alsep_pyramid(12, 'lp_z', '1972-01-01', '1972-07-01', 1600)"
+--
+CREATE OR REPLACE FUNCTION alsep_pyramid(
+  station int	-- apollo station
+  ,ch text	-- channel of tbl_pse
+  ,tstamp0 timestamp	-- start timestamp
+  ,tstamp9 timestamp	-- end timestamp
+  ,npix int	-- maximum number of tiles (plot width in pixel)
+) RETURNS TABLE(level smallint, "time" timestamp, min smallint, max smallint, mean float8, count bigint) AS $$
+#variable_conflict use_column
+DECLARE
+  rate float8;	-- sample rate [Hz]
+  nsample float8;	-- number of samples in the period
+  lv int;	-- level to read
+  lvmin int;	-- lowest stored level
+  lvmax int;	-- highest stored level
+BEGIN
+  rate := alsep_pyramid_rate(ch);
+  IF rate IS NULL THEN
+    RAISE EXCEPTION 'unknown channel: %', ch;
+  END IF;
+
+  SELECT min(p.level), max(p.level) INTO lvmin, lvmax
+  FROM tbl_pyramid p WHERE p.ap_station = station AND p.channel = ch;
+  IF lvmin IS NULL THEN
+    RETURN;
+  END IF;
+
+  -- 2^lv samples per tile
+  nsample := extract(epoch FROM tstamp9 - tstamp0) * rate;
+  lv := ceil(log(2.0, greatest(nsample / greatest(npix, 1), 1.0)::numeric));
+  lv := greatest(lvmin, least(lvmax, lv));
+
+  RETURN QUERY
+  SELECT lv::smallint, p.time, min(p.min), max(p.max),
+         sum(p.sum)::float8 / sum(p.count), sum(p.count)::bigint
+  FROM tbl_pyramid p
+  WHERE p.ap_station = station AND p.channel = ch AND p.level = lv
+    AND p.time > tstamp0 - make_interval(secs => 2 ^ lv / rate)
+    AND p.time < tstamp9
+  GROUP BY p.time
+  ORDER BY p.time;
+END;
+$$ LANGUAGE plpgsql STABLE STRICT;
@@ -0,0 +1,75 @@
+--
+-- quality of the frames of every station in every file (loaded by
+-- pseinfo/wtninfo/wthinfo -Q) and the choice of one of the tapes holding
+-- a time window: the PSE original, a WTN work tape or a duplicated event
+-- tape (tape_type 2). A window is read from the file of the highest
+--
+--	coverage * quality, quality = 1 - (error_frames + 10 * gaps) / frames
+--
+-- (quality at least 0; sync_errors are among the error_frames) where
+-- coverage is the part of the window between time_first and time_last;
+-- on a tie the original (tape_type 1) and then the lowest file_id.
+-- stack2pgcopy -Q ranks the same way (quality.c). The counts are those
+-- a load flags: the survey checks and links the frames as the pgcopy
+-- tools do (WTN frames per package, wtn_demux.h; summary.c).
+--
+DROP TABLE IF EXISTS file_quality CASCADE;
+CREATE TABLE file_quality (
+    name character varying(64) NOT NULL,
+    type text NOT NULL,
+    tape_type smallint NOT NULL,
+    ap_station smallint NOT NULL,
+    time_first timestamp without time zone NOT NULL,
+    time_last timestamp without time zone NOT NULL,
+    frames bigint NOT NULL,
+    error_frames bigint NOT NULL,
+    sync_errors bigint NOT NULL,
+    gaps bigint NOT NULL,
+    PRIMARY KEY (name, ap_station)
+);
+CREATE INDEX idx_file_quality_time ON file_quality(ap_station, time_first, time_last);
+
+--
+-- file_quality with the file_id of the data tables, e.g. for stack2pgcopy -Q:
+--
+--	psql -At -F $'\t' -c 'SELECT * FROM file_quality_catalog' alsep > quality.tsv
+--
+CREATE OR REPLACE VIEW file_quality_catalog AS
+SELECT f.id AS file_id, q.ap_station, q.type, q.tape_type, q.time_first, q.time_last,
+       q.frames, q.error_frames, q.sync_errors, q.gaps
+FROM file_quality q JOIN file f ON f.name = q.name
+ORDER BY f.id, q.ap_station;
+
+DROP FUNCTION IF EXISTS alsep_quality(frames bigint, error_frames bigint, gaps bigint);
+CREATE OR REPLACE FUNCTION alsep_quality(
+  frames bigint
+  ,error_frames bigint
+  ,gaps bigint
+) RETURNS float8 AS $$
+  SELECT greatest(0.0, 1.0 - (error_frames + 10.0 * gaps) / greatest(frames, 1));
+$$ LANGUAGE sql IMMUTABLE STRICT;
+
+--
+-- alsep_best_files()
+--	the file to read every station from for the window tstamp0 <= time < tstamp2
+--	of the types ('pse', 'wtn' or 'wth') of a data table
+--
+-- example:
+--
+--	SELECT * FROM alsep_best_files('1972-11-20T01:30:55.000', '1972-11-20T01:35:00.000', '{pse,wtn}');
+--
+DROP FUNCTION IF EXISTS alsep_best_files(tstamp0 timestamp, tstamp2 timestamp, types text[]);
+CREATE OR REPLACE FUNCTION alsep_best_files(
+  tstamp0 timestamp
+  ,tstamp2 timestamp
+  ,types text[]
+) RETURNS TABLE(ap_station smallint, file_id int) AS $$
+  SELECT DISTINCT ON (q.ap_station) q.ap_station, q.file_id
+  FROM file_quality_catalog q
+  WHERE q.type = ANY(types) AND q.time_first < tstamp2 AND q.time_last >= tstamp0
+  ORDER BY q.ap_station,
+           extract(epoch FROM least(q.time_last, tstamp2) - greatest(q.time_first, tstamp0))
+           / greatest(extract(epoch FROM tstamp2 - tstamp0), 0.001)
+           * alsep_quality(q.frames, q.error_frames, q.gaps) DESC,
+           (q.tape_type = 1) DESC, q.file_id;
+$$ LANGUAGE sql STABLE STRICT;
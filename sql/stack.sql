@@ -0,0 +1,35 @@
+--
+-- aligned stacks of deep moonquake nests (loaded by stack2pgcopy)
+--	linear is the mean of the windows of nstack catalogued events of
+--	deep_nest, each aligned by cross-correlation and normalized to zero
+--	mean and unit norm; pws is the phase-weighted stack. Sample i is at
+--	the event time plus time_offset [msec] plus i / rate [sec].
+--
+DROP TABLE IF EXISTS nest_stack CASCADE;
+CREATE TABLE nest_stack (
+    deep_nest character varying(128) NOT NULL,
+    ap_station smallint NOT NULL,
+    channel text NOT NULL,
+    rate float8 NOT NULL,
+    time_offset integer NOT NULL,
+    nstack integer NOT NULL,
+    linear real[] NOT NULL,
+    pws real[] NOT NULL,
+    PRIMARY KEY (deep_nest, ap_station, channel)
+);
+
+--
+-- shift [sec] of the window of every stacked event and its correlation
+-- coefficient with the linear stack
+--
+DROP TABLE IF EXISTS nest_stack_lag CASCADE;
+CREATE TABLE nest_stack_lag (
+    deep_nest character varying(128) NOT NULL,
+    ap_station smallint NOT NULL,
+    channel text NOT NULL,
+    datetime timestamp without time zone NOT NULL,
+    lag real NOT NULL,
+    cc real
+);
+CREATE INDEX idx_nest_stack_lag_nest ON nest_stack_lag(deep_nest, ap_station, channel);
+CREATE INDEX idx_nest_stack_lag_datetime ON nest_stack_lag(datetime);
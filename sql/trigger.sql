@@ -0,0 +1,59 @@
+--
+-- candidate events of the STA/LTA detector (loaded by stalta2pgcopy)
+--	the first columns are those of event (events.sql): "datetime" is the
+--	time the trigger switched on and type the detector. A reviewed
+--	trigger is copied to the catalogue by
+--
+--	  INSERT INTO event (datetime, type, comments)
+--	    SELECT datetime, 'Meteoroid Impact', ap_station || ' ' || channel
+--	      FROM event_trigger WHERE ...;
+--
+DROP TABLE IF EXISTS event_trigger CASCADE;
+CREATE TABLE event_trigger (
+    LIKE event,
+    ap_station smallint NOT NULL,
+    channel text NOT NULL,
+    time_off timestamp without time zone NOT NULL,
+    sta_lta real,
+    peak real,
+    file_id integer NOT NULL
+);
+CREATE INDEX idx_event_trigger_datetime ON event_trigger(datetime);
+CREATE INDEX idx_event_trigger_station ON event_trigger(ap_station, channel, datetime);
+CREATE INDEX idx_event_trigger_file_id ON event_trigger(file_id);
+
+--
+-- events of STA/LTA triggers of several stations (loaded by stalta2pgcopy -N)
+--	"datetime" is the first switch on and time_off the last switch off of
+--	the ntrigger triggers of the nstation stations, all switched on
+--	within the coincidence window.
+--
+DROP TABLE IF EXISTS event_coincidence CASCADE;
+CREATE TABLE event_coincidence (
+    LIKE event,
+    time_off timestamp without time zone NOT NULL,
+    nstation smallint NOT NULL,
+    stations smallint[] NOT NULL,
+    ntrigger integer NOT NULL,
+    sta_lta real
+);
+CREATE INDEX idx_event_coincidence_datetime ON event_coincidence(datetime);
+
+--
+-- matched-filter detections of deep moonquake nests (loaded by match2pgcopy)
+--	"datetime" is the event time of the template (its start plus the
+--	pre-event window), cc the correlation coefficient with the stack of
+--	nstack catalogued events of deep_nest.
+--
+DROP TABLE IF EXISTS event_match CASCADE;
+CREATE TABLE event_match (
+    LIKE event,
+    ap_station smallint NOT NULL,
+    channel text NOT NULL,
+    cc real NOT NULL,
+    nstack integer,
+    file_id integer NOT NULL
+);
+CREATE INDEX idx_event_match_datetime ON event_match(datetime);
+CREATE INDEX idx_event_match_nest ON event_match(deep_nest, datetime);
+CREATE INDEX idx_event_match_file_id ON event_match(file_id);
@@ -21,3 +21,4 @@ DROP FUNCTION IF EXISTS  alsep_lspe(timestamp, int);
 DROP FUNCTION IF EXISTS  alsep_lspe(timestamp, timestamp, int);
 DROP FUNCTION IF EXISTS  alsep_lspe_query(timestamp, timestamp, int, int);
 DROP TYPE IF EXISTS alsep_lspe_type;
+DROP FUNCTION IF EXISTS  alsep_source_claus(timestamp, timestamp, text);
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+extern "C"
+{
+#include "define.h"
+#include "error.h"
+#include "clock.h"
+}
+
+// true frame clock: 603.77 msec/frame from 1972/100
+static int64_t frame_time(int64_t k)
+{
+    return 100 * 86400000LL + std::llround(k * 603.77);
+}
+
+// small deterministic jitter of the time tags (-20 ... 20 msec)
+static int64_t jitter(int64_t k)
+{
+    return ((k * 7919) % 41) - 20;
+}
+
+TEST(test_clock, jitter)
+{
+    clock_model c;
+    uint32_t flag;
+
+    clock_init(&c, VALID_FRAME_RATE, 90);
+    for (int64_t k = 0; k < 500; k++) {
+        int64_t t = clock_correct(&c, frame_time(k) + jitter(k), k % 90, 0, &flag);
+        if (k == 0) {
+            ASSERT_EQ(0U, flag);
+            continue;
+        }
+        ASSERT_EQ(static_cast<uint32_t>(TIME_FLAG_FITTED), flag);
+        if (k >= 100) {
+            // the fit is closer to the frame clock than the time tags
+            ASSERT_LE(std::llabs(t - frame_time(k)), 8) << "frame " << k;
+        }
+    }
+}
+
+TEST(test_clock, outlier)
+{
+    clock_model c;
+    uint32_t flag;
+
+    clock_init(&c, VALID_FRAME_RATE, 90);
+    for (int64_t k = 0; k < 200; k++) {
+        int64_t tag = frame_time(k);
+        uint32_t error_flag = 0;
+        if (k == 100) {
+            tag += 5000;
+        }
+        if (k == 150) {
+            tag = 0;
+            error_flag = ERROR_INVALID_DATETIME;
+        }
+        int64_t t = clock_correct(&c, tag, k % 90, error_flag, &flag);
+        if (k == 100 || k == 150) {
+            ASSERT_EQ(static_cast<uint32_t>(TIME_FLAG_OUTLIER), flag);
+        }
+        if (k > 0) {
+            ASSERT_LE(std::llabs(t - frame_time(k)), 2) << "frame " << k;
+        }
+    }
+}
+
+TEST(test_clock, jump)
+{
+    clock_model c;
+    uint32_t flag;
+    std::vector<uint32_t> flags;
+
+    clock_init(&c, VALID_FRAME_RATE, 90);
+    for (int64_t k = 0; k < 100; k++) {
+        int64_t tag = frame_time(k) + ((k >= 50) ? 2000 : 0);
+        int64_t t = clock_correct(&c, tag, k % 90, 0, &flag);
+        flags.push_back(flag);
+        if (k >= 52) {
+            ASSERT_LE(std::llabs(t - tag), 2) << "frame " << k;
+        }
+    }
+    ASSERT_EQ(static_cast<uint32_t>(TIME_FLAG_OUTLIER), flags[50]);
+    ASSERT_EQ(static_cast<uint32_t>(TIME_FLAG_OUTLIER), flags[51]);
+    ASSERT_EQ(static_cast<uint32_t>(TIME_FLAG_JUMP), flags[52]);
+    ASSERT_EQ(static_cast<uint32_t>(TIME_FLAG_FITTED), flags[53]);
+}
+
+TEST(test_clock, gap)
+{
+    clock_model c;
+    uint32_t flag;
+
+    clock_init(&c, VALID_FRAME_RATE, 90);
+    for (int64_t k = 0; k < 50; k++) {
+        clock_correct(&c, frame_time(k), k % 90, 0, &flag);
+    }
+
+    // 100 frames are missing: the count says 10, the time tag says 100
+    int64_t t = clock_correct(&c, frame_time(150), 150 % 90, 0, &flag);
+    ASSERT_EQ(static_cast<uint32_t>(TIME_FLAG_GAP | TIME_FLAG_FITTED), flag);
+    ASSERT_LE(std::llabs(t - frame_time(150)), 2);
+
+    // a broken frame_count on a good time tag
+    t = clock_correct(&c, frame_time(151), 37, 0, &flag);
+    ASSERT_EQ(static_cast<uint32_t>(TIME_FLAG_COUNT_ERROR | TIME_FLAG_FITTED), flag);
+    ASSERT_LE(std::llabs(t - frame_time(151)), 2);
+}
+
+TEST(test_clock, uncounted)
+{
+    clock_model c;
+    uint32_t flag;
+
+    // WTH frames have no frame_count
+    clock_init(&c, VALID_FRAME_RATE_WTH, 0);
+    for (int64_t k = 0; k < 100; k++) {
+        int64_t tag = 1000 + std::llround(k * 169.82) - ((k == 60) ? 1000 : 0);
+        int64_t t = clock_correct(&c, tag, -1, 0, &flag);
+        if (k == 60) {
+            ASSERT_EQ(static_cast<uint32_t>(TIME_FLAG_OUTLIER), flag);
+        }
+        if (k > 0) {
+            ASSERT_LE(std::llabs(t - (1000 + std::llround(k * 169.82))), 2) << "frame " << k;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
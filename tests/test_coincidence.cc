@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+extern "C"
+{
+#include <stdint.h>
+#include "coincidence.h"
+}
+
+struct event
+{
+    coinc_event e;
+    std::vector<coinc_trigger> t;
+};
+
+static void collect(const coinc_event *e, const coinc_trigger *t, int n, void *arg)
+{
+    auto *v = static_cast<std::vector<event> *>(arg);
+    v->push_back({*e, std::vector<coinc_trigger>(t, t + n)});
+}
+
+static coinc_trigger trig(int64_t on, int apollo_station, double ratio = 4.0)
+{
+    coinc_trigger t = {on, on + 30000, apollo_station, 0, ratio, 100.0};
+    return t;
+}
+
+TEST(test_coincidence, associate)
+{
+    std::vector<event> ev;
+    coinc_param p = {10000, 3};
+    coinc c;
+
+    ASSERT_EQ(0, coinc_init(&c, &p, collect, &ev));
+    std::vector<coinc_trigger> in = {
+        // three stations within 10 s (station 12 twice)
+        trig(1000, 12), trig(2000, 12), trig(4000, 14), trig(9000, 16, 7.5),
+        // two stations only
+        trig(100000, 12), trig(105000, 15),
+        // three stations, but not within one window of the first
+        trig(200000, 12), trig(208000, 14), trig(215000, 15),
+        // the window moves to the second trigger
+        trig(300000, 16), trig(320000, 12), trig(325000, 14), trig(329000, 15),
+    };
+    for (auto &t : in) {
+        ASSERT_EQ(0, coinc_add(&c, &t));
+        // only the triggers of one window are held
+        ASSERT_LE(c.n, 4);
+    }
+    coinc_flush(&c);
+
+    ASSERT_EQ(2u, ev.size());
+    ASSERT_EQ(1000, ev[0].e.on);
+    ASSERT_EQ(39000, ev[0].e.off);
+    ASSERT_EQ(3, ev[0].e.nstation);
+    ASSERT_EQ((1u << 12) | (1u << 14) | (1u << 16), ev[0].e.stations);
+    ASSERT_EQ(7.5, ev[0].e.ratio);
+    ASSERT_EQ(4u, ev[0].t.size());
+
+    ASSERT_EQ(320000, ev[1].e.on);
+    ASSERT_EQ(3, ev[1].e.nstation);
+    ASSERT_EQ(3u, ev[1].t.size());
+    ASSERT_EQ(0u, c.nlate);
+    coinc_free(&c);
+}
+
+TEST(test_coincidence, order)
+{
+    std::vector<event> ev;
+    coinc_param p = {5000, 2};
+    coinc c;
+
+    ASSERT_EQ(0, coinc_init(&c, &p, collect, &ev));
+    coinc_trigger t[] = {trig(10000, 12), trig(9000, 14), trig(12000, 40), trig(12000, 14)};
+    for (auto &x : t) {
+        ASSERT_EQ(0, coinc_add(&c, &x));
+    }
+    coinc_flush(&c);
+
+    // the late trigger and the invalid station are dropped
+    ASSERT_EQ(2u, c.nlate);
+    ASSERT_EQ(1u, ev.size());
+    ASSERT_EQ(10000, ev[0].e.on);
+    ASSERT_EQ(2u, ev[0].t.size());
+    coinc_free(&c);
+
+    coinc_param bad = {1000, 0};
+    ASSERT_EQ(-1, coinc_init(&c, &bad, collect, nullptr));
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+extern "C"
+{
+#include <stdint.h>
+#include "crc32c.h"
+}
+
+static std::vector<unsigned char> random_bytes(size_t n)
+{
+    std::mt19937 gen(20261018);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<unsigned char> data(n);
+    for (auto &b : data) {
+        b = static_cast<unsigned char>(byte(gen));
+    }
+    return data;
+}
+
+TEST(test_crc32c, check_value)
+{
+    const char *s = "123456789";
+    std::vector<unsigned char> zero(32, 0x00), one(32, 0xff);
+
+    for (int isa = CPU_ISA_SCALAR; isa <= CPU_ISA_SSE42; isa++) {
+        if (crc32c_set_isa(isa) != 0) {
+            continue;
+        }
+        // RFC 3720 B.4
+        ASSERT_EQ(0xe3069283U, crc32c_update(0, s, 9)) << "isa " << isa;
+        ASSERT_EQ(0x8a9136aaU, crc32c_update(0, zero.data(), zero.size())) << "isa " << isa;
+        ASSERT_EQ(0x62a8ab43U, crc32c_update(0, one.data(), one.size())) << "isa " << isa;
+    }
+    crc32c_set_isa(CPU_ISA_AUTO);
+}
+
+TEST(test_crc32c, isa)
+{
+    std::vector<unsigned char> data = random_bytes(100003);
+    uint32_t expect;
+
+    ASSERT_EQ(0, crc32c_set_isa(CPU_ISA_SCALAR));
+    expect = crc32c_update(0, data.data(), data.size());
+
+    for (int isa = CPU_ISA_SCALAR; isa <= CPU_ISA_SSE42; isa++) {
+        if (crc32c_set_isa(isa) != 0) {
+            continue;
+        }
+        ASSERT_EQ(expect, crc32c_update(0, data.data(), data.size())) << "isa " << isa;
+
+        // in pieces of every alignment
+        uint32_t crc = 0;
+        size_t pos = 0;
+        for (size_t len = 1; pos < data.size(); len = len % 13 + 1) {
+            size_t n = std::min(len, data.size() - pos);
+            crc = crc32c_update(crc, &data[pos], n);
+            pos += n;
+        }
+        ASSERT_EQ(expect, crc) << "isa " << isa;
+    }
+    crc32c_set_isa(CPU_ISA_AUTO);
+}
+
+TEST(test_crc32c, file)
+{
+    std::vector<unsigned char> data = random_bytes(3 << 20);
+    std::string filename = testing::TempDir() + "test_crc32c.bin";
+    uint32_t crc;
+    int64_t size;
+
+    FILE *f = fopen(filename.c_str(), "wb");
+    ASSERT_NE(nullptr, f);
+    ASSERT_EQ(data.size(), fwrite(data.data(), 1, data.size(), f));
+    fclose(f);
+
+    ASSERT_EQ(0, crc32c_file(filename.c_str(), &crc, &size));
+    ASSERT_EQ(static_cast<int64_t>(data.size()), size);
+    ASSERT_EQ(crc32c_update(0, data.data(), data.size()), crc);
+    remove(filename.c_str());
+
+    ASSERT_EQ(-1, crc32c_file(filename.c_str(), &crc, &size));
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <cstring>
+#include <random>
+#include <vector>
+
+extern "C"
+{
+#include <sys/types.h>
+#include "util.h"
+#include "pse.h"
+#include "wtn.h"
+}
+
+static std::vector<unsigned char> random_bytes(size_t n, unsigned seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<unsigned char> v(n);
+    for (auto &b : v) {
+        b = static_cast<unsigned char>(byte(gen));
+    }
+    return v;
+}
+
+static void expect_same_pse(const pse_frame &expected, const pse_frame &actual, bool spz)
+{
+    if (spz) {
+        ASSERT_EQ(0, memcmp(expected.spz, actual.spz, sizeof(expected.spz)));
+    }
+    ASSERT_EQ(0, memcmp(expected.lpx, actual.lpx, sizeof(expected.lpx)));
+    ASSERT_EQ(0, memcmp(expected.lpy, actual.lpy, sizeof(expected.lpy)));
+    ASSERT_EQ(0, memcmp(expected.lpz, actual.lpz, sizeof(expected.lpz)));
+    ASSERT_EQ(expected.TidX, actual.TidX);
+    ASSERT_EQ(expected.TidY, actual.TidY);
+    ASSERT_EQ(expected.TidZ, actual.TidZ);
+    ASSERT_EQ(expected.InstT, actual.InstT);
+    ASSERT_EQ(expected.hk, actual.hk);
+    ASSERT_EQ(expected.cv, actual.cv);
+    ASSERT_EQ(expected.msec_of_year, actual.msec_of_year);
+    ASSERT_EQ(expected.frame_count, actual.frame_count);
+    ASSERT_EQ(expected.sync_code, actual.sync_code);
+}
+
+TEST(test_decoder, pse_frames)
+{
+    const unsigned stations[] = {11, 12, 14, 15, 16, 0};
+    const unsigned formats[] = {FORMAT_OLD, FORMAT_NEW};
+    unsigned seed = 1;
+
+    for (unsigned station : stations) {
+        for (unsigned format : formats) {
+            std::vector<unsigned char> record = random_bytes(SIZE_RECORD, seed++);
+            record[2] = 0;
+            record[3] = station;
+            record[10] = 0;
+            record[11] = format;
+            pse_record pr = binary2pse_record(record.data());
+            int size_part = (format == FORMAT_OLD) ? SIZE_DATA_PART_OLD : SIZE_DATA_PART_NEW;
+            int nframe = (SIZE_RECORD - SIZE_PSE_HEADER) / size_part;
+
+            std::vector<pse_frame> pf(MAX_PSE_FRAME + 1);
+            ASSERT_EQ(nframe, binary2pse_frames(pr, record.data(), pf.data(), MAX_PSE_FRAME + 1));
+
+            // the reference reads SP words of FORMAT_NEW beyond the record at the end
+            std::vector<unsigned char> padded(record);
+            padded.resize(SIZE_RECORD + SIZE_DATA_PART_OLD);
+            for (int i = 0; i < nframe; i++) {
+                pse_frame expected = binary2pse_frame(pr, &padded[SIZE_PSE_HEADER + size_part * i]);
+                SCOPED_TRACE(testing::Message() << "station " << station << " format " << format
+                             << " frame " << i);
+                expect_same_pse(expected, pf[i], format == FORMAT_OLD);
+            }
+        }
+    }
+}
+
+TEST(test_decoder, pse_frames_limit)
+{
+    std::vector<unsigned char> record = random_bytes(SIZE_RECORD, 100);
+    pse_record pr = binary2pse_record(record.data());
+    pr.format = FORMAT_OLD;
+    std::vector<pse_frame> pf(MAX_PSE_FRAME + 1);
+
+    ASSERT_EQ(1, binary2pse_frames(pr, record.data(), pf.data(), 0));
+    ASSERT_EQ(90, binary2pse_frames(pr, record.data(), pf.data(), 90));
+    ASSERT_EQ(270, binary2pse_frames(pr, record.data(), pf.data(), 540));
+}
+
+TEST(test_decoder, wtn_frames)
+{
+    const int nframe = 800;
+    std::vector<unsigned char> frames = random_bytes(SIZE_FRAME * nframe, 200);
+    wtn_record wnr = {};
+    std::vector<wtn_frame> wnf(nframe);
+
+    // every package id 0-7 occurs 100 times
+    for (int i = 0; i < nframe; i++) {
+        unsigned char &b = frames[SIZE_FRAME * i + 5];
+        b = static_cast<unsigned char>(((i % 8) << 5) | (b & 0x1f));
+    }
+
+    binary2wtn_frames(wnr, frames.data(), wnf.data(), nframe);
+    for (int i = 0; i < nframe; i++) {
+        wtn_frame expected = binary2wtn_frame(wnr, &frames[SIZE_FRAME * i]);
+        SCOPED_TRACE(testing::Message() << "frame " << i);
+        ASSERT_EQ(0, memcmp(&expected, &wnf[i], sizeof(wtn_frame)));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,217 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+extern "C"
+{
+#include "define.h"
+#include "error.h"
+#include "despike.h"
+}
+
+// 10-bit counts: a slow sine with noise around 512
+static std::vector<int32_t> counts(int n, int seed)
+{
+    std::mt19937 gen(seed);
+    std::normal_distribution<double> noise(0.0, 2.0);
+    std::vector<int32_t> x(n);
+
+    for (int i = 0; i < n; i++) {
+        x[i] = (int32_t)std::lround(512.0 + 60.0 * std::sin(2.0 * M_PI * i / 50.0) + noise(gen));
+    }
+    return x;
+}
+
+TEST(test_despike, spikes)
+{
+    std::vector<int32_t> x = counts(1000, 1), y = x;
+    std::vector<uint8_t> replaced(x.size());
+    despiker d;
+
+    // a spike, a glitch of 3 samples, a dropout to 0 and a clipped 1023
+    y[100] = 1023;
+    for (int i = 300; i < 303; i++) {
+        y[i] = 40;
+    }
+    y[500] = 0;
+    y[501] = 1023;
+
+    despike_init(&d);
+    int m = despike(&d, y.data(), y.size(), replaced.data());
+    ASSERT_EQ(6, m);
+    for (size_t i = 0; i < x.size(); i++) {
+        bool spike = (i == 100 || (i >= 300 && i < 303) || i == 500 || i == 501);
+
+        ASSERT_EQ(spike, replaced[i] != 0) << i;
+        if (spike) {
+            ASSERT_NEAR(x[i], y[i], 30) << i;
+        } else {
+            ASSERT_EQ(x[i], y[i]) << i;
+        }
+    }
+    despike_free(&d);
+}
+
+TEST(test_despike, median)
+{
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<int32_t> u(0, 1023);
+    std::vector<int32_t> e(DESPIKE_WINDOW);
+    despiker d;
+
+    // the median of the network is the median of the window
+    despike_init(&d);
+    for (int t = 0; t < 1000; t++) {
+        for (auto &v : e) {
+            v = u(gen);
+        }
+        // a spike in the middle of the window is replaced by the median
+        std::vector<int32_t> x = e;
+        x[DESPIKE_HALF] = 1000000;
+        despike_reset(&d);
+        despike(&d, x.data(), DESPIKE_WINDOW, NULL);
+        std::vector<int32_t> s = e;
+        s[DESPIKE_HALF] = 1000000;
+        std::nth_element(s.begin(), s.begin() + DESPIKE_HALF, s.end());
+        ASSERT_EQ(s[DESPIKE_HALF], x[DESPIKE_HALF]) << t;
+    }
+    despike_free(&d);
+}
+
+TEST(test_despike, stream)
+{
+    std::vector<int32_t> x = counts(64, 5);
+    despiker d;
+
+    // a spike at the start of a block is judged with the end of the previous one
+    despike_init(&d);
+    std::vector<int32_t> a(x.begin(), x.begin() + 32), b(x.begin() + 32, x.end());
+    int32_t orig = b[0];
+    b[0] = 1023;
+    ASSERT_EQ(0, despike(&d, a.data(), a.size(), NULL));
+    ASSERT_EQ(1, despike(&d, b.data(), b.size(), NULL));
+    ASSERT_NEAR(orig, b[0], 15);
+    despike_free(&d);
+}
+
+TEST(test_despike, block_end)
+{
+    std::vector<int32_t> x = counts(64, 13);
+    std::vector<uint8_t> replaced(x.size());
+    despiker d;
+
+    // a spike in the last sample of a block is replaced like one before it
+    for (int last : {62, 63}) {
+        std::vector<int32_t> y = x;
+        y[20] = 1023;
+        y[last] = 1023;
+        despike_init(&d);
+        ASSERT_EQ(2, despike(&d, y.data(), y.size(), replaced.data())) << last;
+        ASSERT_EQ(1, replaced[20]);
+        ASSERT_EQ(1, replaced[last]) << last;
+        ASSERT_NEAR(x[last], y[last], 30) << last;
+        despike_free(&d);
+    }
+
+    // and in a block of one sample
+    std::vector<int32_t> a(x.begin(), x.begin() + 32);
+    int32_t one = 1023;
+    despike_init(&d);
+    ASSERT_EQ(0, despike(&d, a.data(), a.size(), NULL));
+    ASSERT_EQ(1, despike(&d, &one, 1, NULL));
+    ASSERT_NEAR(x[32], one, 30);
+    despike_free(&d);
+}
+
+static void check_isa(int isa)
+{
+    std::vector<int32_t> x = counts(3001, 7);
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<int> pos(0, 3000), val(0, 1023);
+
+    for (int i = 0; i < 200; i++) {
+        x[pos(gen)] = val(gen);
+    }
+    std::vector<int32_t> y0 = x, y1 = x;
+    std::vector<uint8_t> r0(x.size()), r1(x.size());
+    despiker d;
+
+    despike_init(&d);
+    ASSERT_EQ(0, despike_set_isa(CPU_ISA_SCALAR));
+    int m0 = despike(&d, y0.data(), y0.size(), r0.data());
+    despike_reset(&d);
+    ASSERT_EQ(0, despike_set_isa(isa));
+    ASSERT_EQ(isa, despike_isa());
+    int m1 = despike(&d, y1.data(), y1.size(), r1.data());
+    despike_set_isa(CPU_ISA_AUTO);
+
+    ASSERT_GT(m0, 100);
+    ASSERT_EQ(m0, m1);
+    ASSERT_EQ(0, memcmp(y0.data(), y1.data(), y0.size() * sizeof(int32_t)));
+    ASSERT_EQ(0, memcmp(r0.data(), r1.data(), r0.size()));
+    despike_free(&d);
+}
+
+TEST(test_despike, scalar)
+{
+    check_isa(CPU_ISA_SCALAR);
+}
+
+TEST(test_despike, avx2)
+{
+    if (despike_set_isa(CPU_ISA_AVX2) != 0) {
+        GTEST_SKIP() << "AVX2 is not supported";
+    }
+    check_isa(CPU_ISA_AVX2);
+}
+
+TEST(test_despike, pse_frames)
+{
+    const int n = 10;
+    std::vector<pse_frame> pf(n);
+    std::vector<int32_t> lp = counts(n * COUNTS_PER_FRAME_FOR_PSE_LP, 9);
+    std::vector<int32_t> sp = counts(n * COUNTS_PER_FRAME_FOR_PSE_SP, 10);
+    despike_set s;
+
+    memset(pf.data(), 0, n * sizeof(pse_frame));
+    for (int i = 0; i < n; i++) {
+        for (int k = 0; k < COUNTS_PER_FRAME_FOR_PSE_LP; k++) {
+            pf[i].lpx[k] = pf[i].lpy[k] = pf[i].lpz[k] = lp[i * COUNTS_PER_FRAME_FOR_PSE_LP + k];
+        }
+        for (int k = 0; k < COUNTS_PER_FRAME_FOR_PSE_SP; k++) {
+            pf[i].spz[k] = sp[i * COUNTS_PER_FRAME_FOR_PSE_SP + k];
+        }
+    }
+
+    // a spike over the end of frame 2 in lpy and in spz of frame 5; frame 7 has a sync error
+    pf[2].lpy[COUNTS_PER_FRAME_FOR_PSE_LP - 1] = 1023;
+    pf[5].spz[0] = 0;
+    pf[7].error_flag = ERROR_INVALID_SYNC_CODE;
+    pf[7].lpx[0] = 1023;
+
+    despike_set_init(&s);
+    ASSERT_EQ(2, despike_pse_frames(&s, pf.data(), n, FORMAT_OLD));
+    for (int i = 0; i < n; i++) {
+        ASSERT_EQ((i == 2 || i == 5) ? FLAG_DESPIKED : 0u, pf[i].process_flag) << i;
+    }
+    ASSERT_NE(1023, pf[2].lpy[COUNTS_PER_FRAME_FOR_PSE_LP - 1]);
+    ASSERT_NE(0, pf[5].spz[0]);
+    ASSERT_EQ(1023, pf[7].lpx[0]);
+
+    // without spz in the new format
+    despike_set_free(&s);
+    despike_set_init(&s);
+    pf[5].spz[0] = 0;
+    ASSERT_EQ(0, despike_pse_frames(&s, pf.data(), n, FORMAT_NEW));
+    ASSERT_EQ(0, pf[5].spz[0]);
+    despike_set_free(&s);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
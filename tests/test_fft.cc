@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+extern "C"
+{
+#include "fft.h"
+}
+
+TEST(test_fft, size)
+{
+    ASSERT_EQ(FFT_MIN_SIZE, fft_size(1));
+    ASSERT_EQ(8, fft_size(5));
+    ASSERT_EQ(1024, fft_size(1024));
+    ASSERT_EQ(2048, fft_size(1025));
+
+    fft_plan p;
+    ASSERT_EQ(-1, fft_init(&p, 2));
+    ASSERT_EQ(-1, fft_init(&p, 96));
+}
+
+TEST(test_fft, dft)
+{
+    std::mt19937 gen(20261018);
+    std::normal_distribution<double> noise(0.0, 1.0);
+
+    for (int n = FFT_MIN_SIZE; n <= 256; n *= 2) {
+        std::vector<double> x(n), z(n + 2);
+        fft_plan p;
+
+        for (auto &v : x) {
+            v = noise(gen);
+        }
+        ASSERT_EQ(0, fft_init(&p, n));
+        fft_forward(&p, x.data(), z.data());
+
+        // the definition of the DFT
+        for (int k = 0; k <= n / 2; k++) {
+            double re = 0.0, im = 0.0;
+            for (int i = 0; i < n; i++) {
+                re += x[i] * std::cos(2.0 * M_PI * i * k / n);
+                im -= x[i] * std::sin(2.0 * M_PI * i * k / n);
+            }
+            ASSERT_NEAR(re, z[2*k], 1e-9) << "n " << n << " k " << k;
+            ASSERT_NEAR(im, z[2*k+1], 1e-9) << "n " << n << " k " << k;
+        }
+        fft_free(&p);
+    }
+}
+
+TEST(test_fft, inverse)
+{
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<double> count(0.0, 1023.0);
+    const int n = 1 << 14;
+    std::vector<double> x(n), z(n + 2), y(n);
+    fft_plan p;
+
+    for (auto &v : x) {
+        v = count(gen);
+    }
+    ASSERT_EQ(0, fft_init(&p, n));
+    fft_forward(&p, x.data(), z.data());
+    fft_inverse(&p, z.data(), y.data());
+    for (int i = 0; i < n; i++) {
+        ASSERT_NEAR(x[i], y[i], 1e-8) << "i " << i;
+    }
+    fft_free(&p);
+}
+
+TEST(test_fft, batch)
+{
+    std::mt19937 gen(7);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    const int n = 512, count = 5;
+    std::vector<double> x(n * count), z(count * (n + 2)), work(n * count), y(n + 2);
+    fft_plan p;
+
+    for (auto &v : x) {
+        v = noise(gen);
+    }
+    ASSERT_EQ(0, fft_init(&p, n));
+    fft_forward_batch(&p, x.data(), count, z.data(), work.data());
+
+    // the same as one at a time to the last bit
+    for (int b = 0; b < count; b++) {
+        fft_forward(&p, &x[b * n], y.data());
+        for (int k = 0; k < n + 2; k++) {
+            ASSERT_EQ(y[k], z[b * (n + 2) + k]) << "b " << b << " k " << k;
+        }
+    }
+    fft_free(&p);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+extern "C"
+{
+#include "filter.h"
+}
+
+static const double rate = 53.0;
+
+static std::vector<float> sine(int n, double freq, double offset)
+{
+    std::vector<float> x(n);
+
+    for (int i = 0; i < n; i++) {
+        x[i] = static_cast<float>(offset + 100.0 * std::sin(2.0 * M_PI * freq * i / rate));
+    }
+    return x;
+}
+
+// all outputs of a run given in chunks of up to chunk samples
+static std::vector<float> decimate(fir_decimator *d, const std::vector<float> &x, int chunk)
+{
+    std::vector<float> y(x.size() / d->factor + FIR_HALF_TAPS + 2);
+    int n = 0;
+
+    for (size_t i = 0; i < x.size(); i += chunk) {
+        int m = std::min<int>(chunk, x.size() - i);
+        n += fir_decimator_process(d, &x[i], m, &y[n]);
+    }
+    n += fir_decimator_flush(d, &y[n]);
+    y.resize(n);
+    return y;
+}
+
+// RMS without the ends of the filter
+static double rms(const std::vector<float> &y, size_t skip)
+{
+    double sum = 0.0;
+
+    for (size_t i = skip; i < y.size() - skip; i++) {
+        sum += y[i] * y[i];
+    }
+    return std::sqrt(sum / (y.size() - 2 * skip));
+}
+
+TEST(test_filter, decimator)
+{
+    const int factor = 8, n = 8000;
+    fir_decimator d;
+
+    ASSERT_EQ(-1, fir_decimator_init(&d, 1));
+    ASSERT_EQ(0, fir_decimator_init(&d, factor));
+    ASSERT_EQ(0, d.ntap % FIR_LANES);
+
+    // a constant: every input centre once, unit gain
+    std::vector<float> y = decimate(&d, std::vector<float>(n - 3, 512.0f), 1000);
+    ASSERT_EQ((n - 3 + factor - 1) / factor, (int)y.size());
+    for (float v : y) {
+        ASSERT_NEAR(512.0, v, 1e-3);
+    }
+
+    // passband at half the output Nyquist frequency, stopband above 1.2 of it
+    double nyquist = rate / 2.0 / factor;
+    y = decimate(&d, sine(n, 0.5 * nyquist, 0.0), 1000);
+    ASSERT_NEAR(100.0 / std::sqrt(2.0), rms(y, FIR_HALF_TAPS), 0.1);
+    y = decimate(&d, sine(n, 1.2 * nyquist, 0.0), 1000);
+    ASSERT_LT(rms(y, FIR_HALF_TAPS), 100.0 * 1e-3);
+
+    // output j centred on input j * factor
+    std::vector<float> x = sine(n, 0.25 * nyquist, 0.0);
+    y = decimate(&d, x, 1000);
+    for (size_t j = FIR_HALF_TAPS; j < y.size() - FIR_HALF_TAPS; j++) {
+        ASSERT_NEAR(x[j * factor], y[j], 0.05) << j;
+    }
+    fir_decimator_free(&d);
+}
+
+TEST(test_filter, stream)
+{
+    std::mt19937 gen(20261018);
+    std::normal_distribution<float> noise(0.0f, 50.0f);
+    std::vector<float> x(5000);
+    fir_decimator d;
+
+    for (auto &v : x) {
+        v = 500.0f + noise(gen);
+    }
+    ASSERT_EQ(0, fir_decimator_init(&d, 5));
+    std::vector<float> y = decimate(&d, x, x.size());
+    for (int chunk : {1, 7, 32, FIR_BLOCK + 3}) {
+        std::vector<float> z = decimate(&d, x, chunk);
+        ASSERT_EQ(y.size(), z.size());
+        ASSERT_EQ(0, memcmp(y.data(), z.data(), y.size() * sizeof(float))) << chunk;
+    }
+    fir_decimator_free(&d);
+}
+
+static void check_isa(int isa)
+{
+    std::mt19937 gen(7);
+    std::normal_distribution<float> noise(0.0f, 100.0f);
+    std::vector<float> x(3001);
+    fir_decimator d;
+
+    for (auto &v : x) {
+        v = noise(gen);
+    }
+    ASSERT_EQ(0, fir_decimator_init(&d, 3));
+    ASSERT_EQ(0, filter_set_isa(CPU_ISA_SCALAR));
+    std::vector<float> y0 = decimate(&d, x, 100);
+    ASSERT_EQ(0, filter_set_isa(isa));
+    ASSERT_EQ(isa, filter_isa());
+    std::vector<float> y1 = decimate(&d, x, 100);
+    filter_set_isa(CPU_ISA_AUTO);
+
+    ASSERT_EQ(y0.size(), y1.size());
+    ASSERT_EQ(0, memcmp(y0.data(), y1.data(), y0.size() * sizeof(float)));
+    fir_decimator_free(&d);
+}
+
+TEST(test_filter, scalar)
+{
+    check_isa(CPU_ISA_SCALAR);
+}
+
+TEST(test_filter, avx2)
+{
+    if (filter_set_isa(CPU_ISA_AVX2) != 0) {
+        GTEST_SKIP() << "AVX2 is not supported";
+    }
+    check_isa(CPU_ISA_AVX2);
+}
+
+TEST(test_filter, bandpass)
+{
+    const int n = 4000;
+    iir_bandpass f;
+
+    ASSERT_EQ(-1, iir_bandpass_init(&f, 3, 1.0, 5.0, rate));
+    ASSERT_EQ(-1, iir_bandpass_init(&f, 4, 5.0, 1.0, rate));
+    ASSERT_EQ(-1, iir_bandpass_init(&f, 4, 1.0, 30.0, rate));
+    ASSERT_EQ(0, iir_bandpass_init(&f, 4, 1.0, 5.0, rate));
+
+    // the offset of the counts removed from the first sample
+    std::vector<float> y(n);
+    std::vector<float> x = sine(n, 2.2, 512.0);
+    iir_bandpass_process(&f, x.data(), n, y.data());
+    ASSERT_NEAR(0.0, y[0], 1e-6);
+    ASSERT_NEAR(100.0 / std::sqrt(2.0), rms(y, 500), 0.5);
+
+    // two octaves outside: more than 40 dB down
+    for (double freq : {0.25, 20.0}) {
+        iir_bandpass_reset(&f);
+        x = sine(n, freq, 512.0);
+        iir_bandpass_process(&f, x.data(), n, y.data());
+        ASSERT_LT(rms(y, 500), 100.0 / std::sqrt(2.0) * std::pow(10.0, -40.0 / 20.0)) << freq;
+    }
+}
+
+TEST(test_filter, chain)
+{
+    const int n = 3200, factor = 4;
+    filter_chain c;
+    std::vector<float> x = sine(n, 2.0, 512.0), y(n / factor + FIR_HALF_TAPS + 2);
+
+    ASSERT_EQ(-1, filter_chain_init(&c, rate, 1, 3.0, 2.0));
+    ASSERT_EQ(0, filter_chain_init(&c, rate, factor, 1.0, 0.0));
+    int m = filter_chain_process(&c, x.data(), n, y.data());
+    m += filter_chain_flush(&c, &y[m]);
+    ASSERT_EQ(n / factor, m);
+    y.resize(m);
+    ASSERT_NEAR(100.0 / std::sqrt(2.0), rms(y, 100), 1.0);
+    filter_chain_free(&c);
+
+    // neither: a copy
+    ASSERT_EQ(0, filter_chain_init(&c, rate, 1, 0.0, 0.0));
+    std::vector<float> z(n);
+    ASSERT_EQ(n, filter_chain_process(&c, x.data(), n, z.data()));
+    ASSERT_EQ(0, memcmp(x.data(), z.data(), n * sizeof(float)));
+    filter_chain_free(&c);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
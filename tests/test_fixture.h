@@ -0,0 +1,49 @@
+/*! @file test_fixture.h
+ *  @brief temporary input files and epochs for the tests of the readers
+ *  @date 2026/10/18
+ */
+#ifndef __TEST_FIXTURE_H__
+#define __TEST_FIXTURE_H__
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <unistd.h>
+
+extern "C"
+{
+#include "util.h"
+}
+
+// a text file in /tmp, removed when it goes out of scope
+class temp_file
+{
+public:
+    temp_file(const char *name, const char *text)
+        : filename("/tmp/" + std::string(name) + "." + std::to_string(getpid()))
+    {
+        FILE *f = fopen(filename.c_str(), "w");
+
+        fputs(text, f);
+        fclose(f);
+    }
+    ~temp_file() { unlink(filename.c_str()); }
+    temp_file(const temp_file &) = delete;
+    temp_file &operator=(const temp_file &) = delete;
+
+    const char *path() const { return filename.c_str(); }
+
+private:
+    std::string filename;
+};
+
+// msec since the epoch of a "YYYY-MM-DD hh:mm:ss[.sss]" string
+static inline int64_t epoch(const char *s)
+{
+    int64_t t;
+
+    date_string_to_epoch(s, &t);
+    return t;
+}
+
+#endif
@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+extern "C"
+{
+#include <stdint.h>
+#include "matched.h"
+}
+
+// a decaying chirp as the waveform of a nest
+static std::vector<float> waveform(int n)
+{
+    std::vector<float> w(n);
+    for (int i = 0; i < n; i++) {
+        double t = static_cast<double>(i) / n;
+        w[i] = static_cast<float>(std::exp(-3.0 * t) * std::sin(2.0 * M_PI * (5.0 + 20.0 * t) * t));
+    }
+    return w;
+}
+
+static mf_template make_template(const std::vector<float> &w, const char *nest)
+{
+    std::vector<double> sum(w.size(), 0.0);
+    mf_template t;
+
+    memset(&t, 0, sizeof(t));
+    strcpy(t.nest, nest);
+    t.apollo_station = 12;
+    t.rate = 6.6;
+    EXPECT_EQ(0, mf_stack_add(sum.data(), w.data(), w.size()));
+    EXPECT_EQ(0, mf_stack_finish(&t, sum.data(), w.size(), 1));
+    return t;
+}
+
+TEST(test_matched, detect)
+{
+    const int len = 200, n = 20000;
+    std::vector<float> w = waveform(len);
+    std::vector<float> x(n);
+    std::mt19937 gen(20261018);
+    std::normal_distribution<double> noise(0.0, 0.5);
+    std::vector<int64_t> at = {1000, 5003, 12345, n - len};
+
+    // noise on an offset with the waveform (scaled) at known positions and
+    // a gap which hides one more
+    for (auto &v : x) {
+        v = static_cast<float>(512.0 + noise(gen));
+    }
+    for (size_t j = 0; j < at.size(); j++) {
+        for (int i = 0; i < len; i++) {
+            x[at[j] + i] += static_cast<float>((j + 1) * 10.0 * w[i]);
+        }
+    }
+    for (int i = 0; i < len; i++) {
+        x[15000 + i] += 10.0f * w[i];
+    }
+    x[15100] = NAN;
+
+    mf_template t[2] = {make_template(w, "1"), make_template(waveform(150), "2")};
+    mf_plan p;
+    mf_detections d;
+
+    memset(&d, 0, sizeof(d));
+    ASSERT_EQ(0, mf_init(&p, t, 2));
+    ASSERT_GE(p.step, 1);
+    for (int64_t b = 0; b < mf_blocks(&p, n); b++) {
+        ASSERT_EQ(0, mf_correlate(&p, x.data(), n, b, 0, 1, 0.8, &d));
+    }
+    mf_decluster(&d, &p);
+
+    ASSERT_EQ(at.size(), static_cast<size_t>(d.n));
+    for (size_t j = 0; j < at.size(); j++) {
+        ASSERT_EQ(0, d.d[j].t);
+        ASSERT_EQ(at[j], d.d[j].index);
+        ASSERT_GT(d.d[j].cc, 0.95);
+        ASSERT_LE(d.d[j].cc, 1.0 + 1e-5);
+    }
+
+    free(d.d);
+    mf_free(&p);
+    free(t[0].x);
+    free(t[1].x);
+}
+
+TEST(test_matched, stack)
+{
+    std::vector<float> w = waveform(100);
+    std::vector<float> flat(100, 512.0f);
+    std::vector<double> sum(100, 0.0);
+    mf_template t;
+
+    // a stack of scaled and shifted copies is the waveform
+    memset(&t, 0, sizeof(t));
+    for (int k = 1; k <= 3; k++) {
+        std::vector<float> v(100);
+        for (int i = 0; i < 100; i++) {
+            v[i] = 500.0f + k * 7.0f * w[i];
+        }
+        ASSERT_EQ(0, mf_stack_add(sum.data(), v.data(), 100));
+    }
+    ASSERT_EQ(-1, mf_stack_add(sum.data(), flat.data(), 100));
+    flat[3] = NAN;
+    ASSERT_EQ(-1, mf_stack_add(sum.data(), flat.data(), 100));
+    ASSERT_EQ(0, mf_stack_finish(&t, sum.data(), 100, 3));
+
+    mf_template u = make_template(w, "x");
+    double dot = 0.0;
+    for (int i = 0; i < 100; i++) {
+        dot += t.x[i] * u.x[i];
+    }
+    ASSERT_NEAR(1.0, dot, 1e-5);
+    ASSERT_EQ(3, t.nstack);
+    free(t.x);
+    free(u.x);
+}
+
+TEST(test_matched, file)
+{
+    std::string filename = testing::TempDir() + "test_matched.mf";
+    mf_template t[2] = {make_template(waveform(100), "208"), make_template(waveform(50), "1")};
+    mf_template *r;
+    int nt;
+
+    t[1].apollo_station = 16;
+    t[1].offset = -30000;
+    FILE *f = fopen(filename.c_str(), "wb");
+    ASSERT_NE(nullptr, f);
+    ASSERT_EQ(0, mf_template_write(f, t, 2));
+    fclose(f);
+
+    f = fopen(filename.c_str(), "rb");
+    ASSERT_EQ(0, mf_template_read(f, &r, &nt));
+    fclose(f);
+    remove(filename.c_str());
+
+    ASSERT_EQ(2, nt);
+    for (int i = 0; i < 2; i++) {
+        ASSERT_STREQ(t[i].nest, r[i].nest);
+        ASSERT_EQ(t[i].apollo_station, r[i].apollo_station);
+        ASSERT_EQ(t[i].offset, r[i].offset);
+        ASSERT_EQ(t[i].rate, r[i].rate);
+        ASSERT_EQ(t[i].n, r[i].n);
+        ASSERT_EQ(0, memcmp(t[i].x, r[i].x, t[i].n * sizeof(float)));
+        free(t[i].x);
+    }
+    mf_template_free(r, nt);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+extern "C"
+{
+#include "define.h"
+#include "error.h"
+#include "merge.h"
+}
+
+struct frames
+{
+    std::vector<merge_frame> mf;
+    size_t i;
+};
+
+static int next_frame(void *arg, merge_frame *mf)
+{
+    frames *f = static_cast<frames *>(arg);
+    if (f->i >= f->mf.size()) {
+        return 0;
+    }
+    *mf = f->mf[f->i++];
+    return 1;
+}
+
+static merge_frame make_frame(int station, int64_t msec, uint32_t error_flag, int file_id)
+{
+    merge_frame mf = {};
+    mf.apollo_station = station;
+    mf.year = 1976;
+    mf.file_id = file_id;
+    mf.pf.msec_of_year = msec;
+    mf.pf.msec_of_year_corrected = msec;
+    mf.pf.error_flag = error_flag;
+    return mf;
+}
+
+static std::vector<merge_frame> merge_all(std::vector<frames> &f, int64_t tolerance, uint64_t *nduplicate)
+{
+    std::vector<merge_source> src(f.size());
+    std::vector<merge_frame> out;
+    merger m;
+    merge_frame mf;
+
+    for (size_t s = 0; s < f.size(); s++) {
+        f[s].i = 0;
+        src[s].next = next_frame;
+        src[s].arg = &f[s];
+    }
+    EXPECT_EQ(0, merge_init(&m, src.data(), static_cast<int>(src.size()), tolerance));
+    while (merge_next(&m, &mf) == 1) {
+        out.push_back(mf);
+    }
+    *nduplicate = m.nduplicate;
+    merge_free(&m);
+    return out;
+}
+
+TEST(test_merge, overlap)
+{
+    std::vector<frames> f(2);
+    uint64_t nduplicate;
+
+    // PSE tape of station 12 (file 1) and a work tape of 12 and 15 (file 2)
+    for (int k = 0; k < 10; k++) {
+        f[0].mf.push_back(make_frame(12, 1000 + k * 604, (k == 3) ? ERROR_INVALID_SYNC_CODE : 0, 1));
+    }
+    for (int k = 2; k < 12; k++) {
+        f[1].mf.push_back(make_frame(12, 1000 + k * 604 + 20, (k == 5) ? ERROR_FRAME_SMALL_TIME_ERROR : 0, 2));
+        f[1].mf.push_back(make_frame(15, 1300 + k * 604, 0, 2));
+    }
+
+    std::vector<merge_frame> out = merge_all(f, MERGE_TOLERANCE, &nduplicate);
+
+    // frames 2 ... 9 of station 12 are on both tapes
+    ASSERT_EQ(8U, nduplicate);
+    ASSERT_EQ(22U, out.size());
+
+    std::vector<merge_frame> st12;
+    int64_t last15 = -1;
+    for (size_t i = 0; i < out.size(); i++) {
+        if (out[i].apollo_station == 12) {
+            st12.push_back(out[i]);
+        } else {
+            ASSERT_EQ(15, out[i].apollo_station);
+            ASSERT_LT(last15, out[i].key);
+            last15 = out[i].key;
+        }
+    }
+    ASSERT_EQ(12U, st12.size());
+    for (size_t k = 0; k < st12.size(); k++) {
+        if (k > 0) {
+            ASSERT_LT(st12[k-1].key, st12[k].key);
+        }
+    }
+
+    // the frame of fewer errors is kept, the first source on a tie
+    ASSERT_EQ(1, st12[2].file_id);
+    ASSERT_EQ(2, st12[3].file_id);
+    ASSERT_EQ(1, st12[5].file_id);
+    ASSERT_EQ(2, st12[10].file_id);
+}
+
+TEST(test_merge, tolerance)
+{
+    std::vector<frames> f(2);
+    uint64_t nduplicate;
+
+    f[0].mf.push_back(make_frame(14, 5000, 0, 1));
+    f[1].mf.push_back(make_frame(14, 5400, 0, 2));
+
+    ASSERT_EQ(2U, merge_all(f, MERGE_TOLERANCE, &nduplicate).size());
+    ASSERT_EQ(0U, nduplicate);
+    ASSERT_EQ(1U, merge_all(f, 500, &nduplicate).size());
+    ASSERT_EQ(1U, nduplicate);
+}
+
+TEST(test_merge, year)
+{
+    std::vector<frames> f(1);
+    uint64_t nduplicate;
+
+    f[0].mf.push_back(make_frame(16, 366LL * 86400000LL - 100, 0, 1));
+    f[0].mf.push_back(make_frame(16, 500, 0, 1));
+    f[0].mf[1].year = 1977;
+
+    ASSERT_LT(merge_key(1976, 366LL * 86400000LL - 100), merge_key(1977, 0));
+    std::vector<merge_frame> out = merge_all(f, MERGE_TOLERANCE, &nduplicate);
+    ASSERT_EQ(2U, out.size());
+    ASSERT_EQ(1976, out[0].year);
+    ASSERT_EQ(1977, out[1].year);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
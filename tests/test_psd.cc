@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+extern "C"
+{
+#include "psd.h"
+}
+
+TEST(test_psd, plan)
+{
+    psd_plan p;
+
+    // the largest power of two within the segment
+    ASSERT_EQ(0, psd_init(&p, 6.625, 300.0));
+    ASSERT_EQ(1024, p.nseg);
+    ASSERT_EQ(513, p.nfreq);
+    ASSERT_GT(p.nband, 0);
+    for (int b = 0; b < p.nband; b++) {
+        ASSERT_GE(p.lo[b], 1);
+        ASSERT_LE(p.lo[b], p.hi[b]);
+        ASSERT_LT(p.hi[b], p.nfreq);
+        if (b > 0) {
+            ASSERT_NEAR(std::pow(2.0, 1.0 / PSD_BANDS_PER_OCTAVE), p.fc[b] / p.fc[b-1], 1e-9);
+        }
+    }
+    psd_free(&p);
+
+    ASSERT_EQ(-1, psd_init(&p, 6.625, 1.0));
+}
+
+TEST(test_psd, white)
+{
+    std::mt19937 gen(20261018);
+    std::normal_distribution<float> noise(0.0f, 3.0f);
+    const double rate = 53.0;
+    std::vector<float> x(1 << 16);
+    psd_plan p;
+
+    for (auto &v : x) {
+        v = noise(gen);
+    }
+    ASSERT_EQ(0, psd_init(&p, rate, 20.0));
+    std::vector<double> sum(p.nfreq, 0.0);
+    int n = psd_welch(&p, x.data(), x.size(), sum.data());
+    ASSERT_EQ(((int)x.size() - p.nseg) / (p.nseg / 2) + 1, n);
+
+    // one-sided: the variance spread over 0 ... rate/2
+    double mean = 0.0;
+    for (int k = 1; k < p.nfreq - 1; k++) {
+        mean += sum[k] / n;
+    }
+    mean /= p.nfreq - 2;
+    ASSERT_NEAR(2.0 * 9.0 / rate, mean, 0.02 * 2.0 * 9.0 / rate);
+    psd_free(&p);
+}
+
+TEST(test_psd, sine)
+{
+    const double rate = 6.625, f = 0.5;
+    std::vector<float> x(8192);
+    psd_plan p;
+
+    for (size_t i = 0; i < x.size(); i++) {
+        x[i] = 100.0f + 10.0f * (float)std::sin(2.0 * M_PI * f * i / rate);
+    }
+    ASSERT_EQ(0, psd_init(&p, rate, 300.0));
+    std::vector<double> sum(p.nfreq, 0.0);
+    ASSERT_GT(psd_welch(&p, x.data(), x.size(), sum.data()), 0);
+
+    int peak = 0;
+    for (int k = 1; k < p.nfreq; k++) {
+        if (sum[k] > sum[peak]) {
+            peak = k;
+        }
+    }
+    ASSERT_NEAR(f, peak * rate / p.nseg, rate / p.nseg);
+    psd_free(&p);
+}
+
+TEST(test_psd, missing)
+{
+    const double rate = 6.625;
+    std::vector<float> x(4096, 1.0f);
+    psd_plan p;
+
+    ASSERT_EQ(0, psd_init(&p, rate, 20.0));
+    std::vector<double> sum(p.nfreq, 0.0);
+    int all = psd_welch(&p, x.data(), x.size(), sum.data());
+
+    // a missing sample drops the two segments over it
+    x[1000] = NAN;
+    ASSERT_EQ(all - 2, psd_welch(&p, x.data(), x.size(), sum.data()));
+    for (int k = 0; k < p.nfreq; k++) {
+        ASSERT_FALSE(std::isnan(sum[k]));
+    }
+    psd_free(&p);
+}
+
+TEST(test_psd, day)
+{
+    std::mt19937 gen(3);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    const double rate = 6.625;
+    const int64_t day = 86400000LL * 1000;
+    psd_plan p;
+    psd_day d, r;
+
+    // 00:00 ... 02:30 and 05:00 ... 06:00 of station 12
+    std::vector<float> a((size_t)(2.5 * 3600 * rate)), b((size_t)(3600 * rate));
+    for (auto &v : a) {
+        v = noise(gen);
+    }
+    for (auto &v : b) {
+        v = noise(gen);
+    }
+    samples_series s[3] = {
+        {12, 3, rate, day, a.data(), (int64_t)a.size()},
+        {12, 3, rate, day + 5 * PSD_HOUR_MSEC, b.data(), (int64_t)b.size()},
+        {14, 3, rate, day, a.data(), (int64_t)a.size()},
+    };
+
+    ASSERT_EQ(0, psd_init(&p, rate, 300.0));
+    ASSERT_EQ(1, psd_day_compute(&p, s, 3, 15, 3, day, &d));
+    ASSERT_EQ(0, psd_day_compute(&p, s, 3, 12, 3, day, &d));
+    ASSERT_GT(d.count[0], 0);
+    ASSERT_EQ(d.count[0], d.count[1]);
+    ASSERT_GT(d.count[2], 0);
+    ASSERT_LT(d.count[2], d.count[0]);
+    ASSERT_EQ(0, d.count[3]);
+    ASSERT_GT(d.count[5], 0);
+    ASSERT_TRUE(std::isnan(d.hour[3 * d.nband]));
+
+    // hours 0, 1 and 5 in the histogram, the half hour 2 not
+    for (int k = 0; k < d.nband; k++) {
+        int hours = 0;
+        for (int i = 0; i < PSD_DB_BINS; i++) {
+            hours += d.hist[k * PSD_DB_BINS + i];
+        }
+        ASSERT_EQ(3, hours) << "band " << k;
+    }
+
+    FILE *f = tmpfile();
+    ASSERT_NE(nullptr, f);
+    ASSERT_EQ(0, psd_write_header(f));
+    ASSERT_EQ(0, psd_day_write(f, &d));
+    rewind(f);
+    ASSERT_EQ(0, psd_read_header(f));
+    ASSERT_EQ(1, psd_day_read(f, &r));
+    ASSERT_EQ(12, r.apollo_station);
+    ASSERT_EQ(day, r.day);
+    ASSERT_EQ(d.nfreq, r.nfreq);
+    ASSERT_EQ(d.nband, r.nband);
+    for (int k = 0; k < d.nfreq; k++) {
+        ASSERT_EQ(d.psd[k], r.psd[k]);
+    }
+    for (int k = 0; k < d.nband * PSD_DB_BINS; k++) {
+        ASSERT_EQ(d.hist[k], r.hist[k]);
+    }
+    psd_day_free(&r);
+    ASSERT_EQ(0, psd_day_read(f, &r));
+    fclose(f);
+
+    psd_day_free(&d);
+    psd_free(&p);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
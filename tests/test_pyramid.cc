@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+extern "C"
+{
+#include "pyramid.h"
+}
+
+struct tile
+{
+    int level;
+    pyramid_bin bin;
+};
+
+static void collect(int level, const pyramid_bin *bin, void *arg)
+{
+    static_cast<std::vector<tile> *>(arg)->push_back({level, *bin});
+}
+
+TEST(test_pyramid, bin_index)
+{
+    ASSERT_EQ(0, pyramid_bin_index(0, 2));
+    ASSERT_EQ(0, pyramid_bin_index(3, 2));
+    ASSERT_EQ(1, pyramid_bin_index(4, 2));
+    ASSERT_EQ(-1, pyramid_bin_index(-1, 2));
+    ASSERT_EQ(-1, pyramid_bin_index(-4, 2));
+    ASSERT_EQ(-2, pyramid_bin_index(-5, 2));
+}
+
+TEST(test_pyramid, levels)
+{
+    std::vector<tile> tiles;
+    pyramid p;
+
+    ASSERT_EQ(0, pyramid_init(&p, 1, 2, collect, &tiles));
+    for (int i = 0; i < 8; i++) {
+        pyramid_add(&p, 100 + i, (i % 2) ? i : -i);
+    }
+    pyramid_flush(&p);
+
+    // level 1: {0,1} {-2,3} {-4,5} {-6,7}, level 2: {0,1,-2,3} {-4,5,-6,7}
+    ASSERT_EQ(6U, tiles.size());
+    int64_t level1 = 0, level2 = 0;
+    for (const tile &t : tiles) {
+        if (t.level == 1) {
+            ASSERT_EQ(2, t.bin.count);
+            ASSERT_EQ(t.bin.index * 2 - 100 + 1, t.bin.max);
+            level1 += t.bin.sum;
+        } else {
+            ASSERT_EQ(2, t.level);
+            ASSERT_EQ(4, t.bin.count);
+            level2 += t.bin.sum;
+        }
+    }
+    ASSERT_EQ(4, level1);
+    ASSERT_EQ(4, level2);
+    ASSERT_EQ(2, tiles[3].level);
+    ASSERT_EQ(25, tiles[3].bin.index);
+    ASSERT_EQ(-2, tiles[3].bin.min);
+    ASSERT_EQ(3, tiles[3].bin.max);
+}
+
+TEST(test_pyramid, gap)
+{
+    std::vector<tile> tiles;
+    pyramid p;
+
+    ASSERT_EQ(0, pyramid_init(&p, 0, 3, collect, &tiles));
+    pyramid_add(&p, 0, 5);
+    pyramid_add(&p, 20, 7);
+    pyramid_flush(&p);
+
+    // a tile is emitted only where there are samples
+    ASSERT_EQ(8U, tiles.size());
+    for (const tile &t : tiles) {
+        ASSERT_EQ(1, t.bin.count);
+        ASSERT_EQ(t.bin.min, t.bin.max);
+    }
+}
+
+TEST(test_pyramid, invalid_level)
+{
+    pyramid p;
+    ASSERT_EQ(-1, pyramid_init(&p, 3, 2, collect, nullptr));
+    ASSERT_EQ(-1, pyramid_init(&p, -1, 2, collect, nullptr));
+    ASSERT_EQ(-1, pyramid_init(&p, 0, PYRAMID_MAX_LEVEL + 1, collect, nullptr));
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
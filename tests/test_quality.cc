@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+extern "C"
+{
+#include "define.h"
+#include "error.h"
+#include "samples.h"
+#include "quality.h"
+}
+#include "test_fixture.h"
+
+// an original, a work tape and a duplicated event tape of station 12 and an original of 14
+static const char *catalog =
+    "# file_id ap_station type tape_type time_first time_last frames error_frames sync_errors gaps\n"
+    "1\t12\tpse\t1\t1971-01-01 00:00:00\t1971-01-02 00:00:00.604\t143000\t1430\t0\t0\n"
+    "2\t12\twtn\t0\t1971-01-01 12:00:00\t1971-01-03 00:00:00\t214000\t0\t0\t0\n"
+    "3\t12\tpse\t2\t1971-01-01 00:00:00\t1971-01-02 00:00:00.604\t143000\t1430\t0\t0\n"
+    "4\t14\tpse\t1\t1971-01-01 00:00:00\t1971-01-02 00:00:00\t143000\t100\t100\t10\n";
+
+TEST(test_quality, read)
+{
+    temp_file file("test_quality", catalog);
+    quality_catalog c;
+
+    ASSERT_EQ(0, quality_read(file.path(), &c));
+    ASSERT_EQ(4, c.n);
+    ASSERT_EQ(2, c.q[1].file_id);
+    ASSERT_EQ(12, c.q[1].apollo_station);
+    ASSERT_EQ(SAMPLES_TYPE_WTN, c.q[1].type);
+    ASSERT_EQ(2, c.q[2].tape_type);
+    ASSERT_EQ(epoch("1971-01-02 00:00:00") + 604, c.q[0].epoch_last);
+    ASSERT_EQ(10, c.q[3].gaps);
+    ASSERT_TRUE(quality_known(&c, 3));
+    ASSERT_FALSE(quality_known(&c, 5));
+    quality_free(&c);
+
+    // malformed lines
+    const char *bad[] = {
+        "1\t12\tpsx\t1\t1971-01-01 00:00:00\t1971-01-02 00:00:00\t10\t0\t0\t0\n",
+        "1\t12\tpse\t1\t1971-01-02 00:00:00\t1971-01-01 00:00:00\t10\t0\t0\t0\n",
+        "1\t12\tpse\t1\t1971-01-01 00:00:00\t1971-01-02 00:00:00\t10\t0\t0\n",
+        "1\t12\tpse\t1\t1971-01-01 00:00:00\t1971-01-02 00:00:00\t10\t0\t0\t-1\n",
+    };
+    for (const char *line : bad) {
+        temp_file malformed("test_quality.bad", line);
+        ASSERT_EQ(-1, quality_read(malformed.path(), &c)) << line;
+    }
+}
+
+TEST(test_quality, score)
+{
+    quality_entry q = {1, 12, SAMPLES_TYPE_PSE, 1, epoch("1971-01-01 00:00:00"), epoch("1971-01-02 00:00:00"),
+                       1000, 10, 5, 1};
+    int64_t t0 = epoch("1971-01-01 23:00:00"), t1 = epoch("1971-01-02 01:00:00");
+
+    // the 5 sync errors are among the 10 error frames
+    ASSERT_DOUBLE_EQ(1.0 - 20.0 / 1000.0, quality_of(&q));
+    ASSERT_DOUBLE_EQ(0.5 * quality_of(&q), quality_score(&q, t0, t1));
+    ASSERT_DOUBLE_EQ(quality_of(&q), quality_score(&q, q.epoch_first, q.epoch_last));
+    ASSERT_EQ(-1.0, quality_score(&q, q.epoch_last + 1, q.epoch_last + 1000));
+    ASSERT_EQ(-1.0, quality_score(&q, q.epoch_first - 1000, q.epoch_first));
+
+    // many errors and no frames
+    q.gaps = 1000;
+    ASSERT_EQ(0.0, quality_of(&q));
+    q.frames = 0;
+    ASSERT_EQ(0.0, quality_of(&q));
+}
+
+TEST(test_quality, best)
+{
+    temp_file file("test_quality", catalog);
+    quality_catalog c;
+
+    ASSERT_EQ(0, quality_read(file.path(), &c));
+
+    // the original before its event tape copy with the same quality
+    int64_t t0 = epoch("1971-01-01 06:00:00"), t1 = epoch("1971-01-01 07:00:00");
+    ASSERT_EQ(1, quality_best(&c, 12, t0, t1, NULL, 0)->file_id);
+    int copies[] = {2, 3};
+    ASSERT_EQ(3, quality_best(&c, 12, t0, t1, copies, 2)->file_id);
+
+    // the work tape without errors where it covers the window
+    t0 = epoch("1971-01-01 18:00:00");
+    t1 = epoch("1971-01-01 19:00:00");
+    ASSERT_EQ(2, quality_best(&c, 12, t0, t1, NULL, 0)->file_id);
+
+    // the most of the window: the original ends an hour into it
+    t0 = epoch("1971-01-01 23:00:00");
+    t1 = epoch("1971-01-02 03:00:00");
+    ASSERT_EQ(2, quality_best(&c, 12, t0, t1, NULL, 0)->file_id);
+    t1 = epoch("1971-01-02 00:00:01");
+    ASSERT_EQ(2, quality_best(&c, 12, t0, t1, NULL, 0)->file_id);
+    int originals[] = {1, 3};
+    ASSERT_EQ(1, quality_best(&c, 12, t0, t1, originals, 2)->file_id);
+
+    // errors and gaps lower the quality but a single tape is still read
+    ASSERT_EQ(4, quality_best(&c, 14, t0, t1, NULL, 0)->file_id);
+
+    // no tape
+    ASSERT_EQ(nullptr, quality_best(&c, 15, t0, t1, NULL, 0));
+    ASSERT_EQ(nullptr, quality_best(&c, 12, epoch("1971-01-04 00:00:00"), epoch("1971-01-05 00:00:00"), NULL, 0));
+    int none[] = {4};
+    ASSERT_EQ(nullptr, quality_best(&c, 12, t0, t1, none, 1));
+    quality_free(&c);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+extern "C"
+{
+#include "define.h"
+#include "error.h"
+#include "samples.h"
+#include "response.h"
+}
+#include "test_fixture.h"
+
+static const double rate = 50.0;
+
+// a 1 Hz seismometer with 0.7 of critical damping for displacement, and a flat LSG
+static const char *responses =
+    "# station channel from to quantity sensitivity f_norm zeros poles\n"
+    "12\tlp_z\t1969-11-19 00:00:00\t1974-10-18 00:00:00\tdisplacement\t3.0e9\t5\t0,0;0,0\t-4.398,4.487;-4.398,-4.487\n"
+    "12\tlp_z\t1974-10-18 00:00:00\t1977-09-30 00:00:00\tdisplacement\t1.5e9\t5\t0,0;0,0\t-4.398,4.487;-4.398,-4.487\n"
+    "17\tlsg\t1972-12-12 00:00:00\t1977-09-30 00:00:00\tacceleration\t2.0e8\t1\t-\t-\n";
+
+// counts of a ground displacement a sin(2 pi f t) through a definition
+static std::vector<float> counts(const resp_def *d, double f, double a, int n)
+{
+    std::vector<float> x(n);
+    double re, im;
+
+    resp_eval(d, f, &re, &im);
+    for (int i = 0; i < n; i++) {
+        x[i] = (float)(a * hypot(re, im) * sin(2.0 * M_PI * f * i / rate + atan2(im, re)));
+    }
+    return x;
+}
+
+// deconvolve x in chunks of m samples
+static std::vector<float> deconvolve(const resp_transfer *t, const std::vector<float> &x, int m)
+{
+    std::vector<float> y(x.size() + t->nfft);
+    resp_calib c;
+    int n = 0;
+
+    EXPECT_EQ(0, resp_calib_init(&c, t));
+    for (size_t i = 0; i < x.size(); i += m) {
+        int k = std::min((int)(x.size() - i), m);
+
+        n += resp_calib_process(&c, &x[i], k, &y[n]);
+    }
+    n += resp_calib_flush(&c, &y[n]);
+    resp_calib_free(&c);
+    y.resize(n);
+    return y;
+}
+
+TEST(test_response, read)
+{
+    temp_file file("test_response", responses);
+    resp_table t;
+
+    ASSERT_EQ(0, resp_read(file.path(), &t));
+    ASSERT_EQ(3, t.n);
+    ASSERT_EQ(SAMPLES_LP_Z, t.d[0].channel);
+    ASSERT_EQ(RESP_DISPLACEMENT, t.d[0].input);
+    ASSERT_EQ(2, t.d[0].nzero);
+    ASSERT_EQ(2, t.d[0].npole);
+    ASSERT_EQ(RESP_ACCELERATION, t.d[2].input);
+
+    // the epochs of a channel
+    ASSERT_EQ(&t.d[0], resp_find(&t, 12, SAMPLES_LP_Z, epoch("1971-01-01 00:00:00")));
+    ASSERT_EQ(&t.d[1], resp_find(&t, 12, SAMPLES_LP_Z, epoch("1974-10-18 00:00:00")));
+    ASSERT_EQ(NULL, resp_find(&t, 12, SAMPLES_LP_Z, epoch("1969-01-01 00:00:00")));
+    ASSERT_EQ(NULL, resp_find(&t, 14, SAMPLES_LP_Z, epoch("1971-01-01 00:00:00")));
+    ASSERT_EQ(NULL, resp_find(&t, 12, SAMPLES_LP_X, epoch("1971-01-01 00:00:00")));
+
+    // normalized to the sensitivity at f_norm
+    double re, im;
+    resp_eval(&t.d[0], 5.0, &re, &im);
+    ASSERT_NEAR(3.0e9, hypot(re, im), 1.0);
+    resp_eval(&t.d[2], 0.3, &re, &im);
+    ASSERT_NEAR(2.0e8, re, 1e-6);
+    ASSERT_NEAR(0.0, im, 1e-6);
+    resp_table_free(&t);
+
+    // malformed lines
+    const char *bad[] = {
+        "12\tlp_q\t1969-11-19 00:00:00\t1977-09-30 00:00:00\tdisplacement\t3.0e9\t5\t-\t-1,0\n",
+        "12\tlp_z\t1977-09-30 00:00:00\t1969-11-19 00:00:00\tdisplacement\t3.0e9\t5\t-\t-1,0\n",
+        "12\tlp_z\t1969-11-19 00:00:00\t1977-09-30 00:00:00\tdisplacement\t3.0e9\t5\t-\t-1;0\n",
+        "12\tlp_z\t1969-11-19 00:00:00\t1977-09-30 00:00:00\tdisplacement\t3.0e9\t5\t-\n",
+    };
+    for (const char *line : bad) {
+        temp_file malformed("test_response.bad", line);
+        ASSERT_EQ(-1, resp_read(malformed.path(), &t)) << line;
+    }
+}
+
+TEST(test_response, prefilter)
+{
+    double f[4];
+
+    ASSERT_EQ(0, resp_parse_prefilter("0.1,0.2,10,20", f));
+    ASSERT_DOUBLE_EQ(20.0, f[3]);
+    ASSERT_EQ(-1, resp_parse_prefilter("0.2,0.1,10,20", f));
+    ASSERT_EQ(-1, resp_parse_prefilter("0.1,0.2,10", f));
+    ASSERT_EQ(RESP_VELOCITY, resp_quantity("vel"));
+    ASSERT_EQ(RESP_ACCELERATION, resp_quantity("acceleration"));
+    ASSERT_EQ(-1, resp_quantity("m"));
+}
+
+TEST(test_response, sine)
+{
+    temp_file file("test_response", responses);
+    resp_table t;
+    resp_cache c;
+    const int n = 20000;
+    const double f = 2.0, a = 1e-8;
+
+    ASSERT_EQ(0, resp_read(file.path(), &t));
+    std::vector<float> x = counts(&t.d[0], f, a, n);
+
+    // displacement and velocity away from the ends of the run
+    for (int output = RESP_DISPLACEMENT; output <= RESP_VELOCITY; output++) {
+        resp_cache_init(&c, &t, output, NULL, RESP_WATER_LEVEL);
+        const resp_transfer *tr = resp_cache_get(&c, &t.d[0], rate);
+        ASSERT_NE(nullptr, tr);
+        ASSERT_EQ(tr, resp_cache_get(&c, &t.d[0], rate));
+        ASSERT_NE(tr, resp_cache_get(&c, &t.d[0], rate / 2.0));
+
+        std::vector<float> y = deconvolve(tr, x, 1000);
+        ASSERT_EQ((size_t)n, y.size());
+        double g = (output == RESP_VELOCITY) ? 2.0 * M_PI * f : 1.0;
+        double p = (output == RESP_VELOCITY) ? M_PI / 2.0 : 0.0;
+        for (int i = tr->nfft; i < n - tr->nfft; i++) {
+            ASSERT_NEAR(a * g * sin(2.0 * M_PI * f * i / rate + p), y[i], a * g * 1e-2) << i;
+        }
+        resp_cache_free(&c);
+    }
+    resp_table_free(&t);
+}
+
+TEST(test_response, chunks)
+{
+    temp_file file("test_response", responses);
+    resp_table t;
+    resp_cache c;
+    const int n = 9000;
+
+    ASSERT_EQ(0, resp_read(file.path(), &t));
+    std::vector<float> x = counts(&t.d[0], 0.7, 1e-7, n);
+    for (int i = 0; i < n; i++) {
+        x[i] += (float)(100.0 * sin(i * 0.37) * cos(i * 0.011));
+    }
+
+    // the outputs do not depend on how the run is split
+    double prefilter[4] = {0.2, 0.4, 30.0, 40.0};
+    resp_cache_init(&c, &t, RESP_DISPLACEMENT, prefilter, RESP_WATER_LEVEL);
+    const resp_transfer *tr = resp_cache_get(&c, &t.d[0], rate);
+    ASSERT_NE(nullptr, tr);
+    ASSERT_DOUBLE_EQ(0.4 * rate, tr->prefilter[2]);
+    std::vector<float> y0 = deconvolve(tr, x, n);
+    for (int m : {1, 37, 1000, tr->nfft / 2, 5000}) {
+        std::vector<float> y = deconvolve(tr, x, m);
+        ASSERT_EQ(y0.size(), y.size()) << m;
+        ASSERT_EQ(0, memcmp(y0.data(), y.data(), y.size() * sizeof(float))) << m;
+    }
+
+    // a prefilter above the band of the rate
+    double low[4] = {2.0, 30.0, 40.0, 45.0};
+    resp_cache_free(&c);
+    resp_cache_init(&c, &t, RESP_DISPLACEMENT, low, RESP_WATER_LEVEL);
+    ASSERT_EQ(nullptr, resp_cache_get(&c, &t.d[0], rate));
+    resp_cache_free(&c);
+    resp_table_free(&t);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+extern "C"
+{
+#include "spectrogram.h"
+}
+
+static const double rate = 53.0;
+
+// a sine of 10 Hz, missing from gap0 to gap1
+static std::vector<float> sine(int64_t n, int64_t gap0, int64_t gap1)
+{
+    std::vector<float> x(n);
+
+    for (int64_t i = 0; i < n; i++) {
+        x[i] = (i >= gap0 && i < gap1) ? NAN : 512.0f + 100.0f * (float)std::sin(2.0 * M_PI * 10.0 * i / rate);
+    }
+    return x;
+}
+
+TEST(test_spectrogram, build)
+{
+    spec_plan p;
+    spec_tile *t;
+    int n;
+    const int nfft = 64, levels = 3;
+    double col0 = spec_column_msec(rate, nfft, 0);
+
+    // 1.5 top level tiles of level 0 columns from the start of top tile 1000
+    std::vector<float> x = sine(SPEC_TILE_COLS * 6 * nfft / 2, 1000, 3000);
+    int64_t t0 = (int64_t)std::ceil(1000 * 4 * SPEC_TILE_COLS * col0);
+    samples_series s = {12, 0, rate, t0, x.data(), (int64_t)x.size()};
+    int64_t first, last;
+
+    ASSERT_EQ(0, spec_init(&p, rate, nfft, levels));
+    ASSERT_EQ(0, spec_top_range(&p, &s, &first, &last));
+    ASSERT_EQ(1000, first);
+    ASSERT_EQ(1001, last);
+
+    ASSERT_EQ(0, spec_build(&p, &s, 1, 12, 1, 1000, &t, &n));
+    ASSERT_EQ(0, n);
+    ASSERT_EQ(0, spec_build(&p, &s, 1, 12, 0, 1000, &t, &n));
+
+    // levels 0, 1 and 2 with 4, 2 and 1 tiles
+    ASSERT_EQ(7, n);
+    for (int i = 0; i < n; i++) {
+        int level = (i < 4) ? 0 : (i < 6) ? 1 : 2;
+        int base = (i < 4) ? 0 : (i < 6) ? 4 : 6;
+        ASSERT_EQ(level, t[i].key.level);
+        ASSERT_EQ(nfft, t[i].key.nfft);
+        ASSERT_EQ((1000LL << (levels - 1 - level)) + (i - base), t[i].key.index);
+    }
+
+    // the centre of window k in column k + 1: the peak at 10 Hz, no
+    // data before the first window and over the gap
+    const int rows = spec_rows(nfft);
+    ASSERT_EQ(SPEC_NONE, t[0].data[0]);
+    for (int c = 1; c < SPEC_TILE_COLS; c++) {
+        const uint8_t *px = &t[0].data[c * rows];
+        int64_t start = (int64_t)(c - 1) * nfft / 2;
+
+        if (start + nfft > 1000 && start < 3000) {
+            ASSERT_EQ(SPEC_NONE, px[0]) << "column " << c;
+            continue;
+        }
+        int peak = 0;
+        for (int r = 1; r < rows; r++) {
+            ASSERT_NE(SPEC_NONE, px[r]);
+            if (px[r] > px[peak]) {
+                peak = r;
+            }
+        }
+        ASSERT_NEAR(10.0, peak * rate / nfft, rate / nfft) << "column " << c;
+    }
+    spec_tiles_free(t, n);
+    spec_free(&p);
+}
+
+TEST(test_spectrogram, level)
+{
+    std::mt19937 gen(20261018);
+    std::normal_distribution<float> noise(0.0f, 10.0f);
+    spec_plan p;
+    spec_tile *t;
+    int n;
+    const int nfft = 32;
+    std::vector<float> x(SPEC_TILE_COLS * 2 * nfft / 2 + nfft);
+    samples_series s = {15, 0, rate, 0, x.data(), (int64_t)x.size()};
+
+    for (auto &v : x) {
+        v = noise(gen);
+    }
+    ASSERT_EQ(0, spec_init(&p, rate, nfft, 2));
+    ASSERT_EQ(0, spec_build(&p, &s, 1, 15, 0, 0, &t, &n));
+    ASSERT_EQ(3, n);
+
+    // white noise: 2 sigma^2 / rate at both levels
+    const int rows = spec_rows(nfft);
+    double level0 = 0.0, level1 = 0.0, expected = 10.0 * std::log10(2.0 * 100.0 / rate);
+    for (int c = 1; c <= SPEC_TILE_COLS / 2; c++) {
+        for (int r = 1; r < rows - 1; r++) {
+            level0 += std::pow(10.0, spec_db(t[0].data[c * rows + r]) / 10.0);
+            level1 += std::pow(10.0, spec_db(t[2].data[c * rows + r]) / 10.0);
+        }
+    }
+    level0 /= SPEC_TILE_COLS / 2 * (rows - 2);
+    level1 /= SPEC_TILE_COLS / 2 * (rows - 2);
+    ASSERT_NEAR(expected, 10.0 * std::log10(level0), 0.5);
+    ASSERT_NEAR(expected, 10.0 * std::log10(level1), 0.5);
+    spec_tiles_free(t, n);
+    spec_free(&p);
+}
+
+TEST(test_spectrogram, view)
+{
+    std::string filename = "/tmp/test_spectrogram." + std::to_string(getpid());
+    spec_plan p[2];
+    spec_writer w;
+    spec_file sf;
+    spec_tile *t, *v;
+    int n, nv;
+    std::vector<float> x = sine(SPEC_TILE_COLS * 8 * 128 / 2, 0, 0);
+    samples_series s = {16, 3, rate, 0, x.data(), (int64_t)x.size()};
+
+    ASSERT_EQ(0, spec_writer_open(&w, filename.c_str()));
+    for (int q = 0; q < 2; q++) {
+        int64_t first, last;
+
+        ASSERT_EQ(0, spec_init(&p[q], rate, 64 << q, 3));
+        ASSERT_EQ(0, spec_top_range(&p[q], &s, &first, &last));
+        for (int64_t top = first; top <= last; top++) {
+            ASSERT_EQ(0, spec_build(&p[q], &s, 1, 16, 3, top, &t, &n));
+            for (int i = 0; i < n; i++) {
+                ASSERT_EQ(0, spec_writer_add(&w, &t[i]));
+            }
+            spec_tiles_free(t, n);
+        }
+        spec_free(&p[q]);
+    }
+    ASSERT_EQ(0, spec_writer_close(&w));
+
+    ASSERT_EQ(0, spec_open(&sf, filename.c_str()));
+
+    // 64 samples: 4 tiles of level 0 in 1024 columns of 32 samples
+    double col = spec_column_msec(rate, 64, 0);
+    ASSERT_EQ(0, spec_view(&sf, 16, 3, 0, (int64_t)(1024 * col), 1000, 10, &v, &nv));
+    ASSERT_EQ(4, nv);
+    for (int i = 0; i < nv; i++) {
+        ASSERT_EQ(64, v[i].key.nfft);
+        ASSERT_EQ(0, v[i].key.level);
+        ASSERT_EQ(i, v[i].key.index);
+    }
+    spec_tiles_free(v, nv);
+
+    // 300 columns wanted: level 1 (512 columns), not level 2 (256)
+    ASSERT_EQ(0, spec_view(&sf, 16, 3, 0, (int64_t)(1024 * col), 300, 33, &v, &nv));
+    ASSERT_EQ(2, nv);
+    ASSERT_EQ(1, v[0].key.level);
+    ASSERT_EQ(64, v[0].key.nfft);
+    spec_tiles_free(v, nv);
+
+    // more rows than 64 gives: 128 samples, the largest
+    ASSERT_EQ(0, spec_view(&sf, 16, 3, 0, (int64_t)(1024 * col), 1, 1000, &v, &nv));
+    ASSERT_GT(nv, 0);
+    ASSERT_EQ(128, v[0].key.nfft);
+    ASSERT_EQ(2, v[0].key.level);
+    spec_tiles_free(v, nv);
+
+    // another station
+    ASSERT_EQ(0, spec_view(&sf, 12, 3, 0, (int64_t)(1024 * col), 1, 1, &v, &nv));
+    ASSERT_EQ(0, nv);
+
+    spec_close(&sf);
+    unlink(filename.c_str());
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
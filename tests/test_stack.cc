@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+extern "C"
+{
+#include "stack.h"
+}
+
+// a decaying chirp as the waveform of a nest
+static std::vector<float> waveform(int n)
+{
+    std::vector<float> w(n);
+    for (int i = 0; i < n; i++) {
+        double t = static_cast<double>(i) / n;
+        w[i] = static_cast<float>(std::exp(-3.0 * t) * std::sin(2.0 * M_PI * (5.0 + 20.0 * t) * t));
+    }
+    return w;
+}
+
+TEST(test_stack, align)
+{
+    const int len = 256, maxlag = 20, m = len + 2 * maxlag;
+    std::vector<float> w = waveform(len);
+    std::vector<int> shift = {0, 7, -12, 3, -20, 15, -5, 11};
+    std::vector<std::vector<float>> x(shift.size(), std::vector<float>(m));
+    std::vector<const float *> xp;
+    std::mt19937 gen(20261018);
+    std::normal_distribution<double> noise(0.0, 0.05);
+
+    // copies of the waveform on an offset, the window j starts shift[j]
+    // samples after the nominal one
+    for (size_t j = 0; j < shift.size(); j++) {
+        for (int i = 0; i < m; i++) {
+            int k = i - maxlag - shift[j];
+            x[j][i] = static_cast<float>(512.0 + noise(gen) + ((k >= 0 && k < len) ? (j + 1) * w[k] : 0.0));
+        }
+        xp.push_back(x[j].data());
+    }
+
+    stack_param p = {maxlag, 4, 2.0};
+    stack_result r;
+    ASSERT_EQ(0, stack_windows(xp.data(), xp.size(), len, &p, &r));
+    ASSERT_EQ(static_cast<int>(shift.size()), r.count);
+    ASSERT_EQ(len, r.n);
+
+    // lags are relative to the stack, which is aligned to some window
+    int base = r.lag[0] - shift[0];
+    for (size_t j = 0; j < shift.size(); j++) {
+        ASSERT_EQ(base, r.lag[j] - shift[j]) << "window " << j;
+        ASSERT_GT(r.cc[j], 0.9);
+    }
+
+    // the coherent stack is the normalized waveform, the phase weight is ~1
+    double dot = 0.0, norm = 0.0, mean = 0.0;
+    int off = base;
+    for (int i = 0; i < len; i++) {
+        mean += w[i];
+    }
+    mean /= len;
+    for (int i = 0; i < len; i++) {
+        int k = i + off;
+        double v = (k >= 0 && k < len) ? w[k] - mean : 0.0;
+        dot += v * r.linear[i];
+        norm += r.linear[i] * r.linear[i];
+    }
+    ASSERT_GT(dot / std::sqrt(norm), 0.0);
+    ASSERT_LE(std::abs(base), maxlag);
+    for (int i = 0; i < len; i++) {
+        ASSERT_LE(std::fabs(r.pws[i]), std::fabs(r.linear[i]) + 1e-12);
+    }
+    stack_result_free(&r);
+}
+
+TEST(test_stack, pws)
+{
+    const int len = 512, nw = 32;
+    std::vector<float> w = waveform(len);
+    std::vector<std::vector<float>> x(nw, std::vector<float>(len));
+    std::vector<const float *> xp;
+    std::mt19937 gen(1);
+    std::normal_distribution<double> noise(0.0, 1.0);
+
+    // the signal in the first half, only noise in the second
+    for (int j = 0; j < nw; j++) {
+        for (int i = 0; i < len; i++) {
+            x[j][i] = static_cast<float>(noise(gen) + (i < len / 2 ? 5.0 * w[2 * i] : 0.0));
+        }
+        xp.push_back(x[j].data());
+    }
+
+    stack_param p = {0, 0, 2.0};
+    stack_result r;
+    ASSERT_EQ(0, stack_windows(xp.data(), nw, len, &p, &r));
+
+    // the phase weight suppresses the incoherent noise more than the signal
+    double lin[2] = {0.0, 0.0}, pws[2] = {0.0, 0.0};
+    for (int i = 0; i < len; i++) {
+        lin[i >= len / 2] += r.linear[i] * r.linear[i];
+        pws[i >= len / 2] += r.pws[i] * r.pws[i];
+    }
+    ASSERT_GT(pws[0] / pws[1], 10.0 * lin[0] / lin[1]);
+    for (int j = 0; j < nw; j++) {
+        ASSERT_EQ(0, r.lag[j]);
+    }
+    stack_result_free(&r);
+}
+
+TEST(test_stack, flat)
+{
+    std::vector<float> flat(100, 512.0f);
+    const float *xp[2] = {flat.data(), flat.data()};
+    stack_param p = {0, 0, 2.0};
+    stack_result r;
+
+    ASSERT_EQ(-1, stack_windows(xp, 2, 100, &p, &r));
+    ASSERT_EQ(nullptr, r.linear);
+}
+
+static void check_isa(int isa)
+{
+    const int n = 1003;
+    std::mt19937 gen(7);
+    std::normal_distribution<double> noise(0.0, 100.0);
+    std::vector<float> x(n);
+    std::vector<double> a(n), h(n);
+
+    for (int i = 0; i < n; i++) {
+        x[i] = static_cast<float>(noise(gen));
+        a[i] = noise(gen);
+        h[i] = (i % 17 == 0) ? 0.0 : noise(gen);
+    }
+    a[0] = 0.0;
+
+    std::vector<double> s0(n, 1.0), s1(n, 1.0), re0(n, 0.0), re1(n, 0.0), im0(n, 0.0), im1(n, 0.0);
+    ASSERT_EQ(0, stack_set_isa(CPU_ISA_SCALAR));
+    stack_add(s0.data(), x.data(), 3.25, 0.01, n);
+    stack_phase_add(re0.data(), im0.data(), a.data(), h.data(), n);
+    ASSERT_EQ(0, stack_set_isa(isa));
+    ASSERT_EQ(isa, stack_isa());
+    stack_add(s1.data(), x.data(), 3.25, 0.01, n);
+    stack_phase_add(re1.data(), im1.data(), a.data(), h.data(), n);
+    stack_set_isa(CPU_ISA_AUTO);
+
+    ASSERT_EQ(0, memcmp(s0.data(), s1.data(), n * sizeof(double)));
+    ASSERT_EQ(0, memcmp(re0.data(), re1.data(), n * sizeof(double)));
+    ASSERT_EQ(0, memcmp(im0.data(), im1.data(), n * sizeof(double)));
+    ASSERT_EQ(0.0, re1[0]);
+    ASSERT_EQ(0.0, im1[0]);
+}
+
+TEST(test_stack, scalar)
+{
+    check_isa(CPU_ISA_SCALAR);
+}
+
+TEST(test_stack, avx2)
+{
+    if (stack_set_isa(CPU_ISA_AVX2) != 0) {
+        GTEST_SKIP() << "AVX2 is not supported";
+    }
+    check_isa(CPU_ISA_AVX2);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
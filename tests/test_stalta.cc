@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+extern "C"
+{
+#include <stdint.h>
+#include "stalta.h"
+}
+
+static void collect(const stalta_trigger *t, void *arg)
+{
+    static_cast<std::vector<stalta_trigger> *>(arg)->push_back(*t);
+}
+
+// noise around the offset of the 10 bit counts, a burst from t0 to t1 [sec]
+static double sample(std::mt19937 &gen, double sec, double t0, double t1)
+{
+    std::normal_distribution<double> noise(0.0, 2.0);
+    double x = 512.0 + noise(gen);
+    if (sec >= t0 && sec < t1) {
+        x += 100.0 * std::sin(2.0 * M_PI * 3.0 * sec);
+    }
+    return x;
+}
+
+static stalta_param param(int cf)
+{
+    stalta_param p;
+    stalta_default_param(&p);
+    p.sta = 2.0;
+    p.lta = 60.0;
+    p.cf = cf;
+    return p;
+}
+
+TEST(test_stalta, burst)
+{
+    const double rate = 50.0;
+
+    for (int cf = STALTA_CF_ENERGY; cf <= STALTA_CF_ENVELOPE; cf++) {
+        std::vector<stalta_trigger> t;
+        std::mt19937 gen(20261018);
+        stalta s;
+        stalta_param p = param(cf);
+
+        ASSERT_EQ(0, stalta_init(&s, rate, &p, collect, &t));
+        for (int i = 0; i < 600 * rate; i++) {
+            double sec = i / rate;
+            stalta_add(&s, static_cast<int64_t>(sec * 1000), sample(gen, sec, 300.0, 330.0));
+        }
+        stalta_flush(&s);
+
+        ASSERT_EQ(1u, t.size()) << "cf " << cf;
+        ASSERT_GE(t[0].on, 300000) << "cf " << cf;
+        ASSERT_LT(t[0].on, 302000) << "cf " << cf;
+        ASSERT_GT(t[0].off, 330000) << "cf " << cf;
+        ASSERT_LT(t[0].off, 360000) << "cf " << cf;
+        ASSERT_GE(t[0].ratio, p.on) << "cf " << cf;
+        ASSERT_GT(t[0].peak, 90.0) << "cf " << cf;
+    }
+}
+
+TEST(test_stalta, warmup)
+{
+    const double rate = 50.0;
+    std::vector<stalta_trigger> t;
+    std::mt19937 gen(1);
+    stalta s;
+    stalta_param p = param(STALTA_CF_ENERGY);
+
+    // a burst before the long term window is filled is not a trigger
+    ASSERT_EQ(0, stalta_init(&s, rate, &p, collect, &t));
+    for (int i = 0; i < 120 * rate; i++) {
+        double sec = i / rate;
+        stalta_add(&s, static_cast<int64_t>(sec * 1000), sample(gen, sec, 10.0, 20.0));
+    }
+    stalta_flush(&s);
+    ASSERT_EQ(0u, t.size());
+}
+
+TEST(test_stalta, gap)
+{
+    const double rate = 50.0;
+    std::vector<stalta_trigger> t;
+    std::mt19937 gen(2);
+    stalta s;
+    stalta_param p = param(STALTA_CF_ENERGY);
+
+    // the trigger is switched off at the last sample before a gap and the
+    // averages start again after it
+    ASSERT_EQ(0, stalta_init(&s, rate, &p, collect, &t));
+    for (int i = 0; i < 200 * rate; i++) {
+        double sec = i / rate;
+        stalta_add(&s, static_cast<int64_t>(sec * 1000), sample(gen, sec, 150.0, 1000.0));
+    }
+    for (int i = 0; i < 100 * rate; i++) {
+        double sec = 1000.0 + i / rate;
+        stalta_add(&s, static_cast<int64_t>(sec * 1000), sample(gen, sec, 1010.0, 1020.0));
+    }
+    stalta_flush(&s);
+
+    ASSERT_EQ(1u, t.size());
+    ASSERT_EQ(static_cast<int64_t>((200 * rate - 1) / rate * 1000), t[0].off);
+}
+
+TEST(test_stalta, param)
+{
+    stalta s;
+    stalta_param p = param(STALTA_CF_ENERGY);
+
+    ASSERT_EQ(0, stalta_init(&s, 50.0, &p, collect, nullptr));
+    p.lta = p.sta;
+    ASSERT_EQ(-1, stalta_init(&s, 50.0, &p, collect, nullptr));
+    p = param(STALTA_CF_ENERGY);
+    p.off = p.on + 1.0;
+    ASSERT_EQ(-1, stalta_init(&s, 50.0, &p, collect, nullptr));
+    p = param(2);
+    ASSERT_EQ(-1, stalta_init(&s, 50.0, &p, collect, nullptr));
+    p = param(STALTA_CF_ENERGY);
+    ASSERT_EQ(-1, stalta_init(&s, 0.0, &p, collect, nullptr));
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
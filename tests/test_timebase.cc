@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include <cmath>
+
+extern "C"
+{
+#include "define.h"
+#include "pse.h"
+#include "wtn.h"
+#include "wth.h"
+#include "timebase.h"
+#include "samples.h"
+}
+
+// the offsets are those of the double arithmetic the tools used before
+static void check(int bits, int bit_rate, int n)
+{
+    double dmsec = bits / (double)bit_rate * 1000;
+    timebase tb;
+
+    ASSERT_EQ(0, timebase_init(&tb, bits, bit_rate, n));
+    ASSERT_EQ(n, tb.n);
+    for (uint64_t t : {8640000000ULL, 8640000001ULL, 31622399999ULL, 20000000603ULL}) {
+        for (int i = 0; i < n; i++) {
+            ASSERT_EQ((uint64_t)(t + dmsec * i / n), t + tb.msec[i]) << n << " " << i;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        ASSERT_EQ(llround(dmsec * i / n * 1000), (long long)tb.usec[i]) << n << " " << i;
+    }
+}
+
+TEST(test_timebase, offsets)
+{
+    check(TIMEBASE_FRAME_BITS, TIMEBASE_BIT_RATE, COUNTS_PER_FRAME_FOR_PSE_SP);
+    check(TIMEBASE_FRAME_BITS, TIMEBASE_BIT_RATE, COUNTS_PER_FRAME_FOR_PSE_LP);
+    check(TIMEBASE_FRAME_BITS, TIMEBASE_BIT_RATE, COUNTS_PER_FRAME_FOR_WTN_LSG);
+    check(TIMEBASE_FRAME_BITS_WTH, TIMEBASE_BIT_RATE_WTH, COUNTS_PER_FRAME_FOR_WTH_GP);
+}
+
+TEST(test_timebase, exact)
+{
+    timebase tb;
+
+    // spz sample 16 is half a frame (301886.79 usec) late
+    ASSERT_EQ(0, timebase_init(&tb, TIMEBASE_FRAME_BITS, TIMEBASE_BIT_RATE, 32));
+    ASSERT_EQ(0u, tb.msec[0]);
+    ASSERT_EQ(0u, tb.usec[0]);
+    ASSERT_EQ(301u, tb.msec[16]);
+    ASSERT_EQ(301887u, tb.usec[16]);
+    ASSERT_EQ(584906u, tb.usec[31]);
+
+    ASSERT_EQ(-1, timebase_init(&tb, TIMEBASE_FRAME_BITS, TIMEBASE_BIT_RATE, 0));
+    ASSERT_EQ(-1, timebase_init(&tb, TIMEBASE_FRAME_BITS, TIMEBASE_BIT_RATE, TIMEBASE_MAX_COUNTS + 1));
+}
+
+// the sample times of samples_func follow the same frame lengths
+TEST(test_timebase, samples)
+{
+    timebase tb;
+
+    ASSERT_EQ(0, timebase_init(&tb, TIMEBASE_FRAME_BITS_WTH, TIMEBASE_BIT_RATE_WTH, COUNTS_PER_FRAME_FOR_WTH_GP));
+    for (int i = 0; i < tb.n; i++) {
+        ASSERT_EQ((long long)tb.usec[i], llround(i * samples_frame_msec(SAMPLES_GP_1) / tb.n * 1000)) << i;
+    }
+    ASSERT_EQ(0, timebase_init(&tb, TIMEBASE_FRAME_BITS, TIMEBASE_BIT_RATE, COUNTS_PER_FRAME_FOR_PSE_SP));
+    for (int i = 0; i < tb.n; i++) {
+        ASSERT_EQ((long long)tb.usec[i], llround(i * samples_frame_msec(SAMPLES_SP_Z) / tb.n * 1000)) << i;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -2,6 +2,7 @@
 
 extern "C"
 {
+#include "define.h"
 #include "util.h"
 }
 
@@ -68,6 +69,100 @@ TEST(test_doy_to_date_string, 1972)
     ASSERT_EQ(FALSE, ret);
 }
 
+TEST(test_msec_of_year_to_epoch, epoch)
+{
+    // 1970-01-01 00:00:00.000
+    ASSERT_EQ(0LL, msec_of_year_to_epoch(1970, 86400000LL));
+
+    // 1969-07-21 (doy 202) 00:00:00.000
+    ASSERT_EQ(-14169600000LL, msec_of_year_to_epoch(1969, 202 * 86400000LL));
+
+    // 1972-11-25 (doy 330) 00:00:00.604
+    ASSERT_EQ(91497600604LL, msec_of_year_to_epoch(1972, 330 * 86400000LL + 604));
+
+    // 1977-09-30 (doy 273) 23:59:59.999
+    ASSERT_EQ(244511999999LL, msec_of_year_to_epoch(1977, 274 * 86400000LL - 1));
+}
+
+TEST(test_msec_of_year_to_date_string, us_offset)
+{
+    char s[SIZE_TIME_STRING];
+
+    // 1972-11-25 (doy 330) 00:00:00.604 and 301887 usec
+    ASSERT_EQ(TRUE, msec_of_year_to_date_string(1972, 330 * 86400000LL + 604, 301887, s));
+    ASSERT_STREQ("1972-11-25 00:00:00.905887", s);
+
+    // carried into the next second
+    ASSERT_EQ(TRUE, msec_of_year_to_date_string(1972, 330 * 86400000LL + 999, 584906, s));
+    ASSERT_STREQ("1972-11-25 00:00:01.583906", s);
+}
+
+TEST(test_date_string_to_epoch, event)
+{
+    int64_t epoch;
+    char s[SIZE_TIME_STRING];
+
+    // timestamps of events.sql
+    ASSERT_EQ(0, date_string_to_epoch("1969-07-20 20:17:00", &epoch));
+    ASSERT_EQ(-14182980000LL, epoch);
+    epoch_to_date_string(epoch, s);
+    ASSERT_STREQ("1969-07-20 20:17:00.000", s);
+
+    ASSERT_EQ(0, date_string_to_epoch("1969-11-20 22:17:17.7", &epoch));
+    epoch_to_date_string(epoch, s);
+    ASSERT_STREQ("1969-11-20 22:17:17.700", s);
+
+    ASSERT_EQ(0, date_string_to_epoch("1972-11-25 00:00:00.604", &epoch));
+    ASSERT_EQ(91497600604LL, epoch);
+
+    ASSERT_EQ(0, date_string_to_epoch("1976-03-01 00:00:00", &epoch));
+    epoch_to_date_string(epoch, s);
+    ASSERT_STREQ("1976-03-01 00:00:00.000", s);
+
+    ASSERT_EQ(-1, date_string_to_epoch("1977-13-01 00:00:00", &epoch));
+    ASSERT_EQ(-1, date_string_to_epoch("1977-09-30", &epoch));
+}
+
+TEST(test_validate_date, mission_period)
+{
+    const uint64_t day = 86400000ULL;
+
+    // doy 0 is not a day
+    ASSERT_FALSE(validate_date(12, 1972, 0));
+    ASSERT_FALSE(validate_date(12, 1968, 100 * day));
+    ASSERT_FALSE(validate_date(12, 1978, 100 * day));
+
+    // leap years
+    ASSERT_TRUE(validate_date(-1, 1972, 367 * day - 1));
+    ASSERT_FALSE(validate_date(-1, 1972, 367 * day));
+    ASSERT_FALSE(validate_date(-1, 1973, 366 * day));
+
+    // 11: 1969/202 - 1969/214, 1969/231 - 1969/237
+    ASSERT_FALSE(validate_date(11, 1969, 202 * day - 1));
+    ASSERT_TRUE(validate_date(11, 1969, 202 * day));
+    ASSERT_TRUE(validate_date(11, 1969, 215 * day - 1));
+    ASSERT_FALSE(validate_date(11, 1969, 215 * day));
+    ASSERT_TRUE(validate_date(11, 1969, 231 * day));
+    ASSERT_FALSE(validate_date(11, 1969, 238 * day));
+    ASSERT_FALSE(validate_date(11, 1970, 202 * day));
+
+    // 12: 1969/323-1977/273
+    ASSERT_FALSE(validate_date(12, 1969, 323 * day - 1));
+    ASSERT_TRUE(validate_date(12, 1969, 323 * day));
+    ASSERT_TRUE(validate_date(12, 1977, 274 * day - 1));
+    ASSERT_FALSE(validate_date(12, 1977, 274 * day));
+
+    // 16: 1972/112-1977/273, 17: 1976/061-1977/273
+    ASSERT_FALSE(validate_date(16, 1972, 111 * day));
+    ASSERT_TRUE(validate_date(16, 1972, 366 * day));
+    ASSERT_FALSE(validate_date(17, 1975, 100 * day));
+    ASSERT_TRUE(validate_date(17, 1976, 61 * day));
+
+    // other stations: the days of the year only
+    ASSERT_TRUE(validate_date(13, 1969, 1 * day));
+    ASSERT_TRUE(validate_date(99, 1977, 365 * day));
+}
+
 int main(int argc, char **argv)
 {
     ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+extern "C"
+{
+#include <stdint.h>
+#include "wth.h"
+#include "wth_unpack.h"
+}
+
+// per-field shift/mask code of binary2wth_frame() before wth_unpack_groups()
+static void reference(const unsigned char *frame, wth_frame *whf)
+{
+    for (int i = 1; i < 20; ++i) {
+        int j = (i + 2) * 4;
+        int part1 = frame[j] >> 1;
+        part1 <<= 1;
+        int part2 = frame[j] & 0x01;
+        part2 = (part2 << 6) | (frame[j + 1] >> 2);
+        part2 <<= 1;
+        int part3 = frame[j + 1] & 0x03;
+        part3 = (part3 << 5) | (frame[j + 2] >> 3);
+        part3 <<= 1;
+        int part4 = frame[j + 2] & 0x07;
+        part4 = (part4 << 4) | (frame[j + 3] >> 4);
+        part4 <<= 1;
+        whf->dp1[i] = part1;
+        whf->dp6[i] = part2;
+        whf->dp11[i] = part3;
+        whf->dp16[i] = part4;
+        whf->status[i] = (frame[j + 3] >> 2) & 0x03;
+    }
+}
+
+static std::vector<unsigned char> random_frames(int n)
+{
+    std::mt19937 gen(20261018);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::vector<unsigned char> frames(SIZE_FRAME * n);
+    for (auto &b : frames) {
+        b = static_cast<unsigned char>(byte(gen));
+    }
+    // extreme patterns
+    if (n >= 2) {
+        std::fill(frames.begin(), frames.begin() + SIZE_FRAME, 0x00);
+        std::fill(frames.begin() + SIZE_FRAME, frames.begin() + SIZE_FRAME * 2, 0xff);
+    }
+    return frames;
+}
+
+static void check_isa(int isa)
+{
+    const int n = 1000;
+    std::vector<unsigned char> frames = random_frames(n);
+
+    ASSERT_EQ(0, wth_unpack_set_isa(isa));
+    ASSERT_EQ(isa, wth_unpack_isa());
+    for (int k = 0; k < n; k++) {
+        const unsigned char *frame = &frames[SIZE_FRAME * k];
+        wth_frame expected = {}, actual = {};
+        reference(frame, &expected);
+        wth_unpack_groups(frame, &actual.dp1[1], &actual.dp6[1], &actual.dp11[1],
+                          &actual.dp16[1], &actual.status[1]);
+        for (int i = 1; i < 20; i++) {
+            ASSERT_EQ(expected.dp1[i], actual.dp1[i]) << "frame " << k << " word " << i;
+            ASSERT_EQ(expected.dp6[i], actual.dp6[i]) << "frame " << k << " word " << i;
+            ASSERT_EQ(expected.dp11[i], actual.dp11[i]) << "frame " << k << " word " << i;
+            ASSERT_EQ(expected.dp16[i], actual.dp16[i]) << "frame " << k << " word " << i;
+            ASSERT_EQ(expected.status[i], actual.status[i]) << "frame " << k << " word " << i;
+        }
+        // word 0 is left to binary2wth_frame()
+        ASSERT_EQ(0, actual.dp1[0]);
+        ASSERT_EQ(0, actual.status[0]);
+    }
+    wth_unpack_set_isa(CPU_ISA_AUTO);
+}
+
+TEST(test_wth_unpack, scalar)
+{
+    check_isa(CPU_ISA_SCALAR);
+}
+
+TEST(test_wth_unpack, ssse3)
+{
+    if (wth_unpack_set_isa(CPU_ISA_SSSE3) != 0) {
+        GTEST_SKIP() << "SSSE3 is not supported";
+    }
+    check_isa(CPU_ISA_SSSE3);
+}
+
+TEST(test_wth_unpack, avx2)
+{
+    if (wth_unpack_set_isa(CPU_ISA_AVX2) != 0) {
+        GTEST_SKIP() << "AVX2 is not supported";
+    }
+    check_isa(CPU_ISA_AVX2);
+}
+
+TEST(test_wth_unpack, invalid_isa)
+{
+    ASSERT_EQ(-1, wth_unpack_set_isa(CPU_ISA_AVX2 + 1));
+    ASSERT_EQ(-1, wth_unpack_set_isa(CPU_ISA_SSE42));
+    ASSERT_EQ(0, wth_unpack_set_isa(CPU_ISA_AUTO));
+}
+
+TEST(test_wth_unpack, frame)
+{
+    std::vector<unsigned char> frames = random_frames(1);
+    wth_record whr = {};
+    wth_frame expected = {};
+    reference(frames.data(), &expected);
+    wth_frame whf = binary2wth_frame(whr, frames.data());
+    for (int i = 1; i < 20; i++) {
+        ASSERT_EQ(expected.dp16[i], whf.dp16[i]);
+        ASSERT_EQ(expected.status[i], whf.status[i]);
+    }
+    ASSERT_EQ(-1, whf.status[0]);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <vector>
+
+extern "C"
+{
+#include <sys/types.h>
+#include "define.h"
+#include "util.h"
+#include "wtn_demux.h"
+}
+
+static wtn_frame make_frame(uint32_t package_id, uint32_t frame_count, int64_t msec)
+{
+    wtn_frame wnf = {};
+    wnf.alsep_package_id = package_id;
+    wnf.frame_count = frame_count;
+    wnf.msec_of_year = msec;
+    for (int i = 0; i < COUNTS_PER_FRAME_FOR_WTN_SP; i++) {
+        wnf.spz[i] = 500 + static_cast<int32_t>(package_id) * 10 + i;
+    }
+    return wnf;
+}
+
+TEST(test_wtn_demux, dropout)
+{
+    wtn_demux d;
+    std::vector<wtn_frame> wnf;
+
+    // stations 12 (1), 15 (2), 16 (3) interleaved, 15 drops one frame
+    wnf.push_back(make_frame(1, 0, 1000));
+    wnf.push_back(make_frame(2, 0, 1001));
+    wnf.push_back(make_frame(3, 0, 1002));
+    wnf.push_back(make_frame(1, 1, 1604));
+    wnf.push_back(make_frame(3, 1, 1606));
+    wnf.push_back(make_frame(1, 2, 2208));
+    wnf.push_back(make_frame(2, 2, 2209));
+
+    wtn_demux_init(&d);
+    wtn_demux_frames(&d, wnf.data(), static_cast<int>(wnf.size()));
+
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(wnf[i].msec_of_year, wnf[i].time_diff);
+        ASSERT_EQ(static_cast<uint32_t>(FLAG_FIRST_DATA_COPIED), wnf[i].process_flag);
+        ASSERT_EQ(wnf[i].spz[1], wnf[i].spz[0]);
+    }
+
+    // a fixed stride of 3 would link the frame of 16 to the frame of 12
+    ASSERT_EQ(604, wnf[4].time_diff);
+    ASSERT_EQ(0U, wnf[4].prev_frame);
+    ASSERT_EQ(0U, wnf[4].process_flag);
+    ASSERT_EQ(interp(wnf[2].spz[30], wnf[2].spz[31], wnf[4].spz[1], wnf[4].spz[2]), wnf[4].spz[0]);
+
+    // 15 is linked over its dropout
+    ASSERT_EQ(1208, wnf[6].time_diff);
+    ASSERT_EQ(0U, wnf[6].prev_frame);
+    ASSERT_EQ(0U, wnf[6].process_flag);
+}
+
+TEST(test_wtn_demux, lsg)
+{
+    wtn_demux d;
+    wtn_frame a = make_frame(ALSEP_PACKAGE_ID_APOLLO_17, 5, 1000);
+    wtn_frame b = make_frame(ALSEP_PACKAGE_ID_APOLLO_17, 6, 1604);
+
+    wtn_demux_init(&d);
+    ASSERT_EQ(5, wtn_demux_link(&d, &a));
+    ASSERT_EQ(5, wtn_demux_link(&d, &b));
+
+    // no SP data in the frames of 17
+    ASSERT_EQ(0U, a.process_flag);
+    ASSERT_EQ(500 + 50, a.spz[0]);
+    ASSERT_EQ(604, b.time_diff);
+    ASSERT_EQ(5U, b.prev_frame);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}